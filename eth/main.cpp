@@ -35,11 +35,16 @@
 #include <boost/filesystem.hpp>
 
 #include <libdevcore/FileSystem.h>
+#include <libdevcore/NodeCache.h>
+#include <libdevcore/PersistenceWriter.h>
 #include <libdevcore/easylog.h>
 
 //#include <libethashseal/EthashAux.h>
 #include <libevm/VM.h>
 #include <libevm/VMFactory.h>
+#if ETH_EVMJIT
+#include <libevm/JitScheduler.h>
+#endif
 #include <libethcore/KeyManager.h>
 #include <libethcore/ICAP.h>
 #include <libethereum/All.h>
@@ -1273,7 +1278,12 @@ int main(int argc, char** argv)
 	else if (chainParams.vmKind == "jit")
 		VMFactory::setKind(VMKind::JIT);
 	else if (chainParams.vmKind == "smart")
+	{
 		VMFactory::setKind(VMKind::Smart);
+#if ETH_EVMJIT
+		JitScheduler::instance().configure(chainParams.jitThreshold, chainParams.dataDir + "/jithot.rlp");
+#endif
+	}
 	else if (chainParams.vmKind == "dual")
 		VMFactory::setKind(VMKind::Dual);
 	else
@@ -1364,6 +1374,9 @@ int main(int argc, char** argv)
 		}
 	}
 
+	dev::setNodeCacheSize(static_cast<size_t>(chainParams.stateCacheSize) * 1024 * 1024);
+	dev::PersistenceWriter::instance().setAsync(chainParams.asyncPersist);
+
 	//auto nodesState = contents(getDataDir() + "/network.rlp");
 	//添加落盘加密代码
 	bytes nodesState;
@@ -1405,6 +1418,7 @@ int main(int argc, char** argv)
 	);
 
 	channelServer->setHost(web3.ethereum()->host());
+	channelServer->setClient(web3.ethereum());
 	web3.ethereum()->host().lock()->setWeb3Observer(channelServer->buildObserver());
 
 	cout << "NodeID=" << toString(web3.id()) << "\n";
@@ -1835,6 +1849,8 @@ int main(int argc, char** argv)
 
 			channelServer->setListenAddr(chainParams.listenIp);
 			channelServer->setListenPort(chainParams.channelPort);
+			channelServer->setReadSize(chainParams.channelReadSize);
+			channelServer->setWorkerThreads(chainParams.channelWorkers);
 			channelModularServer->addConnector(channelServer.get());
 
 			LOG(TRACE) << "channelServer启动 IP:" << chainParams.listenIp << " Port:" << chainParams.channelPort;
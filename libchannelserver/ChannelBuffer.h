@@ -0,0 +1,98 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: ChannelBuffer.h
+ * @author: fisco-dev
+ * 
+ * @date: 2017
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <libdevcore/Common.h>
+
+namespace dev
+{
+
+namespace channel {
+
+/**
+ * 接收缓冲区：socket直接读入空闲尾部，消息在缓冲区内原地解析。
+ * 已解析的数据只移动读指针，读空时回到起点；尾部空间不足时才把剩余数据搬到头部，
+ * 不足再按倍数扩容，流水线请求下每字节摊还O(1)。
+ */
+class ChannelBuffer {
+public:
+	explicit ChannelBuffer(size_t readSize): _readSize(std::max(readSize, size_t(c_minReadSize))) {}
+
+	/// 可读数据
+	bytesConstRef data() const { return bytesConstRef(_buffer.data() + _begin, _end - _begin); }
+	size_t size() const { return _end - _begin; }
+
+	/// 返回至少readSize字节的空闲空间，供下一次read写入
+	bytesRef prepare() {
+		if (_buffer.size() - _end < _readSize) {
+			if (_begin > 0) {
+				std::memmove(_buffer.data(), _buffer.data() + _begin, _end - _begin);
+				_end -= _begin;
+				_begin = 0;
+			}
+
+			if (_buffer.size() - _end < _readSize) {
+				_buffer.resize(std::max(_end + _readSize, _buffer.size() * 2));
+			}
+		}
+
+		return bytesRef(_buffer.data() + _end, _buffer.size() - _end);
+	}
+
+	/// read完成后提交写入的字节数
+	void commit(size_t bytesTransferred) { _end += bytesTransferred; }
+
+	/// 丢弃头部已解析的数据
+	void consume(size_t length) {
+		_begin += length;
+		if (_begin == _end) {
+			_begin = _end = 0;
+
+			//大包处理完后释放扩出来的空间
+			if (_buffer.size() > c_shrinkFactor * _readSize) {
+				bytes().swap(_buffer);
+			}
+		}
+	}
+
+	size_t readSize() const { return _readSize; }
+	void setReadSize(size_t readSize) { _readSize = std::max(readSize, size_t(c_minReadSize)); }
+
+	/// readSize为0时read会立即返回0字节并不断重试
+	static const size_t c_minReadSize = 1024;
+
+private:
+	static const size_t c_shrinkFactor = 16;
+
+	bytes _buffer;
+	size_t _begin = 0;
+	size_t _end = 0;
+	size_t _readSize;
+};
+
+}
+
+}
@@ -73,7 +73,7 @@ struct Message {
 
 		length = ntohl(*((uint32_t*)&buffer[0]));
 
-		if(length > MAX_LENGTH) {
+		if(length > MAX_LENGTH || length < HEADER_LENGTH) {
 			return -1;
 		}
 
@@ -82,7 +82,6 @@ struct Message {
 		}
 
 		type = ntohs(*((uint16_t*)&buffer[4]));
-		seq = ntohl(*((uint32_t*)&buffer[6]));
 		seq.assign(&buffer[6], &buffer[6] + 32);
 		result = ntohl(*((uint32_t*)&buffer[38]));
 
@@ -33,6 +33,9 @@ using namespace dev::channel;
 using namespace std;
 
 void dev::channel::ChannelServer::run() {
+	_threadPool = std::make_shared<dev::ThreadPool>("channel", _workerThreads);
+	LOG(INFO) << "channel请求处理线程数:" << _threadPool->size() << " read大小:" << _readSize;
+
 	//是否监听
 	if (!_listenHost.empty() && _listenPort > 0) {
 		_acceptor = std::make_shared<boost::asio::ip::tcp::acceptor>(*_ioService, boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string(_listenHost), _listenPort));
@@ -105,6 +108,8 @@ void dev::channel::ChannelServer::onAccept(const boost::system::error_code& erro
 void dev::channel::ChannelServer::startAccept() {
 	try {
 		ChannelSession::Ptr session = std::make_shared<ChannelSession>();
+		session->setReadSize(_readSize);
+		session->setThreadPool(_threadPool);
 
 		if (_enableSSL) {
 			session->setSSLSocket(std::make_shared<boost::asio::ssl::stream<boost::asio::ip::tcp::socket> >(*_ioService, *_sslContext));
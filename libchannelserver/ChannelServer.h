@@ -32,6 +32,7 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <libdevcore/FixedHash.h>
+#include <libdevcore/ThreadPool.h>
 
 #include "ChannelException.h"
 #include "ChannelSession.h"
@@ -61,6 +62,14 @@ public:
 	void setIOService(std::shared_ptr<boost::asio::io_service> ioService) { _ioService = ioService; };
 	void setSSLContext(std::shared_ptr<boost::asio::ssl::context> sslContext) { _sslContext = sslContext; };
 
+	void setReadSize(size_t readSize) { _readSize = readSize; };
+
+	//请求处理线程数，0为CPU核数
+	void setWorkerThreads(unsigned workerThreads) { _workerThreads = workerThreads; };
+
+	//请求处理线程池，run()之后可用
+	std::shared_ptr<dev::ThreadPool> threadPool() { return _threadPool; };
+
 	void stop();
 
 private:
@@ -71,6 +80,11 @@ private:
 
 	std::vector<std::shared_ptr<std::thread> > _serverThreads;
 
+	//所有session共用的请求处理线程池
+	std::shared_ptr<dev::ThreadPool> _threadPool;
+	unsigned _workerThreads = 0;
+	size_t _readSize = ChannelSession::c_defaultReadSize;
+
 	std::shared_ptr<boost::asio::ip::tcp::acceptor> _acceptor;
 
 	std::function<void(dev::channel::ChannelException, ChannelSession::Ptr)> _connectionHandler;
@@ -33,6 +33,11 @@
 using namespace dev::channel;
 using namespace std;
 
+//单个session排队等待处理的消息上限，超过后暂停read，处理到一半以下时恢复
+static const size_t c_maxPendingMessages = 1024;
+//每个处理任务最多连续处理的消息数，之后让出线程给其它session
+static const size_t c_dispatchBatch = 32;
+
 ChannelSession::ChannelSession() {
 	_topics = std::make_shared<std::set<std::string> >();
 }
@@ -135,6 +140,24 @@ void ChannelSession::asyncSendMessage(Message::Ptr request, std::function<void(d
 	}
 }
 
+void ChannelSession::asyncSendMessages(std::vector<Message::Ptr> const& messages) {
+	try {
+		if (!_actived || messages.empty()) {
+			return;
+		}
+
+		std::shared_ptr<bytes> buffer = std::make_shared<bytes>();
+		for (auto const& message : messages) {
+			message->encode(*buffer);
+		}
+
+		writeBuffer(buffer);
+	}
+	catch (exception &e) {
+		LOG(ERROR) << "错误:" << e.what();
+	}
+}
+
 void ChannelSession::handshake(bool enableSSL, bool isServer) {
 	if (enableSSL) {
 		if (isServer) {
@@ -192,12 +215,12 @@ void ChannelSession::onHandshake(const boost::system::error_code& error) {
 void ChannelSession::startRead() {
 	try {
 		if (_actived) {
-			LOG(TRACE) << "开始read:" << bufferLength;
-
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
 
-			auto session = shared_from_this();
-			_sslSocket->async_read_some(boost::asio::buffer(_recvBuffer, bufferLength),
+			auto buffer = _recvBuffer.prepare();
+			LOG(TRACE) << "开始read:" << buffer.size();
+
+			_sslSocket->async_read_some(boost::asio::buffer(buffer.data(), buffer.size()),
 			                            boost::bind(&ChannelSession::onRead, shared_from_this(), boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred));
 		}
 	}
@@ -212,14 +235,15 @@ void ChannelSession::onRead(const boost::system::error_code& error, size_t bytes
 		updateIdleTimer();
 
 		if (!error) {
-			LOG(TRACE) << "读取: " << bytesTransferred << " 字节 数据:" << std::string(_recvBuffer, _recvBuffer + bytesTransferred);
+			LOG(TRACE) << "读取: " << bytesTransferred << " 字节";
 
-			//成功读取bytesTransferred字节
-			_recvProtocolBuffer.insert(_recvProtocolBuffer.end(), _recvBuffer, _recvBuffer + bytesTransferred);
+			//成功读取bytesTransferred字节，数据已在_recvBuffer尾部
+			_recvBuffer.commit(bytesTransferred);
 
 			while (true) { //上限设置
 				auto message = std::make_shared<Message>();
-				ssize_t result = message->decode(_recvProtocolBuffer.data(), _recvProtocolBuffer.size());
+				auto data = _recvBuffer.data();
+				ssize_t result = message->decode(data.data(), data.size());
 				LOG(TRACE) << "协议解析结果: " << result;
 
 
@@ -230,11 +254,22 @@ void ChannelSession::onRead(const boost::system::error_code& error, size_t bytes
 					onMessage(ChannelException(0, ""), message);
 
 					//移除已解析数据
-					_recvProtocolBuffer.erase(_recvProtocolBuffer.begin(), _recvProtocolBuffer.begin() + result);
+					_recvBuffer.consume(result);
 				}
 				else if (result == 0) {
-					//包尚未接收完毕，继续读
-					startRead();
+					//包尚未接收完毕，继续读；待处理消息过多时等线程池处理后再读
+					bool paused = false;
+					{
+						std::lock_guard<std::mutex> lock(_dispatchMutex);
+						paused = _readPaused = _dispatchQueue.size() >= c_maxPendingMessages;
+					}
+
+					if (!paused) {
+						startRead();
+					}
+					else {
+						LOG(WARNING) << "待处理消息过多，暂停read " << _host << ":" << _port;
+					}
 
 					break;
 				}
@@ -244,12 +279,7 @@ void ChannelSession::onRead(const boost::system::error_code& error, size_t bytes
 
 					disconnect();
 
-					if (_messageHandler) {
-						_messageHandler(ChannelException(-1, "协议解析出错，连接断开"), Message::Ptr());
-					}
-					else {
-						LOG(ERROR) << "messageHandler为空";
-					}
+					dispatch(ChannelException(-1, "协议解析出错，连接断开"), Message::Ptr());
 
 					break;
 				}
@@ -259,7 +289,7 @@ void ChannelSession::onRead(const boost::system::error_code& error, size_t bytes
 			LOG(ERROR) << "read错误:" << error.value() << "," << error.message();
 
 			if (_actived) {
-				_messageHandler(ChannelException(-1, "read失败，连接断开 "), Message::Ptr());
+				dispatch(ChannelException(-1, "read失败，连接断开 "), Message::Ptr());
 				disconnect();
 			}
 		}
@@ -318,12 +348,7 @@ void ChannelSession::onWrite(const boost::system::error_code& error, size_t byte
 			LOG(ERROR) << "write错误: " << error.message();
 
 			if (_actived) {
-				if (_messageHandler) {
-					_messageHandler(ChannelException(-1, "write错误，连接断开"), Message::Ptr());
-				}
-				else {
-					LOG(ERROR) << "messageHandler为空";
-				}
+				dispatch(ChannelException(-1, "write错误，连接断开"), Message::Ptr());
 
 				disconnect();
 			}
@@ -353,17 +378,80 @@ void ChannelSession::onMessage(ChannelException e, Message::Ptr message) {
 			_responseCallbacks.erase(it);
 		}
 		else {
+			dispatch(ChannelException(0, ""), message);
+		}
+	}
+	catch (exception &e) {
+		LOG(ERROR) << "错误:" << e.what();
+	}
+}
+
+void ChannelSession::dispatch(ChannelException e, Message::Ptr message) {
+	if (!_threadPool) {
+		if (_messageHandler) {
+			_messageHandler(e, message);
+		}
+		else {
+			LOG(ERROR) << "messageHandler为空";
+		}
+
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(_dispatchMutex);
+	_dispatchQueue.push(std::make_pair(e, message));
+
+	//同一时刻每个session只有一个处理任务，保证消息按到达顺序处理
+	if (!_dispatching) {
+		_dispatching = true;
+
+		auto session = shared_from_this();
+		_threadPool->enqueue([session]() { session->onDispatch(); });
+	}
+}
+
+void ChannelSession::onDispatch() {
+	for (size_t i = 0; i < c_dispatchBatch; ++i) {
+		std::pair<ChannelException, Message::Ptr> item;
+		bool resumeRead = false;
+		{
+			std::lock_guard<std::mutex> lock(_dispatchMutex);
+			if (_dispatchQueue.empty()) {
+				_dispatching = false;
+				return;
+			}
+
+			item = _dispatchQueue.front();
+			_dispatchQueue.pop();
+
+			if (_readPaused && _dispatchQueue.size() < c_maxPendingMessages / 2) {
+				_readPaused = false;
+				resumeRead = true;
+			}
+		}
+
+		if (resumeRead) {
+			//socket操作回到IO线程
+			auto session = shared_from_this();
+			_sslSocket->get_io_service().post([session]() { session->startRead(); });
+		}
+
+		try {
 			if (_messageHandler) {
-				_messageHandler(ChannelException(0, ""), message);
+				_messageHandler(item.first, item.second);
 			}
 			else {
 				LOG(ERROR) << "messageHandler为空";
 			}
 		}
+		catch (exception &e) {
+			LOG(ERROR) << "处理消息错误:" << e.what();
+		}
 	}
-	catch (exception &e) {
-		LOG(ERROR) << "错误:" << e.what();
-	}
+
+	//本批处理完仍有消息，重新排队，让其它session也能得到线程
+	auto session = shared_from_this();
+	_threadPool->enqueue([session]() { session->onDispatch(); });
 }
 
 void ChannelSession::onTimeout(const boost::system::error_code& error, std::string seq) {
@@ -390,15 +478,19 @@ void ChannelSession::onTimeout(const boost::system::error_code& error, std::stri
 void ChannelSession::onIdle(const boost::system::error_code& error) {
 	try {
 		if (error != boost::asio::error::operation_aborted) {
+			{
+				//暂停read期间不算空闲
+				std::lock_guard<std::mutex> lock(_dispatchMutex);
+				if (_readPaused) {
+					updateIdleTimer();
+					return;
+				}
+			}
+
 			//空闲超时，断开连接
 			LOG(ERROR) << "连接空闲，断开本连接 " << _host << ":" << _port;
 
-			if (_messageHandler) {
-				_messageHandler(ChannelException(-1, "连接空闲，断开"), Message::Ptr());
-			}
-			else {
-				LOG(ERROR) << "_messageHandler为空";
-			}
+			dispatch(ChannelException(-1, "连接空闲，断开"), Message::Ptr());
 
 			disconnect();
 		}
@@ -30,11 +30,13 @@
 #include <libdevcore/easylog.h>
 
 #include <libdevcore/FixedHash.h>
+#include <libdevcore/ThreadPool.h>
 #include <boost/asio.hpp>
 #include <boost/asio/ssl/stream.hpp>
 #include <boost/asio/ssl.hpp>
 #include "ChannelMessage.h"
 #include "ChannelException.h"
+#include "ChannelBuffer.h"
 
 namespace dev
 {
@@ -43,6 +45,8 @@ namespace channel {
 
 class ChannelSession: public std::enable_shared_from_this<ChannelSession> {
 public:
+	static const size_t c_defaultReadSize = 16 * 1024;
+
 	ChannelSession();
 	virtual ~ChannelSession() {
 		LOG(DEBUG) << "session退出";
@@ -51,10 +55,10 @@ public:
 	typedef std::shared_ptr<ChannelSession> Ptr;
 	typedef std::function<void(dev::channel::ChannelException, dev::channel::Message::Ptr)> CallbackType;
 
-	const size_t bufferLength = 1024;
-
 	virtual Message::Ptr sendMessage(Message::Ptr request, size_t timeout = 0) throw(ChannelException);
 	virtual void asyncSendMessage(Message::Ptr request, std::function<void(dev::channel::ChannelException, Message::Ptr)> callback, uint32_t timeout = 0);
+	//多个无需回包的消息合并为一次write
+	virtual void asyncSendMessages(std::vector<Message::Ptr> const& messages);
 
 	virtual void handshake(bool enableSSL, bool isServer);
 	virtual void run();
@@ -77,6 +81,12 @@ public:
 
 	virtual void setIOService(std::shared_ptr<boost::asio::io_service> IOService) { _ioService = IOService; };
 
+	//每次read的字节数
+	virtual void setReadSize(size_t readSize) { _recvBuffer.setReadSize(readSize); };
+
+	//设置后，收到的请求在线程池中按到达顺序逐个处理，不占用IO线程；未设置时在IO线程中直接处理
+	virtual void setThreadPool(std::shared_ptr<dev::ThreadPool> threadPool) { _threadPool = threadPool; };
+
 	std::shared_ptr<std::set<std::string> > topics() { return _topics; };
 	void setTopics(std::shared_ptr<std::set<std::string> > topics) { _topics = topics; };
 
@@ -91,6 +101,10 @@ private:
 	void writeBuffer(std::shared_ptr<bytes> buffer);
 
 	void onMessage(dev::channel::ChannelException e, Message::Ptr message);
+
+	//把消息交给messageHandler，同一session的消息按顺序处理
+	void dispatch(dev::channel::ChannelException e, Message::Ptr message);
+	void onDispatch();
 	void onTimeout(const boost::system::error_code& error, std::string seq);
 
 	void onIdle(const boost::system::error_code& error);
@@ -106,8 +120,13 @@ private:
 	std::string _host;
 	int _port = 0;
 
-	byte _recvBuffer[1024];
-	bytes _recvProtocolBuffer;
+	ChannelBuffer _recvBuffer{c_defaultReadSize};
+
+	std::shared_ptr<dev::ThreadPool> _threadPool;
+	std::queue<std::pair<dev::channel::ChannelException, Message::Ptr> > _dispatchQueue;
+	bool _dispatching = false; //是否已有处理任务在线程池中
+	bool _readPaused = false; //待处理消息过多时暂停read
+	std::mutex _dispatchMutex;
 
 	std::queue<std::shared_ptr<bytes> > _sendBufferList;
 	bool _writing = false;
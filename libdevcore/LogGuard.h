@@ -22,6 +22,7 @@
  */
 
 #pragma once
+#include <chrono>
 #include "StateMonitor.h"
 #include "easylog.h"
 #include "StatCommon.h"
@@ -38,30 +39,35 @@ protected:
 
     virtual ~LogGuard() {}
 
+    //构造到析构的耗时(ms)
+    double elapsed() const { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count(); }
+
 protected:
     std::string m_tag;
+    std::chrono::steady_clock::time_point m_start = std::chrono::steady_clock::now();
 };
 
 class TimeIntervalLogGuard : public LogGuard
 {
 public:
     TimeIntervalLogGuard(const int _code, const std::string _tag, uint64_t _interval) 
-        : LogGuard{_tag}, m_code{_code}
+        : LogGuard{_tag}, m_code{_code}, m_interval{_interval}
     {
-        if (_interval <= 0) 
+        if (m_interval <= 0) 
         {
-            _interval = 10; // 10s
+            m_interval = 10; // 10s
         }
-        statemonitor::recordStateByTimeStart(m_code, _interval);
     }
     virtual ~TimeIntervalLogGuard() 
     {
-        statemonitor::recordStateByTimeEnd(m_code, move(m_tag), m_sstr.str(), m_success);
+        //耗时由guard自己计时，不经过按child_code记录start的全局表
+        statemonitor::recordStateByTimeOnce(m_code, m_interval, elapsed(), move(m_tag), m_sstr.str(), m_success);
     }   
 protected:
     int m_success = 1;
 private:
     int m_code;
+    uint64_t m_interval;
 };
 
 
@@ -69,22 +75,22 @@ class CountIntervalLogGuard : public LogGuard
 {
 public:
     CountIntervalLogGuard(const int _code, const std::string _tag, uint64_t _count) 
-        : LogGuard{_tag}, m_code{_code}
+        : LogGuard{_tag}, m_code{_code}, m_count{_count}
     {
-        if (_count <= 0) 
+        if (m_count <= 0) 
         {
-            _count = 10; // 10s
+            m_count = 10; // 10s
         }
-        statemonitor::recordStateByNumStart(m_code, _count);
     }
     virtual ~CountIntervalLogGuard() 
     {
-        statemonitor::recordStateByNumEnd(m_code, move(m_tag), m_sstr.str());
+        statemonitor::recordStateByNumOnce(m_code, m_count, elapsed(), move(m_tag), m_sstr.str());
     }
 protected:
     int m_success = 1;
 private:
     int m_code;
+    uint64_t m_count;
 };
 
 class NormalLogGuard : public CountIntervalLogGuard 
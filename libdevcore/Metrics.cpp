@@ -0,0 +1,211 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: Metrics.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2017
+ */
+
+#include "Metrics.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+#include "StatCommon.h"
+#include "StateMonitor.h"
+
+using namespace std;
+using namespace dev;
+using namespace dev::metrics;
+
+namespace
+{
+
+struct Family
+{
+	string help;
+	map<string, unique_ptr<Counter>> counters;	///< By label set.
+};
+
+mutex x_counters;
+map<string, Family> s_counters;
+
+enum class Unit { Latency, Size, Plain };
+
+/// How a statemonitor code is exported.
+struct StatFamily
+{
+	string name;
+	string help;
+	Unit unit;
+	string labels;
+};
+
+/// @returns false for codes that are not exported (error and free-form message logs).
+bool statFamily(int _code, StatFamily& _f)
+{
+	if (_code >= StatCode::BROADCAST_TX_SIZE && _code < StatCode::BROADCAST_TX_SIZE + 10000)
+	{
+		_f = StatFamily{"fisco_broadcast_tx_bytes", "Size of transaction broadcast packets per peer", Unit::Size, "idx=\"" + to_string(_code - StatCode::BROADCAST_TX_SIZE) + "\""};
+		return true;
+	}
+	if (_code >= StatCode::BROADCAST_BLOCK_SIZE && _code < StatCode::BROADCAST_BLOCK_SIZE + 10000)
+	{
+		_f = StatFamily{"fisco_broadcast_block_bytes", "Size of block broadcast packets per peer", Unit::Size, "idx=\"" + to_string(_code - StatCode::BROADCAST_BLOCK_SIZE) + "\""};
+		return true;
+	}
+
+	static char const* const c_pbft = "PBFT phase latency in milliseconds";
+	switch (_code)
+	{
+	case StatCode::DB_GET: _f = StatFamily{"fisco_db_get_latency_ms", "State DB lookup latency in milliseconds", Unit::Latency, ""}; return true;
+	case StatCode::DB_SET: _f = StatFamily{"fisco_db_set_latency_ms", "State DB commit latency in milliseconds", Unit::Latency, ""}; return true;
+	case StatCode::DB_GET_SIZE: _f = StatFamily{"fisco_db_get_bytes", "Size of values read from the state DB", Unit::Size, ""}; return true;
+	case StatCode::DB_SET_SIZE: _f = StatFamily{"fisco_db_set_bytes", "Size of state DB commits", Unit::Size, ""}; return true;
+	case StatCode::DB_HIT_MEM: _f = StatFamily{"fisco_db_mem_lookup_latency_ms", "Latency of state DB lookups that may be served from memory, in milliseconds", Unit::Latency, ""}; return true;
+	case StatCode::TX_EXEC: _f = StatFamily{"fisco_tx_exec_latency_ms", "Transaction execution latency in milliseconds", Unit::Latency, ""}; return true;
+	case StatCode::TX_TRACE: _f = StatFamily{"fisco_tx_onchain_latency_ms", "Latency from receiving a transaction to having it on chain, in milliseconds", Unit::Latency, ""}; return true;
+	case StatCode::BLOCK_SEAL: _f = StatFamily{"fisco_pbft_phase_latency_ms", c_pbft, Unit::Latency, "phase=\"seal\""}; return true;
+	case StatCode::BLOCK_EXEC: _f = StatFamily{"fisco_pbft_phase_latency_ms", c_pbft, Unit::Latency, "phase=\"exec\""}; return true;
+	case StatCode::BLOCK_SIGN: _f = StatFamily{"fisco_pbft_phase_latency_ms", c_pbft, Unit::Latency, "phase=\"sign\""}; return true;
+	case StatCode::BLOCK_COMMIT: _f = StatFamily{"fisco_pbft_phase_latency_ms", c_pbft, Unit::Latency, "phase=\"commit\""}; return true;
+	case StatCode::BLOCK_BLKTOCHAIN: _f = StatFamily{"fisco_pbft_phase_latency_ms", c_pbft, Unit::Latency, "phase=\"blktochain\""}; return true;
+	case StatCode::BLOCK_VIEWCHANG: _f = StatFamily{"fisco_pbft_phase_latency_ms", c_pbft, Unit::Latency, "phase=\"viewchange\""}; return true;
+	case StatCode::BLOCK_PACK_PREDICT: _f = StatFamily{"fisco_block_pack_predict_error_percent", "Relative error of the predicted block execution time, in percent", Unit::Plain, ""}; return true;
+	default: return false;
+	}
+}
+
+/// Histogram bucket bounds, fixed so that series stay comparable across scrapes and nodes.
+vector<double> const& bounds(Unit _u)
+{
+	static vector<double> const c_latency{0.1, 0.5, 1, 2.5, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000};
+	static vector<double> const c_size{64, 256, 1024, 4096, 16384, 65536, 262144, 1048576, 4194304, 16777216};
+	return _u == Unit::Size ? c_size : c_latency;
+}
+
+string join(string const& _labels, string const& _more)
+{
+	if (_labels.empty())
+		return _more;
+	if (_more.empty())
+		return _labels;
+	return _labels + "," + _more;
+}
+
+string formatBound(double _b)
+{
+	ostringstream s;
+	s << _b;
+	return s.str();
+}
+
+}
+
+Counter& dev::metrics::counter(string const& _name, string const& _help, string const& _labels)
+{
+	lock_guard<mutex> l(x_counters);
+	Family& f = s_counters[_name];
+	if (f.help.empty())
+		f.help = _help;
+	unique_ptr<Counter>& c = f.counters[_labels];
+	if (!c)
+		c.reset(new Counter);
+	return *c;
+}
+
+void dev::metrics::writeHeader(ostream& _out, string const& _name, string const& _help, char const* _type)
+{
+	_out << "# HELP " << _name << " " << _help << "\n";
+	_out << "# TYPE " << _name << " " << _type << "\n";
+}
+
+void dev::metrics::writeSample(ostream& _out, string const& _name, string const& _labels, double _value)
+{
+	_out << _name;
+	if (!_labels.empty())
+		_out << "{" << _labels << "}";
+	_out << " " << _value << "\n";
+}
+
+string dev::metrics::render()
+{
+	ostringstream out;
+	out.precision(15);
+
+	{
+		lock_guard<mutex> l(x_counters);
+		for (auto const& f : s_counters)
+		{
+			writeHeader(out, f.first, f.second.help, "counter");
+			for (auto const& c : f.second.counters)
+				writeSample(out, f.first, c.first, c.second->value());
+		}
+	}
+
+	// Families must be contiguous in the output, so group the statemonitor series first.
+	struct Series
+	{
+		StatFamily family;
+		statemonitor::MetricSnapshot data;
+	};
+	map<string, vector<Series>> families;
+	for (auto& m : statemonitor::collectMetrics())
+	{
+		StatFamily f;
+		if (statFamily(m.code, f))
+			families[f.name].push_back(Series{f, move(m)});
+	}
+
+	for (auto const& i : families)
+	{
+		Unit unit = i.second.front().family.unit;
+		writeHeader(out, i.first, i.second.front().family.help, unit == Unit::Plain ? "summary" : "histogram");
+		for (auto const& s : i.second)
+		{
+			string const& labels = s.family.labels;
+			if (unit != Unit::Plain)
+			{
+				vector<double> const& b = bounds(unit);
+				vector<uint64_t> cumulative(b.size(), 0);
+				for (unsigned k = 0; k < s.data.buckets.size(); ++k)
+					if (s.data.buckets[k])
+					{
+						double v = statemonitor::Histogram::valueOf(k);
+						for (unsigned j = 0; j < b.size(); ++j)
+							if (v <= b[j])
+								cumulative[j] += s.data.buckets[k];
+					}
+				for (unsigned j = 0; j < b.size(); ++j)
+					writeSample(out, i.first + "_bucket", join(labels, "le=\"" + formatBound(b[j]) + "\""), cumulative[j]);
+				writeSample(out, i.first + "_bucket", join(labels, "le=\"+Inf\""), s.data.record_cnt);
+			}
+			writeSample(out, i.first + "_sum", labels, s.data.data_sum);
+			writeSample(out, i.first + "_count", labels, s.data.record_cnt);
+		}
+	}
+
+	// Successful records per statistic; _count minus this is e.g. failed transactions or DB lookups that missed memory.
+	writeHeader(out, "fisco_stat_success_total", "Records counted as successful, per statistic (e.g. DB lookups served from memory)", "counter");
+	for (auto const& i : families)
+		for (auto const& s : i.second)
+			writeSample(out, "fisco_stat_success_total", join("stat=\"" + i.first + "\"", s.family.labels), s.data.success_cnt);
+
+	return out.str();
+}
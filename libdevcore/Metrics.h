@@ -0,0 +1,61 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: Metrics.h
+ * @author: fisco-dev
+ *
+ * @date: 2017
+ */
+
+#pragma once
+
+#include <atomic>
+#include <ostream>
+#include <string>
+
+namespace dev
+{
+namespace metrics
+{
+
+/// A monotonically increasing value, exported as a Prometheus counter.
+class Counter
+{
+public:
+	void add(uint64_t _n = 1) { m_value.fetch_add(_n, std::memory_order_relaxed); }
+	uint64_t value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<uint64_t> m_value{0};
+};
+
+/// @returns the counter @a _name with the labels @a _labels (e.g. `cap="eth",dir="in"`), created on first use.
+/// Counters live as long as the process, so hot paths should look theirs up once and keep the reference.
+Counter& counter(std::string const& _name, std::string const& _help, std::string const& _labels = std::string());
+
+/// Write the "# HELP" and "# TYPE" lines of a metric family.
+void writeHeader(std::ostream& _out, std::string const& _name, std::string const& _help, char const* _type);
+
+/// Write one sample of a metric family.
+void writeSample(std::ostream& _out, std::string const& _name, std::string const& _labels, double _value);
+
+/// @returns all counters, and the statistics recorded through statemonitor (DB, transaction execution,
+/// PBFT phases, broadcast sizes), in the Prometheus text exposition format.
+std::string render();
+
+}
+}
@@ -0,0 +1,109 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: NodeCache.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2017
+ */
+
+#include "NodeCache.h"
+#include <atomic>
+
+using namespace std;
+using namespace dev;
+
+namespace
+{
+atomic<size_t> s_nodeCacheSize(64 * 1024 * 1024);
+}
+
+void dev::setNodeCacheSize(size_t _bytes)
+{
+	s_nodeCacheSize = _bytes;
+}
+
+size_t dev::getNodeCacheSize()
+{
+	return s_nodeCacheSize;
+}
+
+NodeCache::NodeCache(size_t _capacity):
+	m_shardCapacity(max<size_t>(1, _capacity / c_shards))
+{
+}
+
+bool NodeCache::get(h256 const& _h, string& o_value)
+{
+	Shard& s = shardFor(_h);
+	Guard l(s.lock);
+	auto it = s.index.find(_h);
+	if (it == s.index.end())
+		return false;
+	s.lru.splice(s.lru.begin(), s.lru, it->second);
+	o_value = it->second->second;
+	return true;
+}
+
+void NodeCache::insert(h256 const& _h, string const& _value)
+{
+	// A node larger than a whole shard would only flush it.
+	if (_value.size() > m_shardCapacity)
+		return;
+
+	Shard& s = shardFor(_h);
+	Guard l(s.lock);
+	auto it = s.index.find(_h);
+	if (it != s.index.end())
+	{
+		// Same hash, same content: just refresh.
+		s.lru.splice(s.lru.begin(), s.lru, it->second);
+		return;
+	}
+	s.lru.emplace_front(_h, _value);
+	s.index[_h] = s.lru.begin();
+	s.size += _value.size();
+
+	while (s.size > m_shardCapacity)
+	{
+		auto const& last = s.lru.back();
+		s.size -= last.second.size();
+		s.index.erase(last.first);
+		s.lru.pop_back();
+	}
+}
+
+void NodeCache::remove(h256 const& _h)
+{
+	Shard& s = shardFor(_h);
+	Guard l(s.lock);
+	auto it = s.index.find(_h);
+	if (it == s.index.end())
+		return;
+	s.size -= it->second->second.size();
+	s.lru.erase(it->second);
+	s.index.erase(it);
+}
+
+size_t NodeCache::size() const
+{
+	size_t ret = 0;
+	for (auto const& s: m_shards)
+		DEV_GUARDED(s.lock)
+			ret += s.size;
+	return ret;
+}
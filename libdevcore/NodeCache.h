@@ -0,0 +1,80 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: NodeCache.h
+ * @author: fisco-dev
+ *
+ * @date: 2017
+ */
+
+#pragma once
+
+#include <array>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include "Guards.h"
+#include "FixedHash.h"
+
+namespace dev
+{
+
+/// Sets the capacity in bytes of the node cache of each state database opened afterwards; 0 disables it.
+void setNodeCacheSize(size_t _bytes);
+size_t getNodeCacheSize();
+
+/**
+ * @brief Bounded cache of plaintext trie nodes between OverlayDB and the disk database.
+ * Nodes are keyed by their hash and so never go stale; they only leave the cache when evicted
+ * or explicitly removed. The cache is split into shards by key, each an LRU list under its own
+ * lock, so that readers on different threads rarely contend.
+ */
+class NodeCache
+{
+public:
+	explicit NodeCache(size_t _capacity);
+
+	NodeCache(NodeCache const&) = delete;
+	NodeCache& operator=(NodeCache const&) = delete;
+
+	/// @returns true and sets @a o_value if @a _h is cached.
+	bool get(h256 const& _h, std::string& o_value);
+
+	void insert(h256 const& _h, std::string const& _value);
+	void remove(h256 const& _h);
+
+	/// Total size of the cached values in bytes.
+	size_t size() const;
+
+private:
+	struct Shard
+	{
+		mutable Mutex lock;
+		std::list<std::pair<h256, std::string>> lru;		///< Most recently used first.
+		std::unordered_map<h256, std::list<std::pair<h256, std::string>>::iterator> index;
+		size_t size = 0;
+	};
+
+	static const unsigned c_shards = 16;
+
+	Shard& shardFor(h256 const& _h) { return m_shards[_h[0] % c_shards]; }
+
+	std::array<Shard, c_shards> m_shards;
+	size_t m_shardCapacity;
+};
+
+}
@@ -27,6 +27,7 @@
 #include <libdiskencryption/BatchEncrypto.h>
 #include <libdevcrypto/AES.h>//添加AES加密
 #include "DBStatLog.h"
+#include "PersistenceWriter.h"
 
 using namespace std;
 using namespace dev;
@@ -39,15 +40,12 @@ h256 const EmptyTrie = sha3(rlp(""));
 OverlayDB::~OverlayDB()
 {
 	if (m_db.use_count() == 1 && m_db.get())
+	{
 		LOG(TRACE) << "Closing state DB";
+		PersistenceWriter::instance().flush();
+	}
 }
 
-class WriteBatchNoter: public ldb::WriteBatch::Handler
-{
-	virtual void Put(ldb::Slice const& _key, ldb::Slice const& _value) { LOG(INFO) << "Put" << toHex(bytesConstRef(_key)) << "=>" << toHex(bytesConstRef(_value)); }
-	virtual void Delete(ldb::Slice const& _key) { LOG(INFO) << "Delete" << toHex(bytesConstRef(_key)); }
-};
-
 void OverlayDB::commit()
 {
 	if (m_db)
@@ -60,14 +58,17 @@ void OverlayDB::commit()
 #endif
 		{	
 			uint64_t write_size_all = 0;
+			std::vector<std::pair<ldb::Slice, ldb::Slice>> nodes;
+			nodes.reserve(m_main.size());
 			for (auto const& i: m_main)
 			{
 				if (i.second.second)
 				{
-					batch.Put(ldb::Slice((char const*)i.first.data(), i.first.size), ldb::Slice(i.second.first.data(), i.second.first.size()));
+					nodes.emplace_back(ldb::Slice((char const*)i.first.data(), i.first.size), ldb::Slice(i.second.first.data(), i.second.first.size()));
 					write_size_all += i.second.first.size();
 				}
 			}
+			batch.PutAll(nodes);
 			for (auto const& i: m_aux)
 				if (i.second.second)
 				{
@@ -78,27 +79,18 @@ void OverlayDB::commit()
 				}
 			statSetDBSizeLog(write_size_all);  // statLog
 		}
-		DBSetLogGuard guard;
-		for (unsigned i = 0; i < 10; ++i)
 		{
-			ldb::Status o = m_db->Write(m_writeOptions, &batch);
-			if (o.ok())
-				break;
-			if (i == 9)
-			{
-				LOG(WARNING) << "Fail writing to state database. Bombing out.";
-				exit(-1);
-			}
-			LOG(WARNING) << "Error writing to state database: " << o.ToString();
-			WriteBatchNoter n;
-			batch.Iterate(&n);
-			LOG(WARNING) << "Sleeping for" << (i + 1) << "seconds, then retrying.";
-			this_thread::sleep_for(chrono::seconds(i + 1));
+			DBSetLogGuard guard;
+			PersistenceWriter::instance().write({{m_db.get(), PersistTier::State, batch}});
 		}
 #if DEV_GUARDED_DB
 		DEV_WRITE_GUARDED(x_this)
 #endif
 		{
+			if (m_cache)
+				for (auto const& i: m_main)
+					if (i.second.second)
+						m_cache->insert(i.first, i.second.first);
 			m_aux.clear();
 			m_main.clear();
 		}
@@ -119,7 +111,7 @@ bytes OverlayDB::lookupAux(h256 const& _h) const
 	b.push_back(255);	// for aux
 
 	DBGetLogGuard guard;
-	m_db->Get(m_readOptions, bytesConstRef(&b), &v);
+	PersistenceWriter::instance().get(m_db.get(), m_readOptions, bytesConstRef(&b), &v);
 	statGetDBSizeLog(v.size());
 
 	if (v.empty())
@@ -148,14 +140,23 @@ std::string OverlayDB::lookup(h256 const& _h) const
 	std::string ret = MemoryDB::lookup(_h);
 	if (ret.empty() && m_db)
 	{
+		if (m_cache && m_cache->get(_h, ret))
+		{
+			hitGuard.hit();
+			return ret;
+		}
 		DBGetLogGuard guard;
-		m_db->Get(m_readOptions, ldb::Slice((char const*)_h.data(), 32), &ret);
+		PersistenceWriter::instance().get(m_db.get(), m_readOptions, ldb::Slice((char const*)_h.data(), 32), &ret);
 		statGetDBSizeLog(ret.size());
 		if (m_cryptoMod != CRYPTO_DEFAULT && !ret.empty())
 		{
-			bytes deData = aesCBCDecrypt(bytesConstRef{(const unsigned char*)ret.c_str(),ret.length()},m_superKey,m_superKey.length(),bytesConstRef{(const unsigned char*)m_ivData.c_str(),m_ivData.length()});
-			return asString(deData);
+			static thread_local std::string s_plain;
+			aesCBCDecrypt(bytesConstRef(&ret), m_superKey, m_superKey.length(), bytesConstRef(&m_ivData), s_plain);
+			ret.swap(s_plain);
 		}
+		if (m_cache && !ret.empty())
+			m_cache->insert(_h, ret);
+		return ret;
 	}
 	hitGuard.hit();
 	return ret;
@@ -170,10 +171,15 @@ bool OverlayDB::exists(h256 const& _h) const
 		return true;
 	}
 	std::string ret;
+	if (m_cache && m_cache->get(_h, ret))
+	{
+		hitGuard.hit();
+		return true;
+	}
 	if (m_db)
 	{
 		DBGetLogGuard guard;
-		m_db->Get(m_readOptions, ldb::Slice((char const*)_h.data(), 32), &ret);
+		PersistenceWriter::instance().get(m_db.get(), m_readOptions, ldb::Slice((char const*)_h.data(), 32), &ret);
 		statGetDBSizeLog(ret.size());
 	}
 	return !ret.empty();
@@ -189,7 +195,7 @@ void OverlayDB::kill(h256 const& _h)
 		if (m_db)
 		{
 			DBGetLogGuard guard;
-			m_db->Get(m_readOptions, ldb::Slice((char const*)_h.data(), 32), &ret);
+			PersistenceWriter::instance().get(m_db.get(), m_readOptions, ldb::Slice((char const*)_h.data(), 32), &ret);
 		}
 		// No point node ref decreasing for EmptyTrie since we never bother incrementing it in the first place for
 		// empty storage tries.
@@ -212,6 +218,9 @@ bool OverlayDB::deepkill(h256 const& _h)
 
 	DBGetLogGuard guard;
 	//kill in overlayDB
+	if (m_cache)
+		m_cache->remove(_h);
+	PersistenceWriter::instance().flush();
 	ldb::Status s = m_db->Delete(m_writeOptions, ldb::Slice((char const*)_h.data(), 32));
 	if (s.ok())
 		return true;
@@ -26,6 +26,7 @@
 #include <libdevcore/Common.h>
 #include <libdevcore/easylog.h>
 #include <libdevcore/MemoryDB.h>
+#include <libdevcore/NodeCache.h>
 #include <libdevcore/FileSystem.h>
 //判断是否包含odbc
 #if defined ETH_HAVE_ODBC
@@ -44,6 +45,8 @@ public:
 		std::map<int, std::string> keyData = dev::getDataKey();
 		m_superKey = keyData[0] + keyData[1] + keyData[2] + keyData[3];
 		m_ivData = m_superKey.substr(0,16);
+		if (m_db && getNodeCacheSize())
+			m_cache = std::make_shared<NodeCache>(getNodeCacheSize());
 	}
 	~OverlayDB();
 
@@ -69,6 +72,7 @@ private:
 	int m_cryptoMod;
 	std::string m_superKey;
 	std::string m_ivData;
+	std::shared_ptr<NodeCache> m_cache;	///< Decrypted nodes read from or written to m_db; shared by copies.
 
 	using MemoryDB::clear;
 	//判断是否包含odbc
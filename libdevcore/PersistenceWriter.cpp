@@ -0,0 +1,279 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: PersistenceWriter.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2017
+ */
+
+#include "PersistenceWriter.h"
+#include <chrono>
+#include "easylog.h"
+#include "CommonData.h"
+#include "DBStatLog.h"
+
+using namespace std;
+using namespace dev;
+
+namespace
+{
+
+class WriteBatchNoter: public ldb::WriteBatch::Handler
+{
+	virtual void Put(ldb::Slice const& _key, ldb::Slice const& _value) { LOG(INFO) << "Put" << toHex(bytesConstRef(_key)) << "=>" << toHex(bytesConstRef(_value)); }
+	virtual void Delete(ldb::Slice const& _key) { LOG(INFO) << "Delete" << toHex(bytesConstRef(_key)); }
+};
+
+/// Appends the entries of a batch to another one, as they are (already encrypted if need be).
+class BatchAppender: public ldb::WriteBatch::Handler
+{
+public:
+	explicit BatchAppender(ldb::WriteBatch& _to): m_to(_to) {}
+	virtual void Put(ldb::Slice const& _key, ldb::Slice const& _value) { m_to.Put(_key, _value); }
+	virtual void Delete(ldb::Slice const& _key) { m_to.Delete(_key); }
+
+private:
+	ldb::WriteBatch& m_to;
+};
+
+}
+
+/// Records the entries of a batch as pending.
+class PersistenceWriter::PendingNoter: public ldb::WriteBatch::Handler
+{
+public:
+	PendingNoter(map<string, Entry>& _pending, uint64_t _seq): m_pending(_pending), m_seq(_seq) {}
+	virtual void Put(ldb::Slice const& _key, ldb::Slice const& _value) { m_pending[_key.ToString()] = Entry{m_seq, false, _value.ToString()}; }
+	virtual void Delete(ldb::Slice const& _key) { m_pending[_key.ToString()] = Entry{m_seq, true, string()}; }
+
+private:
+	map<string, Entry>& m_pending;
+	uint64_t m_seq;
+};
+
+PersistenceWriter& PersistenceWriter::instance()
+{
+	static PersistenceWriter s_writer;
+	return s_writer;
+}
+
+PersistenceWriter::~PersistenceWriter()
+{
+	setAsync(false);
+}
+
+void PersistenceWriter::setAsync(bool _async)
+{
+	if (_async == m_async)
+		return;
+
+	if (_async)
+	{
+		m_stopping = false;
+		m_async = true;
+		m_thread = std::thread([this]() { run(); });
+		return;
+	}
+
+	flush();
+	DEV_GUARDED(x_queue)
+		m_stopping = true;
+	m_queueChanged.notify_all();
+	if (m_thread.joinable())
+		m_thread.join();
+	m_async = false;
+}
+
+void PersistenceWriter::write(vector<PersistBatch> _batches)
+{
+	if (!m_async)
+	{
+		stable_sort(_batches.begin(), _batches.end(), [](PersistBatch const& _a, PersistBatch const& _b) { return _a.tier < _b.tier; });
+		for (auto& b: _batches)
+			writeOrDie(b.db, b.batch, ldb::WriteOptions());
+		return;
+	}
+
+	UniqueGuard l(x_queue);
+	m_queueChanged.wait(l, [this]() { return m_queue.size() < c_maxQueued || m_stopping; });
+
+	uint64_t seq = m_nextSeq++;
+	// Visible to readers before the caller goes on, and before the writer can drop it again.
+	DEV_WRITE_GUARDED(x_pending)
+		for (auto& b: _batches)
+		{
+			PendingNoter n(m_pending[b.db], seq);
+			b.batch.Iterate(&n);
+		}
+	m_queue.push_back(Unit{seq, move(_batches)});
+	l.unlock();
+	m_queueChanged.notify_all();
+}
+
+ldb::Status PersistenceWriter::get(ldb::DB* _db, ldb::ReadOptions const& _o, ldb::Slice const& _key, string* o_value) const
+{
+	if (m_async)
+	{
+		ReadGuard l(x_pending);
+		auto db = m_pending.find(_db);
+		if (db != m_pending.end())
+		{
+			auto it = db->second.find(_key.ToString());
+			if (it != db->second.end())
+			{
+				if (it->second.deleted)
+					return ldb::Status::NotFound(_key);
+				*o_value = it->second.value;
+				return ldb::Status::OK();
+			}
+		}
+	}
+	// Not pending, so already on disk: the entry is only dropped from m_pending after the write.
+	return _db->Get(_o, _key, o_value);
+}
+
+void PersistenceWriter::forEachKey(ldb::DB* _db, ldb::ReadOptions const& _o, string const& _begin, string const& _end, std::function<bool(ldb::Slice const&)> const& _f) const
+{
+	// Take the queued keys first: an entry leaves m_pending only once it is on disk, so it is seen
+	// in one place or the other, or both.
+	vector<pair<string, bool>> pending;
+	if (m_async)
+	{
+		ReadGuard l(x_pending);
+		auto db = m_pending.find(_db);
+		if (db != m_pending.end())
+			for (auto it = db->second.lower_bound(_begin); it != db->second.end() && it->first < _end; ++it)
+				pending.emplace_back(it->first, it->second.deleted);
+	}
+
+	unique_ptr<ldb::Iterator> it(_db->NewIterator(_o));
+	auto p = pending.begin();
+	ldb::Slice end(_end);
+	it->Seek(_begin);
+	while (true)
+	{
+		bool onDisk = it->Valid() && it->key().compare(end) < 0;
+		if (p != pending.end() && (!onDisk || ldb::Slice(p->first).compare(it->key()) <= 0))
+		{
+			// A queued write shadows the same key on disk.
+			if (onDisk && ldb::Slice(p->first).compare(it->key()) == 0)
+				it->Next();
+			if (!p->second && !_f(ldb::Slice(p->first)))
+				return;
+			++p;
+		}
+		else if (onDisk)
+		{
+			if (!_f(it->key()))
+				return;
+			it->Next();
+		}
+		else
+			return;
+	}
+}
+
+void PersistenceWriter::flush()
+{
+	if (!m_async)
+		return;
+	UniqueGuard l(x_queue);
+	uint64_t target = m_nextSeq - 1;
+	m_queueChanged.wait(l, [&]() { return m_durableSeq >= target || m_stopping; });
+}
+
+void PersistenceWriter::run()
+{
+	pthread_setThreadName("persist");
+	while (true)
+	{
+		vector<Unit> group;
+		{
+			UniqueGuard l(x_queue);
+			m_queueChanged.wait(l, [this]() { return m_stopping || !m_queue.empty(); });
+			if (m_queue.empty())
+				return;
+			// Everything queued so far goes in one group commit.
+			group.assign(make_move_iterator(m_queue.begin()), make_move_iterator(m_queue.end()));
+			m_queue.clear();
+		}
+		m_queueChanged.notify_all();
+
+		writeGroup(group);
+
+		uint64_t last = group.back().seq;
+		DEV_WRITE_GUARDED(x_pending)
+			for (auto& db: m_pending)
+				for (auto it = db.second.begin(); it != db.second.end();)
+					if (it->second.seq <= last)
+						it = db.second.erase(it);
+					else
+						++it;
+		DEV_GUARDED(x_queue)
+			m_durableSeq = last;
+		m_queueChanged.notify_all();
+	}
+}
+
+void PersistenceWriter::writeGroup(vector<Unit> const& _group)
+{
+	// Merge per tier and database, keeping the order of the units within each.
+	vector<vector<pair<ldb::DB*, ldb::WriteBatch>>> merged(unsigned(PersistTier::Extras) + 1);
+	size_t entries = 0;
+	for (auto const& u: _group)
+		for (auto const& b: u.batches)
+		{
+			auto& tier = merged[unsigned(b.tier)];
+			auto it = find_if(tier.begin(), tier.end(), [&](pair<ldb::DB*, ldb::WriteBatch> const& _m) { return _m.first == b.db; });
+			if (it == tier.end())
+			{
+				tier.emplace_back(b.db, ldb::WriteBatch());
+				it = prev(tier.end());
+			}
+			BatchAppender a(it->second);
+			b.batch.Iterate(&a);
+			++entries;
+		}
+
+	ldb::WriteOptions o;
+	o.sync = true;
+	DBSetLogGuard guard;
+	for (auto& tier: merged)
+		for (auto& m: tier)
+			writeOrDie(m.first, m.second, o);
+	LOG(DEBUG) << "PersistenceWriter wrote units=" << _group.size() << ",batches=" << entries;
+}
+
+void PersistenceWriter::writeOrDie(ldb::DB* _db, ldb::WriteBatch& _batch, ldb::WriteOptions const& _o)
+{
+	for (unsigned i = 0; i < 10; ++i)
+	{
+		ldb::Status o = _db->Write(_o, &_batch);
+		if (o.ok())
+			return;
+		if (i == 9)
+			break;
+		LOG(WARNING) << "Error writing to database: " << o.ToString();
+		WriteBatchNoter n;
+		_batch.Iterate(&n);
+		LOG(WARNING) << "Sleeping for" << (i + 1) << "seconds, then retrying.";
+		this_thread::sleep_for(chrono::seconds(i + 1));
+	}
+	LOG(WARNING) << "Fail writing to database. Bombing out.";
+	exit(-1);
+}
@@ -0,0 +1,131 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: PersistenceWriter.h
+ * @author: fisco-dev
+ *
+ * @date: 2017
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "db.h"
+#include "Guards.h"
+
+namespace dev
+{
+
+/// Order in which queued batches reach the disk: within one group commit, every batch of a lower
+/// tier is durable before any batch of a higher tier is written, so that extras never refer to a
+/// block or state that is not on disk.
+enum class PersistTier: unsigned
+{
+	State = 0,
+	Blocks,
+	Extras
+};
+
+/// One write batch for one database.
+struct PersistBatch
+{
+	ldb::DB* db;
+	PersistTier tier;
+	ldb::WriteBatch batch;
+};
+
+/**
+ * @brief Single writer for the blocks, extras and state databases.
+ * In async mode the batches passed to write() are queued and written by a background thread,
+ * which takes everything queued so far as one group: the batches for the same database and tier
+ * are merged into one write, each with its own fsync, tier by tier. Until a batch is durable its
+ * entries are served to get() from memory. In sync mode write() writes in the calling thread.
+ */
+class PersistenceWriter
+{
+public:
+	static PersistenceWriter& instance();
+
+	~PersistenceWriter();
+
+	/// Switch between background (true) and in-place (false) writes. Drains the queue when switching off.
+	void setAsync(bool _async);
+	bool async() const { return m_async; }
+
+	/// Write @a _batches as one unit, in tier order. Units are written in the order they are passed.
+	/// In async mode, blocks only while too many units are queued.
+	void write(std::vector<PersistBatch> _batches);
+
+	/// Read @a _key from @a _db, including queued writes that are not yet on disk.
+	ldb::Status get(ldb::DB* _db, ldb::ReadOptions const& _o, ldb::Slice const& _key, std::string* o_value) const;
+
+	/// Call @a _f in key order with every key of @a _db in [@a _begin, @a _end), including queued
+	/// writes that are not yet on disk, until it returns false.
+	void forEachKey(ldb::DB* _db, ldb::ReadOptions const& _o, std::string const& _begin, std::string const& _end, std::function<bool(ldb::Slice const&)> const& _f) const;
+
+	/// Block until every unit queued so far is on disk. Must be called before a database
+	/// written through us is iterated or closed.
+	void flush();
+
+private:
+	PersistenceWriter() {}
+
+	/// A queued write, as it is visible to get() until it is durable.
+	struct Entry
+	{
+		uint64_t seq;
+		bool deleted;
+		std::string value;
+	};
+
+	class PendingNoter;
+
+	struct Unit
+	{
+		uint64_t seq;
+		std::vector<PersistBatch> batches;
+	};
+
+	void run();
+	void writeGroup(std::vector<Unit> const& _group);
+	/// Write @a _batch to @a _db, retrying for a while before giving up on the process.
+	void writeOrDie(ldb::DB* _db, ldb::WriteBatch& _batch, ldb::WriteOptions const& _o);
+
+	std::atomic<bool> m_async{false};
+
+	mutable SharedMutex x_pending;
+	std::map<ldb::DB*, std::map<std::string, Entry>> m_pending;
+
+	mutable Mutex x_queue;
+	std::condition_variable m_queueChanged;
+	std::deque<Unit> m_queue;
+	uint64_t m_nextSeq = 1;
+	uint64_t m_durableSeq = 0;		///< Every unit up to and including this one is on disk.
+	bool m_stopping = false;
+	std::thread m_thread;
+
+	static const size_t c_maxQueued = 64;
+};
+
+}
@@ -0,0 +1,120 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: RollingBloom.h
+ * @author: fisco-dev
+ *
+ * @date: 2017
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include "FixedHash.h"
+
+namespace dev
+{
+
+/**
+ * @brief Approximate set of recently seen hashes that can be used from any thread without locking.
+ * Two bloom filters take turns: hashes go into the current one, and once it holds the capacity
+ * the older one is cleared and becomes current. Lookups check both, so a hash is remembered for
+ * one to two generations. Lookups of hashes never inserted are positive about 0.2% of the time.
+ * The filter bits are taken straight from the hash, which must be uniformly distributed (sha3).
+ */
+class RollingBloom
+{
+public:
+	explicit RollingBloom(size_t _capacity):
+		m_capacity(_capacity),
+		m_bits((_capacity * c_bitsPerItem + 63) / 64 * 64)
+	{
+		for (auto& g: m_generations)
+			g.reset(new std::atomic<uint64_t>[m_bits / 64]());
+	}
+
+	void insert(h256 const& _h)
+	{
+		auto& g = m_generations[m_current.load(std::memory_order_relaxed)];
+		for (unsigned i = 0; i < c_hashes; ++i)
+		{
+			uint64_t b = bit(_h, i);
+			g[b / 64].fetch_or(uint64_t(1) << (b % 64), std::memory_order_relaxed);
+		}
+		// exactly one inserter sees the count reach the capacity
+		if (m_count.fetch_add(1, std::memory_order_relaxed) + 1 == m_capacity)
+			rotate();
+	}
+
+	bool contains(h256 const& _h) const
+	{
+		for (auto const& g: m_generations)
+		{
+			unsigned i = 0;
+			for (; i < c_hashes; ++i)
+			{
+				uint64_t b = bit(_h, i);
+				if (!(g[b / 64].load(std::memory_order_relaxed) & (uint64_t(1) << (b % 64))))
+					break;
+			}
+			if (i == c_hashes)
+				return true;
+		}
+		return false;
+	}
+
+	size_t count(h256 const& _h) const { return contains(_h) ? 1 : 0; }
+
+	void clear()
+	{
+		for (auto& g: m_generations)
+			for (size_t w = 0; w < m_bits / 64; ++w)
+				g[w].store(0, std::memory_order_relaxed);
+		m_count = 0;
+	}
+
+private:
+	/// 20 bits and 4 probes per item give ~0.1% false positives per generation.
+	static const unsigned c_bitsPerItem = 20;
+	static const unsigned c_hashes = 4;
+
+	uint64_t bit(h256 const& _h, unsigned _i) const
+	{
+		uint64_t w;
+		std::memcpy(&w, _h.data() + _i * sizeof(w), sizeof(w));
+		return w % m_bits;
+	}
+
+	void rotate()
+	{
+		unsigned next = 1 - m_current.load(std::memory_order_relaxed);
+		for (size_t w = 0; w < m_bits / 64; ++w)
+			m_generations[next][w].store(0, std::memory_order_relaxed);
+		m_current = next;
+		m_count = 0;
+	}
+
+	size_t const m_capacity;
+	size_t const m_bits;
+	std::unique_ptr<std::atomic<uint64_t>[]> m_generations[2];
+	std::atomic<unsigned> m_current = {0};
+	std::atomic<size_t> m_count = {0};
+};
+
+}
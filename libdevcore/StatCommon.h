@@ -48,6 +48,7 @@ enum StatCode
     BLOCK_COMMIT = 43,
     BLOCK_BLKTOCHAIN = 44,
     BLOCK_VIEWCHANG = 45,
+    BLOCK_PACK_PREDICT = 46,
     
     // broadcast
     BROADCAST_BLOCK_SIZE = 10000, 
@@ -76,6 +77,7 @@ enum StatCode
 #define STAT_BLOCK_PBFT_CHAIN "PBFT BlkToChain Time"
 
 #define STAT_BLOCK_PBFT_VIEWCHANGE "PBFT viewchange time"
+#define STAT_BLOCK_PACK_PREDICT "Pack Predict Error(%)"
 
 #define STAT_BROADCAST_BLOCK_SIZE "Broadcast Blk size"
 #define STAT_BROADCAST_TX_SIZE "Broadcast Tx size"
@@ -21,430 +21,534 @@
  * @date: 2017
  */
 
+
 #include <iostream>
 #include <sstream>
-#include <boost/asio.hpp>  
-#include <boost/thread/thread.hpp>  
-#include <boost/thread/mutex.hpp>
-#include <boost/date_time/posix_time/posix_time.hpp> 
 #include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <sys/time.h>
 #include <time.h>
+#include <math.h>
 #include <algorithm>
 #include <climits>
 
 #include "StateMonitor.h"
 
-using namespace std;    
-using namespace boost; 
+using namespace std;
 
 
 namespace statemonitor
 {
 
-static std::unordered_map<int, boost::mutex> monitorByTimeLockTable, monitorByNumLockTable;
-static boost::mutex monitorByTimeTableLock, monitorByNumTableLock; 
-
-#define LOCK_MONITOR(_Type)                                      \
-    monitorBy##_Type##TableLock.lock();                          \
-    boost::mutex &monitor_lock =  monitorBy##_Type##LockTable[code];    \
-    monitorBy##_Type##TableLock.unlock();                        \
-    monitor_lock.lock();
-
-
-#define UNLOCK_MONITOR() \
-    monitor_lock.unlock();
-
+#define MAX_TIME DBL_MAX
 
 /*
-*   StateContainer
+*   Histogram
 */
-void StateContainer::recordStart(int child_code)
-{
-    //_record_start_time = getCurrentTime();
-    setRecordStartTime(child_code);
+constexpr data_t Histogram::c_scale;
 
-    //如果是第一次进来_last_export_time未初始化，则为其赋当前时间
-    if (NO_INIT == _last_export_time) 
-        _last_export_time = getCurrentTime();
-}
-
-void StateContainer::recordEnd(int is_success, int child_code)
+unsigned Histogram::bucketOf(data_t value)
 {
-    if (NO_INIT == _last_export_time)
-        return; //如果未初始化，直接退出
-
-    if (is_success < 0)
-    {
-        //此条记录不可用，删除此child_code对应的start时记录的时间点，并退出
-        auto it = _mp_record_start_time.find(child_code);
-        if (it != _mp_record_start_time.end())
-            _mp_record_start_time.erase(it);
-        return;
-    }
-
-    msec_t time_cost = getRecordInterval(child_code);
-    if (time_cost < 0)
-        return;
-
-    data_t value = convert(time_cost);
-    max_data = max(max_data, value);
-    min_data = min(min_data, value);
-
-    data_sum += value;
-    ++ record_cnt;
-
-    if(is_success > 0)
-        ++ success_cnt;
+    data_t scaled = value * c_scale;
+    if (!(scaled > 0))
+        return 0;
+    uint64_t v = scaled >= data_t(ULLONG_MAX) ? ULLONG_MAX : uint64_t(scaled);
+    if (v < c_subBuckets)
+        return unsigned(v);
+
+    unsigned e = 63 - __builtin_clzll(v);
+    unsigned sub = (v >> (e - c_subBits)) & (c_subBuckets - 1);
+    return (e - c_subBits + 1) * c_subBuckets + sub;
 }
 
-void StateContainer::recordOnce(int is_success, data_t value)
+data_t Histogram::valueOf(unsigned bucket)
 {
-    //recordOnce相当于同时进行了一组start end，用户自定义传入差值 value
-
-    //如果是第一次进来_last_export_time未初始化，则为其赋当前时间
-    if (NO_INIT == _last_export_time) 
-        _last_export_time = getCurrentTime();
-    
-    if (is_success < 0)
-        return;   //数据不可用，直接退出
-    
-    max_data = max(max_data, value);
-    min_data = min(min_data, value);
-
-    data_sum += value;
-    ++ record_cnt;
+    if (bucket < c_subBuckets)
+        return data_t(bucket) / c_scale;
 
-    if(is_success > 0)
-        ++ success_cnt;
+    unsigned e = bucket / c_subBuckets + c_subBits - 1;
+    unsigned sub = bucket % c_subBuckets;
+    data_t width = ldexp(1.0, e - c_subBits);
+    return (data_t(c_subBuckets + sub) * width + width / 2) / c_scale;
 }
 
-#define stateToString(state) (string(#state) + string(":") + to_string(state) + string(" "))
-bool StateContainer::exportState(string &state)
+namespace
 {
-    /*
-        *  导出内容                 单位
-        *  start_timestamp          ms
-        *  end_timestamp            ms
-        *  input_rate               qps
-        *  avg_rate                 qps
-        *  
-        *  max_data            
-        *  min_data            
-        *  avg_data            
-        * 
-        *  export_interval_msec     ms
-        *  record_cnt               次
-        *  success_cnt              次
-        *  success_percent           %
-    */
-    uint64_t start_timestamp = ceil(_last_export_time);
-    msec_t export_interval_msec = getExportInterval();
-    uint64_t end_timestamp = start_timestamp + ceil(export_interval_msec);
-    double export_interval_sec = double(export_interval_msec) / 1000;  
-
-    if (0 == record_cnt)
-        return false; //如果记录数为0，一次数据都没有，导出失败
-
-    data_t avg_data;
-    double input_rate, max_rate, min_rate, success_percent;
-
-    avg_data = data_sum / record_cnt; 
-    input_rate = double(record_cnt) / export_interval_sec;
-    success_percent = 100 * double(success_cnt) / double(record_cnt);
-
-    std::stringstream ss;
-    ss << " " 
-        << "start:" << start_timestamp << " | "
-        << "end:" << end_timestamp << " | "
-        << "in_Rto:" << input_rate << " | "
-        << "max:" << max_data << " | "
-        << "min:" << min_data << " | "
-        << "avg:" << avg_data << " | "
-        << "interval:" << export_interval_msec << " | "
-        << "cnt:" << record_cnt << " | "
-        << "suc_cnt:" << success_cnt << " | "
-        << "suc_per:" << success_percent;
-    state = ss.str();
-    // state = string();
-    // state += stateToString(start_timestamp);
-    // state += stateToString(end_timestamp);
-    // state += stateToString(input_rate);
-    // state += stateToString(max_data);
-    // state += stateToString(min_data);
-    // state += stateToString(avg_data);
-    // state += stateToString(export_interval_msec);
-    // state += stateToString(record_cnt);
-    // state += stateToString(success_cnt);
-    // state += stateToString(success_percent);
-
-    resetState();
-
-    return true;
-}
 
-void StateContainer::reset()
-{
-    resetState();
-    _last_export_time = NO_INIT;
-    _mp_record_start_time = std::map<int, msec_t>(); //赋空值，释放内存
-}
-
-StateContainer::msec_t StateContainer::getExportInterval()
-{
-    msec_t current = getCurrentTime();
-    msec_t interval = current - _last_export_time;
-    _last_export_time = current;
-
-    return interval;
-}
-
-StateContainer::msec_t StateContainer::getRecordInterval(int child_code)
-{
-    // msec_t record_start_time = _mp_record_start_time.at(child_code);
-    auto it = _mp_record_start_time.find(child_code); //recordStart和recordEnd必须在保证在同一个child_code才能被记录下来
-    if (it != _mp_record_start_time.end()){
-        msec_t record_start_time = it->second;
-        _mp_record_start_time.erase(it); //此child_code的记录完成使命，删掉节省空间  
-        return getCurrentTime() - record_start_time;
-    } else {
-        // todo 报警一下，可能出现了函数嵌套多次调用
-        return -1;
-    } 
-}
-
-StateContainer::msec_t StateContainer::getCurrentTime()
+double getCurrentTime()
 {
     struct timeval tv;
     gettimeofday(&tv, NULL);
     uint64_t sec = tv.tv_sec;
-    return msec_t(sec) * 1000 + msec_t(tv.tv_usec) / 1000;
-}
-
-void StateContainer::setRecordStartTime(int child_code)
-{
-    _mp_record_start_time[child_code] = getCurrentTime();
+    return double(sec) * 1000 + double(tv.tv_usec) / 1000;
 }
 
-void StateContainer::resetState()
+struct Totals
 {
-    record_cnt = 0;
-    success_cnt = 0;
-    max_data = 0;
-    min_data = MAX_TIME;
-    data_sum = 0;
-}
+    uint64_t record_cnt = 0;
+    uint64_t success_cnt = 0;
+    data_t data_sum = 0;
+    vector<uint64_t> buckets;
+};
 
 /*
-*   StateMonitor
+*   一个线程在一个code上的数据。计数、求和与直方图只增不减且只有所属线程写，所以写用relaxed的load+store，
+*   没有锁也没有原子RMW；max/min是一个上报周期内的值，由上报方exchange复位，所属线程用CAS更新。
 */
-void StateMonitor::report(int code, string& name, string& info)
+struct ThreadMetric
 {
-    string state_str;
-
-    if (!state.exportState(state_str))
+    atomic<uint64_t> record_cnt{0};
+    atomic<uint64_t> success_cnt{0};
+    atomic<data_t> data_sum{0};
+    atomic<data_t> max_data{0};
+    atomic<data_t> min_data{MAX_TIME};
+    unique_ptr<atomic<uint64_t>[]> buckets;
+    atomic<bool> retired{false};        //线程已退出，合并后即可丢弃
+
+    mutex x_label;                      //name和info只有所属线程写，所属线程读时不用加锁
+    string name, info;
+    uint64_t label_stamp = 0;
+
+    explicit ThreadMetric(bool with_histogram)
     {
-        //cout << "Haven't collected any data, report failed" << endl;
-        return; //导出失败，直接返回，不发送错误数据
+        if (with_histogram)
+        {
+            buckets.reset(new atomic<uint64_t>[Histogram::c_buckets]);
+            for (unsigned i = 0; i < Histogram::c_buckets; ++i)
+                buckets[i].store(0, memory_order_relaxed);
+        }
     }
 
-    //report的格式：[code][name][info] state_str    
-    stringstream ss;
-    ss << "[" << code << "][" << name << "][" << info << "] " << state_str;
-    //开另一个线程来report
-    boost::thread report_thread(StateReporter::report, ss.str());
-}
+    void record(data_t value, int is_success)
+    {
+        record_cnt.store(record_cnt.load(memory_order_relaxed) + 1, memory_order_relaxed);
+        if (is_success > 0)
+            success_cnt.store(success_cnt.load(memory_order_relaxed) + 1, memory_order_relaxed);
+        data_sum.store(data_sum.load(memory_order_relaxed) + value, memory_order_relaxed);
+
+        data_t m = max_data.load(memory_order_relaxed);
+        while (value > m && !max_data.compare_exchange_weak(m, value, memory_order_relaxed)) {}
+        m = min_data.load(memory_order_relaxed);
+        while (value < m && !min_data.compare_exchange_weak(m, value, memory_order_relaxed)) {}
+
+        if (buckets)
+        {
+            atomic<uint64_t>& b = buckets[Histogram::bucketOf(value)];
+            b.store(b.load(memory_order_relaxed) + 1, memory_order_relaxed);
+        }
+    }
 
-/*
-*   StateMonitorByTime
-*/
-void StateMonitorByTime::recordStart(int code, uint64_t interval, int child_code)
-{
-    if (interval != _interval || !_is_timer_on)
+    void label(string& _name, string& _info)
     {
-        NormalStatLog() << "[" << code << "]StateMonitorByTime::interval change to " << interval;
-        startTimer(interval);
+        if (_name == name && _info == info)
+            return;
+        static atomic<uint64_t> s_label_clock{0};
+        lock_guard<mutex> l(x_label);
+        name = move(_name);
+        info = move(_info);
+        label_stamp = ++s_label_clock;
     }
-    state.recordStart(child_code);
-}
 
-void StateMonitorByTime::recordEnd(int code, string& name, string& info, int is_success, int child_code)
-{
-    if (is_success >= 0) //只要不是不可用的，都会被记录
+    void addTo(Totals& totals) const
     {
-        this->code = code;
-        state_name = name;
-        state_info = info;
+        totals.record_cnt += record_cnt.load(memory_order_relaxed);
+        totals.success_cnt += success_cnt.load(memory_order_relaxed);
+        totals.data_sum += data_sum.load(memory_order_relaxed);
+        if (buckets)
+        {
+            totals.buckets.resize(Histogram::c_buckets);
+            for (unsigned i = 0; i < Histogram::c_buckets; ++i)
+                totals.buckets[i] += buckets[i].load(memory_order_relaxed);
+        }
     }
-    state.recordEnd(is_success, child_code);
-}
+};
 
-void StateMonitorByTime::recordOnce(int code, uint64_t interval, data_t value, std::string& name, std::string& info, int is_success)
+//一个code的所有线程分片
+struct Series
 {
-    if (interval != _interval || !_is_timer_on)
+    int code;
+    bool by_time;
+    atomic<uint64_t> period;            //按时间: 上报间隔(s)；按次数: 每多少次上报
+    atomic<uint64_t> pending{0};        //按次数: 上次上报后的记录数
+
+    mutex x_series;                     //保护以下成员，只在新线程加入和上报时使用
+    vector<shared_ptr<ThreadMetric>> shards;
+    Totals retired;                     //已退出线程的累计数据
+    string retired_name, retired_info;  //以及它们最近一次的name和info
+    uint64_t retired_stamp = 0;
+    Totals reported;                    //上次上报时的累计数据
+    double last_export_time;
+
+    Series(int _code, bool _by_time, uint64_t _period):
+        code(_code), by_time(_by_time), period(_period), last_export_time(getCurrentTime()) {}
+
+    //调用时须持有x_series。合并所有分片，返回累计数据，并取出最近一次的name和info
+    Totals merge(string& name, string& info, data_t* max_data = nullptr, data_t* min_data = nullptr)
     {
-        NormalStatLog() << "[" << code << "]StateMonitorByTime::interval change to " << interval;
-        startTimer(interval);
+        Totals now = retired;
+        uint64_t stamp = retired_stamp;
+        name = retired_name;
+        info = retired_info;
+        for (auto it = shards.begin(); it != shards.end();)
+        {
+            ThreadMetric& m = **it;
+            bool gone = m.retired.load(memory_order_acquire);
+            m.addTo(now);
+            if (max_data)
+                *max_data = max(*max_data, m.max_data.exchange(0, memory_order_relaxed));
+            if (min_data)
+                *min_data = min(*min_data, m.min_data.exchange(MAX_TIME, memory_order_relaxed));
+            {
+                lock_guard<mutex> l(m.x_label);
+                if (m.label_stamp > stamp)
+                {
+                    stamp = m.label_stamp;
+                    name = m.name;
+                    info = m.info;
+                }
+            }
+            if (gone)
+            {
+                m.addTo(retired);
+                if (m.label_stamp > retired_stamp)
+                {
+                    retired_stamp = m.label_stamp;
+                    retired_name = m.name;
+                    retired_info = m.info;
+                }
+                it = shards.erase(it);
+            }
+            else
+                ++it;
+        }
+        return now;
     }
 
-    if (is_success >= 0) //只要不是不可用的，都会被记录
+    //调用时须持有x_series。导出上次上报以来的数据，格式与原StateContainer::exportState相同
+    bool exportState(string& name, string& info, string& state)
     {
-        this->code = code;
-        state_name = name;
-        state_info = info;
+        data_t max_data = 0, min_data = MAX_TIME;
+        string last_name, last_info;
+        Totals now = merge(last_name, last_info, &max_data, &min_data);
+        if (name.empty() && info.empty())
+        {
+            name = move(last_name);
+            info = move(last_info);
+        }
+
+        uint64_t record_cnt = now.record_cnt - reported.record_cnt;
+        uint64_t success_cnt = now.success_cnt - reported.success_cnt;
+        data_t data_sum = now.data_sum - reported.data_sum;
+        reported = move(now);
+
+        uint64_t start_timestamp = ceil(last_export_time);
+        double current = getCurrentTime();
+        double export_interval_msec = current - last_export_time;
+        last_export_time = current;
+        uint64_t end_timestamp = start_timestamp + ceil(export_interval_msec);
+        double export_interval_sec = double(export_interval_msec) / 1000;
+
+        if (0 == record_cnt)
+            return false; //如果记录数为0，一次数据都没有，导出失败
+
+        data_t avg_data = data_sum / record_cnt;
+        double input_rate = double(record_cnt) / export_interval_sec;
+        double success_percent = 100 * double(success_cnt) / double(record_cnt);
+
+        std::stringstream ss;
+        ss << " " 
+            << "start:" << start_timestamp << " | "
+            << "end:" << end_timestamp << " | "
+            << "in_Rto:" << input_rate << " | "
+            << "max:" << max_data << " | "
+            << "min:" << min_data << " | "
+            << "avg:" << avg_data << " | "
+            << "interval:" << export_interval_msec << " | "
+            << "cnt:" << record_cnt << " | "
+            << "suc_cnt:" << success_cnt << " | "
+            << "suc_per:" << success_percent;
+        state = ss.str();
+        return true;
     }
 
-    state.recordOnce(is_success, value);
-}
+    void report(string name, string info)
+    {
+        string state_str;
+        {
+            lock_guard<mutex> l(x_series);
+            if (!exportState(name, info, state_str))
+                return; //导出失败，直接返回，不发送错误数据
+        }
+
+        //report的格式：[code][name][info] state_str
+        stringstream ss;
+        ss << "[" << code << "][" << name << "][" << info << "] " << state_str;
+        StateReporter::report(ss.str());
+    }
+};
 
-//按周期（_interval）进行上报
-void StateMonitorByTime::timerToReport()
+//recordStateBy*Start记录的起始时间，按(code, child_code)分条带加锁；只有显式Start/End的流程统计会用到
+class StartTimes
 {
-    while (_is_timer_on)
+public:
+    void start(int code, int child_code)
     {
-        sleep(_interval); //若在sleep时修改了interval，也要等本次跑完，下次新的interval才生效
-        LOCK_MONITOR(Time); //此处是在线程中跑，共享name和info变量，所以需要加与入口一样的锁
-        report(code, state_name, state_info);
-        UNLOCK_MONITOR();
+        Stripe& s = stripe(code, child_code);
+        lock_guard<mutex> l(s.x_starts);
+        s.starts[key(code, child_code)] = getCurrentTime();
     }
-}
 
-void StateMonitorByTime::startTimer(sec_t interval)
-{
-    _interval = interval;
+    //返回start到现在的时间(ms)，没有对应的start则返回-1
+    double end(int code, int child_code, bool discard)
+    {
+        Stripe& s = stripe(code, child_code);
+        lock_guard<mutex> l(s.x_starts);
+        auto it = s.starts.find(key(code, child_code));
+        if (it == s.starts.end())
+            return -1;
+        double cost = discard ? -1 : getCurrentTime() - it->second;
+        s.starts.erase(it);
+        return cost;
+    }
 
-    if (_is_timer_on)
-        return; //避免重复开timer线程
+private:
+    static const unsigned c_stripes = 16;
 
-    _is_timer_on = true;
+    struct Stripe
+    {
+        mutex x_starts;
+        unordered_map<uint64_t, double> starts;
+    };
 
-    //给定时器开一个新的线程
-    boost::thread timer_thread(boost::bind(&StateMonitorByTime::timerToReport, this));
-    //TODO: 核查多个StateMonitorByTime下timer是否是多个
-}
+    static uint64_t key(int code, int child_code) { return (uint64_t(uint32_t(code)) << 32) | uint32_t(child_code); }
+    Stripe& stripe(int code, int child_code) { return m_stripes[(uint32_t(code) * 31 + uint32_t(child_code)) % c_stripes]; }
 
+    Stripe m_stripes[c_stripes];
+};
 
-/*
-*   StateMonitorByNum
-*/
-void StateMonitorByNum::recordStart(int code, uint64_t report_per_num, int child_code)
+class Registry
 {
-    if (_report_per_num != report_per_num)
+public:
+    static Registry& instance()
     {
-        NormalStatLog() << "[" << code << "]StateMonitorByNum::report_per_num change to " << report_per_num;
-        _report_per_num = report_per_num;
+        //不析构：线程退出时的thread_local析构可能晚于静态对象析构
+        static Registry* s_registry = new Registry;
+        return *s_registry;
+    }
 
-        state.reset();
-        _cnt = 0;
+    Series& series(int code, bool by_time, uint64_t period)
+    {
+        lock_guard<mutex> l(x_registry);
+        auto& table = by_time ? m_by_time : m_by_num;
+        auto it = table.find(code);
+        if (it != table.end())
+            return *it->second;
+
+        if (by_time)
+        {
+            NormalStatLog() << "[" << code << "]StateMonitorByTime::interval change to " << period;
+            if (!m_reporter_on)
+            {
+                m_reporter_on = true;
+                thread(&Registry::reportByTime, this).detach();
+            }
+        }
+        shared_ptr<Series> s = make_shared<Series>(code, by_time, period);
+        table[code] = s;
+        return *s;
     }
-    state.recordStart(child_code);
-}
 
-void StateMonitorByNum::recordEnd(int code, string &name, string &info, int is_success, int child_code)
-{
-    state.recordEnd(is_success, child_code);
+    vector<shared_ptr<Series>> all(bool by_time)
+    {
+        vector<shared_ptr<Series>> ret;
+        lock_guard<mutex> l(x_registry);
+        for (auto const& i : by_time ? m_by_time : m_by_num)
+            ret.push_back(i.second);
+        return ret;
+    }
 
-    if (is_success < 0)
-        return; //表示此记录不可用，不被记录
+    StartTimes& startTimes(bool by_time) { return by_time ? m_time_starts : m_num_starts; }
 
-    if (++_cnt < _report_per_num)
-        return;
+private:
+    Registry() {}
 
-    //如果达到了次数，就要report
-    report(code, name, info);
-    _cnt = 0;
-}
+    //按时间上报的后台线程，所有code共用一个
+    void reportByTime()
+    {
+        while (true)
+        {
+            this_thread::sleep_for(chrono::seconds(1));
+            double now = getCurrentTime();
+            for (auto const& s : all(true))
+            {
+                bool due = false;
+                {
+                    lock_guard<mutex> l(s->x_series);
+                    due = now - s->last_export_time >= double(s->period.load(memory_order_relaxed)) * 1000;
+                }
+                if (due)
+                    s->report(string(), string());
+            }
+        }
+    }
+
+    mutex x_registry;
+    map<int, shared_ptr<Series>> m_by_time;
+    map<int, shared_ptr<Series>> m_by_num;
+    bool m_reporter_on = false;
 
-void StateMonitorByNum::recordOnce(int code, uint64_t report_per_num, data_t value, std::string& name, std::string& info, int is_success)
+    StartTimes m_time_starts;
+    StartTimes m_num_starts;
+};
+
+//本线程的分片
+struct LocalMetrics
 {
-    if (_report_per_num != report_per_num)
+    struct Entry
     {
-        NormalStatLog() << "[" << code << "]StateMonitorByNum::report_per_num change to " << report_per_num;
-        _report_per_num = report_per_num;
+        Series* series;
+        shared_ptr<ThreadMetric> metric;
+    };
+    unordered_map<int, Entry> by_time;
+    unordered_map<int, Entry> by_num;
 
-        state.reset();
-        _cnt = 0;
+    ~LocalMetrics()
+    {
+        for (auto const& i : by_time)
+            i.second.metric->retired.store(true, memory_order_release);
+        for (auto const& i : by_num)
+            i.second.metric->retired.store(true, memory_order_release);
     }
 
-    state.recordOnce(is_success, value);
+    //set_period为false时不修改上报周期（只用于取分片）
+    Entry& get(int code, bool by_time_, uint64_t period, bool set_period = true)
+    {
+        auto& table = by_time_ ? by_time : by_num;
+        auto it = table.find(code);
+        if (it == table.end())
+        {
+            Series& s = Registry::instance().series(code, by_time_, period);
+            shared_ptr<ThreadMetric> m = make_shared<ThreadMetric>(by_time_);
+            {
+                lock_guard<mutex> l(s.x_series);
+                s.shards.push_back(m);
+            }
+            it = table.insert(make_pair(code, Entry{&s, m})).first;
+        }
+
+        Series& s = *it->second.series;
+        if (set_period && s.period.load(memory_order_relaxed) != period)
+        {
+            s.period.store(period, memory_order_relaxed);
+            if (by_time_)
+                NormalStatLog() << "[" << code << "]StateMonitorByTime::interval change to " << period;
+            else
+                NormalStatLog() << "[" << code << "]StateMonitorByNum::report_per_num change to " << period;
+        }
+        return it->second;
+    }
+};
+
+LocalMetrics& local()
+{
+    static thread_local LocalMetrics s_local;
+    return s_local;
+}
 
+void recordByTime(int code, uint64_t interval, data_t value, string& name, string& info, int is_success)
+{
+    LocalMetrics::Entry& e = local().get(code, true, interval);
     if (is_success < 0)
-        return; //表示此记录不可用，不被记录
+        return;   //数据不可用，直接退出
+    e.metric->label(name, info);
+    e.metric->record(value, is_success);
+}
 
-    if (++_cnt < _report_per_num)
-        return;
+void recordByNum(int code, uint64_t report_per_num, data_t value, string& name, string& info, int is_success)
+{
+    LocalMetrics::Entry& e = local().get(code, false, report_per_num);
+    if (is_success < 0)
+        return;   //表示此记录不可用，不被记录
+    e.metric->record(value, is_success);
 
     //如果达到了次数，就要report
-    report(code, name, info);
-    _cnt = 0;
+    Series& s = *e.series;
+    uint64_t n = s.pending.fetch_add(1, memory_order_relaxed) + 1;
+    if (n >= s.period.load(memory_order_relaxed) && s.pending.compare_exchange_strong(n, 0, memory_order_relaxed))
+        s.report(name, info);
+    e.metric->label(name, info);
 }
 
-static std::unordered_map<int, StateMonitorByTime> monitorByTimeTable;
-static std::unordered_map<int, StateMonitorByNum> monitorByNumTable;
+}
 
 void recordStateByTimeStart(int code, uint64_t interval, int child_code)
 {
-    LOCK_MONITOR(Time)
-
-    monitorByTimeTable[code].recordStart(code, interval, child_code); //code找不到会自己创建
-
-    UNLOCK_MONITOR()
+    local().get(code, true, interval); //code找不到会自己创建
+    Registry::instance().startTimes(true).start(code, child_code);
 }
 
 void recordStateByTimeEnd(int code, string &&name, string &&info, int is_success, int child_code)
 {
-    LOCK_MONITOR(Time)
-
-    // monitorByTimeTable[code].recordEnd(code, name, info, is_success, child_code);
-    auto it = monitorByTimeTable.find(code);
-    if (it != monitorByTimeTable.end()) 
-        it->second.recordEnd(code, name, info, is_success, child_code);
-
-    UNLOCK_MONITOR()
+    double cost = Registry::instance().startTimes(true).end(code, child_code, is_success < 0);
+    if (cost < 0)
+        return;   //没有对应的start，或此记录不可用
+    LocalMetrics::Entry& e = local().get(code, true, 0, false);
+    e.metric->label(name, info);
+    e.metric->record(cost, is_success);
 }
 
 void recordStateByTimeOnce(int code, uint64_t interval,
                            data_t value, std::string &&name, std::string &&info,
                            int is_success)
 {
-    LOCK_MONITOR(Time)
-    
-    monitorByTimeTable[code].recordOnce(code, interval, value, name, info, is_success);
-    
-    UNLOCK_MONITOR()    
+    recordByTime(code, interval, value, name, info, is_success);
 }
 
 void recordStateByNumStart(int code, uint64_t report_per_num, int child_code)
 {
-    LOCK_MONITOR(Num)
-
-    monitorByNumTable[code].recordStart(code, report_per_num, child_code); //code找不到会自己创建
-
-    UNLOCK_MONITOR()
+    local().get(code, false, report_per_num); //code找不到会自己创建
+    Registry::instance().startTimes(false).start(code, child_code);
 }
 
 void recordStateByNumEnd(int code, string &&name, string &&info, int is_success, int child_code)
 {
-    LOCK_MONITOR(Num)
-    auto it = monitorByNumTable.find(code);
-    if (it != monitorByNumTable.end()) 
-        it->second.recordEnd(code, name, info, is_success, child_code);
-
-    UNLOCK_MONITOR()
+    double cost = Registry::instance().startTimes(false).end(code, child_code, is_success < 0);
+    if (cost < 0)
+        return;
+    recordByNum(code, local().get(code, false, 0, false).series->period.load(memory_order_relaxed), cost, name, info, is_success);
 }
 
 void recordStateByNumOnce(int code, uint64_t report_per_num,
                           data_t value, std::string &&name, std::string &&info,
                           int is_success)
 {
-    LOCK_MONITOR(Num)
-
-    monitorByNumTable[code].recordOnce(code, report_per_num, value, name, info, is_success);
-    
-    UNLOCK_MONITOR()    
+    recordByNum(code, report_per_num, value, name, info, is_success);
 }
 
+std::vector<MetricSnapshot> collectMetrics()
+{
+    std::vector<MetricSnapshot> ret;
+    for (bool by_time: {true, false})
+        for (auto const& s : Registry::instance().all(by_time))
+        {
+            MetricSnapshot snap;
+            snap.code = s->code;
+            snap.by_time = by_time;
+            Totals t;
+            {
+                lock_guard<mutex> l(s->x_series);
+                t = s->merge(snap.name, snap.info);
+            }
+            snap.record_cnt = t.record_cnt;
+            snap.success_cnt = t.success_cnt;
+            snap.data_sum = t.data_sum;
+            snap.buckets = move(t.buckets);
+            ret.push_back(move(snap));
+        }
+    return ret;
 }
 
-
-
+}
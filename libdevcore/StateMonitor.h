@@ -21,6 +21,7 @@
  * @date: 2017
  */
 
+
 #pragma once
 
 #include <iostream>    
@@ -35,6 +36,8 @@
 #include <algorithm>
 #include <climits>
 #include <map>
+#include <string>
+#include <vector>
 #include <unordered_map>
 #include "easylog.h"
 
@@ -42,45 +45,31 @@ namespace statemonitor
 {
 using data_t = double;
 
-class StateContainer
+/*
+*   HDR风格的直方图：每个2的幂区间再线性分成c_subBuckets个桶，桶内相对误差不超过1/c_subBuckets
+*   值乘以c_scale取整后入桶（耗时单位为ms，即按us精度统计）
+*/
+struct Histogram
 {
-    using msec_t = double;
-    using sec_t = double;
-    #define MAX_TIME DBL_MAX
-    #define NO_INIT 0
-public:
-    uint64_t record_cnt, success_cnt;   
-    data_t max_data, min_data, 
-           data_sum; //当前次export的time_cost总和
-
-    StateContainer()
-    {
-        reset();
-    }
+    static const unsigned c_subBits = 2;
+    static const unsigned c_subBuckets = 1 << c_subBits;
+    static const unsigned c_buckets = (64 - c_subBits + 1) * c_subBuckets;
+    static constexpr data_t c_scale = 1000;
+
+    static unsigned bucketOf(data_t value);
+    //桶的代表值（区间中点），单位与记录的值相同
+    static data_t valueOf(unsigned bucket);
+};
 
-    virtual ~StateContainer(){};
-
-    void recordStart(int child_code);
-    void recordEnd(int is_success, int child_code);
-    void recordOnce(int is_success, data_t value);
-    bool exportState(std::string &state);
-    void reset();
-
-private:
-    msec_t _last_export_time;
-    std::map<int, msec_t> _mp_record_start_time;
-
-    msec_t getExportInterval();
-    msec_t getRecordInterval(int child_code);
-    msec_t getCurrentTime();
-    void setRecordStartTime(int child_code);
-
-    void resetState();
-    
-    inline data_t convert(unsigned int x){return data_t(x);}
-    inline data_t convert(unsigned long long x){return data_t(x);}
-    inline data_t convert(float x){return data_t(x);}
-    inline data_t convert(double x){return data_t(x);}
+//某个code自启动以来的累计数据，供外部采集
+struct MetricSnapshot
+{
+    int code;
+    bool by_time;                   //true: recordStateByTime*, false: recordStateByNum*
+    std::string name, info;         //最近一次记录的name和info
+    uint64_t record_cnt, success_cnt;
+    data_t data_sum;
+    std::vector<uint64_t> buckets;  //Histogram的各桶计数，只有按时间上报的code才有
 };
 
 class StateReporter
@@ -93,66 +82,11 @@ public:
     }
 };
 
-class StateMonitor
-{
-public:
-    StateContainer state;
-
-    StateMonitor():state(){};
-    virtual ~StateMonitor(){};
-
-    void report(int code, std::string& name, std::string& info);
-};
-
-//以时间为周期，上报state
-class StateMonitorByTime : public StateMonitor
-{
-    using sec_t = uint64_t;
-public:
-    int code;
-    std::string state_name, state_info;
-
-    StateMonitorByTime(uint64_t interval):_interval(interval),_is_timer_on(false){}
-    StateMonitorByTime():_interval(10),_is_timer_on(false){} //默认10s上报一次
-    virtual ~StateMonitorByTime(){};
-
-    void recordStart(int code, uint64_t interval, int child_code);
-    void recordEnd(int code, std::string& name, std::string& info, int is_success, int child_code);
-    void recordOnce(int code, uint64_t interval, data_t value, std::string& name, std::string& info, int is_success);
-
-    
-private:
-    sec_t _interval; 
-    bool _is_timer_on;
-
-    //按周期（_interval）进行上报
-    void timerToReport();
-    void startTimer(sec_t interval);
-};
-
-//以次数为周期，上报state
-class StateMonitorByNum : public StateMonitor
-{
-    using cnt_t = uint64_t;    
-public:
-    StateMonitorByNum(uint64_t report_per_num)
-            : _report_per_num(report_per_num),
-              _cnt(0){};
-
-    StateMonitorByNum()
-            : _report_per_num(0),
-            _cnt(0){};
-
-    virtual ~StateMonitorByNum(){};
-
-    void recordStart(int code, uint64_t report_per_num, int child_code);
-    void recordEnd(int code, std::string& name, std::string& info, int is_success, int child_code);
-    void recordOnce(int code, uint64_t report_per_num, data_t value, std::string& name, std::string& info, int is_success);
-private:
-    cnt_t _report_per_num;
-    cnt_t _cnt;
-};
-
+/*
+*   记录的热路径上没有锁：每个线程把数据写到自己的分片（计数、求和与直方图只有本线程写），
+*   上报时再由后台线程（按时间）或达到次数的线程（按次数）把所有分片合并后输出。
+*   输出格式与原来的StateContainer::exportState相同。
+*/
 
 inline int getChildCodeFromThreadId()
 {
@@ -185,4 +119,7 @@ void recordStateByNumOnce(int code, uint64_t report_per_num,
                           data_t value, std::string &&name, std::string &&info,
                           int is_success = 1);  //含义与recordStateByTimeOnce相同
 
-}
\ No newline at end of file
+//所有code的累计数据（不影响按周期的上报）
+std::vector<MetricSnapshot> collectMetrics();
+
+}
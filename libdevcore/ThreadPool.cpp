@@ -0,0 +1,118 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: ThreadPool.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2017
+ */
+
+#include "ThreadPool.h"
+#include <atomic>
+#include "easylog.h"
+
+using namespace std;
+using namespace dev;
+
+ThreadPool::ThreadPool(string const& _name, unsigned _size): m_name(_name)
+{
+	if (_size == 0)
+		_size = max(1u, thread::hardware_concurrency());
+
+	for (unsigned i = 0; i < _size; ++i)
+		m_workers.emplace_back([this, i]() { run(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		Guard l(x_queue);
+		m_stopping = true;
+		m_queue.clear();
+	}
+	m_signal.notify_all();
+	for (auto& w : m_workers)
+		if (w.joinable())
+			w.join();
+}
+
+void ThreadPool::enqueue(function<void()> const& _task)
+{
+	{
+		Guard l(x_queue);
+		m_queue.push_back(_task);
+	}
+	m_signal.notify_one();
+}
+
+void ThreadPool::parallelFor(size_t _count, function<void(size_t)> const& _f)
+{
+	if (_count == 0)
+		return;
+
+	// Each worker pulls the next index itself, so an expensive item does not hold back the others.
+	auto next = make_shared<atomic<size_t>>(0);
+	unsigned tasks = min<size_t>(_count, m_workers.size());
+	vector<future<void>> done;
+	done.reserve(tasks);
+	for (unsigned t = 0; t < tasks; ++t)
+		done.push_back(submit([next, _count, &_f]()
+		{
+			for (size_t i = (*next)++; i < _count; i = (*next)++)
+				_f(i);
+		}));
+
+	exception_ptr first;
+	for (auto& d : done)
+		try
+		{
+			d.get();
+		}
+		catch (...)
+		{
+			if (!first)
+				first = current_exception();
+		}
+	if (first)
+		rethrow_exception(first);
+}
+
+void ThreadPool::run(unsigned _index)
+{
+	pthread_setThreadName(m_name + "." + to_string(_index));
+	while (true)
+	{
+		function<void()> task;
+		{
+			UniqueGuard l(x_queue);
+			m_signal.wait(l, [this]() { return m_stopping || !m_queue.empty(); });
+			if (m_stopping)
+				return;
+			task = move(m_queue.front());
+			m_queue.pop_front();
+		}
+
+		try
+		{
+			task();
+		}
+		catch (std::exception const& _e)
+		{
+			LOG(ERROR) << "Exception thrown in ThreadPool[" << m_name << "]: " << _e.what();
+		}
+	}
+}
@@ -0,0 +1,86 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: ThreadPool.h
+ * @author: fisco-dev
+ *
+ * @date: 2017
+ */
+
+#pragma once
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include "Guards.h"
+
+namespace dev
+{
+
+/**
+ * @brief Fixed-size pool of worker threads fed from a single FIFO task queue.
+ * Tasks are executed in submission order by whichever worker is idle first.
+ * The destructor drains nothing: pending tasks are dropped and running ones joined.
+ */
+class ThreadPool
+{
+public:
+	/// @param _size number of workers; 0 means std::thread::hardware_concurrency().
+	ThreadPool(std::string const& _name, unsigned _size = 0);
+	~ThreadPool();
+
+	ThreadPool(ThreadPool const&) = delete;
+	ThreadPool& operator=(ThreadPool const&) = delete;
+
+	/// Queue a fire-and-forget task.
+	void enqueue(std::function<void()> const& _task);
+
+	/// Queue a task and get a future for its result. Exceptions are delivered through the future.
+	template <class F>
+	auto submit(F&& _f) -> std::future<decltype(_f())>
+	{
+		auto task = std::make_shared<std::packaged_task<decltype(_f())()>>(std::forward<F>(_f));
+		auto ret = task->get_future();
+		enqueue([task]() { (*task)(); });
+		return ret;
+	}
+
+	/// Run _f(i) for every i in [0, _count) on the pool and block until all of them returned.
+	/// The first exception thrown by any _f(i) is rethrown in the calling thread.
+	void parallelFor(size_t _count, std::function<void(size_t)> const& _f);
+
+	unsigned size() const { return m_workers.size(); }
+
+	/// Number of tasks waiting for a worker.
+	size_t pending() const { Guard l(x_queue); return m_queue.size(); }
+
+private:
+	void run(unsigned _index);
+
+	std::string m_name;
+	std::vector<std::thread> m_workers;
+	std::deque<std::function<void()>> m_queue;
+	mutable Mutex x_queue;
+	std::condition_variable m_signal;
+	bool m_stopping = false;
+};
+
+}
@@ -63,31 +63,77 @@ bytes dev::aesDecrypt(bytesConstRef _ivCipher, std::string const& _password, uns
 
 bytes dev::aesCBCEncrypt(bytesConstRef plainData,string const& keyData,int keyLen,bytesConstRef ivData)
 {
-	string cipherData;
-	CryptoPP::AES::Encryption aesEncryption((const byte*)keyData.c_str(), keyLen);
-	CryptoPP::CBC_Mode_ExternalCipher::Encryption cbcEncryption( aesEncryption, ivData.data());
-	CryptoPP::StreamTransformationFilter stfEncryptor(cbcEncryption, new CryptoPP::StringSink( cipherData ));  
-	stfEncryptor.Put( plainData.data(), plainData.size());
-	stfEncryptor.MessageEnd();
-	//string cipherDataB64;
-	/*for( int i = 0; i < cipherData.size(); i++ )
-	{  
-		char ch[3] = {0};  
-		sprintf(ch, "%02x",  static_cast<byte>(cipherData[i]));  
-		cipherDataHex += ch;  
-	}*/
-	//cipherDataB64 = toBase64(bytesConstRef{(const unsigned char*)cipherData.c_str(), cipherData.length()});
-	return asBytes(cipherData);
+	bytes cipherData;
+	aesCBCEncrypt(plainData, keyData, keyLen, ivData, cipherData);
+	return cipherData;
 }
 
 bytes dev::aesCBCDecrypt(bytesConstRef cipherData,string const& keyData,int keyLen,bytesConstRef ivData)
 {
-	string decryptedData;
-	CryptoPP::AES::Decryption aesDecryption((const byte*)keyData.c_str(), keyLen); 
-	CryptoPP::CBC_Mode_ExternalCipher::Decryption cbcDecryption( aesDecryption,ivData.data());  
-	CryptoPP::StreamTransformationFilter stfDecryptor(cbcDecryption, new CryptoPP::StringSink( decryptedData ));
-	//stfDecryptor.Put( reinterpret_cast<const unsigned char*>( cipherData.c_str() ),cipherLen);
-	stfDecryptor.Put(cipherData.data(),cipherData.size());
-	stfDecryptor.MessageEnd();
-	return asBytes(decryptedData);
+	bytes decryptedData;
+	aesCBCDecrypt(cipherData, keyData, keyLen, ivData, decryptedData);
+	return decryptedData;
+}
+
+namespace
+{
+
+/// Expanding the key costs about as much as encrypting a trie node, so every thread keeps the
+/// schedule of the last key it used (in practice there is only the one data key).
+template <class Cipher>
+Cipher& cipherFor(string const& _key, int _keyLen)
+{
+	static thread_local string s_key;
+	static thread_local unique_ptr<Cipher> s_cipher;
+	if (!s_cipher || s_key.size() != size_t(_keyLen) || memcmp(s_key.data(), _key.data(), _keyLen))
+	{
+		s_cipher.reset(new Cipher((byte const*)_key.data(), _keyLen));
+		s_key.assign(_key.data(), _keyLen);
+	}
+	return *s_cipher;
+}
+
+template <class Out>
+void cbcDecryptInto(bytesConstRef _cipher, string const& _key, int _keyLen, bytesConstRef _iv, Out& o_plain)
+{
+	if (_cipher.empty() || _cipher.size() % AES::BLOCKSIZE)
+		throw InvalidCiphertext("aesCBCDecrypt: ciphertext length is not a multiple of the block size");
+
+	// CBC decryption of the blocks is independent, so CryptoPP pipelines them through AES-NI.
+	CBC_Mode_ExternalCipher::Decryption cbc(cipherFor<AES::Decryption>(_key, _keyLen), _iv.data());
+	o_plain.resize(_cipher.size());
+	cbc.ProcessData((byte*)&o_plain[0], _cipher.data(), _cipher.size());
+
+	unsigned pad = (byte)o_plain.back();
+	if (pad == 0 || pad > AES::BLOCKSIZE)
+		throw InvalidCiphertext("aesCBCDecrypt: invalid PKCS #7 block padding found");
+	for (size_t i = o_plain.size() - pad; i < o_plain.size(); ++i)
+		if ((byte)o_plain[i] != pad)
+			throw InvalidCiphertext("aesCBCDecrypt: invalid PKCS #7 block padding found");
+	o_plain.resize(o_plain.size() - pad);
+}
+
+}
+
+void dev::aesCBCEncrypt(bytesConstRef _plain, string const& _key, int _keyLen, bytesConstRef _iv, bytes& o_cipher)
+{
+	// PKCS#7, as StreamTransformationFilter does by default: always 1 to 16 bytes of padding.
+	size_t pad = AES::BLOCKSIZE - _plain.size() % AES::BLOCKSIZE;
+	o_cipher.resize(_plain.size() + pad);
+	if (_plain.size())
+		memcpy(o_cipher.data(), _plain.data(), _plain.size());
+	memset(o_cipher.data() + _plain.size(), (int)pad, pad);
+
+	CBC_Mode_ExternalCipher::Encryption cbc(cipherFor<AES::Encryption>(_key, _keyLen), _iv.data());
+	cbc.ProcessData(o_cipher.data(), o_cipher.data(), o_cipher.size());
+}
+
+void dev::aesCBCDecrypt(bytesConstRef _cipher, string const& _key, int _keyLen, bytesConstRef _iv, bytes& o_plain)
+{
+	cbcDecryptInto(_cipher, _key, _keyLen, _iv, o_plain);
+}
+
+void dev::aesCBCDecrypt(bytesConstRef _cipher, string const& _key, int _keyLen, bytesConstRef _iv, string& o_plain)
+{
+	cbcDecryptInto(_cipher, _key, _keyLen, _iv, o_plain);
 }
@@ -32,4 +32,11 @@ namespace dev
 bytes aesDecrypt(bytesConstRef _cipher, std::string const& _password, unsigned _rounds = 2000, bytesConstRef _salt = bytesConstRef());
 bytes aesCBCEncrypt(bytesConstRef plainData,std::string const& keyData,int keyLen,bytesConstRef ivData);//AESܳbase64
 bytes aesCBCDecrypt(bytesConstRef cipherData,std::string const& keyData,int keyLen,bytesConstRef ivData);//AES
+
+/// As above, but into a buffer owned by the caller so that it can be reused from one value to the next.
+/// The expanded key is kept per thread between calls; CryptoPP uses AES-NI where the CPU has it.
+/// Output is PKCS#7 padded exactly as with the functions above. Throws CryptoPP::InvalidCiphertext on bad input.
+void aesCBCEncrypt(bytesConstRef _plain, std::string const& _key, int _keyLen, bytesConstRef _iv, bytes& o_cipher);
+void aesCBCDecrypt(bytesConstRef _cipher, std::string const& _key, int _keyLen, bytesConstRef _iv, bytes& o_plain);
+void aesCBCDecrypt(bytesConstRef _cipher, std::string const& _key, int _keyLen, bytesConstRef _iv, std::string& o_plain);
 }
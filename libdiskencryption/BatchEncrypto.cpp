@@ -25,6 +25,7 @@
 #include <libdevcrypto/AES.h> // 通过AES加密
 #include <libdevcore/FileSystem.h>
 #include <libdevcore/easylog.h>
+#include <libdevcore/ThreadPool.h>
 //#include "LRUCache.h"
 
 #include <iostream>
@@ -58,6 +59,7 @@ BatchEncrypto::BatchEncrypto(void)
 	m_cryptoMod = dev::getCryptoMod();
 	map<int,string> keyData = dev::getDataKey();
 	m_superKey = keyData[0] + keyData[1] + keyData[2] + keyData[3];
+	m_ivData = m_superKey.substr(0,16);
 	//LOG(DEBUG)<<"BatchEncrypto::CacheSize:"<<s_newlrucache->size();
 }
 
@@ -85,9 +87,9 @@ ldb::Status BatchEncrypto::Put(ldb::Slice const& key, ldb::Slice const& value)
 			LOG(DEBUG)<<"BatchEncrypto::InsertDataToCache";*/
 
 		
-			bytes enData = enCryptoData(value.ToString());
-			//LOG(DEBUG)<<"BatchEncrypto::enCryptoData:"<<asString(enData);
-			ldb::WriteBatch::Put(key,(ldb::Slice)dev::ref(enData));
+			aesCBCEncrypt(bytesConstRef((const unsigned char*)value.data(),value.size()),m_superKey,m_superKey.length(),bytesConstRef(&m_ivData),m_buffer);
+			//LOG(DEBUG)<<"BatchEncrypto::enCryptoData:"<<asString(m_buffer);
+			ldb::WriteBatch::Put(key,(ldb::Slice)dev::ref(m_buffer));
 		}
 		catch(Exception& e)
 		{
@@ -98,33 +100,51 @@ ldb::Status BatchEncrypto::Put(ldb::Slice const& key, ldb::Slice const& value)
 	return _status;
 }
 
+ldb::Status BatchEncrypto::PutAll(std::vector<std::pair<ldb::Slice, ldb::Slice>> const& entries)
+{
+	// 少量数据直接逐条加密，线程切换不划算
+	static const size_t c_parallelMin = 64;
+	if (m_cryptoMod == CRYPTO_DEFAULT || entries.size() < c_parallelMin)
+	{
+		for (auto const& e: entries)
+			Put(e.first, e.second);
+		return ldb::Status();
+	}
+
+	static ThreadPool s_cryptoPool("crypt");
+	vector<bytes> enData(entries.size());
+	s_cryptoPool.parallelFor(entries.size(), [&](size_t i)
+	{
+		aesCBCEncrypt(bytesConstRef((const unsigned char*)entries[i].second.data(),entries[i].second.size()),m_superKey,m_superKey.length(),bytesConstRef(&m_ivData),enData[i]);
+	});
+	// 按原顺序写入，与逐条Put的结果一致
+	for (size_t i = 0; i < entries.size(); ++i)
+		ldb::WriteBatch::Put(entries[i].first,(ldb::Slice)dev::ref(enData[i]));
+	return ldb::Status();
+}
 
 bytes BatchEncrypto::enCryptoData(std::string const& v)
 {  
-	string ivData = m_superKey.substr(0,16);
-	bytes enData = aesCBCEncrypt(bytesConstRef(&v),m_superKey,m_superKey.length(),bytesConstRef{(const unsigned char*)ivData.c_str(),ivData.length()});
+	bytes enData = aesCBCEncrypt(bytesConstRef(&v),m_superKey,m_superKey.length(),bytesConstRef(&m_ivData));
 	return enData;
 }
 
 
 bytes BatchEncrypto::enCryptoData(bytesConstRef const& v)
 {  
-	string ivData = m_superKey.substr(0,16);
-	bytes enData = aesCBCEncrypt(v,m_superKey,m_superKey.length(),bytesConstRef{(const unsigned char*)ivData.c_str(),ivData.length()});
+	bytes enData = aesCBCEncrypt(v,m_superKey,m_superKey.length(),bytesConstRef(&m_ivData));
 	return enData;
 }
 
 
 bytes BatchEncrypto::enCryptoData(bytes const& v)
 {
-	string ivData = m_superKey.substr(0,16);
-	bytes enData = aesCBCEncrypt(bytesConstRef(&v),m_superKey,m_superKey.length(),bytesConstRef{(const unsigned char*)ivData.c_str(),ivData.length()});
+	bytes enData = aesCBCEncrypt(bytesConstRef(&v),m_superKey,m_superKey.length(),bytesConstRef(&m_ivData));
 	return enData;
 }
 
 bytes BatchEncrypto::deCryptoData(std::string const& v) const
 {
-	string ivData = m_superKey.substr(0,16);
-	bytes deData = aesCBCDecrypt(bytesConstRef{(const unsigned char*)v.c_str(),v.length()},m_superKey,m_superKey.length(),bytesConstRef{(const unsigned char*)ivData.c_str(),ivData.length()});
+	bytes deData = aesCBCDecrypt(bytesConstRef{(const unsigned char*)v.c_str(),v.length()},m_superKey,m_superKey.length(),bytesConstRef(&m_ivData));
 	return deData;
 }
\ No newline at end of file
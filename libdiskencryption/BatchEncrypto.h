@@ -23,6 +23,7 @@
 
 #pragma once
 #include <iostream>
+#include <vector>
 #include <libdevcore/db.h>
 #include <leveldb/db.h>
 #include <libdevcore/Common.h>
@@ -35,6 +36,8 @@ class BatchEncrypto: public ldb::WriteBatch
 private:
 	int m_cryptoMod;
 	string m_superKey;
+	string m_ivData;
+	bytes m_buffer;		///< Reused for the ciphertext of each Put.
 	enum CRYPTOTYPE
 	{
 		CRYPTO_DEFAULT = 0,
@@ -51,4 +54,6 @@ public:
 	BatchEncrypto(void);
 	~BatchEncrypto(void);
 	ldb::Status Put(ldb::Slice const& key, ldb::Slice const& value);
+	/// Same as calling Put for each entry in order, but large sets are encrypted on several threads.
+	ldb::Status PutAll(std::vector<std::pair<ldb::Slice, ldb::Slice>> const& entries);
 };
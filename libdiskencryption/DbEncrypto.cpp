@@ -68,6 +68,7 @@ DbEncrypto::DbEncrypto(ldb::DB* _db)
 	m_cryptoMod = dev::getCryptoMod();
 	map<int,string> keyData = dev::getDataKey();
 	m_superKey = keyData[0] + keyData[1] + keyData[2] + keyData[3];
+	m_ivData = m_superKey.substr(0,16);
 	LOG(DEBUG)<<"DbEncrypto::cryptoMod:"<<m_cryptoMod;
 	LOG(DEBUG)<<"DbEncrypto::m_db:"<<m_db;
 	//LOG(DEBUG)<<"DbEncrypto::CacheSize:"<<s_newlrucache->size();
@@ -109,9 +110,10 @@ ldb::Status DbEncrypto::Put(const ldb::WriteOptions& options, const ldb::Slice&
 			LOG(DEBUG)<<"DbEncrypto::InsertDataToCache";*/
 
 			//数据加密
-			bytes enData = enCryptoData(value.ToString());
-			//LOG(DEBUG)<<"DbEncrypto::enCryptoData:"<<asString(enData);
-			_status = m_db->Put(options,key,(ldb::Slice)dev::ref(enData));
+			static thread_local bytes s_enData;
+			aesCBCEncrypt(bytesConstRef((const unsigned char*)value.data(),value.size()),m_superKey,m_superKey.length(),bytesConstRef(&m_ivData),s_enData);
+			//LOG(DEBUG)<<"DbEncrypto::enCryptoData:"<<asString(s_enData);
+			_status = m_db->Put(options,key,(ldb::Slice)dev::ref(s_enData));
 		}
 		catch (Exception& ex)
 		{
@@ -166,9 +168,11 @@ ldb::Status DbEncrypto::Get(const ldb::ReadOptions& options,const ldb::Slice& ke
 		{
 			try
 			{
-				bytes deData = deCryptoData(*value);
-				//LOG(DEBUG)<<"DbEncrypto::deCryptoData:"<<asString(deData);
-				*value = asString(deData);
+				// 解密到线程内缓冲区后与value交换，避免每次读都分配内存
+				static thread_local string s_deData;
+				aesCBCDecrypt(bytesConstRef(value),m_superKey,m_superKey.length(),bytesConstRef(&m_ivData),s_deData);
+				//LOG(DEBUG)<<"DbEncrypto::deCryptoData:"<<s_deData;
+				value->swap(s_deData);
 			}catch(Exception& e)
 			{
 				LOG(ERROR)<<"DbEncrypto::deCryptoData error";
@@ -191,30 +195,26 @@ ldb::Iterator* DbEncrypto::NewIterator(const ldb::ReadOptions& options)
 
 bytes DbEncrypto::enCryptoData(std::string const& v)
 {  
-	string ivData = m_superKey.substr(0,16);
-	bytes enData = aesCBCEncrypt(bytesConstRef(&v),m_superKey,m_superKey.length(),bytesConstRef{(const unsigned char*)ivData.c_str(),ivData.length()});
+	bytes enData = aesCBCEncrypt(bytesConstRef(&v),m_superKey,m_superKey.length(),bytesConstRef(&m_ivData));
 	return enData;
 }
 
 
 bytes DbEncrypto::enCryptoData(bytesConstRef const& v)
 {  
-	string ivData = m_superKey.substr(0,16);
-	bytes enData = aesCBCEncrypt(v,m_superKey,m_superKey.length(),bytesConstRef{(const unsigned char*)ivData.c_str(),ivData.length()});
+	bytes enData = aesCBCEncrypt(v,m_superKey,m_superKey.length(),bytesConstRef(&m_ivData));
 	return enData;
 }
 
 
 bytes DbEncrypto::enCryptoData(bytes const& v)
 {
-	string ivData = m_superKey.substr(0,16);
-	bytes enData = aesCBCEncrypt(bytesConstRef(&v),m_superKey,m_superKey.length(),bytesConstRef{(const unsigned char*)ivData.c_str(),ivData.length()});
+	bytes enData = aesCBCEncrypt(bytesConstRef(&v),m_superKey,m_superKey.length(),bytesConstRef(&m_ivData));
 	return enData;
 }
 
 bytes DbEncrypto::deCryptoData(std::string const& v) const
 {
-	string ivData = m_superKey.substr(0,16);
-	bytes deData = aesCBCDecrypt(bytesConstRef{(const unsigned char*)v.c_str(),v.length()},m_superKey,m_superKey.length(),bytesConstRef{(const unsigned char*)ivData.c_str(),ivData.length()});
+	bytes deData = aesCBCDecrypt(bytesConstRef{(const unsigned char*)v.c_str(),v.length()},m_superKey,m_superKey.length(),bytesConstRef(&m_ivData));
 	return deData;
 }
@@ -36,6 +36,7 @@ private:
 	ldb::DB *m_db;
 	int m_cryptoMod;
 	string m_superKey;
+	string m_ivData;//m_superKey前16字节，构造时取一次，避免每次读写都分配
 	int m_dbFlag;//是否在类内创建m_db对象
 	enum CRYPTOTYPE
 	{
@@ -94,6 +94,10 @@ struct ChainOperationParams
 
 	std::string listenIp;
 	int cryptoMod = 0;	//数据落盘加密方式  0：不进行加密 1：使用简单加密 2：使用keycenter加密
+	unsigned stateCacheSize = 64;	//状态库节点缓存大小(MB)，缓存解密后的节点  0：不缓存
+	unsigned extrasCacheSize = 64;	//区块附加数据(收据、交易位置、bloom等)缓存大小(MB)
+	bool asyncPersist = false;	//区块、状态数据由后台线程合并落盘
+	bool logIndex = true;	//日志按合约地址、topic建倒排索引，加速eth_getLogs
 	int cryptoprivatekeyMod = 0;//0：私钥不使用keycenter加密 1：私钥使用keycenter加密
 	int ssl = 0;//0:不启用SSL 1:启用SSL进行通信
 	int rpcPort = 6789;
@@ -112,8 +116,11 @@ struct ChainOperationParams
 	std::string rateLimitConfig;
 	int statsInterval;//接口统计间隔 按秒计
 	int channelPort = 0;
+	unsigned channelReadSize = 16384; // 链上链下连接每次read的字节数
+	unsigned channelWorkers = 0; // 链上链下请求处理线程数 0：使用CPU核数
 
 	std::string vmKind;
+	unsigned jitThreshold = 2; // smart虚拟机：合约在解释器中执行多少次后提交JIT编译
 	unsigned networkId;
 	int logVerbosity = 4;
 
@@ -121,6 +128,12 @@ struct ChainOperationParams
 
 	bool broadcastToNormalNode = false; // 是否在PBFT共识阶段广播信息给非记账者
 
+	bool parallelExec = false; // 是否并行执行块内交易（仅interpreter虚拟机）
+	unsigned parallelExecThreads = 0; // 并行执行线程数 0：使用CPU核数
+
+	bool pbftPipeline = false; // PBFT流水线出块：当前块收集commit时，下一块即开始打包执行
+	unsigned packingTimeBudget = 0; // 每块交易执行时间预算(ms)，0：按出块间隔剩余时间
+
 
 	u256 godMinerStart = 0;
 	u256 godMinerEnd = 0;
@@ -84,6 +84,7 @@ DEV_SIMPLE_EXCEPTION(NoCallPermission);
 DEV_SIMPLE_EXCEPTION(NoTxPermission);
 
 DEV_SIMPLE_EXCEPTION(DatabaseAlreadyOpen);
+DEV_SIMPLE_EXCEPTION(DatabaseConnectFailed);
 DEV_SIMPLE_EXCEPTION(DAGCreationFailure);
 DEV_SIMPLE_EXCEPTION(DAGComputeFailure);
 
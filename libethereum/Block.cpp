@@ -39,6 +39,8 @@
 #include "TransactionQueue.h"
 #include "GenesisInfo.h"
 #include "SystemContractApi.h"
+#include "ParallelExecutor.h"
+#include "PackingScheduler.h"
 
 using namespace std;
 using namespace dev;
@@ -81,6 +83,8 @@ Block::Block(Block const& _s):
     m_transactionSet(_s.m_transactionSet),
     m_precommit(_s.m_state),
     m_previousBlock(_s.m_previousBlock),
+    m_previousUnsaved(_s.m_previousUnsaved),
+    m_previousPending(_s.m_previousPending),
     m_currentBlock(_s.m_currentBlock),
     m_currentBytes(_s.m_currentBytes),
     m_author(_s.m_author),
@@ -99,6 +103,8 @@ Block& Block::operator=(Block const& _s)
     m_receipts = _s.m_receipts;
     m_transactionSet = _s.m_transactionSet;
     m_previousBlock = _s.m_previousBlock;
+    m_previousUnsaved = _s.m_previousUnsaved;
+    m_previousPending = _s.m_previousPending;
     m_currentBlock = _s.m_currentBlock;
     m_currentBytes = _s.m_currentBytes;
     m_author = _s.m_author;
@@ -249,6 +255,8 @@ bool Block::sync(BlockChain const& _bc, h256 const& _block, BlockHeader const& _
         // We mined the last block.
         // Our state is good - we just need to move on to next.
         m_previousBlock = m_currentBlock;
+        m_previousUnsaved = false;
+        m_previousPending.clear();
         resetCurrent();                 //更新为空块
         ret = true;
     }
@@ -271,6 +279,8 @@ bool Block::sync(BlockChain const& _bc, h256 const& _block, BlockHeader const& _
             BOOST_THROW_EXCEPTION(InvalidStateRoot() << errinfo_target(bi.stateRoot()));
         }
         m_previousBlock = bi;
+        m_previousUnsaved = false;
+        m_previousPending.clear();
         resetCurrent();
         ret = true;
     }
@@ -316,7 +326,19 @@ bool Block::sync(BlockChain const& _bc, h256 const& _block, BlockHeader const& _
     return ret;
 }
 
-pair<TransactionReceipts, bool> Block::sync(BlockChain const& _bc, TransactionQueue& _tq, GasPricer const& _gp, bool _exec, u256 const& _max_block_txs)
+void Block::syncOnto(Block const& _parent)
+{
+    Address author = m_author;
+    *this = _parent;
+    m_author = author;
+
+    m_previousBlock = _parent.info();
+    m_previousUnsaved = true;
+    m_previousPending = _parent.pending();
+    resetCurrent();
+}
+
+pair<TransactionReceipts, bool> Block::sync(BlockChain const& _bc, TransactionQueue& _tq, GasPricer const& _gp, bool _exec, u256 const& _max_block_txs, uint64_t _budgetUs)
 {
     LOG(TRACE) << "Block::sync ";
 
@@ -338,14 +360,32 @@ pair<TransactionReceipts, bool> Block::sync(BlockChain const& _bc, TransactionQu
     //ret.second = (ts.size() == max_sync_txs);  // say there's more to the caller if we hit the limit
     auto ts = _tq.allTransactions();
 
+    // 父块尚未上链时，其交易仍在队列中，跳过即可
+    h256Hash previousSet;
+    for (auto const& t : m_previousPending)
+        previousSet.insert(t.sha3());
+
     LastHashes lh;
     unsigned goodTxs = 0;
+    uint64_t packedUs = 0;
+    bool budgetReached = false;
     //for (int goodTxs = max(0, (int)ts.size() - 1); goodTxs < (int)ts.size(); )
     {
         //goodTxs = 0;
         for (auto const& t : ts)
-            if (!m_transactionSet.count(t.sha3()))
+            if (!m_transactionSet.count(t.sha3()) && !previousSet.count(t.sha3()))
             {
+                uint64_t costUs = 0;
+                if (_budgetUs)
+                {
+                    costUs = PackingScheduler::instance().predict(t);
+                    if (goodTxs > 0 && packedUs + costUs > _budgetUs)
+                    {
+                        budgetReached = true;
+                        break;
+                    }
+                }
+
                 try
                 {
                     LOG(INFO) << " Hash=" << (t.sha3()) << ",Randid=" << t.randomid() << ",打包=" << utcTime();
@@ -368,7 +408,7 @@ pair<TransactionReceipts, bool> Block::sync(BlockChain const& _bc, TransactionQu
                         }
                     }*/
 
-                    if ( ! _bc.isBlockLimitOk(t)  ) //blocklimit 检查
+                    if ( ! _bc.isBlockLimitOk(t) || m_previousBlock.number() >= t.blockLimit() ) //blocklimit 检查
                     {
                         LOG(WARNING) << "Block::sync " << t.sha3() << " transition blockLimit=" << t.blockLimit() << " chain number=" << _bc.number();
                         BOOST_THROW_EXCEPTION(BlockLimitCheckFail());
@@ -385,6 +425,11 @@ pair<TransactionReceipts, bool> Block::sync(BlockChain const& _bc, TransactionQu
                         if ( (m_transactions[pIndex].from() == t.from() ) && (m_transactions[pIndex].randomid() == t.randomid()) )
                             BOOST_THROW_EXCEPTION(NonceCheckFail());
                     }//for
+                    for ( size_t pIndex = 0; pIndex < m_previousPending.size(); pIndex++) //父块尚未上链时，其交易也不能重复出现
+                    {
+                        if ( (m_previousPending[pIndex].from() == t.from() ) && (m_previousPending[pIndex].randomid() == t.randomid()) )
+                            BOOST_THROW_EXCEPTION(NonceCheckFail());
+                    }//for
 
                     if (_exec) {
                         u256 _t = _gp.ask(*this);
@@ -393,7 +438,7 @@ pair<TransactionReceipts, bool> Block::sync(BlockChain const& _bc, TransactionQu
                             _t = 0;
                         //Timer t;
                         if (lh.empty())
-                            lh = _bc.lastHashes();
+                            lh = lastHashes(_bc);
                         execute(lh, t, Permanence::Committed, OnOpFunc(), &_bc);
                         ret.first.push_back(m_receipts.back());
                     } else {
@@ -402,6 +447,7 @@ pair<TransactionReceipts, bool> Block::sync(BlockChain const& _bc, TransactionQu
                         m_transactionSet.insert(t.sha3());
                     }
                     ++goodTxs;
+                    packedUs += costUs;
                 }
                 catch ( FilterCheckFail const& in)
                 {
@@ -477,12 +523,12 @@ pair<TransactionReceipts, bool> Block::sync(BlockChain const& _bc, TransactionQu
                     break;
                 }
             }
-        ret.second = (goodTxs >= max_sync_txs);
+        ret.second = (goodTxs >= max_sync_txs) || budgetReached;
     }
     return ret;
 }
 
-TransactionReceipts Block::exec(BlockChain const& _bc, TransactionQueue& _tq)
+TransactionReceipts Block::exec(BlockChain const& _bc, TransactionQueue& _tq, ParallelExecHint const* _hint)
 {
     LOG(TRACE) << "Block::exec ";
 
@@ -496,7 +542,28 @@ TransactionReceipts Block::exec(BlockChain const& _bc, TransactionQueue& _tq)
 
     LastHashes lh;
     DEV_TIMED_ABOVE("lastHashes", 500)
-    lh = _bc.lastHashes();
+    lh = lastHashes(_bc);
+
+    if (parallelExecEnabled(m_transactions.size()))
+    {
+        size_t first = m_receipts.size();
+        Timer timer;
+        DEV_TIMED_ABOVE("txExecParallel,blk=" + toString(info().number()) + ",txs=" + toString(m_transactions.size()), 500)
+        try
+        {
+            executeParallel(lh, m_transactions, Permanence::OnlyReceipt, &_bc, _hint ? _hint->serialMask(m_transactions.size()) : vector<bool>());
+        }
+        catch (Exception& ex)
+        {
+            if (unsigned const* idx = boost::get_error_info<errinfo_transactionIndex>(ex))
+                _tq.drop(m_transactions[*idx].sha3());
+            throw;
+        }
+        // Per-transaction times are not observable here; share the wall time out by predicted cost.
+        PackingScheduler::instance().noteExecuted(m_transactions, uint64_t(timer.elapsed() * 1000000));
+        ret.assign(m_receipts.begin() + first, m_receipts.end());
+        return ret;
+    }
 
     unsigned i = 0;
     DEV_TIMED_ABOVE("txExec,blk=" + toString(info().number()) + ",txs=" + toString(m_transactions.size()), 500)
@@ -505,7 +572,9 @@ TransactionReceipts Block::exec(BlockChain const& _bc, TransactionQueue& _tq)
         try
         {
             LOG(TRACE) << "Block::exec transaction: " << tr.randomid() << tr.from() /*<< state().transactionsFrom(tr.from()) */ << tr.value() << toString(tr.sha3());
+            Timer timer;
             execute(lh, tr, Permanence::OnlyReceipt, OnOpFunc(), &_bc);
+            PackingScheduler::instance().noteExecuted(tr, uint64_t(timer.elapsed() * 1000000));
         }
         catch (Exception& ex)
         {
@@ -525,7 +594,7 @@ TransactionReceipts Block::exec(BlockChain const& _bc, TransactionQueue& _tq)
     return ret;
 }
 
-u256 Block::enactOn(VerifiedBlockRef const& _block, BlockChain const& _bc, bool _statusCheck)
+u256 Block::enactOn(VerifiedBlockRef const& _block, BlockChain const& _bc, bool _statusCheck, ParallelExecHint const* _hint)
 {
     noteChain(_bc);
 
@@ -568,7 +637,9 @@ u256 Block::enactOn(VerifiedBlockRef const& _block, BlockChain const& _bc, bool
 
     //??问题2 重新设置m_previousBlock为 之前的父block
     m_previousBlock = biParent;
-    auto ret = enact(_block, _bc, true, _statusCheck); //执行块里面所有的交易 要检查权限
+    m_previousUnsaved = false;
+    m_previousPending.clear();
+    auto ret = enact(_block, _bc, true, _statusCheck, _hint); //执行块里面所有的交易 要检查权限
 
 #if ETH_TIMED_ENACTMENTS
     enactment = t.elapsed();
@@ -578,7 +649,17 @@ u256 Block::enactOn(VerifiedBlockRef const& _block, BlockChain const& _bc, bool
     return ret;
 }
 
-u256 Block::enact(VerifiedBlockRef const& _block, BlockChain const& _bc, bool _filtercheck, bool _statusCheck)
+u256 Block::enactOn(VerifiedBlockRef const& _block, BlockChain const& _bc, Block const& _parent, ParallelExecHint const* _hint)
+{
+    noteChain(_bc);
+
+    _block.info.verify(CheckNothingNew/*CheckParent*/, _parent.info());
+
+    syncOnto(_parent);
+    return enact(_block, _bc, true, false, _hint);
+}
+
+u256 Block::enact(VerifiedBlockRef const& _block, BlockChain const& _bc, bool _filtercheck, bool _statusCheck, ParallelExecHint const* _hint)
 {
     noteChain(_bc);
 
@@ -603,41 +684,64 @@ u256 Block::enact(VerifiedBlockRef const& _block, BlockChain const& _bc, bool _f
 
     LastHashes lh;
     DEV_TIMED_ABOVE("lastHashes", 500)
-    lh = _bc.lastHashes(m_currentBlock.parentHash());
+    lh = lastHashes(_bc);
 
     RLP rlp(_block.block);
 
     vector<bytes> receipts;
 
     LOG(TRACE) << "Block:enact tx_num=" << _block.transactions.size();
-    // All ok with the block generally. Play back the transactions now...
-    unsigned i = 0;
-    DEV_TIMED_ABOVE("txExec,blk=" + toString(_block.info.number()) + ",txs=" + toString(_block.transactions.size()), 500)
-    for (Transaction const& tr : _block.transactions)
+
+    // Only trust the leader's schedule for the block it was made for; without one, play back serially.
+    vector<bool> serial;
+    if (_hint && parallelExecEnabled(_block.transactions.size()))
+        serial = _hint->serialMask(_block.transactions.size());
+    bool parallel = find(serial.begin(), serial.end(), false) != serial.end();
+
+    if (parallel)
     {
-        try
-        {
-            LOG(TRACE) << "Enacting transaction: " << tr.randomid() << tr.from() /*<< state().transactionsFrom(tr.from()) */ << tr.value() << toString(tr.sha3());
-            // 区分从enactOn和populateFromChain
-            execute(lh, tr, Permanence::Committed, OnOpFunc(), (_filtercheck ? (&_bc) : nullptr));
+        size_t first = m_receipts.size();
+        DEV_TIMED_ABOVE("txExecParallel,blk=" + toString(_block.info.number()) + ",txs=" + toString(_block.transactions.size()), 500)
+        executeParallel(lh, _block.transactions, Permanence::Committed, (_filtercheck ? (&_bc) : nullptr), serial);
 
-            //LOG(TRACE) << "Now: " << tr.from() << state().transactionsFrom(tr.from());
-            //LOG(TRACE) << m_state;
+        for (size_t r = first; r < m_receipts.size(); ++r)
+        {
+            RLPStream receiptRLP;
+            m_receipts[r].streamRLP(receiptRLP);
+            receipts.push_back(receiptRLP.out());
         }
-        catch (Exception& ex)
+    }
+    else
+    {
+        // All ok with the block generally. Play back the transactions now...
+        unsigned i = 0;
+        DEV_TIMED_ABOVE("txExec,blk=" + toString(_block.info.number()) + ",txs=" + toString(_block.transactions.size()), 500)
+        for (Transaction const& tr : _block.transactions)
         {
+            try
+            {
+                LOG(TRACE) << "Enacting transaction: " << tr.randomid() << tr.from() /*<< state().transactionsFrom(tr.from()) */ << tr.value() << toString(tr.sha3());
+                // 区分从enactOn和populateFromChain
+                execute(lh, tr, Permanence::Committed, OnOpFunc(), (_filtercheck ? (&_bc) : nullptr));
 
-            ex << errinfo_transactionIndex(i);
-            throw;
-        }
+                //LOG(TRACE) << "Now: " << tr.from() << state().transactionsFrom(tr.from());
+                //LOG(TRACE) << m_state;
+            }
+            catch (Exception& ex)
+            {
 
-        LOG(TRACE) << "Block::enact: t=" << toString(tr.sha3());
-        LOG(TRACE) << "Block::enact: stateRoot=" << toString(m_receipts.back().stateRoot()) << ",gasUsed=" << toString(m_receipts.back().gasUsed()) << ",sha3=" << toString(sha3(m_receipts.back().rlp()));
+                ex << errinfo_transactionIndex(i);
+                throw;
+            }
 
-        RLPStream receiptRLP;
-        m_receipts.back().streamRLP(receiptRLP);
-        receipts.push_back(receiptRLP.out());
-        ++i;
+            LOG(TRACE) << "Block::enact: t=" << toString(tr.sha3());
+            LOG(TRACE) << "Block::enact: stateRoot=" << toString(m_receipts.back().stateRoot()) << ",gasUsed=" << toString(m_receipts.back().gasUsed()) << ",sha3=" << toString(sha3(m_receipts.back().rlp()));
+
+            RLPStream receiptRLP;
+            m_receipts.back().streamRLP(receiptRLP);
+            receipts.push_back(receiptRLP.out());
+            ++i;
+        }
     }
 
     h256 receiptsRoot;
@@ -667,10 +771,12 @@ u256 Block::enact(VerifiedBlockRef const& _block, BlockChain const& _bc, bool _f
     u256 tdIncrease = m_currentBlock.difficulty();
 
     // Check uncles & apply their rewards to state.
-    if (rlp[2].itemCount() > 2)
+    // A block on top of a parent that is not in the chain yet cannot have uncles.
+    unsigned maxUncles = m_previousUnsaved ? 0 : 2;
+    if (rlp[2].itemCount() > maxUncles)
     {
         TooManyUncles ex;
-        ex << errinfo_max(2);
+        ex << errinfo_max(maxUncles);
         ex << errinfo_got(rlp[2].itemCount());
         BOOST_THROW_EXCEPTION(ex);
     }
@@ -678,7 +784,7 @@ u256 Block::enact(VerifiedBlockRef const& _block, BlockChain const& _bc, bool _f
     vector<BlockHeader> rewarded;
     h256Hash excluded;
     DEV_TIMED_ABOVE("allKin", 500)
-    excluded = _bc.allKinFrom(m_currentBlock.parentHash(), 6);
+    excluded = maxUncles ? _bc.allKinFrom(m_currentBlock.parentHash(), 6) : h256Hash{ m_currentBlock.parentHash() };
     excluded.insert(m_currentBlock.hash());
 
     unsigned ii = 0;
@@ -801,14 +907,7 @@ ExecutionResult Block::execute(LastHashes const& _lh, Transaction const& _t, Per
     uncommitToSeal();
 
     if ( _bcp != nullptr )
-    {
-        u256 check = _bcp->filterCheck(_t, FilterCheckScene::BlockExecuteTransation);
-        if ( (u256)SystemContractCode::Ok != check )
-        {
-            LOG(WARNING) << "Block::execute " << _t.sha3() << " transition filterCheck Fail" << check;
-            BOOST_THROW_EXCEPTION(FilterCheckFail());
-        }
-    }
+        checkFilter(*_bcp, _t);
 
     //双VM，线程不安全
     if (VMFactory::getKind() == VMKind::Dual) {
@@ -895,13 +994,30 @@ ExecutionResult Block::execute(LastHashes const& _lh, Transaction const& _t, Per
 
     std::pair<ExecutionResult, TransactionReceipt> resultReceipt = m_state.execute(EnvInfo(info(), _lh, gasUsed(), m_evmCoverLog, m_evmEventLog), *m_sealEngine, _t, _p, _onOp);
 
+    noteExecuted(_t, resultReceipt.second, _p, _bcp);
+
+    return resultReceipt.first;
+}
+
+void Block::checkFilter(BlockChain const& _bc, Transaction const& _t) const
+{
+    u256 check = _bc.filterCheck(_t, FilterCheckScene::BlockExecuteTransation);
+    if ( (u256)SystemContractCode::Ok != check )
+    {
+        LOG(WARNING) << "Block::execute " << _t.sha3() << " transition filterCheck Fail" << check;
+        BOOST_THROW_EXCEPTION(FilterCheckFail());
+    }
+}
+
+void Block::noteExecuted(Transaction const& _t, TransactionReceipt const& _receipt, Permanence _p, BlockChain const* _bcp)
+{
     if (_p == Permanence::Committed)
     {
         // Add to the user-originated transactions that we've executed.
         m_transactions.push_back(_t);
         LOG(TRACE) << "Block::execute: t=" << toString(_t.sha3());
-        m_receipts.push_back(resultReceipt.second);
-        LOG(TRACE) << "Block::execute: stateRoot=" << toString(resultReceipt.second.stateRoot()) << ",gasUsed=" << toString(resultReceipt.second.gasUsed()) << ",sha3=" << toString(sha3(resultReceipt.second.rlp()));
+        m_receipts.push_back(_receipt);
+        LOG(TRACE) << "Block::execute: stateRoot=" << toString(_receipt.stateRoot()) << ",gasUsed=" << toString(_receipt.gasUsed()) << ",sha3=" << toString(sha3(_receipt.rlp()));
         m_transactionSet.insert(_t.sha3());
 
 
@@ -913,11 +1029,97 @@ ExecutionResult Block::execute(LastHashes const& _lh, Transaction const& _t, Per
     // 交易已经同步到m_transactions，这里只需要保存receipt
     if (_p == Permanence::OnlyReceipt)
     {
-        m_receipts.push_back(resultReceipt.second);
-        LOG(TRACE) << "Block::execute: stateRoot=" << toString(resultReceipt.second.stateRoot()) << ",gasUsed=" << toString(resultReceipt.second.gasUsed()) << ",sha3=" << toString(sha3(resultReceipt.second.rlp()));
+        m_receipts.push_back(_receipt);
+        LOG(TRACE) << "Block::execute: stateRoot=" << toString(_receipt.stateRoot()) << ",gasUsed=" << toString(_receipt.gasUsed()) << ",sha3=" << toString(sha3(_receipt.rlp()));
     }
+}
 
-    return resultReceipt.first;
+bool Block::parallelExecEnabled(size_t _txs) const
+{
+    // The JIT/Smart VMs keep process-wide state that is not safe to share between threads.
+    return _txs > 1 && sealEngine()->chainParams().parallelExec && VMFactory::getKind() == VMKind::Interpreter;
+}
+
+void Block::executeParallel(LastHashes const& _lh, Transactions const& _txs, Permanence _p, BlockChain const* _bcp, vector<bool> const& _serial)
+{
+    if (isSealed())
+        BOOST_THROW_EXCEPTION(InvalidOperationOnSealedBlock());
+
+    ParallelExecutor& executor = ParallelExecutor::instance(sealEngine()->chainParams().parallelExecThreads);
+    // Speculative runs see gasUsed 0; the block gas limit is checked below in block order instead.
+    EnvInfo env(info(), _lh, 0, m_evmCoverLog, m_evmEventLog);
+    unsigned replayed = 0;
+
+    for (size_t begin = 0; begin < _txs.size(); begin += executor.windowSize())
+    {
+        size_t end = min<size_t>(begin + executor.windowSize(), _txs.size());
+        vector<Transaction const*> window;
+        vector<size_t> slot(end - begin, (size_t)-1);	// Position of each transaction in window, if speculated.
+        for (size_t i = begin; i < end; ++i)
+            if (_serial.empty() || !_serial[i])
+            {
+                slot[i - begin] = window.size();
+                window.push_back(&_txs[i]);
+            }
+
+        // Each window speculates on everything merged so far, so only conflicts inside it need replaying.
+        uncommitToSeal();
+        State base(m_state);
+        vector<SpeculativeExecution> results = executor.speculate(base, env, *m_sealEngine, window);
+        SpeculativeExecution none;
+
+        StateAccessSet written;	// Writes merged into m_state since base was taken.
+        for (size_t i = begin; i < end; ++i)
+        {
+            Transaction const& t = _txs[i];
+            bool speculated = slot[i - begin] != (size_t)-1;
+            SpeculativeExecution& r = speculated ? results[slot[i - begin]] : none;
+            try
+            {
+                bool conflicted = r.state && r.access.conflictsWith(written);
+                if (r.state && !conflicted && (bigint)gasUsed() + t.gas() <= env.gasLimit())
+                {
+                    if (_bcp)
+                        checkFilter(*_bcp, t);
+                    m_state.applySpeculative(*r.state, r.access);
+                    written.mergeWrites(r.access);
+                    noteExecuted(t, TransactionReceipt(m_state.rootHash(), gasUsed() + r.gasUsed, r.logs, r.contractAddress), _p, _bcp);
+                    executor.noteOutcome(t, false);
+                }
+                else
+                {
+                    // Conflicting or failed: run it again for real on top of everything before it.
+                    StateAccessSet serial;
+                    m_state.setAccessSet(&serial);
+                    try
+                    {
+                        execute(_lh, t, _p, OnOpFunc(), _bcp);
+                    }
+                    catch (...)
+                    {
+                        m_state.setAccessSet(nullptr);
+                        throw;
+                    }
+                    m_state.setAccessSet(nullptr);
+                    // For transactions kept off the speculative path, learn whether that was needed.
+                    if (!speculated)
+                        conflicted = serial.conflictsWith(written);
+                    executor.noteOutcome(t, conflicted);
+                    written.mergeWrites(serial);
+                    if (speculated)
+                        ++replayed;
+                }
+            }
+            catch (Exception& ex)
+            {
+                ex << errinfo_transactionIndex(i);
+                throw;
+            }
+            r.state.reset();
+        }
+    }
+
+    LOG(DEBUG) << "Block::executeParallel blk=" << info().number() << ",txs=" << _txs.size() << ",serial=" << count(_serial.begin(), _serial.end(), true) << ",replayed=" << replayed << ",threads=" << executor.threads();
 }
 
 // 不要奖励了
@@ -962,7 +1164,7 @@ void Block::commitToSeal(BlockChain const& _bc, bytes const& _extraData)
 
     RLPStream unclesData;
     unsigned unclesCount = 0;
-    if (m_previousBlock.number() != 0)
+    if (m_previousBlock.number() != 0 && !m_previousUnsaved)
     {
         // Find great-uncles (or second-cousins or whatever they are) - children of great-grandparents, great-great-grandparents... that were not already uncles in previous generations.
         LOG(INFO) << "Checking " << m_previousBlock.hash() << ", parent=" << m_previousBlock.parentHash();
@@ -1159,6 +1361,18 @@ bool Block::sealBlock(bytesConstRef _header, bytes & _out)
 
 
 
+LastHashes Block::lastHashes(BlockChain const& _bc) const
+{
+    if (!m_previousUnsaved)
+        return _bc.lastHashes(m_previousBlock.hash());
+
+    // The parent is not in the chain yet: put it in front of its own last hashes.
+    LastHashes ret = _bc.lastHashes(m_previousBlock.parentHash());
+    ret.insert(ret.begin(), m_previousBlock.hash());
+    ret.resize(256);
+    return ret;
+}
+
 State Block::fromPending(unsigned _i) const
 {
     State ret = m_state;
@@ -1203,6 +1417,8 @@ void Block::cleanup(bool _fullCommit)
 
 
         m_previousBlock = m_currentBlock;
+        m_previousUnsaved = false;
+        m_previousPending.clear();
         sealEngine()->populateFromParent(m_currentBlock, m_previousBlock);
 
 
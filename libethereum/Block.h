@@ -50,6 +50,7 @@ class BlockChain;
 class State;
 class TransactionQueue;
 struct VerifiedBlockRef;
+struct ParallelExecHint;
 
 
 struct PopulationStatistics
@@ -73,6 +74,7 @@ class Block
 	friend class dev::test::StateLoader;
 	friend class Executive;
 	friend class BlockChain;
+	friend class FilterEvaluator;
 
 public:
 	// TODO: pass in ChainOperationParams rather than u256
@@ -213,20 +215,35 @@ public:
 	ExecutionResult execute(LastHashes const& _lh, Transaction const& _t, Permanence _p = Permanence::Committed, OnOpFunc const& _onOp = OnOpFunc(), BlockChain const *_bc = nullptr);
 
 	/// Sync our transactions, killing those from the queue that we have and assimilating those that we don't.
+	/// If @a _budgetUs is not zero, stop once the execution time predicted by the PackingScheduler for the
+	/// transactions taken in this call would exceed it (at least one is always taken).
 	/// @returns a list of receipts one for each transaction placed from the queue into the state and bool, true iff there are more transactions to be processed.
-	std::pair<TransactionReceipts, bool> sync(BlockChain const& _bc, TransactionQueue& _tq, GasPricer const& _gp, bool _exec = true, u256 const& _max_block_txs = Invalid256);
+	std::pair<TransactionReceipts, bool> sync(BlockChain const& _bc, TransactionQueue& _tq, GasPricer const& _gp, bool _exec = true, u256 const& _max_block_txs = Invalid256, uint64_t _budgetUs = 0);
 
 	/// Sync our state with the block chain.
 	/// This basically involves wiping ourselves if we've been superceded and rebuilding from the transaction queue.
 	bool sync(BlockChain const& _bc);
-	TransactionReceipts exec(BlockChain const& _bc, TransactionQueue& _tq);
+	/// Execute the synced transactions, feeding their execution times to the PackingScheduler.
+	/// @param _hint if given, transactions it marks as conflicting are not executed speculatively.
+	TransactionReceipts exec(BlockChain const& _bc, TransactionQueue& _tq, ParallelExecHint const* _hint = nullptr);
 
 	/// Sync with the block chain, but rather than synching to the latest block, instead sync to the given block.
 	bool sync(BlockChain const& _bc, h256 const& _blockHash, BlockHeader const& _bi = BlockHeader());
 
+	/// Start a new block on top of @a _parent, an executed block that is not in the chain yet.
+	/// Transactions of @a _parent will not be synced from the queue again.
+	void syncOnto(Block const& _parent);
+
 	/// Execute all transactions within a given block.
+	/// If parallel execution is enabled and @a _hint describes the block, its transactions are run
+	/// on the ParallelExecutor following the hint; otherwise they are run one by one.
+	/// @returns the additional total difficulty.
+	u256 enactOn(VerifiedBlockRef const& _block, BlockChain const& _bc, bool _statusCheck = true, ParallelExecHint const* _hint = nullptr);
+
+	/// Execute all transactions within a given block on top of @a _parent, an executed block
+	/// that is not in the chain yet (see syncOnto()). State roots are not checked.
 	/// @returns the additional total difficulty.
-	u256 enactOn(VerifiedBlockRef const& _block, BlockChain const& _bc, bool _statusCheck = true);
+	u256 enactOn(VerifiedBlockRef const& _block, BlockChain const& _bc, Block const& _parent, ParallelExecHint const* _hint = nullptr);
 
 	/// Returns back to a pristine state after having done a playback.
 	/// @arg _fullCommit if true flush everything out to disk. If false, this effectively only validates
@@ -310,7 +327,7 @@ private:
 
 	/// Execute the given block, assuming it corresponds to m_currentBlock.
 	/// Throws on failure.
-	u256 enact(VerifiedBlockRef const& _block, BlockChain const& _bc, bool _filtercheck = false, bool _statusCheck = true);
+	u256 enact(VerifiedBlockRef const& _block, BlockChain const& _bc, bool _filtercheck = false, bool _statusCheck = true, ParallelExecHint const* _hint = nullptr);
 
 	/// Finalise the block, applying the earned rewards.
 	void applyRewards(std::vector<BlockHeader> const& _uncleBlockHeaders, u256 const& _blockReward);
@@ -318,6 +335,24 @@ private:
 	/// @returns gas used by transactions thus far executed.
 	u256 gasUsed() const { return m_receipts.size() ? m_receipts.back().gasUsed() : 0; }
 
+	/// @returns the hashes of the 256 blocks before the current one, which may include a parent not yet in @a _bc.
+	LastHashes lastHashes(BlockChain const& _bc) const;
+
+	/// Throws FilterCheckFail if the permission filter rejects @a _t.
+	void checkFilter(BlockChain const& _bc, Transaction const& _t) const;
+
+	/// Record the receipt (and for Permanence::Committed the transaction) of an executed transaction.
+	void noteExecuted(Transaction const& _t, TransactionReceipt const& _receipt, Permanence _p, BlockChain const* _bcp);
+
+	/// @returns true if @a _txs transactions should go through executeParallel().
+	bool parallelExecEnabled(size_t _txs) const;
+
+	/// Same effect as calling execute(_lh, t, _p, OnOpFunc(), _bcp) for each of @a _txs in order, but runs
+	/// them speculatively on the ParallelExecutor and only replays those that conflict with an earlier one.
+	/// Transactions flagged in @a _serial (if not empty) skip speculation and are executed in place.
+	/// Exceptions carry errinfo_transactionIndex (index into @a _txs).
+	void executeParallel(LastHashes const& _lh, Transactions const& _txs, Permanence _p, BlockChain const* _bcp, std::vector<bool> const& _serial = std::vector<bool>());
+
 	/// Performs irregular modifications right after initialization, e.g. to implement a hard fork.
 	void performIrregularModifications();
 
@@ -331,6 +366,8 @@ private:
 	State m_precommit;							///< State at the point immediately prior to rewards.
 
 	BlockHeader m_previousBlock;				///< The previous block's information.
+	bool m_previousUnsaved = false;				///< Is the previous block not in the chain yet? (see syncOnto())
+	Transactions m_previousPending;				///< The previous block's transactions, if it is not in the chain yet.
 	BlockHeader m_currentBlock;					///< The current block's information.
 	bytes m_currentBytes;						///< The current block's bytes.
 	bool m_committedToSeal = false;				///< Have we committed to mine on the present m_currentBlock?
@@ -45,7 +45,6 @@
 #include "NodeConnParamsManagerApi.h"
 #include <libdevcore/easylog.h>
 #include <libdiskencryption/BatchEncrypto.h>
-#include <libweb3jsonrpc/RPCallback.h>
 
 using namespace std;
 using namespace dev;
@@ -58,11 +57,19 @@ namespace fs = boost::filesystem;
 
 
 
+#if ETH_ODBC
+// The ODBC backends cannot scan key ranges, which the log index needs.
+static const bool c_logIndexSupported = false;
+#else
+static const bool c_logIndexSupported = true;
+#endif
+
 u256 BlockChain::maxBlockLimit = 1000;
 
 std::ostream& dev::eth::operator<<(std::ostream& _out, BlockChain const& _bc)
 {
 	string cmp = toBigEndianString(_bc.currentHash());
+	PersistenceWriter::instance().flush();
 	auto it = _bc.m_blocksDB->NewIterator(_bc.m_readOptions);
 	for (it->SeekToFirst(); it->Valid(); it->Next())
 		if (it->key().ToString() != "best")
@@ -113,15 +120,6 @@ ldb::Slice dev::eth::toSlice(uint64_t _n, unsigned _sub)
 #endif
 }
 
-namespace dev
-{
-class WriteBatchNoter: public ldb::WriteBatch::Handler
-{
-	virtual void Put(ldb::Slice const& _key, ldb::Slice const& _value) { LOG(INFO) << "Put" << toHex(bytesConstRef(_key)) << "=>" << toHex(bytesConstRef(_value)); }
-	virtual void Delete(ldb::Slice const& _key) { LOG(INFO) << "Delete" << toHex(bytesConstRef(_key)); }
-};
-}
-
 #if ETH_DEBUG&&0
 static const chrono::system_clock::duration c_collectionDuration = chrono::seconds(15);
 static const unsigned c_collectionQueueSize = 2;
@@ -150,7 +148,9 @@ BlockChain::BlockChain(std::shared_ptr<Interface> _interface, ChainParams const&
 	init(_p, _dbPath);
 	open(_dbPath, _we, _pc);
 
-	m_pnoncecheck->init(*this );
+	string path = _dbPath.empty() ? Defaults::get()->m_dbPath : _dbPath;
+	string extrasPath = path + "/" + toHex(m_genesisHash.ref().cropped(0, 4)) + "/" + toString(c_databaseVersion);
+	m_pnoncecheck->init(*this, extrasPath + "/noncecheck");
 
 	m_interface = _interface;
 }
@@ -196,6 +196,10 @@ void BlockChain::updateCache(Address address) const {
 	m_interface->updateCache(address);
 }
 
+bool BlockChain::isSystemContract(Address const& _a) const {
+	return m_interface->isSystemContract(_a);
+}
+
 BlockHeader const& BlockChain::genesis() const
 {
 	UpgradableGuard l(x_genesis);
@@ -218,7 +222,25 @@ void BlockChain::init(ChainParams const& _p, std::string const& _path)
 
 	// Initialise with the genesis as the last block on the longest chain.
 	m_params = _p;
+
+	// Share out the extras cache budget; receipts are the largest and most often asked for over RPC.
+	size_t extrasCache = size_t(m_params.extrasCacheSize) * 1024 * 1024;
+	m_receipts.setCapacity(extrasCache * 4 / 10);
+	m_details.setCapacity(extrasCache * 15 / 100);
+	m_transactionAddresses.setCapacity(extrasCache * 15 / 100);
+	m_logBlooms.setCapacity(extrasCache / 10);
+	m_blocksBlooms.setCapacity(extrasCache / 10);
+	m_blockHashes.setCapacity(extrasCache / 10);
+	m_receipts.setMetrics("receipts");
+	m_details.setMetrics("details");
+	m_transactionAddresses.setMetrics("transactionAddresses");
+	m_logBlooms.setMetrics("logBlooms");
+	m_blocksBlooms.setMetrics("blocksBlooms");
+	m_blockHashes.setMetrics("blockHashes");
 	m_sealEngine.reset(m_params.createSealEngine());
+	map<int, string> keyData = getDataKey();
+	m_dataKey = keyData[0] + keyData[1] + keyData[2] + keyData[3];
+	m_dataIv = m_dataKey.substr(0, 16);
 	m_genesis.clear();
 	genesis();
 
@@ -319,8 +341,9 @@ unsigned BlockChain::open(std::string const& _path, WithExisting _we)
 	{
 		BlockHeader gb(m_params.genesisBlock());
 		// Insert details of genesis block.
-		m_details[m_genesisHash] = BlockDetails(0, gb.difficulty(), h256(), {});
-		auto r = m_details[m_genesisHash].rlp();
+		BlockDetails gd(0, gb.difficulty(), h256(), {});
+		auto r = gd.rlp();
+		m_details.put(m_genesisHash, make_shared<BlockDetails const>(gd));
 
 		if (dev::getCryptoMod() != CRYPTO_DEFAULT)
 		{
@@ -344,13 +367,17 @@ unsigned BlockChain::open(std::string const& _path, WithExisting _we)
 	m_extrasDB->Get(m_readOptions, ldb::Slice("best"), &l);
 	if (dev::getCryptoMod() != CRYPTO_DEFAULT && !l.empty())
 	{
-		bytes deData = decryptodata(l);
-		l = asString(deData);
+		decryptodataInPlace(l);
 	}
 
 	m_lastBlockHash = l.empty() ? m_genesisHash : *(h256*)l.data();
 	m_lastBlockNumber = number(m_lastBlockHash);
 
+	if (c_logIndexSupported && m_params.logIndex)
+		m_logIndex.reset(new LogIndex(*this, m_extrasDB));
+	else
+		LogIndex::forget(m_extrasDB);
+
 	LOG(TRACE) << "Opened blockchain DB. Latest: " << currentHash() << (lastMinor == c_minorProtocolVersion ? "(rebuild not needed)" : "*** REBUILD NEEDED ***");
 	return lastMinor;
 }
@@ -371,6 +398,10 @@ void BlockChain::reopen(ChainParams const& _p, WithExisting _we, ProgressCallbac
 void BlockChain::close()
 {
 	LOG(TRACE) << "Closing blockchain DB";
+	if (m_pnoncecheck)
+		m_pnoncecheck->saveSnapshot(*this);
+	m_logIndex.reset();
+	PersistenceWriter::instance().flush();
 	// Not thread safe...
 	delete m_extrasDB;
 	delete m_blocksDB;
@@ -407,6 +438,8 @@ void BlockChain::rebuild(std::string const& _path, std::function<void(unsigned,
 	///////////////////////////////
 
 	// Keep extras DB around, but under a temp name
+	m_logIndex.reset();
+	PersistenceWriter::instance().flush();
 	delete m_extrasDB;
 	m_extrasDB = nullptr;
 	boost::filesystem::rename(extrasPath + "/extras", extrasPath + "/extras.old");
@@ -435,17 +468,23 @@ void BlockChain::rebuild(std::string const& _path, std::function<void(unsigned,
 	m_lastBlockHash = genesisHash();
 	m_lastBlockNumber = 0;
 
-	m_details[m_lastBlockHash].totalDifficulty = s.info().difficulty();
+	// The replay below indexes every block again.
+	if (c_logIndexSupported && m_params.logIndex)
+		m_logIndex.reset(new LogIndex(*this, m_extrasDB));
+
+	BlockDetails gd;
+	gd.totalDifficulty = s.info().difficulty();
 
-	auto r = m_details[m_lastBlockHash].rlp();
+	auto r = gd.rlp();
+	m_details.put(m_lastBlockHash, make_shared<BlockDetails const>(gd));
 	if (dev::getCryptoMod() != CRYPTO_DEFAULT)
 	{
-		bytes enData = encryptodata(m_details[m_lastBlockHash].rlp());
+		bytes enData = encryptodata(r);
 		m_extrasDB->Put(m_writeOptions, toSlice(m_lastBlockHash, ExtraDetails), (ldb::Slice)dev::ref(enData));
 	}
 	else
 	{
-		m_extrasDB->Put(m_writeOptions, toSlice(m_lastBlockHash, ExtraDetails), (ldb::Slice)dev::ref(m_details[m_lastBlockHash].rlp()));
+		m_extrasDB->Put(m_writeOptions, toSlice(m_lastBlockHash, ExtraDetails), (ldb::Slice)dev::ref(r));
 	}
 
 	h256 lastHash = m_lastBlockHash;
@@ -459,7 +498,7 @@ void BlockChain::rebuild(std::string const& _path, std::function<void(unsigned,
 		}
 		try
 		{
-			bytes b = block(queryExtras<BlockHash, uint64_t, ExtraBlockHash>(d, m_blockHashes, x_blockHashes, NullBlockHash, oldExtrasDB).value);
+			bytes b = block(orNull(queryExtras<BlockHash, uint64_t, ExtraBlockHash>(d, m_blockHashes, oldExtrasDB), NullBlockHash).value);
 
 			BlockHeader bi(&b);
 
@@ -493,6 +532,7 @@ string BlockChain::dumpDatabase() const
 	stringstream ss;
 
 	ss << m_lastBlockHash << "\n";
+	PersistenceWriter::instance().flush();
 	ldb::Iterator* i = m_extrasDB->NewIterator(m_readOptions);
 	for (i->SeekToFirst(); i->Valid(); i->Next())
 		ss << toHex(bytesConstRef(i->key())) << "/" << toHex(bytesConstRef(i->value())) << "\n";
@@ -750,49 +790,25 @@ void BlockChain::insert(VerifiedBlockRef _block, bytesConstRef _receipts, bool _
 	for (auto i : RLP(_receipts))
 		blb.blooms.push_back(TransactionReceipt(i.data()).bloom());
 
-	// ensure parent is cached for later addition.
-	// TODO: this is a bit horrible would be better refactored into an enveloping UpgradableGuard
-	// together with an "ensureCachedWithUpdatableLock(l)" method.
-	// This is safe in practice since the caches don't get flushed nearly often enough to be
-	// done here.
-	details(_block.info.parentHash());
-	DEV_WRITE_GUARDED(x_details)
-	{
-		if (!dev::contains(m_details[_block.info.parentHash()].children, _block.info.hash()))
-			m_details[_block.info.parentHash()].children.push_back(_block.info.hash());
-	}
+	// Cached values are shared and immutable: update a copy of the parent and replace it.
+	BlockDetails parentDetails = details(_block.info.parentHash());
+	if (!dev::contains(parentDetails.children, _block.info.hash()))
+		parentDetails.children.push_back(_block.info.hash());
+	bytes parentRlp = parentDetails.rlp();
+	m_details.put(_block.info.parentHash(), make_shared<BlockDetails const>(move(parentDetails)));
 
 	blocksBatch.Put(toSlice(_block.info.hash()), ldb::Slice(_block.block));
-	DEV_READ_GUARDED(x_details)
-	extrasBatch.Put(toSlice(_block.info.parentHash(), ExtraDetails), (ldb::Slice)dev::ref(m_details[_block.info.parentHash()].rlp()));
+	extrasBatch.Put(toSlice(_block.info.parentHash(), ExtraDetails), (ldb::Slice)dev::ref(parentRlp));
 
 	BlockDetails bd((unsigned)pd.number + 1, pd.totalDifficulty + _block.info.difficulty(), _block.info.parentHash(), {});
 	extrasBatch.Put(toSlice(_block.info.hash(), ExtraDetails), (ldb::Slice)dev::ref(bd.rlp()));
 	extrasBatch.Put(toSlice(_block.info.hash(), ExtraLogBlooms), (ldb::Slice)dev::ref(blb.rlp()));
 	extrasBatch.Put(toSlice(_block.info.hash(), ExtraReceipts), (ldb::Slice)_receipts);
 
-	ldb::Status o = m_blocksDB->Write(m_writeOptions, &blocksBatch);
-	if (!o.ok())
-	{
-		LOG(WARNING) << "Error writing to blockchain database: " << o.ToString();
-		WriteBatchNoter n;
-		blocksBatch.Iterate(&n);
-		LOG(WARNING) << "Fail writing to blockchain database. Bombing out.";
-		exit(-1);
-	}
-
-	o = m_extrasDB->Write(m_writeOptions, &extrasBatch);
-	if (!o.ok())
-	{
-		LOG(WARNING) << "Error writing to extras database: " << o.ToString();
-		WriteBatchNoter n;
-		extrasBatch.Iterate(&n);
-		LOG(WARNING) << "Fail writing to extras database. Bombing out.";
-		exit(-1);
-	}
+	PersistenceWriter::instance().write({{m_blocksDB, PersistTier::Blocks, blocksBatch}, {m_extrasDB, PersistTier::Extras, extrasBatch}});
 }
 
-void BlockChain::checkBlockValid(h256 const& _hash, bytes const& _block, Block & _outBlock) const {
+void BlockChain::checkBlockValid(h256 const& _hash, bytes const& _block, Block & _outBlock, ParallelExecHint const* _hint, Block const* _parent) const {
 	VerifiedBlockRef block = verifyBlock(&_block, m_onBad, ImportRequirements::Everything);
 
 	if (_hash != block.info.hash()) {
@@ -811,7 +827,12 @@ void BlockChain::checkBlockValid(h256 const& _hash, bytes const& _block, Block &
 		BOOST_THROW_EXCEPTION(AlreadyHaveBlock());
 	}
 
-	if (!isKnown(block.info.parentHash(), false) || !details(block.info.parentHash())) {
+	if (_parent) {
+		if (block.info.parentHash() != _parent->info().hash() || block.info.number() != _parent->info().number() + 1 || _parent->info().number() != info().number() + 1) {
+			LOG(WARNING) << block.info.hash() << ": Not on top of the pending parent " << _parent->info().hash();
+			BOOST_THROW_EXCEPTION(UnknownParent() << errinfo_hash256(block.info.parentHash()));
+		}
+	} else if (!isKnown(block.info.parentHash(), false) || !details(block.info.parentHash())) {
 		LOG(WARNING) << block.info.hash() << ": Unknown parent " << block.info.parentHash();
 		// We don't know the parent (yet) - discard for now. It'll get resent to us if we find out about its ancestry later on.
 		BOOST_THROW_EXCEPTION(UnknownParent() << errinfo_hash256(block.info.parentHash()));
@@ -826,8 +847,9 @@ void BlockChain::checkBlockValid(h256 const& _hash, bytes const& _block, Block &
 	}
 
 	// 要放到UnknownParent检测之后
+	// 流水线出块时父块未上链，且父块不含系统合约交易，记账节点列表与链上最新块相同
 	std::map<std::string, NodeConnParams> all_node;
-	NodeConnManagerSingleton::GetInstance().getAllNodeConnInfo(static_cast<int>(block.info.number() - 1), all_node);
+	NodeConnManagerSingleton::GetInstance().getAllNodeConnInfo(static_cast<int>(block.info.number() - (_parent ? 2 : 1)), all_node);
 	unsigned miner_num = 0;
 	for (auto iter = all_node.begin(); iter != all_node.end(); ++iter) {
 		if (iter->second._iIdentityType == EN_ACCOUNT_TYPE_MINER) {
@@ -869,7 +891,20 @@ void BlockChain::checkBlockValid(h256 const& _hash, bytes const& _block, Block &
 	// 跑一遍交易，但是不验证state_root, receipt_root, gas_used, log_bloom
 	_outBlock.setEvmCoverLog(m_params.evmCoverLog);
 	_outBlock.setEvmEventLog(m_params.evmEventLog);
-	_outBlock.enactOn(block, *this, false);
+	if (_parent) {
+		// 父块尚未上链，其交易的nonce还不在链上，需单独排重
+		std::set<std::pair<Address, u256>> parent_nonces;
+		for (auto const& t : _parent->pending())
+			parent_nonces.insert(std::make_pair(t.from(), t.randomid()));
+		for (auto const& t : block.transactions) {
+			if (parent_nonces.count(std::make_pair(t.from(), t.randomid()))) {
+				LOG(WARNING) << block.info.hash() << ": tx " << t.sha3() << " duplicates a nonce of the pending parent";
+				BOOST_THROW_EXCEPTION(BcNonceCheckError());
+			}
+		}
+		_outBlock.enactOn(block, *this, *_parent, _hint);
+	} else
+		_outBlock.enactOn(block, *this, false, _hint);
 }
 
 //写入db
@@ -1027,14 +1062,11 @@ ImportRoute BlockChain::import(VerifiedBlockRef const& _block, OverlayDB const&
 
 		// All ok - insert into DB
 
-		// ensure parent is cached for later addition.
-		// TODO: this is a bit horrible would be better refactored into an enveloping UpgradableGuard
-		// together with an "ensureCachedWithUpdatableLock(l)" method.
-		// This is safe in practice since the caches don't get flushed nearly often enough to be
-		// done here.
-		details(_block.info.parentHash());
-		DEV_WRITE_GUARDED(x_details)
-		m_details[_block.info.parentHash()].children.push_back(_block.info.hash());
+		// Cached values are shared and immutable: update a copy of the parent and replace it.
+		BlockDetails parentDetails = details(_block.info.parentHash());
+		parentDetails.children.push_back(_block.info.hash());
+		bytes parentRlp = parentDetails.rlp();
+		m_details.put(_block.info.parentHash(), make_shared<BlockDetails const>(move(parentDetails)));
 
 #if ETH_TIMED_IMPORTS
 		collation = t.elapsed();
@@ -1043,12 +1075,13 @@ ImportRoute BlockChain::import(VerifiedBlockRef const& _block, OverlayDB const&
 
 		//这里只写块相关，交易相关只有在是最长链的时候写
 		blocksBatch.Put(toSlice(_block.info.hash()), ldb::Slice(_block.block));//_block.block [0]=head [1]=transactionlist [2]=unclelist [3]=hash [4]=siglist
-		DEV_READ_GUARDED(x_details)
-		extrasBatch.Put(toSlice(_block.info.parentHash(), ExtraDetails), (ldb::Slice)dev::ref(m_details[_block.info.parentHash()].rlp()));
+		extrasBatch.Put(toSlice(_block.info.parentHash(), ExtraDetails), (ldb::Slice)dev::ref(parentRlp));
 
 		extrasBatch.Put(toSlice(_block.info.hash(), ExtraDetails), (ldb::Slice)dev::ref(BlockDetails((unsigned)pd.number + 1, td, _block.info.parentHash(), {}).rlp()));
 		extrasBatch.Put(toSlice(_block.info.hash(), ExtraLogBlooms), (ldb::Slice)dev::ref(blb.rlp()));
 		extrasBatch.Put(toSlice(_block.info.hash(), ExtraReceipts), (ldb::Slice)dev::ref(br.rlp()));
+		if (m_logIndex)
+			LogIndex::write((unsigned)pd.number + 1, br.receipts, extrasBatch);
 
 #if ETH_TIMED_IMPORTS
 		writing = t.elapsed();
@@ -1160,6 +1193,7 @@ ImportRoute BlockChain::import(VerifiedBlockRef const& _block, OverlayDB const&
 
 		// Go through ret backwards (i.e. from new head to common) until hash != last.parent and
 		// update m_transactionAddresses, m_blockHashes
+		std::unordered_map<h256, BlocksBlooms> alteredBlooms;
 		for (auto i = route.rbegin(); i != route.rend() && *i != common; ++i)
 		{
 			BlockHeader tbi;
@@ -1169,22 +1203,19 @@ ImportRoute BlockChain::import(VerifiedBlockRef const& _block, OverlayDB const&
 				tbi = BlockHeader(block(*i));
 
 			// Collate logs into blooms.
-			h256s alteredBlooms;
 			{
 				LogBloom blockBloom = tbi.logBloom();
 				blockBloom.shiftBloom<3>(sha3(tbi.author().ref()));
 
-				// Pre-memoize everything we need before locking x_blocksBlooms
-				for (unsigned level = 0, index = (unsigned)tbi.number(); level < c_bloomIndexLevels; level++, index /= c_bloomIndexSize)
-					blocksBlooms(chunkId(level, index / c_bloomIndexSize));
-
-				WriteGuard l(x_blocksBlooms);
 				for (unsigned level = 0, index = (unsigned)tbi.number(); level < c_bloomIndexLevels; level++, index /= c_bloomIndexSize)
 				{
 					unsigned i = index / c_bloomIndexSize;
 					unsigned o = index % c_bloomIndexSize;
-					alteredBlooms.push_back(chunkId(level, i));
-					m_blocksBlooms[alteredBlooms.back()].blooms[o] |= blockBloom;
+					auto id = chunkId(level, i);
+					auto it = alteredBlooms.find(id);
+					if (it == alteredBlooms.end())
+						it = alteredBlooms.insert(make_pair(id, blocksBlooms(id))).first;
+					it->second.blooms[o] |= blockBloom;
 				}
 			}
 			// Collate transaction hashes and remember who they were.
@@ -1199,13 +1230,16 @@ ImportRoute BlockChain::import(VerifiedBlockRef const& _block, OverlayDB const&
 				//覆盖写 如果同一个交易在不同的链上，一定是指向当前链
 			}
 
-			// Update database with them.
-			ReadGuard l1(x_blocksBlooms);
-			for (auto const& h : alteredBlooms)
-				extrasBatch.Put(toSlice(h, ExtraBlocksBlooms), (ldb::Slice)dev::ref(m_blocksBlooms[h].rlp()));
 			extrasBatch.Put(toSlice(h256(tbi.number()), ExtraBlockHash), (ldb::Slice)dev::ref(BlockHash(tbi.hash()).rlp()));
 		}
 
+		// Update database and cache with the altered blooms.
+		for (auto const& b : alteredBlooms)
+		{
+			extrasBatch.Put(toSlice(b.first, ExtraBlocksBlooms), (ldb::Slice)dev::ref(b.second.rlp()));
+			m_blocksBlooms.put(b.first, make_shared<BlocksBlooms const>(b.second));
+		}
+
 		// FINALLY! change our best hash.
 		{
 			newLastBlockHash = _block.info.hash();
@@ -1224,25 +1258,7 @@ ImportRoute BlockChain::import(VerifiedBlockRef const& _block, OverlayDB const&
 		LOG(INFO) << "   Imported but not best (oTD:" << details(last).totalDifficulty << " > TD:" << td << "; " << details(last).number << ".." << _block.info.number() << ")";
 	}
 
-	ldb::Status o = m_blocksDB->Write(m_writeOptions, &blocksBatch);
-	if (!o.ok())
-	{
-		LOG(WARNING) << "Error writing to blockchain database: " << o.ToString();
-		WriteBatchNoter n;
-		blocksBatch.Iterate(&n);
-		LOG(WARNING) << "Fail writing to blockchain database. Bombing out.";
-		exit(-1);
-	}
-
-	o = m_extrasDB->Write(m_writeOptions, &extrasBatch);
-	if (!o.ok())
-	{
-		LOG(WARNING) << "Error writing to extras database: " << o.ToString();
-		WriteBatchNoter n;
-		extrasBatch.Iterate(&n);
-		LOG(WARNING) << "Fail writing to extras database. Bombing out.";
-		exit(-1);
-	}
+	PersistenceWriter::instance().write({{m_blocksDB, PersistTier::Blocks, blocksBatch}, {m_extrasDB, PersistTier::Extras, extrasBatch}});
 
 #if ETH_PARANOIA
 	if (isKnown(_block.info.hash()) && !details(_block.info.hash()))
@@ -1277,22 +1293,18 @@ ImportRoute BlockChain::import(VerifiedBlockRef const& _block, OverlayDB const&
 			m_lastBlockHash = newLastBlockHash;
 			m_lastBlockNumber = newLastBlockNumber;
 			//这里写的是最后的块hash，这样刚启动的时候就知道当前的高度了
+			ldb::WriteBatch bestBatch;
 			if (dev::getCryptoMod() != CRYPTO_DEFAULT)
 			{
 				bytes enData = encryptodata(ldb::Slice((char const *)m_lastBlockHash.data(), 32));
-				o = m_extrasDB->Put(m_writeOptions, ldb::Slice("best"), ldb::Slice((char const*)enData.data(), enData.size()));
+				bestBatch.Put(ldb::Slice("best"), ldb::Slice((char const*)enData.data(), enData.size()));
 			}
 			else
 			{
-				o = m_extrasDB->Put(m_writeOptions, ldb::Slice("best"), ldb::Slice((char const*)&m_lastBlockHash, 32));
-			}
-			if (!o.ok())
-			{
-				LOG(WARNING) << "Error writing to extras database: " << o.ToString();
-				//cout << "Put" << toHex(bytesConstRef(ldb::Slice("best"))) << "=>" << toHex(bytesConstRef(ldb::Slice((char const*)&m_lastBlockHash, 32)));
-				LOG(WARNING) << "Fail writing to extras database. Bombing out.";
-				exit(-1);
+				bestBatch.Put(ldb::Slice("best"), ldb::Slice((char const*)&m_lastBlockHash, 32));
 			}
+			// 排在本块数据之后落盘
+			PersistenceWriter::instance().write({{m_extrasDB, PersistTier::Extras, bestBatch}});
 		}
 
 
@@ -1300,7 +1312,6 @@ ImportRoute BlockChain::import(VerifiedBlockRef const& _block, OverlayDB const&
 		//更新filter 地址
 		//this->updateSystemContract(goodTransactions);
 		this->updateSystemContract(tempBlock);
-		CallbackWorker::getInstance().addBlock(tempBlock);
 	}
 
 #if ETH_PARANOIA
@@ -1382,8 +1393,10 @@ void BlockChain::clearBlockBlooms(unsigned _begin, unsigned _end)
 				for (auto const& bloom : blocksBlooms(lowerChunkId).blooms)
 					acc |= bloom;
 			}
-			blocksBlooms(id);	// make sure it has been memoized.
-			m_blocksBlooms[id].blooms[offset] = acc;
+			BlocksBlooms bb = blocksBlooms(id);
+			bb.blooms[offset] = acc;
+			bb.rlp();	// refresh size
+			m_blocksBlooms.put(id, make_shared<BlocksBlooms const>(move(bb)));
 		}
 	}
 }
@@ -1448,24 +1461,17 @@ void BlockChain::rewind(unsigned _newHead)
 		m_lastBlockHash = numberHash(_newHead);
 		m_lastBlockNumber = _newHead;
 
-		ldb::Status o;
+		ldb::WriteBatch bestBatch;
 		if (dev::getCryptoMod() != CRYPTO_DEFAULT)
 		{
 			bytes enData = encryptodata(ldb::Slice((const char*)m_lastBlockHash.data(), 32));
-			o = m_extrasDB->Put(m_writeOptions, ldb::Slice("best"), (ldb::Slice)dev::ref(enData));
+			bestBatch.Put(ldb::Slice("best"), (ldb::Slice)dev::ref(enData));
 		}
 		else
 		{
-			o = m_extrasDB->Put(m_writeOptions, ldb::Slice("best"), ldb::Slice((char const*)&m_lastBlockHash, 32));
-		}
-
-		if (!o.ok())
-		{
-			LOG(WARNING) << "Error writing to extras database: " << o.ToString();
-			cout << "Put" << toHex(bytesConstRef(ldb::Slice("best"))) << "=>" << toHex(bytesConstRef(ldb::Slice((char const*)&m_lastBlockHash, 32)));
-			LOG(WARNING) << "Fail writing to extras database. Bombing out.";
-			exit(-1);
+			bestBatch.Put(ldb::Slice("best"), ldb::Slice((char const*)&m_lastBlockHash, 32));
 		}
+		PersistenceWriter::instance().write({{m_extrasDB, PersistTier::Extras, bestBatch}});
 		noteCanonChanged();
 	}
 }
@@ -1532,77 +1538,38 @@ void BlockChain::noteUsed(h256 const& _h, unsigned _extra) const
 		m_inUse.insert(id);
 }
 
-template <class K, class T> static unsigned getHashSize(unordered_map<K, T> const& _map)
-{
-	unsigned ret = 0;
-	for (auto const& i : _map)
-		ret += i.second.size + 64;
-	return ret;
-}
-
 void BlockChain::updateStats() const
 {
 	m_lastStats.memBlocks = 0;
 	DEV_READ_GUARDED(x_blocks)
 	for (auto const& i : m_blocks)
 		m_lastStats.memBlocks += i.second.size() + 64;
-	DEV_READ_GUARDED(x_details)
-	m_lastStats.memDetails = getHashSize(m_details);
-	DEV_READ_GUARDED(x_logBlooms)
-	DEV_READ_GUARDED(x_blocksBlooms)
-	m_lastStats.memLogBlooms = getHashSize(m_logBlooms) + getHashSize(m_blocksBlooms);
-	DEV_READ_GUARDED(x_receipts)
-	m_lastStats.memReceipts = getHashSize(m_receipts);
-	DEV_READ_GUARDED(x_blockHashes)
-	m_lastStats.memBlockHashes = getHashSize(m_blockHashes);
-	DEV_READ_GUARDED(x_transactionAddresses)
-	m_lastStats.memTransactionAddresses = getHashSize(m_transactionAddresses);
+	m_lastStats.memDetails = m_details.size();
+	m_lastStats.memLogBlooms = m_logBlooms.size() + m_blocksBlooms.size();
+	m_lastStats.memReceipts = m_receipts.size();
+	m_lastStats.memBlockHashes = m_blockHashes.size();
+	m_lastStats.memTransactionAddresses = m_transactionAddresses.size();
 }
 
 void BlockChain::garbageCollect(bool _force)
 {
 	updateStats();
 
-	if (!_force && chrono::system_clock::now() < m_lastCollection + c_collectionDuration && m_lastStats.memTotal() < c_maxCacheSize)
+	if (!_force && chrono::system_clock::now() < m_lastCollection + c_collectionDuration && m_lastStats.memBlocks < c_maxCacheSize)
 		return;
-	if (m_lastStats.memTotal() < c_minCacheSize)
+	if (m_lastStats.memBlocks < c_minCacheSize)
 		return;
 
 	m_lastCollection = chrono::system_clock::now();
 
+	// The extras caches bound themselves; only the blocks are collected here.
 	Guard l(x_cacheUsage);
 	WriteGuard l1(x_blocks);
-	WriteGuard l2(x_details);
-	WriteGuard l3(x_blockHashes);
-	WriteGuard l4(x_receipts);
-	WriteGuard l5(x_logBlooms);
-	WriteGuard l6(x_transactionAddresses);
-	WriteGuard l7(x_blocksBlooms);
 	for (CacheID const& id : m_cacheUsage.back())
 	{
 		m_inUse.erase(id);
 		// kill i from cache.
-		switch (id.second)
-		{
-		case (unsigned)-1:
-			m_blocks.erase(id.first);
-			break;
-		case ExtraDetails:
-			m_details.erase(id.first);
-			break;
-		case ExtraReceipts:
-			m_receipts.erase(id.first);
-			break;
-		case ExtraLogBlooms:
-			m_logBlooms.erase(id.first);
-			break;
-		case ExtraTransactionAddress:
-			m_transactionAddresses.erase(id.first);
-			break;
-		case ExtraBlocksBlooms:
-			m_blocksBlooms.erase(id.first);
-			break;
-		}
+		m_blocks.erase(id.first);
 	}
 	m_cacheUsage.pop_back();
 	m_cacheUsage.push_front(std::unordered_set<CacheID> {});
@@ -1610,8 +1577,8 @@ void BlockChain::garbageCollect(bool _force)
 
 void BlockChain::checkConsistency()
 {
-	DEV_WRITE_GUARDED(x_details)
 	m_details.clear();
+	PersistenceWriter::instance().flush();
 	ldb::Iterator* it = m_blocksDB->NewIterator(m_readOptions);
 	for (it->SeekToFirst(); it->Valid(); it->Next())
 		if (it->key().size() == 32)
@@ -1634,10 +1601,8 @@ void BlockChain::checkConsistency()
 void BlockChain::clearCachesDuringChainReversion(unsigned _firstInvalid)
 {
 	unsigned end = number() + 1;
-	DEV_WRITE_GUARDED(x_blockHashes)
 	for (auto i = _firstInvalid; i < end; ++i)
-		m_blockHashes.erase(i);
-	DEV_WRITE_GUARDED(x_transactionAddresses)
+		m_blockHashes.remove(i);
 	m_transactionAddresses.clear();	// TODO: could perhaps delete them individually?
 
 	// If we are reverting previous blocks, we need to clear their blooms (in particular, to
@@ -1740,15 +1705,14 @@ bool BlockChain::isKnown(h256 const& _hash, bool _isCurrent) const
 	if (!m_blocks.count(_hash))
 	{
 		string d;
-		m_blocksDB->Get(m_readOptions, toSlice(_hash), &d);
+		PersistenceWriter::instance().get(m_blocksDB, m_readOptions, toSlice(_hash), &d);
 		if (d.empty())
 			return false;
 	}
-	DEV_READ_GUARDED(x_details)
-	if (!m_details.count(_hash))
+	if (!m_details.get(_hash))
 	{
 		string d;
-		m_extrasDB->Get(m_readOptions, toSlice(_hash, ExtraDetails), &d);
+		PersistenceWriter::instance().get(m_extrasDB, m_readOptions, toSlice(_hash, ExtraDetails), &d);
 		if (d.empty())
 			return false;
 	}
@@ -1771,7 +1735,7 @@ bytes BlockChain::block(h256 const& _hash) const
 	//LOG(TRACE)<<"BlockChain::block"<<_hash;
 
 	string d;
-	m_blocksDB->Get(m_readOptions, toSlice(_hash), &d);
+	PersistenceWriter::instance().get(m_blocksDB, m_readOptions, toSlice(_hash), &d);
 
 	if (d.empty())
 	{
@@ -1780,8 +1744,7 @@ bytes BlockChain::block(h256 const& _hash) const
 	}
 	if (dev::getCryptoMod() != CRYPTO_DEFAULT && !d.empty())
 	{
-		bytes deData = decryptodata(d);
-		d = asString(deData);
+		decryptodataInPlace(d);
 	}
 
 	noteUsed(_hash);
@@ -1806,7 +1769,7 @@ bytes BlockChain::headerData(h256 const& _hash) const
 	}
 
 	string d;
-	m_blocksDB->Get(m_readOptions, toSlice(_hash), &d);
+	PersistenceWriter::instance().get(m_blocksDB, m_readOptions, toSlice(_hash), &d);
 
 	if (d.empty())
 	{
@@ -1815,8 +1778,7 @@ bytes BlockChain::headerData(h256 const& _hash) const
 	}
 	if (dev::getCryptoMod() != CRYPTO_DEFAULT && !d.empty())
 	{
-		bytes deData = decryptodata(d);
-		d = asString(deData);
+		decryptodataInPlace(d);
 	}
 
 	noteUsed(_hash);
@@ -1852,42 +1814,39 @@ Block BlockChain::genesisBlock(OverlayDB const& _db) const
 
 bytes BlockChain::encryptodata(std::string const& v)
 {
-	map<int, string> m_keyData = getDataKey();
-	string dataKey = m_keyData[0] + m_keyData[1] + m_keyData[2] + m_keyData[3];
-	string ivData = dataKey.substr(0, 16);
-	bytes enData = aesCBCEncrypt(bytesConstRef(&v), dataKey, dataKey.length(), bytesConstRef{(const unsigned char*)ivData.c_str(), ivData.length()});
-	return enData;
+	return encryptodata(bytesConstRef(&v));
 }
 
 
 bytes BlockChain::encryptodata(bytesConstRef const& v)
 {
-	map<int, string> m_keyData = getDataKey();
-	string dataKey = m_keyData[0] + m_keyData[1] + m_keyData[2] + m_keyData[3];
-	string ivData = dataKey.substr(0, 16);
-	bytes enData = aesCBCEncrypt(v, dataKey, dataKey.length(), bytesConstRef{(const unsigned char*)ivData.c_str(), ivData.length()});
+	bytes enData;
+	aesCBCEncrypt(v, m_dataKey, m_dataKey.length(), bytesConstRef(&m_dataIv), enData);
 	return enData;
 }
 
 
 bytes BlockChain::encryptodata(bytes const& v)
 {
-	map<int, string> m_keyData = getDataKey();
-	string dataKey = m_keyData[0] + m_keyData[1] + m_keyData[2] + m_keyData[3];
-	string ivData = dataKey.substr(0, 16);
-	bytes enData = aesCBCEncrypt(bytesConstRef(&v), dataKey, dataKey.length(), bytesConstRef{(const unsigned char*)ivData.c_str(), ivData.length()});
-	return enData;
+	return encryptodata(bytesConstRef(&v));
 }
 
 bytes BlockChain::decryptodata(std::string const& v) const
 {
-	map<int, string> m_keyData = getDataKey();
-	string dataKey = m_keyData[0] + m_keyData[1] + m_keyData[2] + m_keyData[3];
-	string ivData = dataKey.substr(0, 16);
-	bytes deData = aesCBCDecrypt(bytesConstRef{(const unsigned char*)v.c_str(), v.length()}, dataKey, dataKey.length(), bytesConstRef{(const unsigned char*)ivData.c_str(), ivData.length()});
+	bytes deData;
+	aesCBCDecrypt(bytesConstRef(&v), m_dataKey, m_dataKey.length(), bytesConstRef(&m_dataIv), deData);
 	return deData;
 }
 
+void BlockChain::decryptodataInPlace(std::string& io_v) const
+{
+	// The plaintext goes to a per-thread buffer which then swaps with io_v, so that after warm-up
+	// reading a value allocates nothing.
+	static thread_local std::string s_plain;
+	aesCBCDecrypt(bytesConstRef(&io_v), m_dataKey, m_dataKey.length(), bytesConstRef(&m_dataIv), s_plain);
+	io_v.swap(s_plain);
+}
+
 
 VerifiedBlockRef BlockChain::verifyBlock(bytesConstRef _block, std::function<void(Exception&)> const& _onBad, ImportRequirements::value _ir) const
 {
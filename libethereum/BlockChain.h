@@ -29,11 +29,14 @@
 #include <libdevcore/easylog.h>
 #include <libdevcore/Exceptions.h>
 #include <libdevcore/Guards.h>
+#include <libdevcore/PersistenceWriter.h>
 #include <libethcore/Common.h>
 #include <libethcore/BlockHeader.h>
 #include <libethcore/SealEngine.h>
 #include <libevm/ExtVMFace.h>
 #include "BlockDetails.h"
+#include "ExtrasCache.h"
+#include "LogIndex.h"
 #include "Account.h"
 #include "Transaction.h"
 #include "BlockQueue.h"
@@ -66,6 +69,7 @@ static const h256s NullH256s;
 class State;
 class Block;
 class NonceCheck;
+struct ParallelExecHint;
 
 DEV_SIMPLE_EXCEPTION(AlreadyHaveBlock);
 DEV_SIMPLE_EXCEPTION(FutureTime);
@@ -96,7 +100,8 @@ enum {
 	ExtraTransactionAddress,
 	ExtraLogBlooms,
 	ExtraReceipts,
-	ExtraBlocksBlooms
+	ExtraBlocksBlooms,
+	ExtraLogIndex
 };
 
 using ProgressCallback = std::function<void(unsigned, unsigned)>;
@@ -163,23 +168,26 @@ public:
 	bytes headerData() const { return headerData(currentHash()); }
 
 	/// Get the familial details concerning a block (or the most recent mined if none given). Thread-safe.
-	BlockDetails details(h256 const& _hash) const { return queryExtras<BlockDetails, ExtraDetails>(_hash, m_details, x_details, NullBlockDetails); }
+	BlockDetails details(h256 const& _hash) const { return orNull(queryExtras<BlockDetails, ExtraDetails>(_hash, m_details), NullBlockDetails); }
 	BlockDetails details() const { return details(currentHash()); }
 
 	/// Get the transactions' log blooms of a block (or the most recent mined if none given). Thread-safe.
-	BlockLogBlooms logBlooms(h256 const& _hash) const { return queryExtras<BlockLogBlooms, ExtraLogBlooms>(_hash, m_logBlooms, x_logBlooms, NullBlockLogBlooms); }
+	BlockLogBlooms logBlooms(h256 const& _hash) const { return orNull(queryExtras<BlockLogBlooms, ExtraLogBlooms>(_hash, m_logBlooms), NullBlockLogBlooms); }
 	BlockLogBlooms logBlooms() const { return logBlooms(currentHash()); }
 
 	/// Get the transactions' receipts of a block (or the most recent mined if none given). Thread-safe.
 	/// receipts are given in the same order are in the same order as the transactions
-	BlockReceipts receipts(h256 const& _hash) const { return queryExtras<BlockReceipts, ExtraReceipts>(_hash, m_receipts, x_receipts, NullBlockReceipts); }
+	BlockReceipts receipts(h256 const& _hash) const { return orNull(queryExtras<BlockReceipts, ExtraReceipts>(_hash, m_receipts), NullBlockReceipts); }
 	BlockReceipts receipts() const { return receipts(currentHash()); }
 
+	/// Get the inverted log index, or null when it is disabled. Thread-safe.
+	LogIndex const* logIndex() const { return m_logIndex.get(); }
+
 	/// Get the transaction by block hash and index;
-	TransactionReceipt transactionReceipt(h256 const& _blockHash, unsigned _i) const { return receipts(_blockHash).receipts[_i]; }
+	TransactionReceipt transactionReceipt(h256 const& _blockHash, unsigned _i) const { auto br = queryExtras<BlockReceipts, ExtraReceipts>(_blockHash, m_receipts); if (!br || _i >= br->receipts.size()) return bytesConstRef(); return br->receipts[_i]; }
 
 	/// Get the transaction receipt by transaction hash. Thread-safe.
-	TransactionReceipt transactionReceipt(h256 const& _transactionHash) const { TransactionAddress ta = queryExtras<TransactionAddress, ExtraTransactionAddress>(_transactionHash, m_transactionAddresses, x_transactionAddresses, NullTransactionAddress); if (!ta) return bytesConstRef(); return transactionReceipt(ta.blockHash, ta.index); }
+	TransactionReceipt transactionReceipt(h256 const& _transactionHash) const { auto ta = transactionAddress(_transactionHash); if (!ta) return bytesConstRef(); return transactionReceipt(ta->blockHash, ta->index); }
 
 	/// Get a list of transaction hashes for a given block. Thread-safe.
 	TransactionHashes transactionHashes(h256 const& _hash) const { auto b = block(_hash); RLP rlp(b); h256s ret; for (auto t : rlp[1]) ret.push_back(sha3(t.data())); return ret; }
@@ -190,7 +198,7 @@ public:
 	UncleHashes uncleHashes() const { return uncleHashes(currentHash()); }
 
 	/// Get the hash for a given block's number.
-	h256 numberHash(unsigned _i) const { if (!_i) return genesisHash(); return queryExtras<BlockHash, uint64_t, ExtraBlockHash>(_i, m_blockHashes, x_blockHashes, NullBlockHash).value; }
+	h256 numberHash(unsigned _i) const { if (!_i) return genesisHash(); return orNull(queryExtras<BlockHash, uint64_t, ExtraBlockHash>(_i, m_blockHashes), NullBlockHash).value; }
 
 	/// Get the last N hashes for a given block. (N is determined by the LastHashes type.)
 	LastHashes lastHashes() const { return lastHashes(m_lastBlockHash); }
@@ -211,17 +219,17 @@ public:
 	 * i * (x ^ n) + o * x ^ (n - 1)
 	 */
 	BlocksBlooms blocksBlooms(unsigned _level, unsigned _index) const { return blocksBlooms(chunkId(_level, _index)); }
-	BlocksBlooms blocksBlooms(h256 const& _chunkId) const { return queryExtras<BlocksBlooms, ExtraBlocksBlooms>(_chunkId, m_blocksBlooms, x_blocksBlooms, NullBlocksBlooms); }
-	LogBloom blockBloom(unsigned _number) const { return blocksBlooms(chunkId(0, _number / c_bloomIndexSize)).blooms[_number % c_bloomIndexSize]; }
+	BlocksBlooms blocksBlooms(h256 const& _chunkId) const { return orNull(queryExtras<BlocksBlooms, ExtraBlocksBlooms>(_chunkId, m_blocksBlooms), NullBlocksBlooms); }
+	LogBloom blockBloom(unsigned _number) const { return orNull(queryExtras<BlocksBlooms, ExtraBlocksBlooms>(chunkId(0, _number / c_bloomIndexSize), m_blocksBlooms), NullBlocksBlooms).blooms[_number % c_bloomIndexSize]; }
 	std::vector<unsigned> withBlockBloom(LogBloom const& _b, unsigned _earliest, unsigned _latest) const;
 	std::vector<unsigned> withBlockBloom(LogBloom const& _b, unsigned _earliest, unsigned _latest, unsigned _topLevel, unsigned _index) const;
 
 	/// Returns true if transaction is known. Thread-safe
-	bool isKnownTransaction(h256 const& _transactionHash) const { TransactionAddress ta = queryExtras<TransactionAddress, ExtraTransactionAddress>(_transactionHash, m_transactionAddresses, x_transactionAddresses, NullTransactionAddress); return !!ta; }
+	bool isKnownTransaction(h256 const& _transactionHash) const { return !!transactionAddress(_transactionHash); }
 
 	/// Get a transaction from its hash. Thread-safe.
-	bytes transaction(h256 const& _transactionHash) const { TransactionAddress ta = queryExtras<TransactionAddress, ExtraTransactionAddress>(_transactionHash, m_transactionAddresses, x_transactionAddresses, NullTransactionAddress); if (!ta) return bytes(); return transaction(ta.blockHash, ta.index); }
-	std::pair<h256, unsigned> transactionLocation(h256 const& _transactionHash) const {TransactionAddress ta = queryExtras<TransactionAddress, ExtraTransactionAddress>(_transactionHash, m_transactionAddresses, x_transactionAddresses, NullTransactionAddress); if (!ta) return std::pair<h256, unsigned>(h256(), 0); return std::make_pair(ta.blockHash, ta.index); }
+	bytes transaction(h256 const& _transactionHash) const { auto ta = transactionAddress(_transactionHash); if (!ta) return bytes(); return transaction(ta->blockHash, ta->index); }
+	std::pair<h256, unsigned> transactionLocation(h256 const& _transactionHash) const { auto ta = transactionAddress(_transactionHash); if (!ta) return std::pair<h256, unsigned>(h256(), 0); return std::make_pair(ta->blockHash, ta->index); }
 
 	/// Get a block's transaction (RLP format) for the given block hash (or the most recent mined if none given) & index. Thread-safe.
 	bytes transaction(h256 const& _blockHash, unsigned _i) const { bytes b = block(_blockHash); return RLP(b)[1][_i].data().toBytes(); }
@@ -329,10 +337,12 @@ public:
 	//void    updateSystemContract(Transactions & _transcations);
 	void    updateSystemContract(std::shared_ptr<Block> block);
 	void updateCache(Address address)const;
+	bool isSystemContract(Address const& _a) const;
 
 	static u256 maxBlockLimit;
-	// for pbft，验证块，执行交易，验证执行后的状态
-	void checkBlockValid(h256 const& _head, bytes const& _block, Block & _outBlock) const;
+	// for pbft，验证块，执行交易，验证执行后的状态; _hint为leader给出的并行执行提示，可为空
+	// _parent非空时（流水线出块），父块为其指向的尚未上链的块
+	void checkBlockValid(h256 const& _head, bytes const& _block, Block & _outBlock, ParallelExecHint const* _hint = nullptr, Block const* _parent = nullptr) const;
 
 
 	void addBlockCache(Block block, u256 td) const;
@@ -343,6 +353,8 @@ public:
 	bytes encryptodata(bytesConstRef const& v);
 	bytes encryptodata(bytes const& v);
 	bytes decryptodata(std::string const& v) const;
+	/// Decrypt @a io_v in place.
+	void decryptodataInPlace(std::string& io_v) const;
 private:
 	enum CRYPTOTYPE
 	{
@@ -364,37 +376,38 @@ private:
 	/// Finalise everything and close the database.
 	void close();
 
-	template<class T, class K, unsigned N> T queryExtras(K const& _h, std::unordered_map<K, T>& _m, boost::shared_mutex& _x, T const& _n,ldb::DB* _extrasDB = nullptr) const
+	/// @returns the extras of type @a N for @a _h from the cache @a _m or else the disk, or null if there are none.
+	template<class T, class K, unsigned N> std::shared_ptr<T const> queryExtras(K const& _h, ExtrasCache<K, T>& _m, ldb::DB* _extrasDB = nullptr) const
 	{
-		{
-			ReadGuard l(_x);
-			auto it = _m.find(_h);
-			if (it != _m.end())
-				return it->second;
-		}
+		if (auto ret = _m.get(_h))
+			return ret;
 
 		std::string s;
-		(_extrasDB ? _extrasDB : m_extrasDB)->Get(m_readOptions, toSlice(_h, N), &s);
+		PersistenceWriter::instance().get(_extrasDB ? _extrasDB : m_extrasDB, m_readOptions, toSlice(_h, N), &s);
 		if (s.empty())
-			return _n;
+			return nullptr;
 
 		if (dev::getCryptoMod() != CRYPTO_DEFAULT && !s.empty())
 		{
-			bytes enData = decryptodata(s);
-			s = asString(enData);
+			decryptodataInPlace(s);
 		}
 
-		noteUsed(_h, N);
+		return _m.insert(_h, std::make_shared<T const>(RLP(s)));
+	}
+
 
-		WriteGuard l(_x);
-		auto ret = _m.insert(std::make_pair(_h, T(RLP(s))));
-		return ret.first->second;
+	template<class T, unsigned N> std::shared_ptr<T const> queryExtras(h256 const& _h, ExtrasCache<h256, T>& _m, ldb::DB* _extrasDB = nullptr) const
+	{
+		return queryExtras<T, h256, N>(_h, _m, _extrasDB);
 	}
 
+	template<class T> static T const& orNull(std::shared_ptr<T const> const& _p, T const& _n) { return _p ? *_p : _n; }
 
-	template<class T, unsigned N> T queryExtras(h256 const& _h, std::unordered_map<h256, T>& _m, boost::shared_mutex& _x, T const& _n,ldb::DB* _extrasDB = nullptr) const
+	/// @returns where the transaction @a _transactionHash is, or null if it is not known.
+	std::shared_ptr<TransactionAddress const> transactionAddress(h256 const& _transactionHash) const
 	{
-		return queryExtras<T, h256, N>(_h, _m, _x, _n, _extrasDB);
+		auto ret = queryExtras<TransactionAddress, ExtraTransactionAddress>(_transactionHash, m_transactionAddresses);
+		return ret && *ret ? ret : nullptr;
 	}
 
 	void checkConsistency();
@@ -407,25 +420,20 @@ private:
 	/// The caches of the disk DB and their locks.
 	mutable SharedMutex x_blocks;
 	mutable BlocksHash m_blocks;
-	mutable SharedMutex x_details;
-	mutable BlockDetailsHash m_details;
-	mutable SharedMutex x_logBlooms;
-	mutable BlockLogBloomsHash m_logBlooms;
-	mutable SharedMutex x_receipts;
-	mutable BlockReceiptsHash m_receipts;
-	mutable SharedMutex x_transactionAddresses;
-	mutable TransactionAddressHash m_transactionAddresses;
-	mutable SharedMutex x_blockHashes;
-	mutable BlockHashHash m_blockHashes;
-	mutable SharedMutex x_blocksBlooms;
-	mutable BlocksBloomsHash m_blocksBlooms;
-
+	/// The extras caches are each bounded and locked internally; see ExtrasCache.
+	mutable ExtrasCache<h256, BlockDetails> m_details;
+	mutable ExtrasCache<h256, BlockLogBlooms> m_logBlooms;
+	mutable ExtrasCache<h256, BlockReceipts> m_receipts;
+	mutable ExtrasCache<h256, TransactionAddress> m_transactionAddresses;
+	mutable ExtrasCache<uint64_t, BlockHash> m_blockHashes;
+	mutable ExtrasCache<h256, BlocksBlooms> m_blocksBlooms;
+
+	/// Death row for m_blocks.
 	using CacheID = std::pair<h256, unsigned>;
 	mutable Mutex x_cacheUsage;
 	mutable std::deque<std::unordered_set<CacheID>> m_cacheUsage;
 	mutable std::unordered_set<CacheID> m_inUse;
 	void noteUsed(h256 const& _h, unsigned _extra = (unsigned) - 1) const;
-	void noteUsed(uint64_t const& _h, unsigned _extra = (unsigned) - 1) const { (void)_h; (void)_extra; } // don't note non-hash types
 	std::chrono::system_clock::time_point m_lastCollection;
 
 	void noteCanonChanged() const { Guard l(x_lastLastHashes); m_lastLastHashes.clear(); }
@@ -439,6 +447,9 @@ private:
 	ldb::DB* m_blocksDB;
 	ldb::DB* m_extrasDB;
 
+	/// Inverted index of the logs, in m_extrasDB. Null when disabled.
+	std::unique_ptr<LogIndex> m_logIndex;
+
 	/// Hash of the last (valid) block on the longest chain.
 	mutable boost::shared_mutex x_lastBlockHash;
 	h256 m_lastBlockHash;
@@ -446,6 +457,8 @@ private:
 
 	ldb::ReadOptions m_readOptions;
 	ldb::WriteOptions m_writeOptions;
+	std::string m_dataKey;			///< Disk encryption key and IV, see cryptomod.
+	std::string m_dataIv;
 
 	ChainParams m_params;
 	std::shared_ptr<SealEngineFace> m_sealEngine;	// consider shared_ptr.
@@ -20,6 +20,7 @@
  */
 
 #include "ChainParams.h"
+#include <thread>
 #include <json_spirit/JsonSpiritHeaders.h>
 #include <libdevcore/easylog.h>
 #include <libdevcore/TrieDB.h>
@@ -93,11 +94,26 @@ ChainParams ChainParams::loadConfig(string const& _json, h256 const& ) const
 	cp.sysytemProxyAddress = obj.count("systemproxyaddress") ? h160(obj["systemproxyaddress"].get_str()) : h160();
 	cp.listenIp = obj.count("listenip") ? obj["listenip"].get_str() : "0.0.0.0";
 	cp.cryptoMod = obj.count("cryptomod") ? std::stoi(obj["cryptomod"].get_str()) : 0;//获取加密模式
+	cp.stateCacheSize = obj.count("statecachesize") ? std::stoi(obj["statecachesize"].get_str()) : 64;//状态库节点缓存大小(MB)
+	cp.extrasCacheSize = obj.count("extrascachesize") ? std::stoi(obj["extrascachesize"].get_str()) : 64;//区块附加数据缓存大小(MB)
+	cp.asyncPersist = obj.count("asyncpersist") ? ( (obj["asyncpersist"].get_str() == "ON") ? true : false) : false;//异步落盘
+	cp.logIndex = obj.count("logindex") ? ( (obj["logindex"].get_str() == "ON") ? true : false) : true;//日志倒排索引
 	cp.cryptoprivatekeyMod = obj.count("cryptoprivatekeymod") ? std::stoi(obj["cryptoprivatekeymod"].get_str()):0;
 	cp.ssl = obj.count("ssl") ? std::stoi(obj["ssl"].get_str()):0;
 	cp.rpcPort = obj.count("rpcport") ? std::stoi(obj["rpcport"].get_str()) : 6789;
 	cp.rpcSSLPort = obj.count("rpcsslport") ? std::stoi(obj["rpcsslport"].get_str()) : 6790;
 	cp.channelPort = obj.count("channelPort") ? std::stoi(obj["channelPort"].get_str()) : 0;
+	//每次read的字节数限制在1KB~1MB：为0时read立即返回0字节，会空转
+	int channelReadSize = obj.count("channelReadSize") ? std::stoi(obj["channelReadSize"].get_str()) : 16384;
+	cp.channelReadSize = static_cast<unsigned>(std::min(std::max(channelReadSize, 1024), 1024 * 1024));
+	if (cp.channelReadSize != static_cast<unsigned>(channelReadSize))
+		LOG(WARNING) << "channelReadSize " << channelReadSize << " out of range, using " << cp.channelReadSize;
+	// 0 means one worker per core; more than 4 per core only adds context switches.
+	int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	int channelWorkers = obj.count("channelWorkers") ? std::stoi(obj["channelWorkers"].get_str()) : 0;
+	cp.channelWorkers = static_cast<unsigned>(channelWorkers == 0 ? cores : std::min(std::max(channelWorkers, 1), cores * 4));
+	if (channelWorkers != 0 && cp.channelWorkers != static_cast<unsigned>(channelWorkers))
+		LOG(WARNING) << "channelWorkers " << channelWorkers << " out of range, using " << cp.channelWorkers;
 	cp.p2pPort = obj.count("p2pport") ? std::stoi(obj["p2pport"].get_str()) : 16789;
 	cp.wallet = obj.count("wallet") ? obj["wallet"].get_str() : "/tmp/ethereum/keys.info";
 	cp.keystoreDir = obj.count("keystoredir") ? obj["keystoredir"].get_str() : "/tmp/ethereum/keystore/";
@@ -107,6 +123,7 @@ ChainParams ChainParams::loadConfig(string const& _json, h256 const& ) const
 	cp.statsInterval = obj.count("statsInterval") ? std::stoi(obj["statsInterval"].get_str()) : 0;
 	
 	cp.vmKind = obj.count("vm") ? obj["vm"].get_str() : "interpreter";
+	cp.jitThreshold = obj.count("jitthreshold") ? std::stoi(obj["jitthreshold"].get_str()) : 2;
 	cp.networkId = obj.count("networkid") ? std::stoi(obj["networkid"].get_str()) : (unsigned) - 1;
 	cp.logVerbosity = obj.count("logverbosity") ? std::stoi(obj["logverbosity"].get_str()) : 4;
 	cp.evmEventLog = obj.count("eventlog") ? ( (obj["eventlog"].get_str() == "ON") ? true : false) : false;
@@ -117,6 +134,10 @@ ChainParams ChainParams::loadConfig(string const& _json, h256 const& ) const
 	cp.storagePath = obj.count("dfsStorage") ? obj["dfsStorage"].get_str() : "";
 	cp.statLog = obj.count("statlog") ? ( (obj["statlog"].get_str() == "ON") ? true : false) : false;
 	cp.broadcastToNormalNode = obj.count("broadcastToNormalNode") ? ( (obj["broadcastToNormalNode"].get_str() == "ON") ? true : false) : false;
+	cp.parallelExec = obj.count("parallelexec") ? ( (obj["parallelexec"].get_str() == "ON") ? true : false) : false;
+	cp.parallelExecThreads = obj.count("parallelexecthreads") ? std::stoi(obj["parallelexecthreads"].get_str()) : 0;
+	cp.pbftPipeline = obj.count("pbftpipeline") ? ( (obj["pbftpipeline"].get_str() == "ON") ? true : false) : false;
+	cp.packingTimeBudget = obj.count("packingtimebudget") ? std::stoi(obj["packingtimebudget"].get_str()) : 0;
 	// params
 	js::mObject params = obj["params"].get_obj();
 	cp.accountStartNonce = u256(fromBigEndian<u256>(fromHex(params["accountStartNonce"].get_str())));
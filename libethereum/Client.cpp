@@ -36,6 +36,7 @@
 #include "NodeConnParamsManager.h"
 #include "TransactionQueue.h"
 #include "SystemContractApi.h"
+#include <libweb3jsonrpc/RPCallback.h>
 
 using namespace std;
 using namespace dev;
@@ -199,6 +200,11 @@ void Client::updateCache(Address address) {
 	m_systemcontractapi->updateCache(address);
 }
 
+bool Client::isSystemContract(Address const& _a) const
+{
+	return m_systemcontractapi && m_systemcontractapi->isSystemContract(_a);
+}
+
 void Client::startStatTranscation(h256 t) {
 	m_systemcontractapi->startStatTranscation(t);
 }
@@ -467,25 +473,32 @@ void Client::appendFromNewPending(TransactionReceipt const& _receipt, h256Hash&
 
 void Client::appendFromBlock(h256 const& _block, BlockPolarity _polarity, h256Hash& io_changed)
 {
-	// TODO: more precise check on whether the txs match.
 	auto receipts = bc().receipts(_block).receipts;
+	BlockNumber number = (BlockNumber)bc().number(_block);
+	LogBloom blockBloom;
+	for (TransactionReceipt const& r: receipts)
+		blockBloom |= r.bloom();
+	h256s transactionHashes;
 
 	Guard l(x_filtersWatches);
 	io_changed.insert(ChainChangedFilter);
 	m_specialFilters.at(ChainChangedFilter).push_back(_block);
 	for (pair<h256 const, InstalledFilter>& i : m_filters)
 	{
-		// acceptable number & looks like block may contain a matching log entry.
+		// Most filters watch addresses or topics the block never logged.
+		if (!i.second.filter.matches(blockBloom))
+			continue;
 		for (size_t j = 0; j < receipts.size(); j++)
 		{
-			auto tr = receipts[j];
-			auto m = i.second.filter.matches(tr);
+			auto m = i.second.filter.matches(receipts[j]);
 			if (m.size())
 			{
-				auto transactionHash = transaction(_block, j).sha3();
+				if (transactionHashes.empty())
+					transactionHashes = bc().transactionHashes(_block);
+				h256 transactionHash = j < transactionHashes.size() ? transactionHashes[j] : h256();
 				// filter catches them
 				for (LogEntry const& l : m)
-					i.second.changes.push_back(LocalisedLogEntry(l, _block, (BlockNumber)bc().number(_block), transactionHash, j, 0, _polarity));
+					i.second.changes.push_back(LocalisedLogEntry(l, _block, number, transactionHash, j, 0, _polarity));
 				io_changed.insert(i.first);
 			}
 		}
@@ -705,6 +718,7 @@ void Client::onChainChanged(ImportRoute const& _ir)
 		m_tq.dropGood(t);
 	}
 	onNewBlocks(_ir.liveBlocks, changeds);
+	RPCallback::getInstance().onChainChanged(bc(), _ir.liveBlocks);
 	resyncStateFromChain();
 	noteChanged(changeds);
 }
@@ -204,6 +204,7 @@ public:
 	u256 filterCheck(const Transaction & _t, FilterCheckScene _checkscene = FilterCheckScene::None) const override;
 	void    updateSystemContract(std::shared_ptr<Block> block) override;
 	void updateCache(Address address) override;
+	bool isSystemContract(Address const& _a) const override;
 
 	void startStatTranscation(h256)override;
 
@@ -289,10 +289,29 @@ LocalisedLogEntries ClientBase::logs(LogFilter const& _f) const
 
 	// Handle blocks from main chain
 	set<unsigned> matchingBlocks;
+	map<unsigned, vector<unsigned>> indexedTransactions;
 	if (!_f.isRangeFilter())
-		for (auto const& i : _f.bloomPossibilities())
-			for (auto u : bc().withBlockBloom(i, end, begin))
-				matchingBlocks.insert(u);
+	{
+		// The log index points straight at the transactions of the blocks it covers,
+		// the blooms narrow the older ones down to blocks.
+		unsigned bloomsTo = begin;
+		bool useBlooms = true;
+		if (LogIndex const* index = bc().logIndex())
+		{
+			unsigned from = max(end, index->indexedFrom());
+			if (from <= begin)
+			{
+				for (LogIndex::Location const& l: index->lookup(_f, from, begin))
+					indexedTransactions[l.first].push_back(l.second);
+				useBlooms = from > end;
+				bloomsTo = from - 1;
+			}
+		}
+		if (useBlooms)
+			for (auto const& i : _f.bloomPossibilities())
+				for (auto u : bc().withBlockBloom(i, end, bloomsTo))
+					matchingBlocks.insert(u);
+	}
 	else
 		// if it is a range filter, we want to get all logs from all blocks in given range
 		for (unsigned i = end; i <= begin; i++)
@@ -300,22 +319,40 @@ LocalisedLogEntries ClientBase::logs(LogFilter const& _f) const
 
 	for (auto n : matchingBlocks)
 		prependLogsFromBlock(_f, bc().numberHash(n), BlockPolarity::Live, ret);
+	for (auto const& i: indexedTransactions)
+		prependLogsFromBlock(_f, bc().numberHash(i.first), BlockPolarity::Live, ret, &i.second);
 
 	reverse(ret.begin(), ret.end());
 	return ret;
 }
 
-void ClientBase::prependLogsFromBlock(LogFilter const& _f, h256 const& _blockHash, BlockPolarity _polarity, LocalisedLogEntries& io_logs) const
+void ClientBase::prependLogsFromBlock(LogFilter const& _f, h256 const& _blockHash, BlockPolarity _polarity, LocalisedLogEntries& io_logs, vector<unsigned> const* _transactions) const
 {
 	auto receipts = bc().receipts(_blockHash).receipts;
-	for (size_t i = 0; i < receipts.size(); i++)
+	BlockNumber number = (BlockNumber)bc().number(_blockHash);
+	h256s hashes;
+	auto prepend = [&](unsigned i)
 	{
-		TransactionReceipt receipt = receipts[i];
-		auto th = transaction(_blockHash, i).sha3();
-		LogEntries le = _f.matches(receipt);
+		LogEntries le = _f.matches(receipts[i]);
+		if (le.empty())
+			return;
+		if (hashes.empty())
+			hashes = bc().transactionHashes(_blockHash);
+		h256 th = i < hashes.size() ? hashes[i] : h256();
 		for (unsigned j = 0; j < le.size(); ++j)
-			io_logs.insert(io_logs.begin(), LocalisedLogEntry(le[j], _blockHash, (BlockNumber)bc().number(_blockHash), th, i, 0, _polarity));
+			io_logs.insert(io_logs.begin(), LocalisedLogEntry(le[j], _blockHash, number, th, i, 0, _polarity));
+	};
+
+	if (_transactions)
+	{
+		// Index entries of a block that left the canonical chain may point past its receipts.
+		for (unsigned i: *_transactions)
+			if (i < receipts.size())
+				prepend(i);
 	}
+	else
+		for (unsigned i = 0; i < receipts.size(); i++)
+			prepend(i);
 }
 
 unsigned ClientBase::installWatch(LogFilter const& _f, Reaping _r)
@@ -107,7 +107,9 @@ public:
 
 	virtual LocalisedLogEntries logs(unsigned _watchId) const override;
 	virtual LocalisedLogEntries logs(LogFilter const& _filter) const override;
-	virtual void prependLogsFromBlock(LogFilter const& _filter, h256 const& _blockHash, BlockPolarity _polarity, LocalisedLogEntries& io_logs) const;
+	/// Prepend the logs of @a _blockHash matching @a _filter to @a io_logs, looking only at the
+	/// transactions in @a _transactions (ascending) if given.
+	virtual void prependLogsFromBlock(LogFilter const& _filter, h256 const& _blockHash, BlockPolarity _polarity, LocalisedLogEntries& io_logs, std::vector<unsigned> const* _transactions = nullptr) const;
 
 	/// Install, uninstall and query watches.
 	virtual unsigned installWatch(LogFilter const& _filter, Reaping _r = Reaping::Automatic) override;
@@ -143,6 +145,7 @@ public:
 	virtual EVMSchedule evmSchedule() const override { return sealEngine()->evmSchedule(EnvInfo(pendingInfo())); }
 
 	virtual std::pair<ImportResult, h256> injectTransaction(bytes const& _rlp, IfDropped _id = IfDropped::Ignore) override { prepareForTransaction(); return m_tq.import(_rlp, _id); }
+	virtual std::vector<std::pair<ImportResult, h256>> injectTransactions(std::vector<bytesConstRef> const& _rlps) override { prepareForTransaction(); return m_tq.import(_rlps); }
 	virtual ImportResult injectBlock(bytes const& _block) override;
 
 	using Interface::addresses;
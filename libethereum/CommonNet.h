@@ -85,6 +85,10 @@ enum SubprotocolPacketType : byte
 	//channel消息
 	ChannelMessage = 0x15,
 
+	//交易广播：转发时只发哈希，对方缺少时再拉取交易
+	NewTransactionHashesPacket = 0x16,
+	GetTransactionsPacket = 0x17,
+
 	PacketCount
 };
 
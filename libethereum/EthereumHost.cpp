@@ -22,6 +22,7 @@
 #include "EthereumHost.h"
 
 #include <chrono>
+#include <deque>
 #include <thread>
 
 #include <libdevcore/Common.h>
@@ -44,6 +45,8 @@ using namespace p2p;
 
 unsigned const EthereumHost::c_oldProtocolVersion = 62; //TODO: remove this once v63+ is common
 static unsigned const c_maxSendTransactions = 10;
+/// How long a transaction requested from one announcing peer is not requested from another.
+static chrono::milliseconds const c_txRequestTimeout = chrono::milliseconds(5000);
 
 char const* const EthereumHost::s_stateNames[static_cast<int>(SyncState::Size)] = {"NotSynced", "Idle", "Waiting", "Blocks", "State", "NewBlocks" };
 
@@ -76,9 +79,36 @@ public:
 	{
 		unsigned itemCount = _r.itemCount();
 		LOG(TRACE) << "Transactions (" << dec << itemCount << "entries)";
+		DEV_GUARDED(x_requested)
+			if (!m_requested.empty())
+				for (auto const& tx : _r)
+					m_requested.erase(sha3(tx.data()));
 		m_tq.enqueue(_r, _peer->id());
 	}
 
+	void onPeerTransactionHashes(std::shared_ptr<EthereumPeer> _peer, RLP const& _r) override
+	{
+		h256s missing;
+		auto now = chrono::steady_clock::now();
+		DEV_GUARDED(x_requested)
+		{
+			expireRequests(now);
+			for (auto const& h : _r)
+			{
+				h256 hash = h.toHash<h256>();
+				// Another peer announced it too and has been asked already.
+				if (m_requested.count(hash) || m_tq.isKnown(hash))
+					continue;
+				m_requested[hash] = now + c_txRequestTimeout;
+				m_requestDeadlines.emplace_back(now + c_txRequestTimeout, hash);
+				missing.push_back(hash);
+			}
+		}
+		LOG(TRACE) << "TransactionHashes (" << dec << _r.itemCount() << "entries," << missing.size() << "missing)";
+		if (!missing.empty())
+			_peer->requestTransactions(missing);
+	}
+
 	void onPeerAborting() override
 	{
 		RecursiveGuard l(m_syncMutex);
@@ -177,12 +207,27 @@ private:
 
 	Web3Observer::Ptr m_channelMessageObserver;
 
+	/// Forget requests older than c_txRequestTimeout, so that another peer announcing them is asked.
+	void expireRequests(chrono::steady_clock::time_point _now)
+	{
+		while (!m_requestDeadlines.empty() && m_requestDeadlines.front().first <= _now)
+		{
+			auto it = m_requested.find(m_requestDeadlines.front().second);
+			if (it != m_requested.end() && it->second <= _now)
+				m_requested.erase(it);
+			m_requestDeadlines.pop_front();
+		}
+	}
+
+	Mutex x_requested;
+	std::unordered_map<h256, chrono::steady_clock::time_point> m_requested;	///< Transactions requested and not received yet, with their deadline.
+	std::deque<std::pair<chrono::steady_clock::time_point, h256>> m_requestDeadlines;	///< Entries of m_requested in request order.
 };
 
 class EthereumHostData: public EthereumHostDataFace
 {
 public:
-	EthereumHostData(BlockChain const& _chain, OverlayDB const& _db): m_chain(_chain), m_db(_db) {}
+	EthereumHostData(BlockChain const& _chain, OverlayDB const& _db, TransactionQueue const& _tq): m_chain(_chain), m_db(_db), m_tq(_tq) {}
 
 	pair<bytes, unsigned> blockHeaders(RLP const& _blockId, unsigned _maxHeaders, u256 _skip, bool _reverse) const override
 	{
@@ -380,9 +425,33 @@ public:
 		return make_pair(rlp, n);
 	}
 
+	pair<bytes, unsigned> transactions(RLP const& _txHashes) const override
+	{
+		unsigned const count = static_cast<unsigned>(_txHashes.itemCount());
+		h256s hashes;
+		hashes.reserve(min(count, c_maxSendTransactions));
+		for (unsigned i = 0; i < count && i < c_maxSendTransactions; ++i)
+			hashes.push_back(_txHashes[i].toHash<h256>());
+
+		bytes rlp;
+		unsigned n = 0;
+		for (auto const& t : m_tq.transactions(hashes))
+		{
+			if (rlp.size() >= c_maxPayload)
+				break;
+			auto txRlp = t.rlp();
+			rlp.insert(rlp.end(), txRlp.begin(), txRlp.end());
+			++n;
+		}
+		LOG(TRACE) << n << " transactions known and returned;" << (hashes.size() - n) << " unknown;" << (count > hashes.size() ? count - hashes.size() : 0) << " ignored";
+
+		return make_pair(rlp, n);
+	}
+
 private:
 	BlockChain const& m_chain;
 	OverlayDB const& m_db;
+	TransactionQueue const& m_tq;
 };
 
 class ChannelMessageObserver: public ChannelMessageObserverFace {
@@ -450,7 +519,7 @@ EthereumHost::EthereumHost(BlockChain const& _ch, OverlayDB const& _db, Transact
 	m_tq		(_tq),
 	m_bq		(_bq),
 	m_networkId	(_networkId),
-	m_hostData(make_shared<EthereumHostData>(m_chain, m_db))
+	m_hostData(make_shared<EthereumHostData>(m_chain, m_db, m_tq))
 {
 	// TODO: Composition would be better. Left like that to avoid initialization
 	//       issues as BlockChainSync accesses other EthereumHost members.
@@ -529,88 +598,92 @@ void EthereumHost::doWork()
 void EthereumHost::maintainTransactions()
 {
 	// Send any new transactions.
-	unordered_map<std::shared_ptr<EthereumPeer>, std::vector<size_t>> peerTransactions;
+	// Our own transactions go in full to every peer that has not got them. Relayed ones are only
+	// announced by hash, to the same random quarter of the peers as before; the peers that miss
+	// them pull them with GetTransactionsPacket, so in a full mesh the bodies cross each link
+	// about once instead of once per relaying node.
+	auto ts = m_tq.topTransactions(c_maxSendTransactions, m_transactionsSent);
 
-	/*
-	auto ts = m_tq.topTransactions(c_maxSendTransactions);
-	{
-		Guard l(x_transactions);
+	vector<shared_ptr<EthereumPeer>> peers;
+	foreachPeer([&](shared_ptr<EthereumPeer> _p) { peers.push_back(_p); return true; });
+	if (peers.empty())
+		return;
+
+	vector<vector<size_t>> bodies(peers.size());
+	vector<vector<size_t>> announces(peers.size());
+	vector<size_t> candidates;
+	candidates.reserve(peers.size());
+	DEV_GUARDED(x_transactions)
 		for (size_t i = 0; i < ts.size(); ++i)
 		{
-			auto const& t = ts[i];
-			bool unsent = !m_transactionsSent.count(t.sha3());
-			auto peers = get<1>(randomSelection(0, [&](EthereumPeer * p) { return p->m_requireTransactions || (unsent && !p->m_knownTransactions.count(t.sha3())); }));
-			for (auto const& p : peers)
-				peerTransactions[p].push_back(i);
+			h256 const& h = ts[i].sha3();
+			bool unsent = !m_transactionsSent.count(h);
+
+			candidates.clear();
+			for (size_t p = 0; p < peers.size(); ++p)
+				if (peers[p]->m_requireTransactions)
+					bodies[p].push_back(i);
+				else if (unsent && !peers[p]->m_knownTransactions.contains(h))
+					candidates.push_back(p);
+
+			if (ts[i].importType() == 0)
+				for (auto p : candidates)
+					bodies[p].push_back(i);
+			else
+				for (size_t n = min(candidates.size(), (peers.size() * 25 + 99) / 100); n; --n)
+				{
+					size_t c = rand() % candidates.size();
+					announces[candidates[c]].push_back(i);
+					candidates.erase(candidates.begin() + c);
+				}
+
+			if (unsent)
+				m_transactionsSent.insert(h);
 		}
-		for (auto const& t : ts)
-			m_transactionsSent.insert(t.sha3());
-	}
-	*/
 
-	//auto ts = m_tq.allTransactions();
-	auto ts = m_tq.topTransactions(c_maxSendTransactions, m_transactionsSent);
+	// every body is encoded once and copied into the packets
+	vector<bytes> rlps(ts.size());
+	for (size_t p = 0; p < peers.size(); ++p)
 	{
-		Guard l(x_transactions);
-		for (size_t i = 0; i < ts.size(); ++i) {
-			auto const& t = ts[i];
-			bool unsent = !m_transactionsSent.count(t.sha3());
-			vector<shared_ptr<EthereumPeer>> peers;
-			if (t.importType() == 0) {
-				peers = get<1>(randomSelection(0, [&](EthereumPeer * p) {
-					DEV_GUARDED(p->x_knownTransactions)
-					return p->m_requireTransactions || (unsent && !p->m_knownTransactions.count(t.sha3()));
-					return false;
-				}));
-			} else {
-				peers = get<0>(randomSelection(25, [&](EthereumPeer * p) {
-					DEV_GUARDED(p->x_knownTransactions)
-					return p->m_requireTransactions || (unsent && !p->m_knownTransactions.count(t.sha3()));
-					return false;
-				}));
+		shared_ptr<EthereumPeer> const& peer = peers[p];
+		if (!bodies[p].empty() || peer->m_requireTransactions)
+		{
+			size_t size = 0;
+			for (auto i : bodies[p])
+			{
+				if (rlps[i].empty())
+					rlps[i] = ts[i].rlp();
+				size += rlps[i].size();
 			}
-			for (auto const& p : peers) {
-				peerTransactions[p].push_back(i);
+			bytes b;
+			b.reserve(size);
+			for (auto i : bodies[p])
+			{
+				b.insert(b.end(), rlps[i].begin(), rlps[i].end());
+				peer->m_knownTransactions.insert(ts[i].sha3());
 			}
 
-			if (unsent) {
-				m_transactionsSent.insert(t.sha3());
-			}
+			RLPStream s;
+			peer->prep(s, TransactionsPacket, bodies[p].size()).appendRaw(b, bodies[p].size());
+			BroadcastTxSizeLog(peer->session()->id(), s.out().size());
+			peer->sealAndSend(s);
+			LOG(TRACE) << "Sent" << bodies[p].size() << "transactions to " << peer->session()->info().clientVersion;
 		}
-	}
-
-	foreachPeer([&](shared_ptr<EthereumPeer> _p)
-	{
-		bytes b;
-		unsigned n = 0;
-
-		DEV_GUARDED(_p->x_knownTransactions)
-		for (auto const& i : peerTransactions[_p])
+		if (!announces[p].empty())
 		{
-			if (_p->m_knownTransactions.size() > EthereumPeer::kKnownTranscationsSize) {
-				_p->m_knownTransactions.pop();
+			RLPStream s;
+			peer->prep(s, NewTransactionHashesPacket, announces[p].size());
+			for (auto i : announces[p])
+			{
+				s << ts[i].sha3();
+				peer->m_knownTransactions.insert(ts[i].sha3());
 			}
-			_p->m_knownTransactions.insert(ts[i].sha3());
-			b += ts[i].rlp();
-			++n;
-			// LOG(DEBUG) << "Sent transactions to " << _p->session()->id() << " " << ts[i].sha3() ;
-		}
-
-		//_p->clearKnownTransactions();
-
-		if (n || _p->m_requireTransactions)
-		{
-			RLPStream ts;
-			_p->prep(ts, TransactionsPacket, n).appendRaw(b, n);
-
-			BroadcastTxSizeLog(_p->session()->id(), ts.out().size());
-
-			_p->sealAndSend(ts);
-			LOG(TRACE) << "Sent" << n << "transactions to " << _p->session()->info().clientVersion;
+			BroadcastTxSizeLog(peer->session()->id(), s.out().size());
+			peer->sealAndSend(s);
+			LOG(TRACE) << "Announced" << announces[p].size() << "transactions to " << peer->session()->info().clientVersion;
 		}
-		_p->m_requireTransactions = false;
-		return true;
-	});
+		peer->m_requireTransactions = false;
+	}
 }
 
 void EthereumHost::foreachPeer(std::function<bool(std::shared_ptr<EthereumPeer>)> const & _f) const
@@ -752,7 +825,6 @@ void EthereumHost::onTransactionImported(ImportResult _ir, h256 const & _h, h512
 	if (!peer)
 		return;
 
-	Guard l(peer->x_knownTransactions);
 	peer->m_knownTransactions.insert(_h);
 	switch (_ir)
 	{
@@ -192,6 +192,17 @@ void EthereumPeer::requestReceipts(h256s const& _blocks)
 	requestByHashes(_blocks, Asking::Receipts, GetReceiptsPacket);
 }
 
+void EthereumPeer::requestTransactions(h256s const& _hashes)
+{
+	if (_hashes.empty())
+		return;
+	RLPStream s;
+	prep(s, GetTransactionsPacket, _hashes.size());
+	for (auto const& i : _hashes)
+		s << i;
+	sealAndSend(s);
+}
+
 void EthereumPeer::requestByHashes(h256s const& _hashes, Asking _asking, SubprotocolPacketType _packetType)
 {
 	if (m_asking != Asking::Nothing)
@@ -290,6 +301,29 @@ bool EthereumPeer::interpret(unsigned _id, RLP const& _r)
 			m_observer->onPeerTransactions(dynamic_pointer_cast<EthereumPeer>(dynamic_pointer_cast<EthereumPeer>(shared_from_this())), _r);
 			break;
 		}
+		case NewTransactionHashesPacket:
+		{
+			unsigned itemCount = _r.itemCount();
+			LOG(TRACE) << "NewTransactionHashesPacket (" << dec << itemCount << "entries)";
+			for (auto const& h : _r)
+				m_knownTransactions.insert(h.toHash<h256>());
+			m_observer->onPeerTransactionHashes(dynamic_pointer_cast<EthereumPeer>(shared_from_this()), _r);
+			break;
+		}
+		case GetTransactionsPacket:
+		{
+			unsigned count = static_cast<unsigned>(_r.itemCount());
+			if (!count)
+			{
+				addRating(-10);
+				break;
+			}
+			auto txs = m_hostData->transactions(_r);
+			RLPStream s;
+			prep(s, TransactionsPacket, txs.second).appendRaw(txs.first, txs.second);
+			sealAndSend(s);
+			break;
+		}
 		case GetBlockHeadersPacket:
 		{
 			/// Packet layout:
@@ -28,6 +28,7 @@
 
 #include <libdevcore/RLP.h>
 #include <libdevcore/Guards.h>
+#include <libdevcore/RollingBloom.h>
 #include <libethcore/Common.h>
 #include <libp2p/Capability.h>
 #include "CommonNet.h"
@@ -46,6 +47,8 @@ public:
 
 	virtual void onPeerTransactions(std::shared_ptr<EthereumPeer> _peer, RLP const& _r) = 0;
 
+	virtual void onPeerTransactionHashes(std::shared_ptr<EthereumPeer> _peer, RLP const& _r) = 0;
+
 	virtual void onPeerBlockHeaders(std::shared_ptr<EthereumPeer> _peer, RLP const& _headers) = 0;
 
 	virtual void onPeerBlockBodies(std::shared_ptr<EthereumPeer> _peer, RLP const& _r) = 0;
@@ -75,6 +78,8 @@ public:
 	virtual strings nodeData(RLP const& _dataHashes) const = 0;
 
 	virtual std::pair<bytes, unsigned> receipts(RLP const& _blockHashes) const = 0;
+
+	virtual std::pair<bytes, unsigned> transactions(RLP const& _txHashes) const = 0;
 };
 
 class ChannelMessageObserverFace {
@@ -137,6 +142,9 @@ public:
 	/// Request receipts for specified blocks from peer.
 	void requestReceipts(h256s const& _blocks);
 
+	/// Request announced transactions we do not have. Independent of the sync asking state.
+	void requestTransactions(h256s const& _hashes);
+
 	/// Check if this node is rude.
 	bool isRude() const;
 
@@ -170,7 +178,7 @@ private:
 	void requestStatus(u256 _hostNetworkId, u256 _chainTotalDifficulty, h256 _chainCurrentHash, h256 _chainGenesisHash, u256 _height);
 
 	/// Clear all known transactions.
-	void clearKnownTransactions() { std::lock_guard<std::mutex> l(x_knownTransactions); m_knownTransactions.clear(); }
+	void clearKnownTransactions() { m_knownTransactions.clear(); }
 
 	// Request of type _packetType with _hashes as input parameters
 	void requestByHashes(h256s const& _hashes, Asking _asking, SubprotocolPacketType _packetType);
@@ -215,11 +223,9 @@ private:
 	Mutex x_knownBlocks;
 	//h256Hash m_knownBlocks;					///< Blocks that the peer already knows about (that don't need to be sent to them).
 	QueueSet<h256> m_knownBlocks;
-	Mutex x_knownTransactions;
-	//h256Hash m_knownTransactions;			///< Transactions that the peer already knows of.
-	QueueSet<h256> m_knownTransactions;
 	static const size_t kKnownBlockSize = 100;
 	static const size_t kKnownTranscationsSize = 10000;
+	RollingBloom m_knownTransactions{kKnownTranscationsSize};	///< Transactions that the peer already knows of.
 	unsigned m_unknownNewBlocks = 0;		///< Number of unknown NewBlocks received from this peer
 	unsigned m_lastAskedHeaders = 0;		///< Number of hashes asked
 
@@ -0,0 +1,278 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: ExtrasCache.h
+ * @author: fisco-dev
+ *
+ * @date: 2017
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <libdevcore/Guards.h>
+#include <libdevcore/Metrics.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * @brief Count-min sketch of how often keys were asked for. Counters saturate at 15 and are all
+ * halved periodically, so that old popularity fades.
+ */
+class FrequencySketch
+{
+public:
+	void increment(uint64_t _h)
+	{
+		for (unsigned i = 0; i < c_depth; ++i)
+		{
+			uint8_t& c = m_counters[slot(_h, i)];
+			if (c < c_maxCount)
+				++c;
+		}
+		if (++m_samples >= c_width * 10)
+		{
+			for (auto& c : m_counters)
+				c >>= 1;
+			m_samples /= 2;
+		}
+	}
+
+	unsigned estimate(uint64_t _h) const
+	{
+		unsigned ret = c_maxCount;
+		for (unsigned i = 0; i < c_depth; ++i)
+			ret = std::min<unsigned>(ret, m_counters[slot(_h, i)]);
+		return ret;
+	}
+
+private:
+	static const unsigned c_depth = 4;
+	static const unsigned c_widthBits = 10;
+	static const size_t c_width = size_t(1) << c_widthBits;
+	static const uint8_t c_maxCount = 15;
+
+	static size_t slot(uint64_t _h, unsigned _row)
+	{
+		static const uint64_t c_seeds[c_depth] = {0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL, 0x165667b19e3779f9ULL, 0xd6e8feb86659fd93ULL};
+		return _row * c_width + (((_h ^ (_h >> 29)) * c_seeds[_row]) >> (64 - c_widthBits));
+	}
+
+	std::array<uint8_t, c_depth * c_width> m_counters = {};
+	size_t m_samples = 0;
+};
+
+/**
+ * @brief Byte-bounded concurrent cache for the extras (details, receipts, blooms...) of BlockChain.
+ * Values are immutable and shared, so a hit costs a pointer copy rather than a copy of the value.
+ * The cache is split into shards by key, each under its own lock. Each shard follows W-TinyLFU:
+ * new entries go into a small LRU window; an entry leaving the window only displaces the least
+ * recently used entry of the main LRU if the frequency sketch says it is asked for more often,
+ * so a scan over old blocks cannot flush the working set.
+ * V must have a `size` member giving its encoded size in bytes.
+ */
+template <class K, class V>
+class ExtrasCache
+{
+public:
+	using Ptr = std::shared_ptr<V const>;
+
+	explicit ExtrasCache(size_t _capacity = 0) { setCapacity(_capacity); }
+
+	ExtrasCache(ExtrasCache const&) = delete;
+	ExtrasCache& operator=(ExtrasCache const&) = delete;
+
+	/// Set the total capacity in bytes; takes effect as entries are next inserted.
+	void setCapacity(size_t _bytes)
+	{
+		m_shardCapacity = _bytes / c_shards;
+		m_windowCapacity = m_shardCapacity / 100;
+	}
+
+	/// Count hits and misses of get() as the "fisco_extras_cache_requests_total" metric with cache=@a _name.
+	void setMetrics(std::string const& _name)
+	{
+		char const* help = "BlockChain extras cache lookups by result";
+		m_hits = &metrics::counter("fisco_extras_cache_requests_total", help, "cache=\"" + _name + "\",result=\"hit\"");
+		m_misses = &metrics::counter("fisco_extras_cache_requests_total", help, "cache=\"" + _name + "\",result=\"miss\"");
+	}
+
+	/// @returns the cached value of @a _k, or null.
+	Ptr get(K const& _k)
+	{
+		uint64_t h = hashOf(_k);
+		Shard& s = shardFor(h);
+		Guard l(s.lock);
+		s.sketch.increment(h);
+		auto it = s.index.find(_k);
+		if (it == s.index.end())
+		{
+			if (m_misses)
+				m_misses->add();
+			return Ptr();
+		}
+		if (m_hits)
+			m_hits->add();
+		touch(s, it->second);
+		return it->second->value;
+	}
+
+	/// Cache @a _v, just read from disk, unless @a _k was cached meanwhile.
+	/// @returns the cached value, which is @a _v unless another thread got there first.
+	Ptr insert(K const& _k, Ptr const& _v)
+	{
+		uint64_t h = hashOf(_k);
+		Shard& s = shardFor(h);
+		Guard l(s.lock);
+		auto it = s.index.find(_k);
+		if (it != s.index.end())
+			return it->second->value;
+		add(s, _k, _v);
+		return _v;
+	}
+
+	/// Cache @a _v as the new value of @a _k, replacing any cached one.
+	void put(K const& _k, Ptr const& _v)
+	{
+		Shard& s = shardFor(hashOf(_k));
+		Guard l(s.lock);
+		auto it = s.index.find(_k);
+		if (it != s.index.end())
+			erase(s, it->second);
+		add(s, _k, _v);
+	}
+
+	void remove(K const& _k)
+	{
+		Shard& s = shardFor(hashOf(_k));
+		Guard l(s.lock);
+		auto it = s.index.find(_k);
+		if (it != s.index.end())
+			erase(s, it->second);
+	}
+
+	void clear()
+	{
+		for (Shard& s : m_shards)
+		{
+			Guard l(s.lock);
+			s.window.clear();
+			s.main.clear();
+			s.index.clear();
+			s.windowSize = s.mainSize = 0;
+		}
+	}
+
+	/// Total size of the cached values in bytes.
+	size_t size() const
+	{
+		size_t ret = 0;
+		for (Shard const& s : m_shards)
+			DEV_GUARDED(s.lock)
+				ret += s.windowSize + s.mainSize;
+		return ret;
+	}
+
+private:
+	struct Entry
+	{
+		K key;
+		Ptr value;
+		size_t size;
+		bool inWindow;
+	};
+	using List = std::list<Entry>;		///< Most recently used first.
+
+	struct Shard
+	{
+		mutable Mutex lock;
+		List window;
+		List main;
+		std::unordered_map<K, typename List::iterator> index;
+		size_t windowSize = 0;
+		size_t mainSize = 0;
+		FrequencySketch sketch;
+	};
+
+	static const unsigned c_shards = 16;
+	static const size_t c_entryOverhead = 64;	///< Rough bookkeeping cost of an entry, as BlockChain::updateStats always counted.
+
+	static uint64_t hashOf(K const& _k) { return std::hash<K>()(_k); }
+	Shard& shardFor(uint64_t _h) { return m_shards[(_h ^ (_h >> 32)) % c_shards]; }
+
+	void touch(Shard& _s, typename List::iterator _it)
+	{
+		List& l = _it->inWindow ? _s.window : _s.main;
+		l.splice(l.begin(), l, _it);
+	}
+
+	void erase(Shard& _s, typename List::iterator _it)
+	{
+		(_it->inWindow ? _s.windowSize : _s.mainSize) -= _it->size;
+		_s.index.erase(_it->key);
+		(_it->inWindow ? _s.window : _s.main).erase(_it);
+	}
+
+	void add(Shard& _s, K const& _k, Ptr const& _v)
+	{
+		size_t size = _v->size + c_entryOverhead;
+		_s.window.push_front(Entry{_k, _v, size, true});
+		_s.index[_k] = _s.window.begin();
+		_s.windowSize += size;
+
+		size_t mainCapacity = m_shardCapacity - m_windowCapacity;
+		while (_s.windowSize > m_windowCapacity && !_s.window.empty())
+		{
+			auto candidate = std::prev(_s.window.end());
+			bool admit = candidate->size <= mainCapacity;
+			unsigned frequency = _s.sketch.estimate(hashOf(candidate->key));
+			while (admit && _s.mainSize + candidate->size > mainCapacity)
+			{
+				auto victim = std::prev(_s.main.end());
+				if (frequency <= _s.sketch.estimate(hashOf(victim->key)))
+					admit = false;
+				else
+					erase(_s, victim);
+			}
+			if (!admit)
+			{
+				erase(_s, candidate);
+				continue;
+			}
+			_s.windowSize -= candidate->size;
+			_s.mainSize += candidate->size;
+			candidate->inWindow = false;
+			_s.main.splice(_s.main.begin(), _s.window, candidate);
+		}
+	}
+
+	std::array<Shard, c_shards> m_shards;
+	size_t m_shardCapacity = 0;
+	size_t m_windowCapacity = 0;
+	metrics::Counter* m_hits = nullptr;
+	metrics::Counter* m_misses = nullptr;
+};
+
+}
+}
@@ -0,0 +1,234 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: FilterEvaluator.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2017
+ */
+
+#include "FilterEvaluator.h"
+#include <sys/time.h>
+#include <algorithm>
+#include <libdevcore/easylog.h>
+#include <libdevcore/SHA3.h>
+#include <libethcore/ABI.h>
+#include "Block.h"
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+
+/// What a filter can observe of an account.
+tuple<bool, h256, h256> fingerprint(State& _s, Address const& _a)
+{
+	if (!_s.addressInUse(_a))
+		return make_tuple(false, h256(), h256());
+	return make_tuple(true, _s.storageRoot(_a), _s.codeHash(_a));
+}
+
+}
+
+void FilterEvaluator::update(Block const& _block, LastHashes const& _lh)
+{
+	shared_ptr<Snapshot> next(new Snapshot{_block.state(), EnvInfo(_block.info(), _lh, _block.gasUsed()), _block.gasLimitRemaining(), _block.sealEngine(), 1});
+
+	shared_ptr<Snapshot const> prev;
+	DEV_WRITE_GUARDED(x_snapshot)
+	{
+		prev = m_snapshot;
+		if (prev)
+			next->version = prev->version + 1;
+		m_snapshot = next;
+	}
+
+	vector<pair<h256, Decision>> redo;
+	DEV_WRITE_GUARDED(x_decisions)
+	{
+		bool changed = !prev;
+		if (prev)
+		{
+			State before(prev->state);
+			State after(next->state);
+			for (auto const& a : m_dependencies)
+				if (fingerprint(before, a) != fingerprint(after, a))
+				{
+					LOG(TRACE) << "FilterEvaluator::update " << a << " changed, re-evaluating " << m_decisions.size() << " decisions";
+					changed = true;
+					break;
+				}
+		}
+		if (changed)
+		{
+			redo.assign(m_decisions.begin(), m_decisions.end());
+			m_decisions.clear();
+			m_dependencies.clear();
+		}
+	}
+
+	shared_ptr<Snapshot const> s = next;
+	for (auto& r : redo)
+		m_pool.enqueue([this, s, r]() mutable
+		{
+			try
+			{
+				evaluate(*s, r.first, r.second);
+			}
+			catch (...)
+			{
+				LOG(WARNING) << "FilterEvaluator re-evaluation failed " << boost::current_exception_diagnostic_information();
+			}
+		});
+}
+
+ExecutionResult FilterEvaluator::run(Snapshot const& _s, Address const& _to, bytes const& _input, StateAccessSet* _access) const
+{
+	//取个随机值
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	u256 nonce = (u256)(rand() + rand() + tv.tv_usec);
+
+	Transaction t(0, 100000000, _s.gas, _to, _input, nonce);
+	t.forceSender(m_sender);
+
+	State state(_s.state);
+	state.setAccessSet(_access);
+	return state.execute(_s.env, *_s.sealEngine, t, Permanence::Reverted).first;
+}
+
+ExecutionResult FilterEvaluator::call(Address const& _to, bytes const& _input) const
+{
+	auto s = snapshot();
+	if (!s)
+		return ExecutionResult();
+	return run(*s, _to, _input, nullptr);
+}
+
+h256 FilterEvaluator::keyOf(Decision const& _d, bool _selectorOnly)
+{
+	RLPStream s(6);
+	s << _d.filter << _d.origin << _d.from << _d.to << _selectorOnly;
+	if (_d.creation)
+		s << "";
+	else if (_selectorOnly)
+		s << _d.input.substr(0, 8);
+	else
+		s << sha3(_d.input);
+	return sha3(s.out());
+}
+
+bool FilterEvaluator::selectorOnly(Snapshot const& _s, Address const& _chain)
+{
+	DEV_READ_GUARDED(x_decisions)
+	{
+		auto it = m_selectorOnly.find(_chain);
+		if (it != m_selectorOnly.end() && it->second.first == _s.version)
+			return it->second.second;
+	}
+
+	bool ret = stockFilters(_s, _chain);
+	DEV_WRITE_GUARDED(x_decisions)
+		m_selectorOnly[_chain] = make_pair(_s.version, ret);
+	return ret;
+}
+
+bool FilterEvaluator::stockFilters(Snapshot const& _s, Address const& _chain) const
+{
+	ExecutionResult res = run(_s, _chain, ContractABI().abiIn("getFiltersLength()"), nullptr);
+	if (res.output.empty())
+		return false;
+	u256 count;
+	ContractABI().abiOut(bytesConstRef(&res.output), count);
+	if (count > c_maxStockFilters)
+		return false;
+
+	State state(_s.state);
+	bytes chainCode = state.code(_chain);
+	for (unsigned i = 0; i < count; ++i)
+	{
+		res = run(_s, _chain, ContractABI().abiIn("getFilter(uint256)", u256(i)), nullptr);
+		if (res.output.empty())
+			return false;
+		Address filter;
+		ContractABI().abiOut(bytesConstRef(&res.output), filter);
+
+		bytes const& code = state.code(filter);
+		if (code.empty() || code == chainCode || search(chainCode.begin(), chainCode.end(), code.begin(), code.end()) == chainCode.end())
+			return false;
+	}
+	return true;
+}
+
+void FilterEvaluator::evaluate(Snapshot const& _s, h256 const& _key, Decision& _d)
+{
+	bytes input = _d.creation ?
+		ContractABI().abiIn("deploy(address)", _d.origin) :
+		ContractABI().abiIn("process(address,address,address,string,string)", _d.origin, _d.from, _d.to, _d.input.substr(0, 8), _d.input);
+
+	StateAccessSet access;
+	ExecutionResult res = run(_s, _d.filter, input, &access);
+
+	//未部署系统合约或权限合约
+	_d.allowed = true;
+	if (!res.output.empty())
+		ContractABI().abiOut(bytesConstRef(&res.output), _d.allowed);
+
+	DEV_WRITE_GUARDED(x_decisions)
+	{
+		// A decision made on an outdated snapshot may already be wrong.
+		if (snapshot()->version != _s.version)
+			return;
+		if (m_decisions.size() >= c_maxDecisions)
+		{
+			m_decisions.clear();
+			m_dependencies.clear();
+		}
+		m_decisions[_key] = _d;
+		m_dependencies.insert(access.readAccounts.begin(), access.readAccounts.end());
+		for (auto const& i : access.readSlots)
+			m_dependencies.insert(i.first);
+	}
+}
+
+bool FilterEvaluator::allowed(Address const& _filter, Transaction const& _t)
+{
+	++m_checks;
+
+	auto s = snapshot();
+	if (!s)
+		return true;
+
+	Decision d{_filter, _t.safeSender(), _t.from(), _t.to(), _t.isCreation(), _t.isCreation() ? string() : toHex(_t.data()), true};
+	// Filters added to the chain may look at the arguments: only a chain of stock AuthorityFilters
+	// answers the same for every call of a function.
+	h256 key = keyOf(d, !d.creation && selectorOnly(*s, _filter));
+	DEV_READ_GUARDED(x_decisions)
+	{
+		auto it = m_decisions.find(key);
+		if (it != m_decisions.end())
+		{
+			++m_hits;
+			return it->second.allowed;
+		}
+	}
+
+	evaluate(*s, key, d);
+	return d.allowed;
+}
@@ -0,0 +1,133 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: FilterEvaluator.h
+ * @author: fisco-dev
+ *
+ * @date: 2017
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <libdevcore/Guards.h>
+#include <libdevcore/ThreadPool.h>
+#include <libevm/ExtVMFace.h>
+#include "State.h"
+#include "Transaction.h"
+
+namespace dev
+{
+namespace eth
+{
+
+class Block;
+class SealEngineFace;
+
+/**
+ * @brief Read-only system contract calls, and the transaction filter decisions made with them.
+ * The state of each new block is kept as an immutable snapshot; every call runs on a private copy
+ * of it, so the transaction verifiers, RPC and block import no longer queue on one Block.
+ * Filter decisions are cached per (filter, origin, from, to, call data). When every filter of the
+ * chain is a stock AuthorityFilter, which only looks at the function selector, the call data is
+ * narrowed to the selector. A new snapshot keeps the decisions unless an account they read (the
+ * filter chain, its filters, their groups...) changed; in that case the tuples seen so far are
+ * re-evaluated in the background.
+ */
+class FilterEvaluator
+{
+public:
+	/// @param _sender the account system contract calls are sent from.
+	explicit FilterEvaluator(Address const& _sender): m_sender(_sender), m_pool("filter", c_threads) {}
+
+	/// Make the state of @a _block the snapshot for all later calls.
+	void update(Block const& _block, LastHashes const& _lh);
+
+	/// Call @a _to with @a _input on the current snapshot; nothing is kept.
+	ExecutionResult call(Address const& _to, bytes const& _input) const;
+
+	/// @returns true if the filter chain @a _filter lets @a _t through.
+	bool allowed(Address const& _filter, Transaction const& _t);
+
+	/// Number of filter checks, and of those answered from the cache.
+	unsigned checks() const { return m_checks; }
+	unsigned hits() const { return m_hits; }
+
+private:
+	struct Snapshot
+	{
+		State state;				///< Never used directly: concurrent const calls on a State race on its cache.
+		EnvInfo env;
+		u256 gas;
+		SealEngineFace const* sealEngine;
+		uint64_t version;
+	};
+
+	struct Decision
+	{
+		Address filter;
+		Address origin;
+		Address from;
+		Address to;
+		bool creation;
+		std::string input;			///< Hex call data of the transaction first seen with this tuple.
+		bool allowed;
+	};
+
+	std::shared_ptr<Snapshot const> snapshot() const { ReadGuard l(x_snapshot); return m_snapshot; }
+
+	ExecutionResult run(Snapshot const& _s, Address const& _to, bytes const& _input, StateAccessSet* _access) const;
+
+	/// Evaluate @a _d on @a _s and cache it if @a _s is still the current snapshot.
+	void evaluate(Snapshot const& _s, h256 const& _key, Decision& _d);
+
+	/// @param _selectorOnly key on the function selector instead of the whole call data.
+	static h256 keyOf(Decision const& _d, bool _selectorOnly);
+
+	/// @returns true if every filter of the chain @a _chain is a stock AuthorityFilter on @a _s.
+	/// Cached per snapshot.
+	bool selectorOnly(Snapshot const& _s, Address const& _chain);
+
+	/// A stock AuthorityFilter is one the chain can create itself: its runtime code is part of the
+	/// chain's code (and is not another chain, which would forward the whole call data).
+	bool stockFilters(Snapshot const& _s, Address const& _chain) const;
+
+	Address m_sender;
+
+	mutable SharedMutex x_snapshot;
+	std::shared_ptr<Snapshot const> m_snapshot;
+
+	mutable SharedMutex x_decisions;
+	std::unordered_map<h256, Decision> m_decisions;
+	AddressHash m_dependencies;		///< Accounts read while making the decisions in m_decisions.
+	std::unordered_map<Address, std::pair<uint64_t, bool>> m_selectorOnly;	///< Filter chain -> (snapshot version, selectorOnly()).
+
+	std::atomic<unsigned> m_checks{0};
+	std::atomic<unsigned> m_hits{0};
+
+	ThreadPool m_pool;				///< Re-evaluates decisions after a filter or authority change.
+
+	static const unsigned c_threads = 2;
+	static const size_t c_maxDecisions = 65536;
+	static const unsigned c_maxStockFilters = 64;	///< Longer chains are keyed on the whole call data.
+};
+
+}
+}
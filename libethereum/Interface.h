@@ -109,6 +109,10 @@ public:
 	/// Injects the RLP-encoded transaction given by the _rlp into the transaction queue directly.
 	virtual std::pair<ImportResult, h256> injectTransaction(bytes const& _rlp, IfDropped _id = IfDropped::Ignore) = 0;
 
+	/// Injects a batch of RLP-encoded transactions into the transaction queue directly.
+	/// @returns the import result and hash of each transaction, in order.
+	virtual std::vector<std::pair<ImportResult, h256>> injectTransactions(std::vector<bytesConstRef> const& _rlps) = 0;
+
 	/// Injects the RLP-encoded block given by the _rlp into the block queue directly.
 	virtual ImportResult injectBlock(bytes const& _block) = 0;
 
@@ -253,6 +257,9 @@ public:
 
 	virtual void updateCache(Address ) {}
 
+	/// @returns true if @a _a is the system proxy or one of the system contracts routed by it.
+	virtual bool isSystemContract(Address const&) const { return false; }
+
 	virtual void sendCustomMessage(const h512, std::shared_ptr<dev::bytes>) {};
 	//为了统计交易处理平均耗时，也是拼了
 	virtual void startStatTranscation(h256) {}
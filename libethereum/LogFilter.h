@@ -66,12 +66,17 @@ public:
 	/// @returns true if addresses and topics are unspecified
 	bool isRangeFilter() const;
 
+	AddressHash const& addresses() const { return m_addresses; }
+	std::array<h256Hash, 4> const& topics() const { return m_topics; }
+
 	/// @returns bloom possibilities for all addresses and topics
 	std::vector<LogBloom> bloomPossibilities() const;
 
 	bool matches(LogBloom _bloom) const;
 	bool matches(Block const& _b, unsigned _i) const;
 	LogEntries matches(TransactionReceipt const& _r) const;
+	/// @returns true if the address and topics of @a _e match, without a bloom check.
+	bool matches(LogEntry const& _e) const;
 
 	LogFilter address(Address _a) { m_addresses.insert(_a); return *this; }
 	LogFilter topic(unsigned _index, h256 const& _t) { if (_index < 4) m_topics[_index].insert(_t); return *this; }
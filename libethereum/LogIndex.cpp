@@ -0,0 +1,196 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: LogIndex.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2017
+ */
+
+#include "LogIndex.h"
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <set>
+#include <libdevcore/easylog.h>
+#include <libdevcore/PersistenceWriter.h>
+#include "BlockChain.h"
+#include "LogFilter.h"
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+/// [ExtraLogIndex][kind][term][block number][transaction index]
+static const unsigned c_keySize = 1 + 1 + 32 + 4 + 4;
+static const string c_fromKey = "logindexfrom";
+
+void putFrom(ldb::WriteBatch& io_batch, unsigned _from)
+{
+	string v(4, '\0');
+	toBigEndian(_from, v);
+	io_batch.Put(ldb::Slice(c_fromKey), ldb::Slice(v));
+}
+}
+
+LogIndex::LogIndex(BlockChain const& _bc, ldb::DB* _extrasDB):
+	m_bc(_bc),
+	m_db(_extrasDB)
+{
+	string v;
+	PersistenceWriter::instance().get(m_db, m_readOptions, ldb::Slice(c_fromKey), &v);
+	if (v.size() == 4)
+		m_from = fromBigEndian<unsigned>(bytesConstRef((byte const*)v.data(), v.size()));
+	else
+	{
+		// First start with the index: blocks imported from now on are indexed as they come in,
+		// the ones already in the chain by backfill().
+		m_from = m_bc.number() + 1;
+		ldb::WriteBatch batch;
+		putFrom(batch, m_from);
+		PersistenceWriter::instance().write({{m_db, PersistTier::Extras, batch}});
+	}
+
+	LOG(INFO) << "Log index covers blocks from #" << m_from;
+	if (m_from > 1)
+		m_backfill = thread([this]()
+		{
+			pthread_setThreadName("logindex");
+			backfill();
+		});
+}
+
+void LogIndex::forget(ldb::DB* _extrasDB)
+{
+	ldb::WriteBatch batch;
+	batch.Delete(ldb::Slice(c_fromKey));
+	PersistenceWriter::instance().write({{_extrasDB, PersistTier::Extras, batch}});
+}
+
+LogIndex::~LogIndex()
+{
+	m_stopping = true;
+	if (m_backfill.joinable())
+		m_backfill.join();
+}
+
+string LogIndex::key(byte _kind, h256 const& _term, unsigned _number, unsigned _tx)
+{
+	string ret(c_keySize, '\0');
+	ret[0] = (char)ExtraLogIndex;
+	ret[1] = (char)_kind;
+	memcpy(&ret[2], _term.data(), 32);
+	bytesRef n((byte*)&ret[34], 4);
+	toBigEndian(_number, n);
+	bytesRef t((byte*)&ret[38], 4);
+	toBigEndian(_tx, t);
+	return ret;
+}
+
+void LogIndex::write(unsigned _number, TransactionReceipts const& _receipts, ldb::WriteBatch& io_batch)
+{
+	for (unsigned i = 0; i < _receipts.size(); ++i)
+	{
+		// A transaction usually emits the same address and topics more than once.
+		set<string> keys;
+		for (LogEntry const& l: _receipts[i].log())
+		{
+			keys.insert(key(AddressKind, h256(l.address, h256::AlignRight), _number, i));
+			for (unsigned j = 0; j < l.topics.size() && j < 4; ++j)
+				keys.insert(key(TopicKind + j, l.topics[j], _number, i));
+		}
+		for (string const& k: keys)
+			io_batch.Put(ldb::Slice(k), ldb::Slice());
+	}
+}
+
+void LogIndex::scan(byte _kind, h256 const& _term, unsigned _from, unsigned _to, vector<Location>& io_locations) const
+{
+	PersistenceWriter::instance().forEachKey(m_db, m_readOptions, key(_kind, _term, _from, 0), key(_kind, _term, _to + 1, 0), [&](ldb::Slice const& _k)
+	{
+		if (_k.size() == c_keySize)
+			io_locations.emplace_back(
+				fromBigEndian<unsigned>(bytesConstRef((byte const*)_k.data() + 34, 4)),
+				fromBigEndian<unsigned>(bytesConstRef((byte const*)_k.data() + 38, 4))
+			);
+		return true;
+	});
+}
+
+vector<LogIndex::Location> LogIndex::lookup(LogFilter const& _f, unsigned _from, unsigned _to) const
+{
+	vector<Location> ret;
+	bool constrained = false;
+
+	// Any of the terms of one dimension may match (union), every constrained dimension must (intersection).
+	auto narrow = [&](byte _kind, h256s const& _terms)
+	{
+		vector<Location> found;
+		for (h256 const& t: _terms)
+			scan(_kind, t, _from, _to, found);
+		sort(found.begin(), found.end());
+		found.erase(unique(found.begin(), found.end()), found.end());
+		if (!constrained)
+			ret = move(found);
+		else
+		{
+			vector<Location> both;
+			set_intersection(ret.begin(), ret.end(), found.begin(), found.end(), back_inserter(both));
+			ret = move(both);
+		}
+		constrained = true;
+		return !ret.empty();
+	};
+
+	if (!_f.addresses().empty())
+	{
+		h256s terms;
+		for (Address const& a: _f.addresses())
+			terms.push_back(h256(a, h256::AlignRight));
+		if (!narrow(AddressKind, terms))
+			return ret;
+	}
+	for (unsigned i = 0; i < 4; ++i)
+		if (!_f.topics()[i].empty() && !narrow(TopicKind + i, h256s(_f.topics()[i].begin(), _f.topics()[i].end())))
+			return ret;
+	return ret;
+}
+
+void LogIndex::backfill()
+{
+	while (!m_stopping && m_from > 1)
+	{
+		unsigned to = m_from - 1;
+		unsigned from = to > c_backfillChunk ? to - c_backfillChunk + 1 : 1;
+		ldb::WriteBatch batch;
+		for (unsigned n = to; n >= from; --n)
+		{
+			if (m_stopping)
+				return;
+			write(n, m_bc.receipts(m_bc.numberHash(n)).receipts, batch);
+		}
+		putFrom(batch, from);
+		PersistenceWriter::instance().write({{m_db, PersistTier::Extras, batch}});
+		m_from = from;
+		// Leave the disk to block import.
+		this_thread::sleep_for(chrono::milliseconds(10));
+	}
+	if (m_from <= 1)
+		LOG(INFO) << "Log index complete";
+}
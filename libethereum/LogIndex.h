@@ -0,0 +1,98 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: LogIndex.h
+ * @author: fisco-dev
+ *
+ * @date: 2017
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <libdevcore/db.h>
+#include "TransactionReceipt.h"
+
+namespace dev
+{
+namespace eth
+{
+
+class BlockChain;
+class LogFilter;
+
+/**
+ * @brief Inverted index of the logs of the canonical chain, kept in the extras database.
+ * There is one empty-valued key per (log address or topic at a position, block number, transaction
+ * index), so the transactions of a block range that emitted a given address or topic are one range
+ * scan. The entries of a block go in the same batch as its receipts. Blocks imported before the
+ * index existed are indexed newest first by a background thread; indexedFrom() tells how far it got.
+ * Entries only narrow the search: callers still match the receipts, which also discards entries
+ * of blocks that are no longer canonical.
+ */
+class LogIndex
+{
+public:
+	/// (block number, transaction index)
+	using Location = std::pair<unsigned, unsigned>;
+
+	LogIndex(BlockChain const& _bc, ldb::DB* _extrasDB);
+	~LogIndex();
+
+	LogIndex(LogIndex const&) = delete;
+	LogIndex& operator=(LogIndex const&) = delete;
+
+	/// Add the index entries of block @a _number with receipts @a _receipts to @a io_batch.
+	static void write(unsigned _number, TransactionReceipts const& _receipts, ldb::WriteBatch& io_batch);
+
+	/// Drop the indexing progress kept in @a _extrasDB. Called when the chain opens with the index disabled,
+	/// since the blocks imported meanwhile are not indexed: the next LogIndex starts over from the head.
+	static void forget(ldb::DB* _extrasDB);
+
+	/// Every block from this number on is indexed.
+	unsigned indexedFrom() const { return m_from; }
+
+	/// @returns the transactions in blocks [@a _from, @a _to] that may hold logs matching @a _f, in
+	/// chain order. @a _f must not be a range filter.
+	std::vector<Location> lookup(LogFilter const& _f, unsigned _from, unsigned _to) const;
+
+private:
+	enum Kind: byte { AddressKind = 0, TopicKind = 1 };		///< TopicKind + i for the topic at position i.
+
+	static std::string key(byte _kind, h256 const& _term, unsigned _number, unsigned _tx);
+
+	/// Append the locations of @a _term in [@a _from, @a _to] to @a io_locations.
+	void scan(byte _kind, h256 const& _term, unsigned _from, unsigned _to, std::vector<Location>& io_locations) const;
+
+	/// Index the blocks below indexedFrom(), newest first, until done or stopped.
+	void backfill();
+
+	BlockChain const& m_bc;
+	ldb::DB* m_db;
+	ldb::ReadOptions m_readOptions;
+	std::atomic<unsigned> m_from{0};
+	std::atomic<bool> m_stopping{false};
+	std::thread m_backfill;
+
+	static const unsigned c_backfillChunk = 256;
+};
+
+}
+}
@@ -23,6 +23,7 @@
 
 #include <libethereum/NonceCheck.h>
 #include <libdevcore/Common.h>
+#include <libdevcore/SHA3.h>
 
 using namespace dev;
 
@@ -33,42 +34,60 @@ NonceCheck:: ~NonceCheck()
 
 u256 NonceCheck::maxblocksize=1000;
 
-void NonceCheck::init(BlockChain const& _bc)
+void NonceCheck::init(BlockChain const& _bc, std::string const& _snapshotPath)
 {   
-    m_startblk=0;
-    m_endblk=0;   
-
+    DEV_GUARDED(x_buckets)
+    {
+        m_snapshotPath = _snapshotPath;
+        if (!m_snapshotPath.empty() && loadSnapshot_WITH_LOCK(_bc))
+        {
+            //只补上快照之后的块，窗口外的留到下次updateCache淘汰
+            unsigned from = m_endblk + 1;
+            m_endblk = _bc.number();
+            addBlocks(_bc, from, m_endblk);
+            LOG(INFO) << "NonceCheck::init from snapshot m_startblk=" << m_startblk << ",m_endblk=" << m_endblk << ",caught up from " << from << ",size=" << size();
+            return;
+        }
+        m_startblk=0;
+        m_endblk=0;   
+    }
 
     updateCache(_bc,true);
 
 }//fun 
 
 //这个地方的生成算法 是可变的，但感觉不用加上blocklimit? blocklimit 在交易进块之前做就可以了，和nonce校验分开
-std::string NonceCheck::generateKey(Transaction const & _t)
+//注意：快照中存的是这个key，改变算法需同时改c_snapshotVersion
+h256 NonceCheck::generateKey(Transaction const & _t)
 {   
     Address account=_t.from();
-    std::string key=toHex(account.ref());
-    key += "_"+toString(_t.randomid());
+    h256 randomid(_t.randomid());
+    bytes data = account.asBytes();
+    data += randomid.asBytes();
+
+    return sha3(data);
+}
 
-    return key; //可读性好些，计算sha256也可以 
+bool NonceCheck::live(Stripe const& _s, h256 const& _key) const
+{
+    auto iter = _s.keys.find(_key);
+    return iter != _s.keys.end() && iter->second >= m_startblk;
 }
 
 bool NonceCheck::ok(Transaction const & _transaction,bool _needinsert)
 {
-    DEV_WRITE_GUARDED(m_lock)
+    h256 key=generateKey(_transaction);
+    Stripe& s = stripeFor(key);
+    if( !_needinsert )
     {
-        string key=this->generateKey(_transaction);
-        auto iter=  m_cache.find( key );
-        if( iter != m_cache.end() )
-            return false;
-        if( _needinsert )
-        {
-            m_cache.insert(std::pair<std::string,bool>(key,true));  
-        }
-
+        ReadGuard l(s.lock);
+        return !live(s, key);
+    }
 
-        
-    }   
+    WriteGuard l(s.lock);
+    if( live(s, key) )
+        return false;
+    s.keys[key] = c_pendingBlock;
 
     return true;
 }
@@ -77,24 +96,78 @@ bool NonceCheck::ok(Transaction const & _transaction,bool _needinsert)
 
 void NonceCheck::delCache( Transactions const & _transcations)
 {
-    DEV_WRITE_GUARDED(m_lock)
+    //只删ok(_needinsert)插入的，已上链的key由updateCache维护
+    for( unsigned i=0;i<_transcations.size();i++)
+    {
+        h256 key=generateKey(_transcations[i]);
+        Stripe& s = stripeFor(key);
+        WriteGuard l(s.lock);
+        auto iter=  s.keys.find( key );
+        if( iter != s.keys.end() && iter->second == c_pendingBlock )
+            s.keys.erase(iter);   
+    }//for 
+}
+
+void NonceCheck::addBlocks(BlockChain const& _bc, unsigned _from, unsigned _to)
+{
+    for( unsigned  i=_from;i<=_to;i++)
     {
-        for( unsigned i=0;i<_transcations.size();i++)
+        h256 blockhash=_bc.numberHash(i);//先拿到块hash
+
+        std::vector<bytes> bytestrans=_bc.transactions(blockhash);
+        h256s& bucket = m_buckets[i];
+        bucket.clear();
+        bucket.reserve(bytestrans.size());
+        for( unsigned j=0;j<bytestrans.size();j++)
         {
-            string key=this->generateKey(_transcations[i]);
-            auto iter=  m_cache.find( key );
-            if( iter != m_cache.end() )
-                m_cache.erase(iter);   
+            Transaction	t = Transaction(bytestrans[j], CheckTransaction::None);
+            h256 key=generateKey(t);
+            bucket.push_back(key);
+
+            Stripe& s = stripeFor(key);
+            WriteGuard l(s.lock);
+            s.keys[key] = i;
         }//for 
+    }//for
+}
+
+void NonceCheck::dropBlocks(unsigned _before)
+{
+    for (auto it = m_buckets.begin(); it != m_buckets.end() && it->first < _before; it = m_buckets.erase(it))
+    {
+        for (h256 const& key : it->second)
+        {
+            Stripe& s = stripeFor(key);
+            WriteGuard l(s.lock);
+            auto iter = s.keys.find(key);
+            //同一个key可能已被更新的块或未上链的交易占用
+            if( iter != s.keys.end() && iter->second == it->first )
+                s.keys.erase(iter);
+        }
     }
 }
 
+void NonceCheck::clear_WITH_LOCK()
+{
+    for (Stripe& s : m_stripes)
+        DEV_WRITE_GUARDED(s.lock)
+            s.keys.clear();
+    m_buckets.clear();
+}
 
+size_t NonceCheck::size() const
+{
+    size_t ret = 0;
+    for (Stripe const& s : m_stripes)
+        DEV_READ_GUARDED(s.lock)
+            ret += s.keys.size();
+    return ret;
+}
 
 void NonceCheck::updateCache(BlockChain const& _bc,bool _rebuild/*是否强制rebuild */)
 { 
   
-    DEV_WRITE_GUARDED(m_lock)
+    DEV_GUARDED(x_buckets)
     {
         try
         {
@@ -105,54 +178,33 @@ void NonceCheck::updateCache(BlockChain const& _bc,bool _rebuild/*是否强制re
             unsigned prestartblk=m_startblk;
             unsigned preendblk=m_endblk;
 
-            m_endblk=lastnumber;
+            unsigned startblk = 0;
             if( lastnumber >(unsigned)NonceCheck::maxblocksize )
-                m_startblk=lastnumber-(unsigned)NonceCheck::maxblocksize;
-            else
-                m_startblk=0;
+                startblk=lastnumber-(unsigned)NonceCheck::maxblocksize;
            
-            LOG(TRACE)<<"NonceCheck::updateCache m_startblk="<<m_startblk<<",m_endblk="<<m_endblk<<",prestartblk="<<prestartblk<<",preendblk="<<preendblk<<",_rebuild="<<_rebuild;
+            LOG(TRACE)<<"NonceCheck::updateCache m_startblk="<<startblk<<",m_endblk="<<lastnumber<<",prestartblk="<<prestartblk<<",preendblk="<<preendblk<<",_rebuild="<<_rebuild;
             if( _rebuild ) // 如果是直接重建
             {
-                m_cache.clear();//直接清空，重建，避免在切链的时候或者启动的时候工作量太大
+                clear_WITH_LOCK();//直接清空，重建，避免在切链的时候或者启动的时候工作量太大
                 preendblk=0;//让下面的for循环取到m_startblk开始
+                m_startblk=startblk;
             }
             else
             {
-                //第二步 淘汰掉 窗口外的
-                 for( unsigned  i=prestartblk;i<m_startblk;i++)
-                {
-                    h256 blockhash=_bc.numberHash(i);//先拿到块hash
-
-                    std::vector<bytes> bytestrans=_bc.transactions(blockhash);
-                    for( unsigned j=0;j<bytestrans.size();j++)
-                    {
-                            Transaction	t = Transaction(bytestrans[j], CheckTransaction::None);
-                            string key=this->generateKey(t);
-                            auto iter=  m_cache.find( key );
-                            if( iter != m_cache.end() )
-                                m_cache.erase(iter);   
-                    }//for 
-                }//for
+                //第二步 淘汰掉 窗口外的：前移m_startblk后它们立即失效，再回收内存
+                m_startblk=startblk;
+                dropBlocks(startblk);
             }
            
             //第三步 新增  注意这里的条件 避免重复执行插入
-            for( unsigned  i=std::max(preendblk+1,m_startblk);i<=m_endblk;i++)
-            {
-                h256 blockhash=_bc.numberHash(i);//先拿到块hash
-
-                std::vector<bytes> bytestrans=_bc.transactions(blockhash);
-                for( unsigned j=0;j<bytestrans.size();j++)
-                {
-                        Transaction	t = Transaction(bytestrans[j], CheckTransaction::None);
-                        string key=this->generateKey(t);
-                        auto iter=  m_cache.find( key );
-                        if( iter == m_cache.end() )
-                            m_cache.insert(std::pair<std::string,bool>(key,true));   
-                }//for 
-            }//for
+            m_endblk=lastnumber;
+            if( m_endblk >= std::max(preendblk+1,startblk) )
+                addBlocks(_bc, std::max(preendblk+1,startblk), m_endblk);
+
+            if( !m_snapshotPath.empty() && m_endblk >= m_lastSnapshot + c_snapshotInterval )
+                saveSnapshot_WITH_LOCK(_bc);
                 
-            LOG(TRACE)<<"NonceCheck::updateCache cache size="<<m_cache.size()<<",cost"<<(timer.elapsed() * 1000);
+            LOG(TRACE)<<"NonceCheck::updateCache cache size="<<size()<<",cost"<<(timer.elapsed() * 1000);
 
         }
         catch (...)
@@ -166,5 +218,78 @@ void NonceCheck::updateCache(BlockChain const& _bc,bool _rebuild/*是否强制re
     
 }//fun
 
+void NonceCheck::saveSnapshot(BlockChain const& _bc)
+{
+    Guard l(x_buckets);
+    if( !m_snapshotPath.empty() )
+        saveSnapshot_WITH_LOCK(_bc);
+}
 
+void NonceCheck::saveSnapshot_WITH_LOCK(BlockChain const& _bc)
+{
+    try
+    {
+        Timer timer;
+        //快照与最新块hash绑定，切链或回滚后失效
+        RLPStream buckets(m_buckets.size());
+        for (auto const& b : m_buckets)
+            buckets.appendList(2) << b.first << b.second;
+
+        RLPStream s(5);
+        s << c_snapshotVersion << _bc.numberHash(m_endblk) << (unsigned)m_startblk << m_endblk;
+        s.appendRaw(buckets.out());
+        writeFile(m_snapshotPath, s.out(), true);
+        m_lastSnapshot = m_endblk;
+        LOG(TRACE) << "NonceCheck::saveSnapshot m_endblk=" << m_endblk << ",buckets=" << m_buckets.size() << ",cost" << (timer.elapsed() * 1000);
+    }
+    catch (...)
+    {
+        LOG(WARNING) << "NonceCheck::saveSnapshot failed " << boost::current_exception_diagnostic_information();
+    }
+}
+
+bool NonceCheck::loadSnapshot_WITH_LOCK(BlockChain const& _bc)
+{
+    bytes data = contents(m_snapshotPath);
+    if( data.empty() )
+        return false;
 
+    try
+    {
+        RLP r(data);
+        if( r[0].toInt<unsigned>() != c_snapshotVersion )
+            return false;
+        h256 endhash = r[1].toHash<h256>();
+        unsigned startblk = r[2].toInt<unsigned>();
+        unsigned endblk = r[3].toInt<unsigned>();
+        if( endblk > _bc.number() || _bc.numberHash(endblk) != endhash )
+        {
+            LOG(INFO) << "NonceCheck::loadSnapshot snapshot at " << endblk << " is not on the current chain, rebuild";
+            return false;
+        }
+
+        clear_WITH_LOCK();
+        for (auto const& b : r[4])
+        {
+            unsigned number = b[0].toInt<unsigned>();
+            h256s& bucket = m_buckets[number];
+            bucket = b[1].toVector<h256>();
+            for (h256 const& key : bucket)
+            {
+                Stripe& s = stripeFor(key);
+                WriteGuard l(s.lock);
+                s.keys[key] = number;
+            }
+        }
+        m_startblk = startblk;
+        m_endblk = endblk;
+        m_lastSnapshot = endblk;
+        return true;
+    }
+    catch (...)
+    {
+        LOG(WARNING) << "NonceCheck::loadSnapshot bad snapshot, rebuild " << boost::current_exception_diagnostic_information();
+        clear_WITH_LOCK();
+        return false;
+    }
+}
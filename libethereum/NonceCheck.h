@@ -24,6 +24,9 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <map>
 #include <libdevcore/Common.h>
 #include <libdevcore/Guards.h>
 #include <libdevcore/easylog.h>
@@ -44,20 +47,46 @@ namespace eth
 {
 
 
+/**
+ * 链上最近maxblocksize个块中交易的(sender, randomid)索引，用于防重放。
+ * key是sender和randomid的hash；按块分桶记录每块的key，淘汰窗口外的块时只需前移m_startblk，
+ * 不必再从库里读出交易解码。key按hash分片加锁，ok()只读锁一个分片。
+ * 索引定期快照到磁盘，重启时加载快照后只需补上快照之后的块。
+ */
 class NonceCheck 
 {
 private:   
     //不用 起线程refresh 
-  
-    std::unordered_map< std::string,bool  > m_cache;    
-    unsigned m_startblk;  //cache中最老的块号
-    unsigned m_endblk;  //cache中最新的块号
-
-    
-
-    mutable SharedMutex  m_lock;
-    
-   std::string generateKey(Transaction const & _t);  //根据交易信息生成 命中的value，后面可以加blocklimit 
+    static const unsigned c_stripes = 16;
+    static const unsigned c_pendingBlock = (unsigned)-1;   //ok(_needinsert)插入的、尚未上链的key
+    static const unsigned c_snapshotInterval = 1000;       //每隔多少块落一次快照
+    static const unsigned c_snapshotVersion = 1;
+
+    struct Stripe
+    {
+        mutable SharedMutex lock;
+        std::unordered_map<h256, unsigned> keys;   //key -> 所在块号
+    };
+    std::array<Stripe, c_stripes> m_stripes;
+
+    std::atomic<unsigned> m_startblk{0};  //cache中最老的块号，块号比它小的key视为已淘汰
+    unsigned m_endblk = 0;  //cache中最新的块号
+
+    mutable Mutex x_buckets;   //保护m_buckets、m_endblk，同时让updateCache串行
+    std::map<unsigned, h256s> m_buckets;    //块号 -> 块中交易的key
+    std::string m_snapshotPath;
+    unsigned m_lastSnapshot = 0;     //上一次快照时的m_endblk
+
+    static h256 generateKey(Transaction const & _t);  //根据交易信息生成 命中的value，后面可以加blocklimit 
+    Stripe& stripeFor(h256 const& _key) { return m_stripes[_key[0] % c_stripes]; }
+    bool live(Stripe const& _s, h256 const& _key) const;
+
+    //以下需持有x_buckets
+    void addBlocks(BlockChain const& _bc, unsigned _from, unsigned _to);   //把[_from, _to]块的交易加入索引
+    void dropBlocks(unsigned _before);      //回收块号小于_before的桶
+    void clear_WITH_LOCK();
+    bool loadSnapshot_WITH_LOCK(BlockChain const& _bc);
+    void saveSnapshot_WITH_LOCK(BlockChain const& _bc);
    
 public:
     static u256    maxblocksize;//最多缓存多少个块的的交易的nonce 从全网配置中读取
@@ -69,7 +98,8 @@ public:
 
 	 ~NonceCheck() ;
 
-	void init(BlockChain const& _bc);
+	//_snapshotPath为空时不使用快照
+	void init(BlockChain const& _bc, std::string const& _snapshotPath = std::string());
 	//如果存在cache中，返回false 否则true
     bool ok(Transaction const & _transaction,bool _needinsert=false/*如果不存在是否插入*/);
    
@@ -78,6 +108,9 @@ public:
 
     void delCache( Transactions const & _transcations);//考虑 当前块处理所有交易的回滚
 
+    void saveSnapshot(BlockChain const& _bc);   //退出前调用，下次启动时不必重建
+
+    size_t size() const;
 };
 
 
@@ -0,0 +1,146 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: PackingScheduler.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2017
+ */
+
+#include "PackingScheduler.h"
+#include <cmath>
+#include <libdevcore/easylog.h>
+#include <libdevcore/SHA3.h>
+#include "StatLog.h"
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+PackingScheduler& PackingScheduler::instance()
+{
+	static PackingScheduler s_scheduler;
+	return s_scheduler;
+}
+
+void PackingScheduler::Histogram::add(uint64_t _us)
+{
+	unsigned b = 0;
+	while (b + 1 < c_buckets && (_us >> (b + 1)))
+		++b;
+	++counts[b];
+	++total;
+
+	if (total >= c_maxSamples)
+	{
+		total = 0;
+		for (auto& c : counts)
+			total += (c /= 2);
+	}
+}
+
+uint64_t PackingScheduler::Histogram::estimate() const
+{
+	if (!total)
+		return c_defaultUs;
+
+	// Leave out the top 5%: a rare slow run should not make every block half-empty.
+	uint32_t keep = max<uint32_t>(1, total - total / 20);
+	uint64_t sum = 0;
+	uint32_t n = 0;
+	for (unsigned b = 0; b < c_buckets && n < keep; ++b)
+	{
+		uint32_t c = min(counts[b], keep - n);
+		sum += c * ((uint64_t(1) << b) * 3 / 2);	// bucket midpoint
+		n += c;
+	}
+	return max<uint64_t>(1, sum / n);
+}
+
+h256 PackingScheduler::costKey(Transaction const& _t)
+{
+	if (_t.isCreation())
+		return h256();
+	bytes key = _t.receiveAddress().asBytes();
+	key.insert(key.end(), _t.data().begin(), _t.data().begin() + min<size_t>(4, _t.data().size()));
+	return sha3(key);
+}
+
+uint64_t PackingScheduler::predict_WITH_LOCK(Transaction const& _t) const
+{
+	auto it = m_histograms.find(costKey(_t));
+	if (it != m_histograms.end() && it->second.total >= c_minSamples)
+		return it->second.estimate();
+	return m_all.estimate();
+}
+
+uint64_t PackingScheduler::predict(Transaction const& _t) const
+{
+	Guard l(x_stats);
+	return predict_WITH_LOCK(_t);
+}
+
+uint64_t PackingScheduler::predict(Transactions const& _txs) const
+{
+	Guard l(x_stats);
+	uint64_t ret = 0;
+	for (auto const& t : _txs)
+		ret += predict_WITH_LOCK(t);
+	return ret;
+}
+
+void PackingScheduler::noteExecuted_WITH_LOCK(Transaction const& _t, uint64_t _us)
+{
+	m_histograms[costKey(_t)].add(_us);
+	m_all.add(_us);
+}
+
+void PackingScheduler::noteExecuted(Transaction const& _t, uint64_t _us)
+{
+	Guard l(x_stats);
+	noteExecuted_WITH_LOCK(_t, _us);
+}
+
+void PackingScheduler::noteExecuted(Transactions const& _txs, uint64_t _us)
+{
+	Guard l(x_stats);
+	vector<uint64_t> predicted;
+	predicted.reserve(_txs.size());
+	uint64_t sum = 0;
+	for (auto const& t : _txs)
+	{
+		predicted.push_back(predict_WITH_LOCK(t));
+		sum += predicted.back();
+	}
+	if (!sum)
+		return;
+	for (size_t i = 0; i < _txs.size(); ++i)
+		noteExecuted_WITH_LOCK(_txs[i], max<uint64_t>(1, _us * predicted[i] / sum));
+}
+
+void PackingScheduler::noteBlock(uint64_t _predictedUs, uint64_t _actualUs)
+{
+	if (!_actualUs)
+		return;
+
+	double error = 100.0 * fabs(double(_predictedUs) - double(_actualUs)) / double(_actualUs);
+	DEV_GUARDED(x_stats)
+		m_predictionError = m_predictionError ? (m_predictionError * 7 + error) / 8 : error;
+
+	LOG(DEBUG) << "PackingScheduler predicted=" << _predictedUs << "us,actual=" << _actualUs << "us,error=" << error << "%";
+	statemonitor::recordStateByTimeOnce(dev::StatCode::BLOCK_PACK_PREDICT, LogFlowConstant::PBFTReportInterval, error, STAT_BLOCK_PACK_PREDICT, "");
+}
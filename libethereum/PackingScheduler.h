@@ -0,0 +1,101 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: PackingScheduler.h
+ * @author: fisco-dev
+ *
+ * @date: 2017
+ */
+
+#pragma once
+
+#include <array>
+#include <unordered_map>
+#include <libdevcore/Guards.h>
+#include "Transaction.h"
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * @brief Predicts how long transactions take to execute, so that a block can be packed up to a
+ * time budget rather than up to a fixed count.
+ * Execution times measured by Block::exec are kept in a log-scale histogram per
+ * (receiver, function selector); contract creations share one histogram. A transaction is
+ * predicted from its own histogram once it has enough samples, otherwise from the histogram
+ * of all transactions.
+ */
+class PackingScheduler
+{
+public:
+	/// The process-wide scheduler.
+	static PackingScheduler& instance();
+
+	/// @returns the predicted execution time of @a _t in microseconds.
+	uint64_t predict(Transaction const& _t) const;
+
+	/// @returns the predicted execution time of all of @a _txs in microseconds.
+	uint64_t predict(Transactions const& _txs) const;
+
+	/// Learn that @a _t took @a _us microseconds to execute.
+	void noteExecuted(Transaction const& _t, uint64_t _us);
+
+	/// Learn that @a _txs took @a _us microseconds to execute together (e.g. in parallel); the time is
+	/// shared out in proportion to the current predictions.
+	void noteExecuted(Transactions const& _txs, uint64_t _us);
+
+	/// Record the predicted and the measured execution time of a packed block, for the accuracy metric.
+	void noteBlock(uint64_t _predictedUs, uint64_t _actualUs);
+
+	/// @returns the moving average of the relative prediction error of packed blocks, in percent.
+	double predictionError() const { Guard l(x_stats); return m_predictionError; }
+
+private:
+	PackingScheduler() {}
+
+	static const unsigned c_buckets = 24;			///< Bucket i holds times in [2^i, 2^(i+1)) us; the last one everything above.
+
+	struct Histogram
+	{
+		std::array<uint32_t, c_buckets> counts = {};
+		uint32_t total = 0;
+
+		void add(uint64_t _us);
+		/// Mean of the samples below the 95th percentile, from the bucket midpoints.
+		uint64_t estimate() const;
+	};
+
+	/// @returns the key under which execution times of @a _t are tracked.
+	static h256 costKey(Transaction const& _t);
+
+	uint64_t predict_WITH_LOCK(Transaction const& _t) const;
+	void noteExecuted_WITH_LOCK(Transaction const& _t, uint64_t _us);
+
+	mutable Mutex x_stats;
+	std::unordered_map<h256, Histogram> m_histograms;
+	Histogram m_all;								///< All transactions, for keys without enough samples.
+	double m_predictionError = 0;
+
+	static const uint32_t c_minSamples = 4;			///< Samples needed before a key's own histogram is used.
+	static const uint32_t c_maxSamples = 1024;		///< Halve a histogram beyond this, to follow workload changes.
+	static const uint64_t c_defaultUs = 1000;		///< Prediction before anything has been measured.
+};
+
+}
+}
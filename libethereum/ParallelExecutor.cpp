@@ -0,0 +1,157 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: ParallelExecutor.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2017
+ */
+
+#include "ParallelExecutor.h"
+#include <libdevcore/easylog.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+ParallelExecutor& ParallelExecutor::instance(unsigned _threads)
+{
+	static ParallelExecutor s_executor(_threads);
+	return s_executor;
+}
+
+vector<SpeculativeExecution> ParallelExecutor::speculate(State const& _base, EnvInfo const& _env, SealEngineFace const& _sealEngine, vector<Transaction const*> const& _txs)
+{
+	vector<SpeculativeExecution> ret(_txs.size());
+
+	m_pool.parallelFor(_txs.size(), [&](size_t _i)
+	{
+		SpeculativeExecution& out = ret[_i];
+		try
+		{
+			unique_ptr<State> s(new State(_base));
+			s->setAccessSet(&out.access);
+			auto resultReceipt = s->execute(_env, _sealEngine, *_txs[_i], Permanence::Dry);
+			s->setAccessSet(nullptr);
+
+			out.result = resultReceipt.first;
+			out.gasUsed = resultReceipt.second.gasUsed() - _env.gasUsed();
+			out.logs = resultReceipt.second.log();
+			out.contractAddress = resultReceipt.second.contractAddress();
+			out.state = move(s);
+		}
+		catch (...)
+		{
+			LOG(TRACE) << "ParallelExecutor::speculate tx " << _txs[_i]->sha3() << " threw, will be replayed";
+			out.exception = current_exception();
+		}
+	});
+
+	return ret;
+}
+
+ParallelExecHint ParallelExecutor::predict(Transactions const& _txs) const
+{
+	ParallelExecHint ret;
+	ret.txCount = _txs.size();
+
+	AddressHash senders;
+	Guard l(x_stats);
+	for (unsigned i = 0; i < _txs.size(); ++i)
+	{
+		Transaction const& t = _txs[i];
+
+		// A second transaction from the same sender always reads the nonce the first one wrote.
+		bool serial = !senders.insert(t.safeSender()).second;
+		if (!serial && !t.isCreation())
+		{
+			auto it = m_stats.find(conflictKey(t));
+			serial = it != m_stats.end() && it->second.runs >= c_minRuns && it->second.conflicts * 2 > it->second.runs;
+		}
+		if (serial)
+			ret.serial.push_back(i);
+	}
+	return ret;
+}
+
+void ParallelExecutor::noteOutcome(Transaction const& _t, bool _conflicted)
+{
+	if (_t.isCreation())
+		return;
+
+	h256 key = conflictKey(_t);
+	Guard l(x_stats);
+	ConflictStat& stat = m_stats[key];
+	++stat.runs;
+	if (_conflicted)
+		++stat.conflicts;
+	if (stat.runs >= c_maxRuns)
+	{
+		stat.runs /= 2;
+		stat.conflicts /= 2;
+	}
+}
+
+h256 ParallelExecutor::conflictKey(Transaction const& _t)
+{
+	bytes key = _t.receiveAddress().asBytes();
+	key.insert(key.end(), _t.data().begin(), _t.data().begin() + min<size_t>(4, _t.data().size()));
+	return sha3(key);
+}
+
+bytes ParallelExecHint::rlp() const
+{
+	RLPStream s(2);
+	s << txCount;
+	s.appendVector(serial);
+	return s.out();
+}
+
+bool ParallelExecHint::populate(bytesConstRef _data)
+{
+	if (_data.empty())
+		return false;
+	try
+	{
+		RLP r(_data);
+		if (!r.isList() || r.itemCount() != 2)
+			return false;
+		txCount = r[0].toInt<unsigned>();
+		serial = r[1].toVector<unsigned>();
+		return true;
+	}
+	catch (Exception const& _e)
+	{
+		LOG(WARNING) << "ParallelExecHint::populate bad hint: " << _e.what();
+		return false;
+	}
+}
+
+vector<bool> ParallelExecHint::serialMask(size_t _txCount) const
+{
+	if (_txCount != txCount)
+		return vector<bool>();
+
+	vector<bool> ret(_txCount, false);
+	for (unsigned i: serial)
+	{
+		if (i >= _txCount)
+			return vector<bool>();
+		ret[i] = true;
+	}
+	return ret;
+}
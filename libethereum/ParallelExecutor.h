@@ -0,0 +1,127 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: ParallelExecutor.h
+ * @author: fisco-dev
+ *
+ * @date: 2017
+ */
+
+#pragma once
+
+#include <memory>
+#include <exception>
+#include <vector>
+#include <unordered_map>
+#include <libdevcore/ThreadPool.h>
+#include <libevm/ExtVMFace.h>
+#include "State.h"
+#include "Transaction.h"
+
+namespace dev
+{
+namespace eth
+{
+
+class SealEngineFace;
+
+/// One transaction run on a private copy of the block's state.
+struct SpeculativeExecution
+{
+	std::unique_ptr<State> state;		///< The private copy after execution; null if the transaction threw.
+	StateAccessSet access;				///< Everything the transaction read or wrote.
+	ExecutionResult result;
+	u256 gasUsed;						///< Gas used by this transaction alone.
+	LogEntries logs;
+	Address contractAddress;
+	std::exception_ptr exception;		///< Set if execution threw; the transaction must be re-run serially.
+};
+
+/**
+ * @brief Scheduling hint for the transactions of one block.
+ * Produced by the PBFT leader and carried in the PrepareReq so that followers do not waste
+ * speculative runs on transactions that are known to depend on an earlier one. It is advisory
+ * only: every speculative result is still checked for conflicts before it is merged.
+ */
+struct ParallelExecHint
+{
+	unsigned txCount = 0;				///< Number of transactions in the block the hint was made for.
+	std::vector<unsigned> serial;		///< Ascending indices of transactions to execute serially.
+
+	bytes rlp() const;
+
+	/// @returns false if @a _data is empty or not a well-formed hint.
+	bool populate(bytesConstRef _data);
+
+	/// @returns one flag per transaction (true: execute serially), or an empty vector if the hint
+	/// does not describe a block of @a _txCount transactions.
+	std::vector<bool> serialMask(size_t _txCount) const;
+};
+
+/**
+ * @brief Optimistic executor for the transactions of a block.
+ * Each transaction runs on its own copy of a common base state on a shared worker pool,
+ * recording its read/write set. Block then commits the results in block order, replaying
+ * serially any transaction whose reads overlap the writes of those committed before it.
+ */
+class ParallelExecutor
+{
+public:
+	/// The process-wide executor. @a _threads is only honoured by the first call (0: one per core).
+	static ParallelExecutor& instance(unsigned _threads = 0);
+
+	/// Execute each of @a _txs independently on a copy of @a _base.
+	/// @a _env.gasUsed() should be zero; the block gas limit check is repeated by the caller in order.
+	/// Blocks until all transactions have run. Never throws for a failing transaction.
+	std::vector<SpeculativeExecution> speculate(State const& _base, EnvInfo const& _env, SealEngineFace const& _sealEngine, std::vector<Transaction const*> const& _txs);
+
+	/// How many transactions to speculate on before merging and taking a fresh base state.
+	unsigned windowSize() const { return m_pool.size() * 4; }
+
+	unsigned threads() const { return m_pool.size(); }
+
+	/// Predict which of @a _txs will conflict, from the sender order and the conflict history of
+	/// previously executed transactions calling the same contract function.
+	ParallelExecHint predict(Transactions const& _txs) const;
+
+	/// Learn whether @a _t conflicted with an earlier transaction of its block.
+	void noteOutcome(Transaction const& _t, bool _conflicted);
+
+private:
+	explicit ParallelExecutor(unsigned _threads): m_pool("txexec", _threads) {}
+
+	/// Conflict history of one (receiver, function selector) pair.
+	struct ConflictStat
+	{
+		unsigned runs = 0;
+		unsigned conflicts = 0;
+	};
+
+	/// @returns the key under which conflicts of @a _t are tracked.
+	static h256 conflictKey(Transaction const& _t);
+
+	ThreadPool m_pool;
+
+	mutable Mutex x_stats;
+	std::unordered_map<h256, ConflictStat> m_stats;
+
+	static const unsigned c_minRuns = 8;			///< Samples needed before a prediction is made.
+	static const unsigned c_maxRuns = 256;			///< Halve the history beyond this, to follow workload changes.
+};
+
+}
+}
@@ -28,6 +28,7 @@
 #include <libdevcore/easylog.h>
 #include <libdevcore/Assertions.h>
 #include <libdevcore/TrieHash.h>
+#include <libdevcore/Metrics.h>
 #include <libevmcore/Instruction.h>
 #include <libethcore/Exceptions.h>
 #include <libevm/VMFactory.h>
@@ -183,6 +184,9 @@ Account const* State::account(Address const& _a) const
 
 Account* State::account(Address const& _addr)
 {
+	if (m_access)
+		m_access->readAccounts.insert(_addr);
+
 	auto it = m_cache.find(_addr);
 	if (it != m_cache.end())
 		return &it->second;
@@ -302,6 +306,8 @@ u256 State::balance(Address const& ) const
 
 void State::incNonce(Address const& _addr)
 {
+	if (m_access)
+		m_access->writtenAccounts.insert(_addr);
 	if (Account* a = account(_addr))
 	{
 		a->incNonce();
@@ -315,6 +321,8 @@ void State::incNonce(Address const& _addr)
 void State::addBalance(Address const& _id, u256 const& _amount)
 {
 	//不能直接return
+	if (m_access)
+		m_access->writtenAccounts.insert(_id);
 
 	if (Account* a = account(_id))
 	{
@@ -364,6 +372,8 @@ void State::createContract(Address const& _address)
 void State::createAccount(Address const& _address, Account const&& _account)
 {
 	assert(!addressInUse(_address) && "Account already exists");
+	if (m_access)
+		m_access->writtenAccounts.insert(_address);
 	m_cache[_address] = std::move(_account);
 	m_nonExistingAccountsCache.erase(_address);
 	m_changeLog.emplace_back(Change::Create, _address);
@@ -371,6 +381,8 @@ void State::createAccount(Address const& _address, Account const&& _account)
 
 void State::kill(Address _addr)
 {
+	if (m_access)
+		m_access->writtenAccounts.insert(_addr);
 	if (auto a = account(_addr))
 		a->kill();
 	// If the account is not in the db, nothing to kill.
@@ -386,6 +398,9 @@ u256 State::getNonce(Address const& _addr) const
 
 u256 State::storage(Address const& _id, u256 const& _key) const
 {
+	if (m_access)
+		m_access->readSlots[_id].insert(_key);
+
 	if (Account const* a = account(_id))
 	{
 		//从对应的account下找寻存在的key
@@ -408,6 +423,8 @@ u256 State::storage(Address const& _id, u256 const& _key) const
 void State::setStorage(Address const& _contract, u256 const& _key, u256 const& _value)
 {
 	//LOG(TRACE) << "State::setStorage " << _key << "," << _value;
+	if (m_access)
+		m_access->writtenSlots[_contract].insert(_key);
 
 	m_changeLog.emplace_back(_contract, _key, storage(_contract, _key));
 	m_cache[_contract].setStorage(_key, _value);
@@ -457,6 +474,8 @@ map<h256, pair<u256, u256>> State::storage(Address const& _id) const
 
 h256 State::storageRoot(Address const& _id) const
 {
+	if (m_access)
+		m_access->readAccounts.insert(_id);
 	string s = m_state.at(_id);
 	if (s.size())
 	{
@@ -485,6 +504,11 @@ bytes const& State::code(Address const& _addr) const
 
 void State::setNewCode(Address const& _address, bytes&& _code)
 {
+	if (m_access)
+	{
+		m_access->readAccounts.insert(_address);
+		m_access->writtenAccounts.insert(_address);
+	}
 	m_cache[_address].setNewCode(std::move(_code));
 	m_changeLog.emplace_back(Change::NewCode, _address);
 }
@@ -586,6 +610,11 @@ std::pair<ExecutionResult, TransactionReceipt> State::execute(EnvInfo const& _en
 		e.go(onOp);
 	e.finalize();
 
+	static metrics::Counter& s_gasUsed = metrics::counter("fisco_vm_gas_used_total", "Gas used by executed transactions and calls");
+	static metrics::Counter& s_executed = metrics::counter("fisco_vm_transactions_total", "Transactions and calls executed");
+	s_gasUsed.add(e.gasUsed().convert_to<uint64_t>());
+	s_executed.add();
+
 	if (_p == Permanence::Dry) {
 		//什么也不做
 	}
@@ -607,6 +636,76 @@ std::unordered_map<Address, Account> dev::eth::State::getCache() {
 	return m_cache;
 }
 
+void State::applySpeculative(State const& _speculative, StateAccessSet const& _access)
+{
+	// Accounts whose nonce, balance, code or existence changed: nothing else in the block touched
+	// them since the copy was taken, so the speculative account is exactly what serial execution gives.
+	for (auto const& a : _access.writtenAccounts)
+	{
+		auto it = _speculative.m_cache.find(a);
+		if (it == _speculative.m_cache.end())
+			continue;	// Created and rolled back again; no net effect.
+		m_cache[a] = it->second;
+		m_nonExistingAccountsCache.erase(a);
+		if (m_access)
+			m_access->writtenAccounts.insert(a);
+	}
+
+	// Storage-only changes are merged slot by slot; other slots of the same account may have
+	// been written by earlier transactions of the block.
+	for (auto const& slots : _access.writtenSlots)
+	{
+		if (_access.writtenAccounts.count(slots.first))
+			continue;
+		auto it = _speculative.m_cache.find(slots.first);
+		if (it == _speculative.m_cache.end())
+			continue;
+
+		account(slots.first);
+		Account& target = m_cache[slots.first];
+		for (auto const& key : slots.second)
+		{
+			auto v = it->second.storageOverlay().find(key);
+			if (v == it->second.storageOverlay().end())
+				continue;
+			target.setStorage(key, v->second);
+			if (m_access)
+				m_access->writtenSlots[slots.first].insert(key);
+		}
+	}
+}
+
+bool StateAccessSet::conflictsWith(StateAccessSet const& _prior) const
+{
+	for (auto const& a : readAccounts)
+		if (_prior.writtenAccounts.count(a))
+			return true;
+
+	for (auto const& slots : readSlots)
+	{
+		auto it = _prior.writtenSlots.find(slots.first);
+		if (it == _prior.writtenSlots.end())
+			continue;
+		for (auto const& key : slots.second)
+			if (it->second.count(key))
+				return true;
+	}
+
+	// Whole accounts are copied back by State::applySpeculative(), which would drop storage writes made in between.
+	for (auto const& a : writtenAccounts)
+		if (_prior.writtenSlots.count(a))
+			return true;
+
+	return false;
+}
+
+void StateAccessSet::mergeWrites(StateAccessSet const& _s)
+{
+	writtenAccounts += _s.writtenAccounts;
+	for (auto const& slots : _s.writtenSlots)
+		writtenSlots[slots.first].insert(slots.second.begin(), slots.second.end());
+}
+
 std::ostream& dev::eth::operator<<(std::ostream& _out, State const& _s)
 {
 	_out << "--- " << _s.rootHash() << "\n";
@@ -23,6 +23,7 @@
 
 #include <array>
 #include <unordered_map>
+#include <unordered_set>
 #include <libdevcore/Common.h>
 #include <libdevcore/RLP.h>
 #include <libdevcore/TrieDB.h>
@@ -142,6 +143,29 @@ struct Change
 
 }
 
+/**
+ * Accounts and storage slots looked up or changed through a State while the set is attached to it
+ * (see State::setAccessSet()). "Account" access covers existence, nonce, balance and code; storage
+ * access is tracked per slot. Every State mutator looks the account up first, so writes are always
+ * also recorded as reads.
+ */
+struct StateAccessSet
+{
+	AddressHash readAccounts;
+	AddressHash writtenAccounts;
+	std::unordered_map<Address, std::unordered_set<u256>> readSlots;
+	std::unordered_map<Address, std::unordered_set<u256>> writtenSlots;
+
+	/// @returns true if an execution that recorded this set could have observed a value written in @a _prior,
+	/// or would overwrite an account whose storage @a _prior already modified.
+	bool conflictsWith(StateAccessSet const& _prior) const;
+
+	/// Accumulate the writes (only) of @a _s into this set.
+	void mergeWrites(StateAccessSet const& _s);
+
+	void clear() { readAccounts.clear(); writtenAccounts.clear(); readSlots.clear(); writtenSlots.clear(); }
+};
+
 
 /**
  * Model of an Ethereum state, essentially a facade for the trie.
@@ -300,6 +324,16 @@ public:
 
 	std::unordered_map<Address, Account> getCache();
 
+	/// Start recording every account and storage slot accessed into @a _access; pass nullptr to stop.
+	/// The set must outlive the recording.
+	void setAccessSet(StateAccessSet* _access) { m_access = _access; }
+
+	/// Apply the effects of a transaction that was executed on @a _speculative, a copy of this state,
+	/// while it recorded @a _access. Only valid if nothing written to this state since the copy was made
+	/// conflicts with @a _access (see StateAccessSet::conflictsWith()); the result is then identical to
+	/// having executed the transaction here.
+	void applySpeculative(State const& _speculative, StateAccessSet const& _access);
+
 	/// Create a savepoint in the state changelog.	///
 	/// @return The savepoint index that can be used in rollback() function.
 	size_t savepoint() const;
@@ -335,6 +369,8 @@ private:
 
 	friend std::ostream& operator<<(std::ostream& _out, State const& _s);
 	std::vector<detail::Change> m_changeLog;
+
+	StateAccessSet* m_access = nullptr;			///< Access recorder for speculative execution, if any. Not copied.
 };
 
 std::ostream& operator<<(std::ostream& _out, State const& _s);
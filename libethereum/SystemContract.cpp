@@ -52,6 +52,8 @@ void SystemContract::updateSystemContract(std::shared_ptr<Block> block)
         m_tempblock->setEvmEventLog(true);//方便看log
         LOG(TRACE) << "SystemContract::updateSystemContract blocknumber=" << m_tempblock->info().number();
     }
+    //只读调用都在这个块的状态快照上执行；filter判定缓存只在其依赖的账户变化时才重新计算
+    m_filters.update(*block, m_client->blockChain().lastHashes());
 
 
     bool configChange = false, nodeChange = false, caChange = false, routeChange = false, coChange = false;
@@ -154,15 +156,6 @@ void SystemContract::updateSystemContract(std::shared_ptr<Block> block)
 
     }//for
 
-    DEV_WRITE_GUARDED(m_lockfilter)
-    {
-
-        m_filterchecktranscache.clear();//清除缓存
-        m_transcount = 0;
-        m_transcachehit = 0;
-
-    }
-
 
 
     if ( routeChange || (m_routes.size() < 1) )
@@ -279,10 +272,6 @@ void SystemContract::updateRoute()
     {
         m_transactionfilter.filter = getRoute("TransactionFilterChain");
         m_transactionfilter.name = "TransactionFilterChain";
-
-        m_filterchecktranscache.clear();//清除缓存
-        m_transcount = 0;
-        m_transcachehit = 0;
     }
 
     DEV_READ_GUARDED(m_lockroute)
@@ -632,13 +621,6 @@ Address SystemContract::getRoute(const string & _route) const
 }
 
 
-h256 SystemContract::filterCheckTransCacheKey(const Transaction & _t) const
-{
-    RLPStream s;
-    s << _t.safeSender() << _t.from() << _t.to() << toString(_t.data()) ;//<< _t.randomid() ;
-    return dev::sha3(s.out());
-}
-
 u256 SystemContract::transactionFilterCheck(const Transaction & transaction) {
 
     LOG(TRACE) << "SystemContract::transactionFilterCheck sender:" << transaction.safeSender();
@@ -649,79 +631,23 @@ u256 SystemContract::transactionFilterCheck(const Transaction & transaction) {
         return (u256)SystemContractCode::Ok;
     }
 
-    m_transcount++;
-
-
-    u256 checkresult = -1;
-	LOG(TRACE) << "SystemContract::transactionFilterCheck filter:" << m_transactionfilter.filter;
-    if (transaction.isCreation()) {
-        Address sender = transaction.safeSender();
-        LOG(TRACE) << "SystemContract::transactionFilterCheck sender:" << sender;
-        bytes inputBytes = dev::eth::ContractABI().abiIn(
-                               "deploy(address)",
-                               transaction.safeSender());
-
-        ExecutionResult res = call(m_transactionfilter.filter, inputBytes);
+    Address filter;
+    DEV_READ_GUARDED(m_lockfilter)
+        filter = m_transactionfilter.filter;
+	LOG(TRACE) << "SystemContract::transactionFilterCheck filter:" << filter;
 
-        if (res.output.empty()) {
-            //未部署系统合约或权限合约
-            LOG(TRACE) << "SystemContract::transactionFilterCheck res.output.empty()";
-            checkresult = (u256)SystemContractCode::Ok;
-        }
-        else {
-            bool result = false;
-            dev::eth::ContractABI().abiOut(bytesConstRef(&res.output), result);
-            LOG(TRACE) << "SystemContract::transactionFilterCheck result:" << result;
-            checkresult = result ? ((u256)SystemContractCode::Ok) : (u256)SystemContractCode::Other;
-        }
+    u256 checkresult = (u256)SystemContractCode::Ok;
+    try
+    {
+        //未部署系统合约或权限合约时 也是通过
+        checkresult = m_filters.allowed(filter, transaction) ? ((u256)SystemContractCode::Ok) : (u256)SystemContractCode::Other;
     }
-    else {
-    h256 key = filterCheckTransCacheKey(transaction);
-
-    DEV_READ_GUARDED(m_lockfilter)
+    catch (...)
     {
-        std::map<h256, u256>::iterator iter = m_filterchecktranscache.find(key);
-
-        if (iter != m_filterchecktranscache.end()) {
-            checkresult = iter->second;
-        }
+        LOG(ERROR) << boost::current_exception_diagnostic_information() << "\n";
+        LOG(WARNING) << "SystemContract::transactionFilterCheck call Fail!" << toJS(transaction.sha3());
     }
 
-    if (checkresult != -1) {
-        //if ( iter != m_filterchecktranscache.end() ) //命中cache
-        //{
-        //checkresult = iter->second;
-        m_transcachehit++;
-		LOG(TRACE) << "SystemContract::transactionFilterCheck hit cache";
-    }
-    else {
-        string input = toHex(transaction.data());
-        string func = input.substr(0, 8);
-		LOG(TRACE) << "SystemContract::transactionFilterCheck input:" << input << ",func:" << func;
-        bytes inputBytes = dev::eth::ContractABI().abiIn(
-                               "process(address,address,address,string,string)",
-                               transaction.safeSender(), transaction.from(), transaction.to(), func,
-                               input);
-
-        ExecutionResult res = call(m_transactionfilter.filter, inputBytes);
-
-        if (res.output.empty()) {
-            //未部署系统合约或权限合约
-			LOG(TRACE) << "SystemContract::transactionFilterCheck res.output.empty()";
-            checkresult = (u256)SystemContractCode::Ok;
-        }
-        else {
-            bool result = false;
-            dev::eth::ContractABI().abiOut(bytesConstRef(&res.output), result);
-			LOG(TRACE) << "SystemContract::transactionFilterCheck result:" << result;
-            checkresult = result ? ((u256)SystemContractCode::Ok) : (u256)SystemContractCode::Other;
-        }
-        DEV_WRITE_GUARDED(m_lockfilter)
-        {
-            m_filterchecktranscache.insert(pair<h256, u256>(key, checkresult)); //更新cache
-        }
-    }
-	}
     if ( (u256)SystemContractCode::Ok != checkresult )
     {
         LOG(WARNING) << "SystemContract::transactionFilterCheck Fail!"  << toJS(transaction.sha3()) << ",from=" << toJS(transaction.from());
@@ -730,8 +656,8 @@ u256 SystemContract::transactionFilterCheck(const Transaction & transaction) {
         LOG(TRACE) << "SystemContract::transactionFilterCheck Suc!"  << toJS(transaction.sha3()) << ",from=" << toJS(transaction.from());
     }
 
-    if (  (0 == (rand() % 1000)  ) && (m_transcount) )
-        LOG(TRACE) << "SystemContract Cache Hint:" << ((100 * m_transcachehit) / m_transcount) << "%";
+    if (  (0 == (rand() % 1000)  ) && (m_filters.checks()) )
+        LOG(TRACE) << "SystemContract Cache Hint:" << ((100 * m_filters.hits()) / m_filters.checks()) << "%";
 
     return checkresult;
 
@@ -748,6 +674,24 @@ void SystemContract::updateCache(Address ) {
     }*/
 }
 
+bool SystemContract::isSystemContract(Address const& _address) const
+{
+    if ( dev::ZeroAddress == m_systemproxyaddress )
+        return false;
+    if ( _address == m_systemproxyaddress )
+        return true;
+
+    DEV_READ_GUARDED(m_lockroute)
+    {
+        for ( size_t i = 0; i < m_routes.size(); i++)
+        {
+            if ( m_routes[i].action == _address )
+                return true;
+        }
+    }
+    return false;
+}
+
 void SystemContract::startStatTranscation(h256 t) {
     if ( m_stattransation.end() == m_stattransation.find(t) )
     {
@@ -794,29 +738,11 @@ bool SystemContract::getValue(const string _key, string & _value)
 
 ExecutionResult SystemContract::call(Address const& _to, bytes const& _inputdata, bool )
 {
-
-
     ExecutionResult ret;
     try
     {
-        //取个随机值
-        srand((unsigned)utcTime());
-        struct timeval tv;
-        gettimeofday(&tv, NULL);
-        u256 nonce = (u256)(rand() + rand() + tv.tv_usec);
-
-        DEV_WRITE_GUARDED(m_blocklock)
-        {
-            u256 gas = m_tempblock->gasLimitRemaining() ;
-
-            u256 gasPrice = 100000000;
-            Transaction t(0, gasPrice, gas, _to, _inputdata, nonce);
-            t.forceSender(m_god);
-            LOG(TRACE) << "SystemContract::call gas=" << gas << ",gasPrice=" << gasPrice << ",nonce=" << nonce;
-            ret = m_tempblock->execute(m_client->blockChain().lastHashes(), t, Permanence::Reverted);
-        }
-
-
+        //不再锁块：每次调用都在最新块状态快照的私有副本上执行
+        ret = m_filters.call(_to, _inputdata);
     }
     catch (...)
     {
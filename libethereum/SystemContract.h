@@ -28,6 +28,7 @@
 #include <libdevcore/CommonIO.h>
 #include "Client.h"
 #include "SystemContractApi.h"
+#include "FilterEvaluator.h"
 
 using namespace std;
 using namespace dev;
@@ -69,7 +70,7 @@ class SystemContract: public SystemContractApi
 {
 public:
     /// Constructor.
-    SystemContract(const Address _address, const Address _god, Client* _client) : SystemContractApi(  _address, _god), m_client(_client), m_tempblock(0)
+    SystemContract(const Address _address, const Address _god, Client* _client) : SystemContractApi(  _address, _god), m_client(_client), m_tempblock(0), m_filters(_god)
     {
         //m_tempblock = m_client->block(m_client->blockChain().number());
        // Transactions ts;
@@ -93,6 +94,8 @@ public:
 
     virtual void updateCache(Address address) override;
 
+    virtual bool isSystemContract(Address const& _address) const override;
+
     //是否是链的管理员
     virtual bool isAdmin(const Address & _address) override;
     //获取全网配置项
@@ -125,10 +128,8 @@ private:
 
     mutable SharedMutex  m_lockfilter;//锁cache
     SystemFilter m_transactionfilter;//目前只有交易，就先只用一个变量吧
-    std::map<h256, u256> m_filterchecktranscache; //filterCheck 交易的cache
 
-    unsigned m_transcachehit;//命中次数
-    unsigned m_transcount;//总数
+    FilterEvaluator m_filters;//在最新块的状态快照上并发执行只读调用，并缓存filter的判定结果
 
     mutable SharedMutex  m_locknode;//锁节点列表更新
     std::vector< NodeConnParams> m_nodelist;//缓存当前最新块的节点列表
@@ -145,8 +146,6 @@ private:
 
     Address getRoute(const string & _route)const;
 
-    h256 filterCheckTransCacheKey(const Transaction & _t) const ;
-
     void updateRoute( );
     void updateNode( );
     void tempGetAllNode(int _blocknumber,std::vector< NodeConnParams> & _nodevector);//在指定块上面获取列表
@@ -100,6 +100,9 @@ class SystemContractApi
 
 	//更新缓存
 	virtual void updateCache(Address) {};
+
+	//是否为系统合约（SystemProxy及其路由的合约）
+	virtual bool isSystemContract(Address const&) const { return false; }
     virtual void startStatTranscation(h256){}
 	
     /*
@@ -32,15 +32,15 @@ using namespace dev::eth;
 
 
 const size_t c_maxVerificationQueueSize = 8192;
+const size_t c_maxVerificationBatchSize = 256;		///< Max transactions a verifier thread takes from the queue at once.
 
 TransactionQueue::TransactionQueue(std::shared_ptr<Interface> _interface, unsigned _limit, unsigned _futureLimit):
-	m_current(PriorityCompare { *this }),
 	m_limit(_limit),
 	m_futureLimit(_futureLimit)
 {
 	m_interface = _interface;
-	unsigned verifierThreads = std::max(thread::hardware_concurrency(), 3U) - 2U;
-	for (unsigned i = 0; i < verifierThreads; ++i)
+	m_verifierThreads = std::max(thread::hardware_concurrency(), 3U) - 2U;
+	for (unsigned i = 0; i < m_verifierThreads; ++i)
 		m_verifiers.emplace_back([ = ]() {
 		pthread_setThreadName("txcheck" + toString(i));
 		this->verifierBody();
@@ -63,88 +63,217 @@ std::pair<ImportResult, h256> TransactionQueue::import(bytesConstRef _transactio
 	// Check if we already know this transaction.
 	h256 h = sha3(_transactionRLP);
 
+	ImportResult ir = check(h, _ik);
+	if (ir != ImportResult::Success)
+		return std::make_pair(ir, h);
+
 	Transaction t;
-	ImportResult ir;
+	try
+	{
+		// Check validity of _transactionRLP as a transaction. To do this we just deserialise and attempt to determine the sender.
+		// If it doesn't work, the signature is bad.
+		// The transaction's nonce may yet be invalid (or, it could be "valid" but we may be missing a marginally older transaction).
+		// EC recovery is done here, before any lock is taken, so that concurrent imports do not queue up behind it.
+		t = Transaction(_transactionRLP, CheckTransaction::Everything);
+		if (t.bNameCall())
+		{	//这里仅仅是检查根据调用的name能否找见对应的abi信息，找不见则抛出异常
+			t.addrAnddata();
+		}
+
+		t.setImportTime(utcTime());
+	}
+	catch (...)
 	{
-		UpgradableGuard l(m_lock);
+		LOG(ERROR) << boost::current_exception_diagnostic_information() << "\n";
+		return std::make_pair(ImportResult::Malformed, h);
+	}
+
+	SenderShard& s = senderShard(t.from());
+	{
+		WriteGuard l(s.lock);
 
-		ir = check_WITH_LOCK(h, _ik);
+		// Another thread may have imported it while we were verifying.
+		ir = check(h, _ik);
 		if (ir != ImportResult::Success)
 			return std::make_pair(ir, h);
 
-		try
+		m_interface->startStatTranscation(h);
+		LOG(TRACE) << "Importing" << t;
+		ir = manageImport_WITH_LOCK(s, h, t);
+	}
+	return std::make_pair(ir, h);
+}
+
+std::vector<std::pair<ImportResult, h256>> TransactionQueue::import(std::vector<bytesConstRef> const& _txs)
+{
+	std::vector<std::pair<ImportResult, h256>> ret;
+	ret.reserve(_txs.size());
+	std::vector<Transaction> verified;
+	std::vector<size_t> positions;
+	verified.reserve(_txs.size());
+	positions.reserve(_txs.size());
+
+	for (auto const& rlp : _txs)
+	{
+		h256 h = sha3(rlp);
+		ImportResult ir = check(h, IfDropped::Ignore);
+		if (ir == ImportResult::Success)
 		{
-			// Check validity of _transactionRLP as a transaction. To do this we just deserialise and attempt to determine the sender.
-			// If it doesn't work, the signature is bad.
-			// The transaction's nonce may yet be invalid (or, it could be "valid" but we may be missing a marginally older transaction).
-			//LOG(TRACE)<<"TransactionQueue::import befor check ";
-			m_interface->startStatTranscation(h);
-
-			t = Transaction(_transactionRLP, CheckTransaction::Everything);
-			if (t.bNameCall())
-			{	//这里仅仅是检查根据调用的name能否找见对应的abi信息，找不见则抛出异常
-				t.addrAnddata();
+			try
+			{
+				Transaction t(rlp, CheckTransaction::Everything);
+				if (t.bNameCall())
+					t.addrAnddata();
+				t.setImportTime(utcTime());
+				positions.push_back(ret.size());
+				verified.push_back(move(t));
 			}
+			catch (...)
+			{
+				LOG(WARNING) << "Bad transaction in batch:" << boost::current_exception_diagnostic_information();
+				ir = ImportResult::Malformed;
+			}
+		}
+		ret.emplace_back(ir, h);
+	}
 
-			t.setImportTime(utcTime());
+	if (!verified.empty())
+	{
+		std::vector<ImportResult> ir = importVerified(verified);
+		for (size_t i = 0; i < ir.size(); ++i)
+			ret[positions[i]].first = ir[i];
+	}
+	return ret;
+}
 
-			UpgradeGuard ul(l);
-			LOG(TRACE) << "Importing" << t;
-			ir = manageImport_WITH_LOCK(h, t);
-		}
-		catch (...)
+std::vector<ImportResult> TransactionQueue::importVerified(std::vector<Transaction> const& _txs)
+{
+	std::vector<ImportResult> ret(_txs.size(), ImportResult::Success);
+
+	// Group the batch by shard so that each shard lock is taken once, keeping the batch order within a shard.
+	std::array<std::vector<size_t>, c_shards> byShard;
+	for (size_t i = 0; i < _txs.size(); ++i)
+		byShard[std::hash<Address>()(_txs[i].from()) % c_shards].push_back(i);
+
+	for (unsigned i = 0; i < c_shards; ++i)
+	{
+		if (byShard[i].empty())
+			continue;
+
+		SenderShard& s = m_senderShards[i];
+		WriteGuard l(s.lock);
+		for (size_t idx : byShard[i])
 		{
-			LOG(ERROR) << boost::current_exception_diagnostic_information() << "\n";
-			return std::make_pair(ImportResult::Malformed, h);
+			Transaction const& t = _txs[idx];
+			h256 h = t.sha3();
+			ImportResult ir = check(h, IfDropped::Ignore);
+			if (ir == ImportResult::Success)
+			{
+				m_interface->startStatTranscation(h);
+				ir = manageImport_WITH_LOCK(s, h, t);
+			}
+			ret[idx] = ir;
 		}
 	}
-	return std::make_pair(ir, h);
+	return ret;
 }
 
-ImportResult TransactionQueue::check_WITH_LOCK(h256 const& _h, IfDropped _ik)
+ImportResult TransactionQueue::check(h256 const& _h, IfDropped _ik) const
 {
-	//LOG(TRACE) << "TransactionQueue::check_WITH_LOCK " << _h;
+	//LOG(TRACE) << "TransactionQueue::check " << _h;
+	HashShard const& hs = hashShard(_h);
+	Guard l(hs.lock);
 
-	if (m_known.count(_h))
+	if (hs.known.count(_h))
 		return ImportResult::AlreadyKnown;
 
-	if (m_dropped.count(_h) && _ik == IfDropped::Ignore)
+	if (hs.dropped.count(_h) && _ik == IfDropped::Ignore)
 		return ImportResult::AlreadyInChain;
 
 	return ImportResult::Success;
 }
 
+Address TransactionQueue::knownSender(h256 const& _h) const
+{
+	HashShard const& hs = hashShard(_h);
+	Guard l(hs.lock);
+	auto it = hs.known.find(_h);
+	return it == hs.known.end() ? ZeroAddress : it->second;
+}
+
+void TransactionQueue::setKnown(h256 const& _h, Address const& _from)
+{
+	HashShard& hs = hashShard(_h);
+	Guard l(hs.lock);
+	hs.known[_h] = _from;
+}
+
+void TransactionQueue::eraseKnown(h256 const& _h)
+{
+	HashShard& hs = hashShard(_h);
+	Guard l(hs.lock);
+	hs.known.erase(_h);
+}
+
 ImportResult TransactionQueue::import(Transaction const& _transaction, IfDropped _ik)
 {
 	// Check if we already know this transaction.
 	h256 h = _transaction.sha3();
-	ImportResult ret;
+	ImportResult ir = check(h, _ik);
+	if (ir != ImportResult::Success)
+		return ir;
+
+	_transaction.safeSender(); // Perform EC recovery outside of the lock
+
+	SenderShard& s = senderShard(_transaction.from());
+	WriteGuard l(s.lock);
+	ir = check(h, _ik);
+	if (ir != ImportResult::Success)
+		return ir;
+
+	m_interface->startStatTranscation(h);
+	return manageImport_WITH_LOCK(s, h, _transaction);
+}
+
+void TransactionQueue::forEachCurrent(std::function<bool(Transaction const&)> const& _f) const
+{
+	// Shards are always locked in index order, and writers hold a single shard, so this cannot deadlock.
+	std::vector<ReadGuard> locks;
+	locks.reserve(c_shards);
+	std::array<PriorityQueue::const_iterator, c_shards> pos;
+	for (unsigned i = 0; i < c_shards; ++i)
 	{
-		UpgradableGuard l(m_lock);
-		auto ir = check_WITH_LOCK(h, _ik);
-		if (ir != ImportResult::Success)
-			return ir;
+		locks.emplace_back(m_senderShards[i].lock);
+		pos[i] = m_senderShards[i].current.begin();
+	}
 
-		{
-			_transaction.safeSender(); // Perform EC recovery outside of the write lock
-			m_interface->startStatTranscation(h);
-			UpgradeGuard ul(l);
-			ret = manageImport_WITH_LOCK(h, _transaction);
-		}
+	// Merge the per-shard queues, each already in import-time order.
+	while (true)
+	{
+		int next = -1;
+		for (unsigned i = 0; i < c_shards; ++i)
+			if (pos[i] != m_senderShards[i].current.end() && (next < 0 || pos[i]->transaction.importTime() < pos[next]->transaction.importTime()))
+				next = i;
+		if (next < 0 || !_f(pos[next]->transaction))
+			return;
+		++pos[next];
 	}
-	return ret;
 }
 
 Transactions TransactionQueue::topTransactions(unsigned _limit, h256Hash const& _avoid) const
 {
-	ReadGuard l(m_lock);
 	Transactions ret;
-	for (auto t = m_current.begin(); ret.size() < _limit && t != m_current.end(); ++t)
-		if (!_avoid.count(t->transaction.sha3()))
+	forEachCurrent([&](Transaction const& _t)
+	{
+		if (ret.size() >= _limit)
+			return false;
+		if (!_avoid.count(_t.sha3()))
 		{
-			ret.push_back(t->transaction);
-			LOG(TRACE) << "TransactionQueue::topTransactions " << t->transaction.sha3() << ",nonce=" << t->transaction.randomid();
+			ret.push_back(_t);
+			LOG(TRACE) << "TransactionQueue::topTransactions " << _t.sha3() << ",nonce=" << _t.randomid();
 		}
+		return true;
+	});
 
 	LOG(TRACE) << "TransactionQueue::topTransactions " << ret.size();
 
@@ -152,21 +281,60 @@ Transactions TransactionQueue::topTransactions(unsigned _limit, h256Hash const&
 }
 
 Transactions TransactionQueue::allTransactions() const {
-	ReadGuard l(m_lock);
 	Transactions ret;
-	for (auto t = m_current.begin(); t != m_current.end(); ++t) {
-		ret.push_back(t->transaction);
+	ret.reserve(m_currentSize);
+	forEachCurrent([&](Transaction const& _t)
+	{
+		ret.push_back(_t);
+		return true;
+	});
+	return ret;
+}
+
+Transactions TransactionQueue::transactions(h256s const& _txHashes) const
+{
+	Transactions ret;
+	for (auto const& h : _txHashes)
+	{
+		Address from = knownSender(h);
+		if (!from)
+			continue;
+		SenderShard const& s = senderShard(from);
+		ReadGuard l(s.lock);
+		auto it = s.currentByHash.find(h);
+		if (it != s.currentByHash.end())
+			ret.push_back(it->second->transaction);
 	}
 	return ret;
 }
 
 h256Hash TransactionQueue::knownTransactions() const
 {
-	ReadGuard l(m_lock);
-	return m_known;
+	h256Hash ret;
+	for (auto const& hs : m_hashShards)
+	{
+		Guard l(hs.lock);
+		for (auto const& k : hs.known)
+			ret.insert(k.first);
+	}
+	return ret;
 }
 
-ImportResult TransactionQueue::manageImport_WITH_LOCK(h256 const& _h, Transaction const& _transaction)
+TransactionQueue::Status TransactionQueue::status() const
+{
+	Status ret;
+	DEV_GUARDED(x_queue)
+		ret.unverified = m_unverified.size();
+	ret.dropped = 0;
+	for (auto const& hs : m_hashShards)
+		DEV_GUARDED(hs.lock)
+			ret.dropped += hs.dropped.size();
+	ret.current = m_currentSize;
+	ret.future = m_futureSize;
+	return ret;
+}
+
+ImportResult TransactionQueue::manageImport_WITH_LOCK(SenderShard& _s, h256 const& _h, Transaction const& _transaction)
 {
 	LOG(TRACE) << " TransactionQueue::manageImport_WITH_LOCK " << _h << _transaction.sha3();
 
@@ -211,8 +379,8 @@ ImportResult TransactionQueue::manageImport_WITH_LOCK(h256 const& _h, Transactio
 
 		// Remove any prior transaction with the same nonce but a lower gas price.
 		// Bomb out if there's a prior transaction with higher gas price.
-		auto cs = m_currentByAddressAndNonce.find(_transaction.from());
-		if (cs != m_currentByAddressAndNonce.end())
+		auto cs = _s.currentByAddressAndNonce.find(_transaction.from());
+		if (cs != _s.currentByAddressAndNonce.end())
 		{
 			auto t = cs->second.find(_transaction.randomid());
 			if (t != cs->second.end())
@@ -222,7 +390,7 @@ ImportResult TransactionQueue::manageImport_WITH_LOCK(h256 const& _h, Transactio
 				else
 				{
 					h256 dropped = (*t->second).transaction.sha3();
-					remove_WITH_LOCK(dropped);
+					remove_WITH_LOCK(_s, dropped);
 					// drop bed log
 					dev::eth::TxFlowLog(dropped, "same nonce", true);
 					LOG(WARNING) << _transaction.from() << "," << dropped << " Dropping Same Nonce" << _transaction.randomid();
@@ -230,8 +398,8 @@ ImportResult TransactionQueue::manageImport_WITH_LOCK(h256 const& _h, Transactio
 				}
 			}
 		}
-		auto fs = m_future.find(_transaction.from());
-		if (fs != m_future.end())
+		auto fs = _s.future.find(_transaction.from());
+		if (fs != _s.future.end())
 		{
 			auto t = fs->second.find(_transaction.randomid());
 			if (t != fs->second.end())
@@ -240,24 +408,26 @@ ImportResult TransactionQueue::manageImport_WITH_LOCK(h256 const& _h, Transactio
 					return ImportResult::OverbidGasPrice;
 				else
 				{
+					eraseKnown(t->second.transaction.sha3());
 					fs->second.erase(t);
 					--m_futureSize;
 					if (fs->second.empty())
-						m_future.erase(fs);
+						_s.future.erase(fs);
 				}
 			}
 		}
 		// If valid, append to transactions.
-		insertCurrent_WITH_LOCK(make_pair(_h, _transaction));
+		insertCurrent_WITH_LOCK(_s, make_pair(_h, _transaction));
 		LOG(TRACE) << "Queued vaguely legit-looking transaction" << _h;
 
-		while (m_current.size() > m_limit)
+		// The newest transaction of this shard is almost always the one just imported.
+		while (m_currentSize > m_limit && !_s.current.empty())
 		{
-			//LOG(TRACE) << "Dropping out of bounds transaction" << _h;
-			LOG(WARNING) << "Dropping out of bounds transaction" << _h;
-			remove_WITH_LOCK(m_current.rbegin()->transaction.sha3());
+			h256 dropped = _s.current.rbegin()->transaction.sha3();
+			LOG(WARNING) << "Dropping out of bounds transaction" << dropped;
+			remove_WITH_LOCK(_s, dropped);
 			// drop oversize log
-			dev::eth::TxFlowLog(m_current.rbegin()->transaction.sha3(), "oversize", true);
+			dev::eth::TxFlowLog(dropped, "oversize", true);
 		}
 
 		m_onReady();
@@ -280,27 +450,28 @@ ImportResult TransactionQueue::manageImport_WITH_LOCK(h256 const& _h, Transactio
 
 u256 TransactionQueue::maxNonce(Address const& _a) const
 {
-	ReadGuard l(m_lock);
-	return maxNonce_WITH_LOCK(_a);
+	SenderShard const& s = senderShard(_a);
+	ReadGuard l(s.lock);
+	return maxNonce_WITH_LOCK(s, _a);
 }
 
-u256 TransactionQueue::maxNonce_WITH_LOCK(Address const& _a) const
+u256 TransactionQueue::maxNonce_WITH_LOCK(SenderShard const& _s, Address const& _a) const
 {
 	u256 ret = 0;
-	auto cs = m_currentByAddressAndNonce.find(_a);
-	if (cs != m_currentByAddressAndNonce.end() && !cs->second.empty())
+	auto cs = _s.currentByAddressAndNonce.find(_a);
+	if (cs != _s.currentByAddressAndNonce.end() && !cs->second.empty())
 		ret = cs->second.rbegin()->first + 1;
-	auto fs = m_future.find(_a);
-	if (fs != m_future.end() && !fs->second.empty())
+	auto fs = _s.future.find(_a);
+	if (fs != _s.future.end() && !fs->second.empty())
 		ret = std::max(ret, fs->second.rbegin()->first + 1);
 	return ret;
 }
 
-void TransactionQueue::insertCurrent_WITH_LOCK(std::pair<h256, Transaction> const& _p)
+void TransactionQueue::insertCurrent_WITH_LOCK(SenderShard& _s, std::pair<h256, Transaction> const& _p)
 {
 	LOG(TRACE) << " TransactionQueue::insertCurrent_WITH_LOCK " << _p.first;
 
-	if (m_currentByHash.count(_p.first))
+	if (_s.currentByHash.count(_p.first))
 	{
 		LOG(WARNING) << "Transaction hash" << _p.first << "already in current?!";
 		return;
@@ -308,34 +479,36 @@ void TransactionQueue::insertCurrent_WITH_LOCK(std::pair<h256, Transaction> cons
 
 	Transaction const& t = _p.second;
 	// Insert into current
-	auto inserted = m_currentByAddressAndNonce[t.from()].insert(std::make_pair(t.randomid(), PriorityQueue::iterator()));
-	PriorityQueue::iterator handle = m_current.emplace(VerifiedTransaction(t));
+	auto inserted = _s.currentByAddressAndNonce[t.from()].insert(std::make_pair(t.randomid(), PriorityQueue::iterator()));
+	PriorityQueue::iterator handle = _s.current.emplace(VerifiedTransaction(t));
 	inserted.first->second = handle;
-	m_currentByHash[_p.first] = handle;
+	_s.currentByHash[_p.first] = handle;
+	++m_currentSize;
 
 	// Move following transactions from future to current
-	makeCurrent_WITH_LOCK(t);
-	m_known.insert(_p.first);
+	makeCurrent_WITH_LOCK(_s, t);
+	setKnown(_p.first, t.from());
 	// start tx trace log
 	dev::eth::TxFlowLog(_p.first, "0x" + _p.first.hex().substr(0, 5), false, true);	
 	LOG(INFO) << " Hash=" << (t.sha3()) << ",Randid=" << t.randomid() << ",入队=" << utcTime();
 }
 
-bool TransactionQueue::remove_WITH_LOCK(h256 const& _txHash)
+bool TransactionQueue::remove_WITH_LOCK(SenderShard& _s, h256 const& _txHash)
 {
-	auto t = m_currentByHash.find(_txHash);
-	if (t == m_currentByHash.end())
+	auto t = _s.currentByHash.find(_txHash);
+	if (t == _s.currentByHash.end())
 		return false;
 
 	Address from = (*t->second).transaction.from();
-	auto it = m_currentByAddressAndNonce.find(from);
-	assert (it != m_currentByAddressAndNonce.end());
+	auto it = _s.currentByAddressAndNonce.find(from);
+	assert (it != _s.currentByAddressAndNonce.end());
 	it->second.erase((*t->second).transaction.randomid());
-	m_current.erase(t->second);
-	m_currentByHash.erase(t);
+	_s.current.erase(t->second);
+	_s.currentByHash.erase(t);
+	--m_currentSize;
 	if (it->second.empty())
-		m_currentByAddressAndNonce.erase(it);
-	m_known.erase(_txHash);
+		_s.currentByAddressAndNonce.erase(it);
+	eraseKnown(_txHash);
 
 	LOG(TRACE) << "TransactionQueue::remove_WITH_LOCK " << toString(_txHash);
 	return true;
@@ -343,49 +516,55 @@ bool TransactionQueue::remove_WITH_LOCK(h256 const& _txHash)
 
 unsigned TransactionQueue::waiting(Address const& _a) const
 {
-	ReadGuard l(m_lock);
+	SenderShard const& s = senderShard(_a);
+	ReadGuard l(s.lock);
 	unsigned ret = 0;
-	auto cs = m_currentByAddressAndNonce.find(_a);
-	if (cs != m_currentByAddressAndNonce.end())
+	auto cs = s.currentByAddressAndNonce.find(_a);
+	if (cs != s.currentByAddressAndNonce.end())
 		ret = cs->second.size();
-	auto fs = m_future.find(_a);
-	if (fs != m_future.end())
+	auto fs = s.future.find(_a);
+	if (fs != s.future.end())
 		ret += fs->second.size();
 	return ret;
 }
 
 void TransactionQueue::setFuture(h256 const& _txHash)
 {
-	WriteGuard l(m_lock);
-	auto it = m_currentByHash.find(_txHash);
-	if (it == m_currentByHash.end())
+	Address from = knownSender(_txHash);
+	if (!from)
+		return;
+
+	SenderShard& s = senderShard(from);
+	WriteGuard l(s.lock);
+	auto it = s.currentByHash.find(_txHash);
+	if (it == s.currentByHash.end())
 		return;
 
 	VerifiedTransaction const& st = *(it->second);
 
-	Address from = st.transaction.from();
-	auto& queue = m_currentByAddressAndNonce[from];
-	auto& target = m_future[from];
+	auto& queue = s.currentByAddressAndNonce[from];
+	auto& target = s.future[from];
 	auto cutoff = queue.lower_bound(st.transaction.randomid());
 	for (auto m = cutoff; m != queue.end(); ++m)
 	{
 		VerifiedTransaction& t = const_cast<VerifiedTransaction&>(*(m->second)); // set has only const iterators. Since we are moving out of container that's fine
-		m_currentByHash.erase(t.transaction.sha3());
+		s.currentByHash.erase(t.transaction.sha3());
 		target.emplace(t.transaction.randomid(), move(t));
-		m_current.erase(m->second);
+		s.current.erase(m->second);
+		--m_currentSize;
 		++m_futureSize;
 	}
 	queue.erase(cutoff, queue.end());
 	if (queue.empty())
-		m_currentByAddressAndNonce.erase(from);
+		s.currentByAddressAndNonce.erase(from);
 }
 
-void TransactionQueue::makeCurrent_WITH_LOCK(Transaction const& _t)
+void TransactionQueue::makeCurrent_WITH_LOCK(SenderShard& _s, Transaction const& _t)
 {
 
 	bool newCurrent = false;
-	auto fs = m_future.find(_t.from());
-	if (fs != m_future.end())
+	auto fs = _s.future.find(_t.from());
+	if (fs != _s.future.end())
 	{
 		u256 nonce = _t.randomid() + 1;
 		auto fb = fs->second.find(nonce);
@@ -394,10 +573,11 @@ void TransactionQueue::makeCurrent_WITH_LOCK(Transaction const& _t)
 			auto ft = fb;
 			while (ft != fs->second.end() && ft->second.transaction.randomid() == nonce)
 			{
-				auto inserted = m_currentByAddressAndNonce[_t.from()].insert(std::make_pair(ft->second.transaction.randomid(), PriorityQueue::iterator()));
-				PriorityQueue::iterator handle = m_current.emplace(move(ft->second));
+				auto inserted = _s.currentByAddressAndNonce[_t.from()].insert(std::make_pair(ft->second.transaction.randomid(), PriorityQueue::iterator()));
+				PriorityQueue::iterator handle = _s.current.emplace(move(ft->second));
 				inserted.first->second = handle;
-				m_currentByHash[(*handle).transaction.sha3()] = handle;
+				_s.currentByHash[(*handle).transaction.sha3()] = handle;
+				++m_currentSize;
 				--m_futureSize;
 				++ft;
 				++nonce;
@@ -405,19 +585,21 @@ void TransactionQueue::makeCurrent_WITH_LOCK(Transaction const& _t)
 			}
 			fs->second.erase(fb, ft);
 			if (fs->second.empty())
-				m_future.erase(_t.from());
+				_s.future.erase(_t.from());
 		}
 	}
 
-	while (m_futureSize > m_futureLimit)
+	while (m_futureSize > m_futureLimit && !_s.future.empty())
 	{
 		// TODO: priority queue for future transactions
-		// For now just drop random chain end
+		// For now just drop random chain end of this shard
 		--m_futureSize;
-		LOG(WARNING) << "Dropping out of bounds future transaction" << m_future.begin()->second.rbegin()->second.transaction.sha3();
-		m_future.begin()->second.erase(--m_future.begin()->second.end());
-		if (m_future.begin()->second.empty())
-			m_future.erase(m_future.begin());
+		h256 dropped = _s.future.begin()->second.rbegin()->second.transaction.sha3();
+		LOG(WARNING) << "Dropping out of bounds future transaction" << dropped;
+		eraseKnown(dropped);
+		_s.future.begin()->second.erase(--_s.future.begin()->second.end());
+		if (_s.future.begin()->second.empty())
+			_s.future.erase(_s.future.begin());
 	}
 
 	if (newCurrent)
@@ -426,25 +608,27 @@ void TransactionQueue::makeCurrent_WITH_LOCK(Transaction const& _t)
 
 void TransactionQueue::drop(h256 const& _txHash)
 {
-	UpgradableGuard l(m_lock);
-
-	if (!m_known.count(_txHash))
+	Address from = knownSender(_txHash);
+	if (!from)
 		return;
 
-	UpgradeGuard ul(l);
-	m_dropped.insert(_txHash);
-	remove_WITH_LOCK(_txHash);
+	SenderShard& s = senderShard(from);
+	WriteGuard l(s.lock);
+	DEV_GUARDED(hashShard(_txHash).lock)
+		hashShard(_txHash).dropped.insert(_txHash);
+	remove_WITH_LOCK(s, _txHash);
 	// bed drop log
 	dev::eth::TxFlowLog(_txHash, "drop", true);
 }
 
 void TransactionQueue::dropGood(Transaction const& _t)
 {
-	WriteGuard l(m_lock);
-	makeCurrent_WITH_LOCK(_t);
-	if (!m_known.count(_t.sha3()))
+	SenderShard& s = senderShard(_t.from());
+	WriteGuard l(s.lock);
+	makeCurrent_WITH_LOCK(s, _t);
+	if (!knownSender(_t.sha3()))
 		return;
-	remove_WITH_LOCK(_t.sha3());
+	remove_WITH_LOCK(s, _t.sha3());
 
 	// good drop log
 	dev::eth::TxFlowLog(_t.sha3(), "onChain");
@@ -453,12 +637,22 @@ void TransactionQueue::dropGood(Transaction const& _t)
 
 void TransactionQueue::clear()
 {
-	WriteGuard l(m_lock);
-	m_known.clear();
-	m_current.clear();
-	m_currentByAddressAndNonce.clear();
-	m_currentByHash.clear();
-	m_future.clear();
+	std::vector<WriteGuard> locks;
+	locks.reserve(c_shards);
+	for (auto& s : m_senderShards)
+		locks.emplace_back(s.lock);
+
+	for (auto& hs : m_hashShards)
+		DEV_GUARDED(hs.lock)
+			hs.known.clear();
+	for (auto& s : m_senderShards)
+	{
+		s.current.clear();
+		s.currentByAddressAndNonce.clear();
+		s.currentByHash.clear();
+		s.future.clear();
+	}
+	m_currentSize = 0;
 	m_futureSize = 0;
 }
 
@@ -487,30 +681,58 @@ void TransactionQueue::verifierBody()
 {
 	while (!m_aborting)
 	{
-		UnverifiedTransaction work;
+		std::vector<UnverifiedTransaction> work;
 
 		{
 			unique_lock<Mutex> l(x_queue);
 			m_queueReady.wait(l, [&]() { return !m_unverified.empty() || m_aborting; });
 			if (m_aborting)
 				return;
-			work = move(m_unverified.front());
-			m_unverified.pop_front();
+			// Take an even share of the backlog so that all verifiers stay busy.
+			size_t batch = std::min(c_maxVerificationBatchSize, std::max<size_t>(1, m_unverified.size() / m_verifierThreads));
+			work.reserve(batch);
+			for (size_t i = 0; i < batch; ++i)
+			{
+				work.push_back(move(m_unverified.front()));
+				m_unverified.pop_front();
+			}
 		}
 
+		// Recover all senders of the batch without holding m_lock.
+		std::vector<Transaction> verified;
+		std::vector<h512> nodeIds;
+		verified.reserve(work.size());
+		nodeIds.reserve(work.size());
+		for (auto const& w : work)
+		{
+			try
+			{
+				Transaction t(w.transaction, CheckTransaction::Everything);
+				//这里改为这里验证 后面Executive::initialize里面不验证了
+				t.setImportTime(utcTime());
+				t.setImportType(1); // 1 for p2p
+				verified.push_back(move(t));
+				nodeIds.push_back(w.nodeId);
+			}
+			catch (...)
+			{
+				LOG(WARNING) << "Bad transaction:" << boost::current_exception_diagnostic_information();
+			}
+		}
+
+		if (verified.empty())
+			continue;
+
 		try
 		{
-			Transaction t(work.transaction, CheckTransaction::Everything); //Signature will be checked later
-			//这里改为这里验证 后面Executive::initialize里面不验证了
-			t.setImportTime(utcTime());
-			t.setImportType(1); // 1 for p2p
-			ImportResult ir = import(t);
-			m_onImport(ir, t.sha3(), work.nodeId);
+			std::vector<ImportResult> ir = importVerified(verified);
+			for (size_t i = 0; i < ir.size(); ++i)
+				m_onImport(ir[i], verified[i].sha3(), nodeIds[i]);
 		}
 		catch (...)
 		{
-			// should not happen as exceptions are handled in import.
-			LOG(WARNING) << "Bad transaction:" << boost::current_exception_diagnostic_information();
+			// should not happen as exceptions are handled in manageImport_WITH_LOCK.
+			LOG(WARNING) << "Bad transaction batch:" << boost::current_exception_diagnostic_information();
 		}
 	}
 }
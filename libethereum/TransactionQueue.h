@@ -21,6 +21,8 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <functional>
 #include <condition_variable>
 #include <thread>
@@ -42,7 +44,8 @@ namespace eth
 
 /**
  * @brief A queue of Transactions, each stored as RLP.
- * Maintains a transaction queue sorted by nonce diff and gas price.
+ * Maintains a transaction queue sorted by import time. The queue is sharded by sender and the
+ * known-hash index by transaction hash, each shard with its own lock.
  * @threadsafe
  */
 class TransactionQueue
@@ -73,6 +76,12 @@ public:
 	/// @returns Import result code.
 	ImportResult import(Transaction const& _tx, IfDropped _ik = IfDropped::Ignore);
 
+	/// Verify and add a batch of transactions synchronously. All senders are recovered before
+	/// any shard is locked, and each shard lock is then taken once for the whole batch.
+	/// @param _txs RLP encoded transactions.
+	/// @returns Import result code and hash of each transaction, in input order.
+	std::vector<std::pair<ImportResult, h256>> import(std::vector<bytesConstRef> const& _txs);
+
 	/// Remove transaction from the queue
 	/// @param _txHash Trasnaction hash
 	void drop(h256 const& _txHash);
@@ -88,15 +97,21 @@ public:
 	Transactions topTransactions(unsigned _limit, h256Hash const& _avoid = h256Hash()) const;
 
 	Transactions allTransactions() const;
-	size_t currentTxNum() const {ReadGuard l(m_lock); return m_current.size();}
+	size_t currentTxNum() const { return m_currentSize; }
 
 	std::size_t unverifiedSize(){return m_unverified.size();}
-	std::size_t verifiedSize(){return m_current.size();}
+	std::size_t verifiedSize(){return m_currentSize;}
 
 	/// Get a hash set of transactions in the queue
 	/// @returns A hash set of all transactions in the queue
 	h256Hash knownTransactions() const;
 
+	/// @returns true if the transaction is in the queue or was dropped from it, so need not be fetched.
+	bool isKnown(h256 const& _txHash) const { return check(_txHash, IfDropped::Ignore) != ImportResult::Success; }
+
+	/// @returns those of @a _txHashes that are current transactions in the queue.
+	Transactions transactions(h256s const& _txHashes) const;
+
 	/// Get max nonce for an account
 	/// @returns Max transaction nonce for account in the queue
 	u256 maxNonce(Address const& _a) const;
@@ -117,7 +132,7 @@ public:
 		size_t dropped;
 	};
 	/// @returns the status of the transaction queue.
-	Status status() const { Status ret; DEV_GUARDED(x_queue) { ret.unverified = m_unverified.size(); } ReadGuard l(m_lock); ret.dropped = m_dropped.size(); ret.current = m_currentByHash.size(); ret.future = m_future.size(); return ret; }
+	Status status() const;
 
 	/// @returns the transacrtion limits on current/future.
 	Limits limits() const { return Limits{m_limit, m_futureLimit}; }
@@ -172,52 +187,79 @@ private:
 
 	struct PriorityCompare
 	{
-		TransactionQueue& queue;
-		/// Compare transaction by nonce height and gas price.
+		/// Compare transaction by import time.
 		bool operator()(VerifiedTransaction const& _first, VerifiedTransaction const& _second) const
 		{	//这个地方要改下 超载情况下不能用randomid来排序 ，poc没问题
 			return _first.transaction.importTime() <= _second.transaction.importTime();
-			/*
-			u256 const& height1 = _first.transaction.randomid() - queue.m_currentByAddressAndNonce[_first.transaction.sender()].begin()->first;
-			u256 const& height2 = _second.transaction.randomid() - queue.m_currentByAddressAndNonce[_second.transaction.sender()].begin()->first;
-			return height1 < height2 || (height1 == height2 && _first.transaction.gasPrice() > _second.transaction.gasPrice());
-			*/
 		}
 	};
 
-	// Use a set with dynamic comparator for minmax priority queue. The comparator takes into account min account nonce. Updating it does not affect the order.
+	// Use a set with dynamic comparator for minmax priority queue.
 	using PriorityQueue = std::multiset<VerifiedTransaction, PriorityCompare>;
 
-	std::pair<ImportResult, h256> import(bytesConstRef _tx, IfDropped _ik = IfDropped::Ignore);
-	ImportResult check_WITH_LOCK(h256 const& _h, IfDropped _ik);
-	ImportResult manageImport_WITH_LOCK(h256 const& _h, Transaction const& _transaction);
+	/// Pending transactions of the senders that map to one shard. Everything about one sender
+	/// (nonce replacement, future promotion) stays inside its shard, so imports from different
+	/// senders do not contend.
+	struct SenderShard
+	{
+		mutable SharedMutex lock;
+		PriorityQueue current;
+		std::unordered_map<h256, PriorityQueue::iterator> currentByHash;			///< Transaction hash to set ref
+		std::unordered_map<Address, std::map<u256, PriorityQueue::iterator>> currentByAddressAndNonce; ///< Transactions grouped by account and nonce
+		std::unordered_map<Address, std::map<u256, VerifiedTransaction>> future;	///< Future transactions
+	};
 
-	void insertCurrent_WITH_LOCK(std::pair<h256, Transaction> const& _p);
-	void makeCurrent_WITH_LOCK(Transaction const& _t);
-	bool remove_WITH_LOCK(h256 const& _txHash);
-	u256 maxNonce_WITH_LOCK(Address const& _a) const;
-	void verifierBody();
+	/// Known and dropped transaction hashes of one shard, keyed by hash.
+	/// The lock is a leaf: nothing else is locked while it is held.
+	struct HashShard
+	{
+		mutable Mutex lock;
+		std::unordered_map<h256, Address> known;		///< Hash to sender of transactions in the current and future sets.
+		h256Hash dropped;								///< Transactions that have previously been dropped
+	};
+
+	static const unsigned c_shards = 16;
+
+	SenderShard& senderShard(Address const& _a) { return m_senderShards[std::hash<Address>()(_a) % c_shards]; }
+	SenderShard const& senderShard(Address const& _a) const { return m_senderShards[std::hash<Address>()(_a) % c_shards]; }
+	HashShard& hashShard(h256 const& _h) { return m_hashShards[std::hash<h256>()(_h) % c_shards]; }
+	HashShard const& hashShard(h256 const& _h) const { return m_hashShards[std::hash<h256>()(_h) % c_shards]; }
 
-	mutable SharedMutex m_lock;													///< General lock.
-	h256Hash m_known;															///< Headers of transactions in both sets.
+	/// @returns the sender of a known transaction, or ZeroAddress.
+	Address knownSender(h256 const& _h) const;
+	void setKnown(h256 const& _h, Address const& _from);
+	void eraseKnown(h256 const& _h);
 
-	std::unordered_map<h256, std::function<void(ImportResult)>> m_callbacks;	///< Called once.
-	h256Hash m_dropped;															///< Transactions that have previously been dropped
+	/// Walk the current transactions of all shards in import-time order, with every shard read-locked.
+	/// Stops when @a _f returns false.
+	void forEachCurrent(std::function<bool(Transaction const&)> const& _f) const;
+
+	std::pair<ImportResult, h256> import(bytesConstRef _tx, IfDropped _ik = IfDropped::Ignore);
+	/// Import a batch of transactions whose senders are already recovered, taking each shard lock once.
+	std::vector<ImportResult> importVerified(std::vector<Transaction> const& _txs);
+	ImportResult check(h256 const& _h, IfDropped _ik) const;
+	ImportResult manageImport_WITH_LOCK(SenderShard& _s, h256 const& _h, Transaction const& _transaction);
+
+	void insertCurrent_WITH_LOCK(SenderShard& _s, std::pair<h256, Transaction> const& _p);
+	void makeCurrent_WITH_LOCK(SenderShard& _s, Transaction const& _t);
+	bool remove_WITH_LOCK(SenderShard& _s, h256 const& _txHash);
+	u256 maxNonce_WITH_LOCK(SenderShard const& _s, Address const& _a) const;
+	void verifierBody();
 
-	PriorityQueue m_current;
-	std::unordered_map<h256, PriorityQueue::iterator> m_currentByHash;			///< Transaction hash to set ref
-	std::unordered_map<Address, std::map<u256, PriorityQueue::iterator>> m_currentByAddressAndNonce; ///< Transactions grouped by account and nonce
-	std::unordered_map<Address, std::map<u256, VerifiedTransaction>> m_future;	/// Future transactions
+	std::array<SenderShard, c_shards> m_senderShards;
+	std::array<HashShard, c_shards> m_hashShards;
+	std::atomic<size_t> m_currentSize = {0};									///< Current transactions over all shards.
+	std::atomic<size_t> m_futureSize = {0};										///< Current number of future transactions
 
 	Signal<> m_onReady;															///< Called when a subsequent call to import transactions will return a non-empty container. Be nice and exit fast.
 	Signal<ImportResult, h256 const&, h512 const&> m_onImport;					///< Called for each import attempt. Arguments are result, transaction id an node id. Be nice and exit fast.
 	Signal<h256 const&> m_onReplaced;											///< Called whan transction is dropped during a call to import() to make room for another transaction.
 	unsigned m_limit;															///< Max number of pending transactions
 	unsigned m_futureLimit;														///< Max number of future transactions
-	unsigned m_futureSize = 0;													///< Current number of future transactions
 
 	std::condition_variable m_queueReady;										///< Signaled when m_unverified has a new entry.
 	std::vector<std::thread> m_verifiers;
+	unsigned m_verifierThreads = 1;												///< Number of verifier threads sharing m_unverified.
 	std::deque<UnverifiedTransaction> m_unverified;								///< Pending verification queue
 	mutable Mutex x_queue;														///< Verification queue mutex
 	std::atomic<bool> m_aborting = {false};										///< Exit condition for verifier.
@@ -0,0 +1,247 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "JitScheduler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <libdevcore/CommonIO.h>
+#include <libdevcore/RLP.h>
+#include <libdevcore/SHA3.h>
+#include <libdevcore/easylog.h>
+#include "JitVM.h"
+
+namespace dev
+{
+namespace eth
+{
+
+JitScheduler& JitScheduler::instance()
+{
+	static JitScheduler s_scheduler;
+	return s_scheduler;
+}
+
+JitScheduler::JitScheduler(): m_worker([this]{ work(); })
+{}
+
+JitScheduler::~JitScheduler()
+{
+	DEV_GUARDED(x_queue)
+		m_stop = true;
+	m_queueChanged.notify_all();
+	m_worker.join();
+	saveHotList();
+}
+
+void JitScheduler::configure(unsigned _threshold, std::string const& _hotListPath)
+{
+	m_threshold = std::max(1u, _threshold);
+	DEV_GUARDED(x_queue)
+		m_hotListPath = _hotListPath;
+
+	// Keep compiled objects on disk across restarts, unless evmjit options were given explicitly.
+	// Must happen before the first JIT use, which reads the options.
+	setenv("EVMJIT", "-cache=1", 0);
+
+	loadHotList();
+	LOG(INFO) << "JitScheduler threshold=" << m_threshold << ",hotList=" << _hotListPath;
+}
+
+void JitScheduler::noteExecution(h256 const& _codeHash, bytesConstRef _code, evm_mode _mode, u256 const& _gas, bool _interpreted)
+{
+	uint64_t gas = _gas > u256(std::numeric_limits<uint64_t>::max() >> 1) ? std::numeric_limits<uint64_t>::max() >> 1 : _gas.convert_to<uint64_t>();
+	bool schedule = false;
+	bool queued = false;
+	Stripe& s = stripeOf(_codeHash);
+	DEV_GUARDED(s.lock)
+	{
+		CodeStats& c = s.codes[_codeHash];
+		c.gas += gas;
+		gas = c.gas;
+		if (_interpreted)
+		{
+			++c.hits;
+			queued = c.scheduled;
+			if (!c.scheduled && c.hits >= m_threshold)
+				schedule = c.scheduled = true;
+		}
+	}
+
+	if (schedule)
+	{
+		LOG(INFO) << "Schedule:      " << _codeHash;
+		enqueue(_codeHash, Task{_code.toBytes(), _mode, gas});
+	}
+	else if (queued)
+	{
+		// Still waiting: move it up the queue.
+		DEV_GUARDED(x_queue)
+		{
+			auto it = m_queue.find(_codeHash);
+			if (it != m_queue.end())
+				it->second.gas = gas;
+		}
+	}
+}
+
+uint64_t JitScheduler::gasOf(h256 const& _codeHash)
+{
+	Stripe& s = stripeOf(_codeHash);
+	Guard l(s.lock);
+	auto it = s.codes.find(_codeHash);
+	return it == s.codes.end() ? 0 : it->second.gas;
+}
+
+void JitScheduler::enqueue(h256 const& _codeHash, Task&& _task)
+{
+	DEV_GUARDED(x_queue)
+		m_queue.emplace(_codeHash, std::move(_task));
+	m_queueChanged.notify_one();
+}
+
+void JitScheduler::work()
+{
+	LOG(INFO) << "JIT worker started.";
+	while (true)
+	{
+		h256 codeHash;
+		Task task;
+		{
+			std::unique_lock<Mutex> l(x_queue);
+			m_queueChanged.wait(l, [&]{ return m_stop || !m_queue.empty(); });
+			if (m_stop)
+				break;
+			auto best = std::max_element(m_queue.begin(), m_queue.end(), [](std::pair<h256 const, Task> const& _a, std::pair<h256 const, Task> const& _b) { return _a.second.gas < _b.second.gas; });
+			codeHash = best->first;
+			task = std::move(best->second);
+			m_queue.erase(best);
+		}
+
+		if (!JitVM::isCodeReady(task.mode, codeHash))
+		{
+			LOG(INFO) << "Compilation... " << codeHash;
+			JitVM::compile(task.mode, &task.code, codeHash);
+			LOG(INFO) << "   ...finished " << codeHash;
+		}
+
+		bool idle = false;
+		DEV_GUARDED(x_queue)
+		{
+			m_compiled[codeHash] = std::move(task);
+			idle = m_queue.empty();
+		}
+		if (idle)
+			saveHotList();
+	}
+	LOG(INFO) << "JIT worker finished.";
+}
+
+void JitScheduler::loadHotList()
+{
+	std::string path;
+	DEV_GUARDED(x_queue)
+		path = m_hotListPath;
+	if (path.empty())
+		return;
+
+	bytes data = contents(path);
+	if (data.empty())
+		return;
+
+	unsigned loaded = 0;
+	try
+	{
+		for (auto const& item : RLP(data))
+		{
+			if (!item.isList() || item.itemCount() < 4)
+			{
+				LOG(WARNING) << "JitScheduler: skipping malformed hot list entry";
+				continue;
+			}
+			// Compiled code is looked up by code hash, so an entry whose code does not hash to its key
+			// would make this node run other bytecode for that contract.
+			h256 codeHash = item[0].toHash<h256>();
+			bytes code = item[3].toBytes();
+			if (sha3(code) != codeHash)
+			{
+				LOG(WARNING) << "JitScheduler: skipping hot list entry with mismatching code: " << codeHash;
+				continue;
+			}
+			unsigned mode = item[1].toInt<unsigned>();
+			if (mode > EVM_CLEARING)
+			{
+				LOG(WARNING) << "JitScheduler: skipping hot list entry with unknown mode " << mode << ": " << codeHash;
+				continue;
+			}
+			Task task{std::move(code), static_cast<evm_mode>(mode), item[2].toInt<uint64_t>()};
+			bool fresh = false;
+			Stripe& s = stripeOf(codeHash);
+			DEV_GUARDED(s.lock)
+			{
+				CodeStats& c = s.codes[codeHash];
+				fresh = !c.scheduled;
+				c.scheduled = true;
+				c.gas = std::max(c.gas, task.gas);
+			}
+			if (fresh)
+			{
+				enqueue(codeHash, std::move(task));
+				++loaded;
+			}
+		}
+	}
+	catch (std::exception const& _e)
+	{
+		LOG(WARNING) << "JitScheduler: ignoring broken hot list " << path << ": " << _e.what();
+	}
+	LOG(INFO) << "JitScheduler: preloading " << loaded << " hot contracts";
+}
+
+void JitScheduler::saveHotList()
+{
+	std::string path;
+	std::vector<std::pair<h256, Task>> hot;
+	DEV_GUARDED(x_queue)
+	{
+		path = m_hotListPath;
+		if (path.empty())
+			return;
+		hot.assign(m_compiled.begin(), m_compiled.end());
+	}
+
+	for (auto& h : hot)
+		h.second.gas = gasOf(h.first);
+	std::sort(hot.begin(), hot.end(), [](std::pair<h256, Task> const& _a, std::pair<h256, Task> const& _b) { return _a.second.gas > _b.second.gas; });
+	if (hot.size() > c_hotListSize)
+		hot.resize(c_hotListSize);
+
+	RLPStream s(hot.size());
+	for (auto const& h : hot)
+		s.appendList(4) << h.first << unsigned(h.second.mode) << h.second.gas << h.second.code;
+	try
+	{
+		writeFile(path, s.out(), true);
+	}
+	catch (...)
+	{
+		LOG(WARNING) << "JitScheduler: could not write hot list " << path;
+	}
+}
+
+}
+}
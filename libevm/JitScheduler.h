@@ -0,0 +1,107 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <evmjit.h>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/// Decides which EVM code SmartVM gets compiled by the JIT, and when.
+///
+/// Executions are counted per code hash in lock-striped tables, so concurrent executions of
+/// different contracts do not contend. Code that has run in the interpreter the configured
+/// number of times is queued for compilation; the queue is served by gas consumed, so the
+/// contracts costing the most interpreter time are compiled first. The compiling codes that
+/// consumed the most gas are remembered in a hot list file and compiled again right at startup,
+/// which with the evmjit object cache enabled only loads the objects from disk.
+///
+/// Compilation runs on a single thread: evmjit shares one LLVM context and execution engine.
+class JitScheduler
+{
+public:
+	static JitScheduler& instance();
+
+	/// @param _threshold number of interpreter executions after which code is compiled.
+	/// @param _hotListPath where the hot list is kept; its codes are queued right away.
+	void configure(unsigned _threshold, std::string const& _hotListPath);
+
+	/// Note that code @a _codeHash used @a _gas; @a _interpreted if it ran in the interpreter.
+	void noteExecution(h256 const& _codeHash, bytesConstRef _code, evm_mode _mode, u256 const& _gas, bool _interpreted);
+
+private:
+	JitScheduler();
+	~JitScheduler();
+
+	struct CodeStats
+	{
+		uint64_t hits = 0;
+		uint64_t gas = 0;
+		bool scheduled = false;
+	};
+
+	struct Task
+	{
+		bytes code;
+		evm_mode mode;
+		uint64_t gas;
+	};
+
+	static const unsigned c_stripes = 16;
+	static const unsigned c_hotListSize = 64;
+
+	struct Stripe
+	{
+		Mutex lock;
+		std::unordered_map<h256, CodeStats> codes;
+	};
+
+	Stripe& stripeOf(h256 const& _codeHash) { return m_stripes[_codeHash[0] % c_stripes]; }
+	uint64_t gasOf(h256 const& _codeHash);
+
+	void enqueue(h256 const& _codeHash, Task&& _task);
+	void work();
+
+	void loadHotList();
+	void saveHotList();
+
+	std::atomic<unsigned> m_threshold{2};
+	std::array<Stripe, c_stripes> m_stripes;
+
+	Mutex x_queue;
+	std::condition_variable m_queueChanged;
+	std::unordered_map<h256, Task> m_queue;		///< Waiting for compilation.
+	std::unordered_map<h256, Task> m_compiled;	///< Candidates for the hot list.
+	std::string m_hotListPath;
+	bool m_stop = false;
+
+	std::thread m_worker; // Worker must be last to initialize
+};
+
+}
+}
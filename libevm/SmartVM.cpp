@@ -16,75 +16,15 @@
 */
 
 #include "SmartVM.h"
-#include <unordered_map>
-#include <thread>
-#include <libdevcore/concurrent_queue.h>
 #include <libdevcore/easylog.h>
-#include <libdevcore/Guards.h>
 #include "VMFactory.h"
 #include "JitVM.h"
+#include "JitScheduler.h"
 
 namespace dev
 {
 namespace eth
 {
-namespace
-{
-
-	using HitMap = std::unordered_map<h256, uint64_t>;
-
-	HitMap& getHitMap()
-	{
-		static HitMap s_hitMap;
-		return s_hitMap;
-	}
-
-	struct JitTask
-	{
-		bytes code;
-		h256 codeHash;
-		evm_mode mode;
-
-		static JitTask createStopSentinel() { return JitTask(); }
-
-		bool isStopSentinel()
-		{
-			assert((!code.empty() || !codeHash) && "'empty code => empty hash' invariant failed");
-			return code.empty();
-		}
-	};
-
-	class JitWorker
-	{
-		concurrent_queue<JitTask> m_queue;
-		std::thread m_worker; // Worker must be last to initialize
-
-		void work()
-		{
-			LOG(INFO) << "JIT worker started.";
-			JitTask task;
-			while (!(task = m_queue.pop()).isStopSentinel())
-			{
-				LOG(INFO) << "Compilation... " << task.codeHash;
-				JitVM::compile(task.mode, {task.code.data(), task.code.size()}, task.codeHash);
-				LOG(INFO) << "   ...finished " << task.codeHash;
-			}
-			LOG(INFO) << "JIT worker finished.";
-		}
-
-	public:
-		JitWorker() noexcept: m_worker([this]{ work(); })
-		{}
-
-		~JitWorker()
-		{
-			push(JitTask::createStopSentinel());
-			m_worker.join();
-		}
-
-		void push(JitTask&& _task) { m_queue.push(std::move(_task)); }
-	};
-}
 
 bytesConstRef SmartVM::execImpl(u256& io_gas, ExtVMFace& _ext, OnOpFunc const& _onOp)
 {
@@ -93,29 +33,23 @@ bytesConstRef SmartVM::execImpl(u256& io_gas, ExtVMFace& _ext, OnOpFunc const& _
 	// Jitted EVM code already in memory?
 	if (JitVM::isCodeReady(mode, _ext.codeHash))
 	{
-		LOG(INFO) << "JIT:           " << _ext.codeHash;
+		LOG(TRACE) << "JIT:           " << _ext.codeHash;
 		vmKind = VMKind::JIT;
 	}
-	else if (!_ext.code.empty()) // This check is needed for VM tests
-	{
-		static JitWorker s_worker;
-
-		// Check EVM code hit count
-		static const uint64_t c_hitTreshold = 2;
-		auto& hits = getHitMap()[_ext.codeHash];
-		++hits;
-		if (hits == c_hitTreshold)
-		{
-			LOG(INFO) << "Schedule:      " << _ext.codeHash;
-			s_worker.push({_ext.code, _ext.codeHash, mode});
-		}
-		LOG(INFO) << "Interpreter:   " << _ext.codeHash;
-	}
+	else
+		LOG(TRACE) << "Interpreter:   " << _ext.codeHash;
 
 	// TODO: Selected VM must be kept only because it returns reference to its internal memory.
 	//       VM implementations should be stateless, without escaping memory reference.
 	m_selectedVM = VMFactory::create(vmKind);
-	return m_selectedVM->execImpl(io_gas, _ext, _onOp);
+	if (_ext.code.empty()) // This check is needed for VM tests
+		return m_selectedVM->execImpl(io_gas, _ext, _onOp);
+
+	// Gas is counted for JIT executions too, so that the hot list ranks contracts by total cost.
+	u256 gas = io_gas;
+	auto out = m_selectedVM->execImpl(io_gas, _ext, _onOp);
+	JitScheduler::instance().noteExecution(_ext.codeHash, &_ext.code, mode, gas - io_gas, vmKind == VMKind::Interpreter);
+	return out;
 }
 
 }
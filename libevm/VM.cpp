@@ -145,7 +145,7 @@ void VM::fetchInstruction()
 	if( m_ext->envInfo().coverLog() )
 	{
 		//cout<<"VM::fetchInstruction"<<"\n";
-		VM::covertool.hint(m_ext->myAddress,(size_t)m_pc,m_codeSpace.size() );
+		VM::covertool.hint(m_ext->myAddress,(size_t)m_pc,m_analysis->code.size() );
 		//这个地方把code的大小传进去，是为了比较是部署合约，还是交易，因为这两者之间的code有偏移，CoverTool计算的时候需要加上
 	}
 	#endif
@@ -1118,9 +1118,371 @@ void VM::interpretCases()
 			throwBadInstruction();
 		CASE_END
 
+		CASE_BEGIN(BLOCKC)
+#ifdef EVM_FAST_BLOCKS
+		{
+			FastBlock const& block = m_analysis->blocks[m_analysis->blockAt[m_pc]];
+			int const size = 1 + m_sp - m_stack;
+			if (m_io_gas >= block.gas && block.stackNeed <= size && size <= block.stackLimit)
+				runBlock(block);
+			else
+				// the block is bound to fail, so run the rest of the code an instruction at a time
+				// to fail exactly where and how the interpreter does
+				m_code = m_analysis->code.data();
+		}
+#else
+			throwBadInstruction();
+#endif
+		CASE_END
+
 		CASE_DEFAULT
 			throwBadInstruction();
 		CASE_END
 		
 	END_CASES
 }
+
+#ifdef EVM_FAST_BLOCKS
+
+//
+// fast blocks
+//
+
+static inline bool fits64(u256 const& _v)
+{
+	return _v.backend().size() == 1;
+}
+
+static inline uint64_t low64(u256 const& _v)
+{
+	return _v.backend().limbs()[0];
+}
+
+void VM::runBlock(FastBlock const& _block)
+{
+	static_assert(sizeof(boost::multiprecision::limb_type) == sizeof(uint64_t), "fast arithmetic needs 64-bit limbs");
+
+	// memory growth is the only gas not already paid on entry
+	auto growMemory = [&](u256 const& _offset, uint64_t _size)
+	{
+		m_runGas = 0;
+		m_copyMemSize = 0;
+		m_newMemSize = toUint64(_offset) + _size;
+		updateMem();
+		m_io_gas -= m_runGas;
+	};
+
+	m_io_gas -= _block.gas;
+	m_pc = _block.endPc;
+
+	for (FastOp const* op = m_analysis->fastOps.data() + _block.begin, *end = m_analysis->fastOps.data() + _block.end; op != end; ++op)
+	{
+		switch (op->op)
+		{
+		case (unsigned)Instruction::JUMPDEST:
+			break;
+
+		// operands that fit in 64 bits are worked on natively
+		case (unsigned)Instruction::ADD:
+			if (fits64(*m_sp) && fits64(*(m_sp - 1)))
+			{
+				uint64_t a = low64(*m_sp);
+				uint64_t r = a + low64(*(m_sp - 1));
+				if (r >= a)
+				{
+					*--m_sp = r;
+					break;
+				}
+			}
+			*(m_sp - 1) += *m_sp;
+			--m_sp;
+			break;
+
+		case (unsigned)Instruction::MUL:
+			if (fits64(*m_sp) && fits64(*(m_sp - 1)) && low64(*m_sp) <= 0xFFFFFFFF && low64(*(m_sp - 1)) <= 0xFFFFFFFF)
+				*(m_sp - 1) = low64(*m_sp) * low64(*(m_sp - 1));
+			else
+				*(m_sp - 1) *= *m_sp;
+			--m_sp;
+			break;
+
+		case (unsigned)Instruction::SUB:
+			if (fits64(*m_sp) && fits64(*(m_sp - 1)) && low64(*m_sp) >= low64(*(m_sp - 1)))
+				*(m_sp - 1) = low64(*m_sp) - low64(*(m_sp - 1));
+			else
+				*(m_sp - 1) = *m_sp - *(m_sp - 1);
+			--m_sp;
+			break;
+
+		case (unsigned)Instruction::DIV:
+			if (!*(m_sp - 1))
+				*(m_sp - 1) = 0;
+			else if (fits64(*m_sp) && fits64(*(m_sp - 1)))
+				*(m_sp - 1) = low64(*m_sp) / low64(*(m_sp - 1));
+			else
+				*(m_sp - 1) = divWorkaround(*m_sp, *(m_sp - 1));
+			--m_sp;
+			break;
+
+		case (unsigned)Instruction::MOD:
+			if (!*(m_sp - 1))
+				*(m_sp - 1) = 0;
+			else if (fits64(*m_sp) && fits64(*(m_sp - 1)))
+				*(m_sp - 1) = low64(*m_sp) % low64(*(m_sp - 1));
+			else
+				*(m_sp - 1) = modWorkaround(*m_sp, *(m_sp - 1));
+			--m_sp;
+			break;
+
+		case (unsigned)Instruction::LT:
+			if (fits64(*m_sp) && fits64(*(m_sp - 1)))
+				*(m_sp - 1) = low64(*m_sp) < low64(*(m_sp - 1)) ? 1 : 0;
+			else
+				*(m_sp - 1) = *m_sp < *(m_sp - 1) ? 1 : 0;
+			--m_sp;
+			break;
+
+		case (unsigned)Instruction::GT:
+			if (fits64(*m_sp) && fits64(*(m_sp - 1)))
+				*(m_sp - 1) = low64(*m_sp) > low64(*(m_sp - 1)) ? 1 : 0;
+			else
+				*(m_sp - 1) = *m_sp > *(m_sp - 1) ? 1 : 0;
+			--m_sp;
+			break;
+
+		case (unsigned)Instruction::EQ:
+			if (fits64(*m_sp) && fits64(*(m_sp - 1)))
+				*(m_sp - 1) = low64(*m_sp) == low64(*(m_sp - 1)) ? 1 : 0;
+			else
+				*(m_sp - 1) = *m_sp == *(m_sp - 1) ? 1 : 0;
+			--m_sp;
+			break;
+
+		case (unsigned)Instruction::AND:
+			if (fits64(*m_sp) && fits64(*(m_sp - 1)))
+				*(m_sp - 1) = low64(*m_sp) & low64(*(m_sp - 1));
+			else
+				*(m_sp - 1) = *m_sp & *(m_sp - 1);
+			--m_sp;
+			break;
+
+		case (unsigned)Instruction::OR:
+			if (fits64(*m_sp) && fits64(*(m_sp - 1)))
+				*(m_sp - 1) = low64(*m_sp) | low64(*(m_sp - 1));
+			else
+				*(m_sp - 1) = *m_sp | *(m_sp - 1);
+			--m_sp;
+			break;
+
+		case (unsigned)Instruction::SDIV:
+			*(m_sp - 1) = *(m_sp - 1) ? s2u(divWorkaround(u2s(*m_sp), u2s(*(m_sp - 1)))) : 0;
+			--m_sp;
+			break;
+
+		case (unsigned)Instruction::SMOD:
+			*(m_sp - 1) = *(m_sp - 1) ? s2u(modWorkaround(u2s(*m_sp), u2s(*(m_sp - 1)))) : 0;
+			--m_sp;
+			break;
+
+		case (unsigned)Instruction::ADDMOD:
+			*(m_sp - 2) = *(m_sp - 2) ? u256((u512(*m_sp) + u512(*(m_sp - 1))) % *(m_sp - 2)) : 0;
+			m_sp -= 2;
+			break;
+
+		case (unsigned)Instruction::MULMOD:
+			*(m_sp - 2) = *(m_sp - 2) ? u256((u512(*m_sp) * u512(*(m_sp - 1))) % *(m_sp - 2)) : 0;
+			m_sp -= 2;
+			break;
+
+		case (unsigned)Instruction::SIGNEXTEND:
+			if (*m_sp < 31)
+			{
+				unsigned testBit = static_cast<unsigned>(*m_sp) * 8 + 7;
+				u256& number = *(m_sp - 1);
+				u256 mask = ((u256(1) << testBit) - 1);
+				if (boost::multiprecision::bit_test(number, testBit))
+					number |= ~mask;
+				else
+					number &= mask;
+			}
+			--m_sp;
+			break;
+
+		case (unsigned)Instruction::SLT:
+			*(m_sp - 1) = u2s(*m_sp) < u2s(*(m_sp - 1)) ? 1 : 0;
+			--m_sp;
+			break;
+
+		case (unsigned)Instruction::SGT:
+			*(m_sp - 1) = u2s(*m_sp) > u2s(*(m_sp - 1)) ? 1 : 0;
+			--m_sp;
+			break;
+
+		case (unsigned)Instruction::ISZERO:
+			*m_sp = *m_sp ? 0 : 1;
+			break;
+
+		case (unsigned)Instruction::XOR:
+			*(m_sp - 1) = *m_sp ^ *(m_sp - 1);
+			--m_sp;
+			break;
+
+		case (unsigned)Instruction::NOT:
+			*m_sp = ~*m_sp;
+			break;
+
+		case (unsigned)Instruction::BYTE:
+			*(m_sp - 1) = *m_sp < 32 ? (*(m_sp - 1) >> (unsigned)(8 * (31 - *m_sp))) & 0xff : 0;
+			--m_sp;
+			break;
+
+		case (unsigned)Instruction::ADDRESS:
+			*++m_sp = fromAddress(m_ext->myAddress);
+			break;
+
+		case (unsigned)Instruction::ORIGIN:
+			*++m_sp = fromAddress(m_ext->origin);
+			break;
+
+		case (unsigned)Instruction::CALLER:
+			*++m_sp = fromAddress(m_ext->caller);
+			break;
+
+		case (unsigned)Instruction::CALLVALUE:
+			*++m_sp = m_ext->value;
+			break;
+
+		case (unsigned)Instruction::CALLDATALOAD:
+			if (u512(*m_sp) + 31 < m_ext->data.size())
+				*m_sp = (u256)*(h256 const*)(m_ext->data.data() + (size_t)*m_sp);
+			else if (*m_sp >= m_ext->data.size())
+				*m_sp = u256(0);
+			else
+			{
+				h256 r;
+				for (uint64_t i = (uint64_t)*m_sp, e = (uint64_t)*m_sp + (uint64_t)32, j = 0; i < e; ++i, ++j)
+					r[j] = i < m_ext->data.size() ? m_ext->data[i] : 0;
+				*m_sp = (u256)r;
+			}
+			break;
+
+		case (unsigned)Instruction::CALLDATASIZE:
+			*++m_sp = m_ext->data.size();
+			break;
+
+		case (unsigned)Instruction::CODESIZE:
+			*++m_sp = m_ext->code.size();
+			break;
+
+		case (unsigned)Instruction::GASPRICE:
+			*++m_sp = m_ext->gasPrice;
+			break;
+
+		case (unsigned)Instruction::COINBASE:
+			*++m_sp = (u160)m_ext->envInfo().author();
+			break;
+
+		case (unsigned)Instruction::TIMESTAMP:
+			*++m_sp = m_ext->envInfo().timestamp();
+			break;
+
+		case (unsigned)Instruction::NUMBER:
+			*++m_sp = m_ext->envInfo().number();
+			break;
+
+		case (unsigned)Instruction::DIFFICULTY:
+			*++m_sp = m_ext->envInfo().difficulty();
+			break;
+
+		case (unsigned)Instruction::GASLIMIT:
+			*++m_sp = m_ext->envInfo().gasLimit();
+			break;
+
+		case (unsigned)Instruction::POP:
+			--m_sp;
+			break;
+
+		case (unsigned)Instruction::MLOAD:
+			growMemory(*m_sp, 32);
+			*m_sp = (u256)*(h256 const*)(m_mem.data() + (unsigned)*m_sp);
+			break;
+
+		case (unsigned)Instruction::MSTORE:
+			growMemory(*m_sp, 32);
+			*(h256*)&m_mem[(unsigned)*m_sp] = (h256)*(m_sp - 1);
+			m_sp -= 2;
+			break;
+
+		case (unsigned)Instruction::MSTORE8:
+			growMemory(*m_sp, 1);
+			m_mem[(unsigned)*m_sp] = (byte)(*(m_sp - 1) & 0xff);
+			m_sp -= 2;
+			break;
+
+		case (unsigned)Instruction::PC:
+			*++m_sp = op->pc;
+			break;
+
+		case (unsigned)Instruction::MSIZE:
+			*++m_sp = m_mem.size();
+			break;
+
+		// all PUSHn, DUPn and SWAPn are stored as the first of their kind
+		case (unsigned)Instruction::PUSH1:
+			*++m_sp = op->value;
+			break;
+
+		case (unsigned)Instruction::DUP1:
+			*(m_sp + 1) = *(m_sp + 1 - op->n);
+			++m_sp;
+			break;
+
+		case (unsigned)Instruction::SWAP1:
+			swap(*m_sp, *(m_sp - op->n));
+			break;
+
+		// a jump always ends the block
+		case (unsigned)Instruction::JUMP:
+			m_pc = verifyJumpDest(*m_sp);
+			--m_sp;
+			break;
+
+		case (unsigned)Instruction::JUMPI:
+			if (*(m_sp - 1))
+				m_pc = verifyJumpDest(*m_sp);
+			m_sp -= 2;
+			break;
+
+		case FastOp::PushJump:
+			m_pc = op->pc;
+			break;
+
+		case FastOp::PushJumpi:
+			if (*m_sp)
+				m_pc = op->pc;
+			--m_sp;
+			break;
+
+		case FastOp::PushMload:
+			growMemory(op->value, 32);
+			*++m_sp = (u256)*(h256 const*)(m_mem.data() + (unsigned)op->value);
+			break;
+
+		case FastOp::DupSwap:
+			*(m_sp + 1) = *(m_sp + 1 - op->n);
+			++m_sp;
+			swap(*m_sp, *(m_sp - op->m));
+			break;
+
+		case FastOp::SwapPop:
+			*(m_sp - op->n) = *m_sp;
+			--m_sp;
+			break;
+
+		default:
+			throwBadInstruction();
+		}
+	}
+}
+
+#endif
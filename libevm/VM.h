@@ -28,6 +28,7 @@
 #include <libdevcore/SHA3.h>
 #include <libethcore/BlockHeader.h>
 #include "VMFace.h"
+#include "VMCache.h"
 
 #ifdef EVM_COVERTOOL
 #include "CoverTool.h"
@@ -108,7 +109,6 @@ private:
 	static std::array<InstructionMetric, 256> c_metrics;
 	static void initMetrics();
 	static u256 exp256(u256 _base, u256 _exponent);
-	void copyCode(int);
 	const void* const* c_jumpTable = 0;
 	bool m_caseInit = false;
 	
@@ -124,9 +124,9 @@ private:
 	// space for memory
 	bytes m_mem;
 
-	// space for code and pointer to data
-	bytes m_codeSpace;
-	byte* m_code = nullptr;
+	// analysed code, shared with other VMs running the same code, and pointer to data
+	std::shared_ptr<AnalysedCode const> m_analysis;
+	byte const* m_code = nullptr;
 
 	// space for stack and pointer to data
 	u256 m_stackSpace[1025];
@@ -139,7 +139,7 @@ private:
 #endif
 
 	// constant pool
-	u256 m_pool[256];
+	u256 const* m_pool = nullptr;
 
 	// interpreter state
 	Instruction m_op;                   // current operator
@@ -157,10 +157,15 @@ private:
 	// initialize interpreter
 	void initEntry();
 	void optimize();
+	static std::shared_ptr<AnalysedCode> analyse(bytes const& _code);
+	static void buildFastBlocks(AnalysedCode& _a, size_t _nBytes);
 
 	// interpreter loop & switch
 	void interpretCases();
 
+	// run a fast block whose gas and stack bounds have been checked
+	void runBlock(FastBlock const& _block);
+
 	// interpreter cases that call out
 	void caseCreate();
 	bool caseCallSetup(CallParameters*);
@@ -176,8 +181,6 @@ private:
 
 	void reportStackUse();
 
-	std::vector<uint64_t> m_beginSubs;
-	std::vector<uint64_t> m_jumpDests;
 	int64_t verifyJumpDest(u256 const& _dest, bool _throw = true);
 
 	int poolConstant(const u256&);
@@ -0,0 +1,59 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "VMCache.h"
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+shared_ptr<AnalysedCode const> AnalysedCodeCache::get(h256 const& _codeHash)
+{
+	Guard l(x_cache);
+	auto it = m_cache.find(_codeHash);
+	if (it == m_cache.end())
+	{
+		++m_misses;
+		return nullptr;
+	}
+	++m_hits;
+	m_uses.splice(m_uses.begin(), m_uses, it->second.use);
+	return it->second.analysis;
+}
+
+void AnalysedCodeCache::store(h256 const& _codeHash, shared_ptr<AnalysedCode const> const& _analysis)
+{
+	size_t size = _analysis->memoryUsage();
+	if (size > c_maxMemory)
+		return;
+
+	Guard l(x_cache);
+	// Another VM may have analysed the same code meanwhile; keep the first one.
+	if (m_cache.count(_codeHash))
+		return;
+
+	while (m_memory + size > c_maxMemory && !m_uses.empty())
+	{
+		auto it = m_cache.find(m_uses.back());
+		m_memory -= it->second.analysis->memoryUsage();
+		m_cache.erase(it);
+		m_uses.pop_back();
+	}
+
+	m_uses.push_front(_codeHash);
+	m_cache[_codeHash] = Entry{_analysis, m_uses.begin()};
+	m_memory += size;
+}
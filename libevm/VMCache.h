@@ -0,0 +1,129 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <array>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/// One step of a fast block: an instruction, or a fused pair of instructions, with its
+/// immediate already decoded.
+struct FastOp
+{
+	/// Pairs fused into one step; the other values are Instructions.
+	enum Fused: unsigned
+	{
+		PushJump = 0x100,	///< PUSH to a valid JUMPDEST, JUMP
+		PushJumpi,			///< PUSH to a valid JUMPDEST, JUMPI
+		PushMload,			///< PUSH, MLOAD
+		DupSwap,			///< DUPn, SWAPm
+		SwapPop				///< SWAPn, POP
+	};
+
+	unsigned op;
+	unsigned n = 0;			///< DUP/SWAP depth
+	unsigned m = 0;			///< SWAP depth of DupSwap
+	uint64_t pc = 0;		///< PC of the instruction, or the verified jump destination
+	u256 value;				///< PUSH immediate
+};
+
+/// A run of instructions without calls, storage access or dynamic gas other than memory growth,
+/// ending at the next JUMPDEST or after a JUMP/JUMPI.
+struct FastBlock
+{
+	uint64_t gas = 0;		///< Static gas of all the instructions.
+	int stackNeed = 0;		///< Smallest stack size on entry for which no instruction underflows.
+	int stackLimit = 1024;	///< Largest stack size on entry for which no instruction overflows.
+	uint64_t endPc = 0;		///< PC after the block when it does not jump.
+	uint32_t begin = 0;		///< Range of the block in AnalysedCode::fastOps.
+	uint32_t end = 0;
+};
+
+/// The result of VM::analyse for one piece of EVM code. Immutable once built, so it is shared
+/// by every VM executing that code.
+struct AnalysedCode
+{
+	/// The code padded with zero bytes, with the first-pass rewrites (PUSHC/JUMPC/JUMPCI) applied.
+	bytes code;
+	/// Sorted positions of the valid JUMPDESTs.
+	std::vector<uint64_t> jumpDests;
+	std::vector<uint64_t> beginSubs;
+	/// Constant pool indexed by the PUSHC operand.
+	u256 pool[256];
+
+	/// The code with BLOCKC at the start of every fast block, run when nothing traces the execution.
+	bytes fastCode;
+	std::vector<FastBlock> blocks;
+	std::vector<FastOp> fastOps;
+	/// Index into blocks by PC, valid where fastCode has BLOCKC.
+	std::vector<uint32_t> blockAt;
+	/// Tier gas prices the block gas was computed with.
+	std::array<unsigned, 8> tierStepGas;
+
+	/// Approximate memory used, for the cache budget.
+	size_t memoryUsage() const
+	{
+		return sizeof(AnalysedCode) + code.capacity() + fastCode.capacity() + (jumpDests.capacity() + beginSubs.capacity()) * sizeof(uint64_t) +
+			blocks.capacity() * sizeof(FastBlock) + fastOps.capacity() * sizeof(FastOp) + blockAt.capacity() * sizeof(uint32_t);
+	}
+};
+
+/// Process-wide cache of analysed code by code hash, bounded by memory usage.
+/// The least recently used entries are dropped first.
+class AnalysedCodeCache
+{
+public:
+	static AnalysedCodeCache& instance() { static AnalysedCodeCache cache; return cache; }
+
+	/// @returns the analysis of the code with hash @a _codeHash, or null if it is not cached.
+	std::shared_ptr<AnalysedCode const> get(h256 const& _codeHash);
+	void store(h256 const& _codeHash, std::shared_ptr<AnalysedCode const> const& _analysis);
+
+	uint64_t hits() const { Guard l(x_cache); return m_hits; }
+	uint64_t misses() const { Guard l(x_cache); return m_misses; }
+
+private:
+	AnalysedCodeCache() {}
+
+	struct Entry
+	{
+		std::shared_ptr<AnalysedCode const> analysis;
+		std::list<h256>::iterator use;
+	};
+
+	static const size_t c_maxMemory = 32 * 1024 * 1024;
+
+	mutable Mutex x_cache;
+	std::unordered_map<h256, Entry> m_cache;
+	std::list<h256> m_uses;				///< Most recently used first.
+	size_t m_memory = 0;
+	uint64_t m_hits = 0;
+	uint64_t m_misses = 0;
+};
+
+}
+}
@@ -31,6 +31,9 @@ namespace eth
 //
 // EVM_REPLACE_CONST_JUMP - with pre-verified jumps to save runtime lookup
 //
+// EVM_FAST_BLOCKS        - run straight-line code a basic block at a time, with gas and
+//                          stack checked once per block and common pairs of ops fused
+//
 // EVM_TRACE              - provides various levels of tracing
 
 #if true
@@ -38,6 +41,10 @@ namespace eth
 		#define EVM_ETHCALL
 #endif
 
+#if true
+	#define EVM_FAST_BLOCKS
+#endif
+
 #if true && defined(__GNUG__)
 	#define EVM_JUMP_DISPATCH
 #else
@@ -330,7 +337,7 @@ namespace eth
 			&&JUMPC,  \
 			&&JUMPCI,  \
 			&&BAD,  \
-			&&INVALID,       /* B0, */  \
+			&&BLOCKC,        /* B0, */  \
 			&&INVALID,  \
 			&&INVALID,  \
 			&&INVALID,  \
@@ -598,7 +605,7 @@ namespace eth
 			&&JUMPC,  \
 			&&JUMPCI,  \
 			&&BAD,  \
-			&&INVALID,       /* B0, */  \
+			&&BLOCKC,        /* B0, */  \
 			&&INVALID,  \
 			&&INVALID,  \
 			&&INVALID,  \
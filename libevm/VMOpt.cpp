@@ -49,46 +49,215 @@ void VM::initMetrics()
 	done = true;
 }
 
-void VM::copyCode(int _extraBytes)
+void VM::optimize()
 {
-	// Copy code so that it can be safely modified and extend code by
-	// _extraBytes zero bytes to allow reading virtual data at the end
-	// of the code without bounds checks.
-	auto extendedSize = m_ext->code.size() + _extraBytes;
-	m_codeSpace.reserve(extendedSize);
-	m_codeSpace = m_ext->code;
-	m_codeSpace.resize(extendedSize);
-	m_code = m_codeSpace.data();
+	// Code is analysed once per code hash; repeated calls into the same contract reuse it.
+	h256 const& codeHash = m_ext->codeHash;
+	m_analysis = codeHash ? AnalysedCodeCache::instance().get(codeHash) : nullptr;
+	if (!m_analysis)
+	{
+		auto analysis = analyse(m_ext->code);
+		if (codeHash)
+			AnalysedCodeCache::instance().store(codeHash, analysis);
+		m_analysis = analysis;
+	}
+	m_code = m_analysis->code.data();
+	m_pool = m_analysis->pool;
+
+#ifdef EVM_FAST_BLOCKS
+	// tracers and the cover tool need to see every instruction
+	bool fast = !m_onOp && !m_analysis->fastCode.empty() && m_schedule->tierStepGas == m_analysis->tierStepGas;
+	#ifdef EVM_COVERTOOL
+		fast = fast && !m_ext->envInfo().coverLog();
+	#endif
+	if (fast)
+		m_code = m_analysis->fastCode.data();
+#endif
 }
 
-void VM::optimize()
+#ifdef EVM_FAST_BLOCKS
+
+// instructions a fast block may contain: fixed gas apart from memory growth, and no effect
+// outside the VM, so that a block which is going to fail can still be rerun op by op
+static bool isFastInstruction(Instruction _op)
+{
+	switch (_op)
+	{
+	case Instruction::ADD: case Instruction::MUL: case Instruction::SUB: case Instruction::DIV:
+	case Instruction::SDIV: case Instruction::MOD: case Instruction::SMOD: case Instruction::ADDMOD:
+	case Instruction::MULMOD: case Instruction::SIGNEXTEND:
+	case Instruction::LT: case Instruction::GT: case Instruction::SLT: case Instruction::SGT:
+	case Instruction::EQ: case Instruction::ISZERO: case Instruction::AND: case Instruction::OR:
+	case Instruction::XOR: case Instruction::NOT: case Instruction::BYTE:
+	case Instruction::ADDRESS: case Instruction::ORIGIN: case Instruction::CALLER:
+	case Instruction::CALLVALUE: case Instruction::CALLDATALOAD: case Instruction::CALLDATASIZE:
+	case Instruction::CODESIZE: case Instruction::GASPRICE: case Instruction::COINBASE:
+	case Instruction::TIMESTAMP: case Instruction::NUMBER: case Instruction::DIFFICULTY:
+	case Instruction::GASLIMIT:
+	case Instruction::POP: case Instruction::MLOAD: case Instruction::MSTORE: case Instruction::MSTORE8:
+	case Instruction::PC: case Instruction::MSIZE: case Instruction::JUMPDEST:
+	case Instruction::JUMP: case Instruction::JUMPI:
+		return true;
+	default:
+		return
+			(Instruction::PUSH1 <= _op && _op <= Instruction::PUSH32) ||
+			(Instruction::DUP1 <= _op && _op <= Instruction::DUP16) ||
+			(Instruction::SWAP1 <= _op && _op <= Instruction::SWAP16);
+	}
+}
+
+// fuse _op into the last op of the block if they make a known pair
+static bool fuse(AnalysedCode& _a, size_t _begin, Instruction _op)
+{
+	if (_a.fastOps.size() <= _begin)
+		return false;
+	FastOp& last = _a.fastOps.back();
+	if (last.op >= 0x100)
+		return false;
+	Instruction prev = Instruction(last.op);
+	bool prevPush = Instruction::PUSH1 <= prev && prev <= Instruction::PUSH32;
+
+	if (prevPush && (_op == Instruction::JUMP || _op == Instruction::JUMPI))
+	{
+		// only jumps known to be valid; others are left to fail at run time
+		if (last.value > 0x7FFFFFFFFFFFFFFF || !binary_search(_a.jumpDests.begin(), _a.jumpDests.end(), uint64_t(last.value)))
+			return false;
+		last.op = _op == Instruction::JUMP ? FastOp::PushJump : FastOp::PushJumpi;
+		last.pc = uint64_t(last.value);
+	}
+	else if (prevPush && _op == Instruction::MLOAD)
+		last.op = FastOp::PushMload;
+	else if (Instruction::DUP1 <= prev && prev <= Instruction::DUP16 && Instruction::SWAP1 <= _op && _op <= Instruction::SWAP16)
+	{
+		last.op = FastOp::DupSwap;
+		last.m = (unsigned)_op - (unsigned)Instruction::SWAP1 + 1;
+	}
+	else if (Instruction::SWAP1 <= prev && prev <= Instruction::SWAP16 && _op == Instruction::POP)
+		last.op = FastOp::SwapPop;
+	else
+		return false;
+	return true;
+}
+
+//
+// Split the code into fast blocks and mark their starts in fastCode.
+//
+void VM::buildFastBlocks(AnalysedCode& _a, size_t _nBytes)
+{
+	_a.tierStepGas = EVMSchedule().tierStepGas;
+	_a.fastCode = _a.code;
+	_a.blockAt.assign(_nBytes, 0);
+
+	for (size_t pc = 0; pc < _nBytes;)
+	{
+		FastBlock block;
+		block.begin = _a.fastOps.size();
+		int height = 0;
+		unsigned count = 0;
+		size_t next = pc;
+		while (next < _nBytes)
+		{
+			Instruction op = Instruction(_a.code[next]);
+			if (!isFastInstruction(op) || (op == Instruction::JUMPDEST && next != pc))
+				break;
+
+			// the bounds checkStack enforces for each instruction, as bounds on the entry size
+			InstructionMetric const& metric = c_metrics[(size_t)op];
+			block.stackNeed = max(block.stackNeed, metric.args - height);
+			block.stackLimit = min(block.stackLimit, 1024 - height + metric.args - metric.ret);
+			height += metric.ret - metric.args;
+			block.gas += op == Instruction::JUMPDEST ? 1 : _a.tierStepGas[(unsigned)metric.gasPriceTier];
+			++count;
+
+			if (!fuse(_a, block.begin, op))
+			{
+				FastOp fop;
+				fop.op = (unsigned)op;
+				fop.pc = next;
+				if (Instruction::PUSH1 <= op && op <= Instruction::PUSH32)
+				{
+					// the code is padded, as for the interpreter
+					for (size_t i = 1, n = (size_t)op - (size_t)Instruction::PUSH1 + 1; i <= n; ++i)
+						fop.value = (fop.value << 8) | _a.code[next + i];
+					fop.op = (unsigned)Instruction::PUSH1;
+				}
+				else if (Instruction::DUP1 <= op && op <= Instruction::DUP16)
+				{
+					fop.n = (unsigned)op - (unsigned)Instruction::DUP1 + 1;
+					fop.op = (unsigned)Instruction::DUP1;
+				}
+				else if (Instruction::SWAP1 <= op && op <= Instruction::SWAP16)
+				{
+					fop.n = (unsigned)op - (unsigned)Instruction::SWAP1 + 1;
+					fop.op = (unsigned)Instruction::SWAP1;
+				}
+				_a.fastOps.push_back(fop);
+			}
+
+			next += 1;
+			if (Instruction::PUSH1 <= op && op <= Instruction::PUSH32)
+				next += (size_t)op - (size_t)Instruction::PUSH1 + 1;
+			if (op == Instruction::JUMP || op == Instruction::JUMPI)
+				break;
+		}
+
+		// a single instruction is cheaper through the interpreter
+		if (count > 1)
+		{
+			block.endPc = next;
+			block.end = _a.fastOps.size();
+			_a.fastCode[pc] = (byte)Instruction::BLOCKC;
+			_a.blockAt[pc] = _a.blocks.size();
+			_a.blocks.push_back(block);
+		}
+		else
+			_a.fastOps.resize(block.begin);
+
+		// step over the instruction that ended the previous block
+		pc = next == pc ? pc + 1 : next;
+	}
+}
+
+#endif
+
+shared_ptr<AnalysedCode> VM::analyse(bytes const& _code)
 {
-	copyCode(33);
+	auto ret = make_shared<AnalysedCode>();
 
-	size_t const nBytes = m_ext->code.size();
+	// Copy code so that it can be safely modified and extend code by
+	// 33 zero bytes to allow reading virtual data at the end
+	// of the code without bounds checks.
+	ret->code.reserve(_code.size() + 33);
+	ret->code = _code;
+	ret->code.resize(_code.size() + 33);
+	byte* code = ret->code.data();
+	vector<uint64_t>& jumpDests = ret->jumpDests;
+
+	size_t const nBytes = _code.size();
 
 	// build a table of jump destinations for use in verifyJumpDest
 	
 	TRACE_STR(1, "Build JUMPDEST table")
 	for (size_t pc = 0; pc < nBytes; ++pc)
 	{
-		Instruction op = Instruction(m_code[pc]);
+		Instruction op = Instruction(code[pc]);
 		TRACE_OP(2, pc, op);
 				
 		// make synthetic ops in user code trigger invalid instruction if run
 		if (
 			op == Instruction::PUSHC ||
 			op == Instruction::JUMPC ||
-			op == Instruction::JUMPCI
+			op == Instruction::JUMPCI ||
+			op == Instruction::BLOCKC
 		)
 		{
 			TRACE_OP(1, pc, op);
-			m_code[pc] = (byte)Instruction::BAD;
+			code[pc] = (byte)Instruction::BAD;
 		}
 
 		if (op == Instruction::JUMPDEST)
 		{
-			m_jumpDests.push_back(pc);
+			jumpDests.push_back(pc);
 		}
 		else if (
 			(byte)Instruction::PUSH1 <= (byte)op &&
@@ -109,11 +278,11 @@ void VM::optimize()
 		else if (op == Instruction::JUMPV || op == Instruction::JUMPSUBV)
 		{
 			++pc;
-			pc += 4 * m_code[pc];  // number of 4-byte dests followed by table
+			pc += 4 * code[pc];  // number of 4-byte dests followed by table
 		}
 		else if (op == Instruction::BEGINSUB)
 		{
-			m_beginSubs.push_back(pc);
+			ret->beginSubs.push_back(pc);
 		}
 		else if (op == Instruction::BEGINDATA)
 		{
@@ -121,6 +290,11 @@ void VM::optimize()
 		}
 #endif
 	}
+
+#if defined(EVM_FAST_BLOCKS) && !EVM_JUMPS_AND_SUBS
+	// (block splitting does not step over the immediates of the static jumps)
+	buildFastBlocks(*ret, nBytes);
+#endif
 	
 #ifdef EVM_DO_FIRST_PASS_OPTIMIZATION
 	
@@ -165,7 +339,7 @@ void VM::optimize()
 				}
 				return table[hash] == val;
 			}
-		} constantPool(m_pool);
+		} constantPool(ret->pool);
 		#define CONST_POOL_HASH_INIT() constantPool.hashInit()
 		#define CONST_POOL_HASH_BYTE(b) constantPool.hashByte(b)
 		#define CONST_POOL_GET_HASH() constantPool.getHash()
@@ -181,7 +355,7 @@ void VM::optimize()
 	for (size_t pc = 0; pc < nBytes; ++pc)
 	{
 		u256 val = 0;
-		Instruction op = Instruction(m_code[pc]);
+		Instruction op = Instruction(code[pc]);
 
 		if ((byte)Instruction::PUSH1 <= (byte)op && (byte)op <= (byte)Instruction::PUSH32)
 		{
@@ -190,10 +364,10 @@ void VM::optimize()
 
 			// decode pushed bytes to integral value
 			CONST_POOL_HASH_INIT();
-			val = m_code[pc+1];
+			val = code[pc+1];
 			for (uint64_t i = pc+2, n = nPush; --n; ++i) {
-				val = (val << 8) | m_code[i];
-				CONST_POOL_HASH_BYTE(m_code[i]);
+				val = (val << 8) | code[i];
+				CONST_POOL_HASH_BYTE(code[i]);
 			}
 
 		#ifdef EVM_USE_CONSTANT_POOL
@@ -205,9 +379,9 @@ void VM::optimize()
 				byte hash = CONST_POOL_GET_HASH();
 				if (CONST_POOL_INSERT_VAL(hash, val))
 				{
-					m_code[pc] = (byte)Instruction::PUSHC;
-					m_code[pc+1] = hash;
-					m_code[pc+2] = nPush - 1;
+					code[pc] = (byte)Instruction::PUSHC;
+					code[pc+1] = hash;
+					code[pc+2] = nPush - 1;
 					TRACE_VAL(1, "constant pooled", val);
 				}
 				TRACE_POST_OPT(1, pc, op);
@@ -215,19 +389,23 @@ void VM::optimize()
 		#endif
 
 		#ifdef EVM_REPLACE_CONST_JUMP	
+			auto isJumpDest = [&](u256 const& _dest) {
+				return _dest <= 0x7FFFFFFFFFFFFFFF && binary_search(jumpDests.begin(), jumpDests.end(), uint64_t(_dest));
+			};
+
 			// replace JUMP or JUMPI to constant location with JUMPC or JUMPCI
 			// verifyJumpDest is M = log(number of jump destinations)
 			// outer loop is N = number of bytes in code array
 			// so complexity is N log M, worst case is N log N
 			size_t i = pc + nPush + 1;
-			op = Instruction(m_code[i]);
+			op = Instruction(code[i]);
 			if (op == Instruction::JUMP)
 			{
 				TRACE_STR(1, "Replace const JUMPC")
 				TRACE_PRE_OPT(1, i, op);
 				
-				if (0 <= verifyJumpDest(val, false))
-					m_code[i] = byte(op = Instruction::JUMPC);
+				if (isJumpDest(val))
+					code[i] = byte(op = Instruction::JUMPC);
 				
 				TRACE_POST_OPT(1, i, op);
 			}
@@ -236,8 +414,8 @@ void VM::optimize()
 				TRACE_STR(1, "Replace const JUMPCI")
 				TRACE_PRE_OPT(1, i, op);
 				
-				if (0 <= verifyJumpDest(val, false))
-					m_code[i] = byte(op = Instruction::JUMPCI);
+				if (isJumpDest(val))
+					code[i] = byte(op = Instruction::JUMPCI);
 				
 				TRACE_POST_OPT(1, ii, op);
 			}
@@ -249,6 +427,8 @@ void VM::optimize()
 	}
 	TRACE_STR(1, "Finished optimizations")
 #endif	
+
+	return ret;
 }
 
 
@@ -269,7 +449,7 @@ void VM::initEntry()
 
 			if( !VM::covertool.has(m_ext->myAddress) )
 			{	
-				covertool.init(m_ext->myAddress,m_codeSpace);//部署合约的时候就会进来
+				covertool.init(m_ext->myAddress,m_analysis->code);//部署合约的时候就会进来
 			}
 		}		
 	#endif
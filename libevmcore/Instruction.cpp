@@ -175,7 +175,8 @@ const std::map<std::string,  Instruction> dev::eth::c_instructions =
 	// these are generated by the interpreter - should never be in user code
 	{ "PUSHC", Instruction::PUSHC },
 	{ "JUMPC", Instruction::JUMPC },
-	{ "JUMPCI", Instruction::JUMPCI }
+	{ "JUMPCI", Instruction::JUMPCI },
+	{ "BLOCKC", Instruction::BLOCKC }
 };
 
 static const std::map<Instruction,  InstructionInfo> c_instructionInfo =
@@ -325,6 +326,7 @@ static const std::map<Instruction,  InstructionInfo> c_instructionInfo =
 	{ Instruction::JUMPC,        { "JUMPC",          0,     1,     0,   true,      Tier::Mid } },
 	{ Instruction::JUMPCI,       { "JUMPCI",         0,     1,     0,   true,      Tier::High } },
 	{ Instruction::STOP,         { "BAD",            0,     0,     0,   true,      Tier::Zero } },
+	{ Instruction::BLOCKC,       { "BLOCKC",         0,     0,     0,   true,      Tier::Zero } },
 }; 
  
 void dev::eth::eachInstruction( 
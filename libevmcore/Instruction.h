@@ -183,6 +183,7 @@ enum class Instruction: uint8_t
 	JUMPC,              ///< alter the program counter - pre-verified
 	JUMPCI,             ///< conditionally alter the program counter - pre-verified
 	BAD,                ///< placed to force invalid instruction exception
+	BLOCKC,             ///< start of a basic block run by the fast path
 
 	CREATE = 0xf0,      ///< create a new account with associated code
 	CALL,               ///< message-call into an account
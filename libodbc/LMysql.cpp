@@ -23,290 +23,390 @@
 
 #include "LMysql.h"
 
+#include <algorithm>
 #include <unistd.h>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
 #include <iostream>
 #include <libdevcore/db.h>
 #include <libdevcore/Common.h>
 #include <libdevcore/CommonData.h>
+#include <libethcore/Exceptions.h>
 
 using namespace std;
 using namespace leveldb;
 using namespace dev;
 
-static void* EncodeValue(char* v) { return reinterpret_cast<void*>(v); }
+//cache中存放解码后的值
+static void Deleter(const Slice&, void* v)
+{
+	delete reinterpret_cast<std::string*>(v);
+}
 
-static void Deleter(const Slice&, void* v) {
+static void insertCache(Cache *cc, const Slice &key, const std::string &value)
+{
+	cc->Release(cc->Insert(key, new std::string(value), value.size(), &Deleter));
+}
 
-	char * pch = reinterpret_cast<char *>(v);
-	delete pch;
-//	std::cout << "delete cache " << toHex(dev::bytesConstRef(key)) << std::endl;
+static SAString hexParam(const Slice &s)
+{
+	std::string sHex = toHex(dev::bytesConstRef(s));
+	return SAString(sHex.c_str(), sHex.size());
+}
+
+static std::string fieldString(SAField &field)
+{
+	SAString s = field.asString();
+	return std::string(s.GetMultiByteChars(), s.GetMultiByteCharsLength());
+}
+
+static bool isConnectionLost(SAException &x)
+{
+	return x.ErrNativeCode() == CR_SERVER_LOST || x.ErrNativeCode() == CR_SERVER_GONE_ERROR;
 }
 
 class MysqlWriterBatch : public leveldb::WriteBatch::Handler
 {
 public:
+	struct Entry
+	{
+		Slice key;
+		bool deleted;
+		Slice value;
+	};
 
 	virtual void Put(leveldb::Slice const& _key, leveldb::Slice const& _value)
 	{
-		leveldb::OdbcWriteStruct odbcWrite(_key, _value);
-		//std::cout << "LMYSQL write "  << _key.ToString() << "|" << _value.ToString() << std::endl;
-		//std::cout << "LMYSQL write hex " << odbcWrite._sKey << "|" << odbcWrite._sValue << std::endl;
-
-		_vData.push_back(odbcWrite);
+		note(Entry{_key, false, _value});
 	}
 
 	virtual void Delete(leveldb::Slice const& _key)
 	{
-		std::cout << "Delete" << _key.ToString();
-		//cnote << "Delete" << _key.ToString();
+		note(Entry{_key, true, Slice()});
 	}
 
+	bool empty() const { return _vData.empty(); }
+
 	virtual void setCache(Cache *cc){
 		if (cc == nullptr)
 		{
 			return;
 		}
-		
-		for (auto data : _vData)
+
+		for (auto const& data : _vData)
 		{
-			std::string sHex = toHex(dev::bytesConstRef(data._sValue));
-			char *cstr = new char[sHex.size() + 1];
-			strcpy(cstr, sHex.c_str());
-			cc->Release(cc->Insert(data._sKey, EncodeValue(cstr), sHex.size(), &Deleter));
+			if (data.deleted)
+				cc->Erase(data.key);
+			else
+				insertCache(cc, data.key, data.value.ToString());
 		}
 	}
 
-	std::string toWriteSqlString(std::string tableName)
+	//在conn上执行整批写入，由调用方提交
+	void execute(MysqlConn &conn, const std::string &tableName)
 	{
-		if (_vData.size() == 0)
+		std::vector<const Entry*> vPuts;
+		std::vector<const Entry*> vDeletes;
+		for (auto const& data : _vData)
+			(data.deleted ? vDeletes : vPuts).push_back(&data);
+
+		for (size_t iFrom = 0; iFrom < vDeletes.size(); iFrom += LMysql::c_rowsPerDelete)
 		{
-			return "";
+			size_t iRows = std::min(vDeletes.size() - iFrom, (size_t)LMysql::c_rowsPerDelete);
+			SACommand cmd(&conn.con, SAString(placeholders("delete from " + tableName + " where s_key in (", iRows, 1).c_str()));
+			for (size_t i = 0; i < iRows; ++i)
+				cmd.Param(i + 1).setAsString() = hexParam(vDeletes[iFrom + i]->key);
+			cmd.Execute();
 		}
 
-		std::string retSql = "replace into " + tableName + " ( s_key,s_value) values ";
-		int i = 0;
-		for (auto data : _vData)
+		size_t i = 0;
+		//整块的用预编译好的语句，余下的单独拼一条
+		for (; i + LMysql::c_rowsPerUpsert <= vPuts.size(); i += LMysql::c_rowsPerUpsert)
+		{
+			if (!conn.upsert)
+			{
+				conn.upsert.reset(new SACommand(&conn.con, SAString(upsertSql(tableName, LMysql::c_rowsPerUpsert).c_str())));
+				conn.upsert->Prepare();
+			}
+			bind(*conn.upsert, vPuts, i, LMysql::c_rowsPerUpsert);
+			conn.upsert->Execute();
+		}
+		if (i < vPuts.size())
+		{
+			SACommand cmd(&conn.con, SAString(upsertSql(tableName, vPuts.size() - i).c_str()));
+			bind(cmd, vPuts, i, vPuts.size() - i);
+			cmd.Execute();
+		}
+	}
+
+private:
+	//同一个key以最后一次操作为准
+	void note(Entry const &entry)
+	{
+		std::string sKey = entry.key.ToString();
+		auto it = _index.find(sKey);
+		if (it != _index.end())
+		{
+			_vData[it->second] = entry;
+			return;
+		}
+		_index[sKey] = _vData.size();
+		_vData.push_back(entry);
+	}
+
+	//prefix后接iRows组参数：单列为:1,:2...)，多列为(:1,:2),(:3,:4)...
+	static std::string placeholders(std::string const& prefix, size_t iRows, int iCols)
+	{
+		std::string sql = prefix;
+		int n = 1;
+		for (size_t r = 0; r < iRows; ++r)
 		{
-			if (i > 0)
+			if (iCols == 1)
 			{
-				retSql += ",";
+				sql += (r ? ",:" : ":") + std::to_string(n++);
+				continue;
 			}
+			sql += r ? ",(" : "(";
+			for (int c = 0; c < iCols; ++c)
+				sql += (c ? ",:" : ":") + std::to_string(n++);
+			sql += ")";
+		}
+		return iCols == 1 ? sql + ")" : sql;
+	}
 
-			retSql += " ('" + toHex(dev::bytesConstRef(data._sKey)) + "','" + toHex(dev::bytesConstRef(data._sValue)) + "')";
-			i++;
+	static std::string upsertSql(std::string const& tableName, size_t iRows)
+	{
+		return placeholders("replace into " + tableName + " (s_key,s_value) values ", iRows, 2);
+	}
+
+	static void bind(SACommand &cmd, std::vector<const Entry*> const& vPuts, size_t iFrom, size_t iRows)
+	{
+		for (size_t r = 0; r < iRows; ++r)
+		{
+			cmd.Param(2 * r + 1).setAsString() = hexParam(vPuts[iFrom + r]->key);
+			cmd.Param(2 * r + 2).setAsString() = hexParam(vPuts[iFrom + r]->value);
 		}
-		
-		retSql += ";";
-	    //std::cout << "write sql is " << retSql <<std::endl;
-		//ctrace << "write sql is " << retSql;
-		return retSql;
 	}
 
+	std::vector<Entry> _vData;
+	std::unordered_map<std::string, size_t> _index;
+};
+
+//按key顺序分页读取整表
+class MysqlIterator : public leveldb::Iterator
+{
+public:
+	explicit MysqlIterator(LMysql *db): _db(db) {}
+
+	virtual bool Valid() const override { return _iPos < _vRows.size(); }
+	virtual void SeekToFirst() override { load("", true, true); }
+	virtual void SeekToLast() override { load("", true, false); }
+	virtual void Seek(const Slice& target) override { load(toHex(dev::bytesConstRef(target)), true, true); }
+
+	virtual void Next() override { step(true); }
+	virtual void Prev() override { step(false); }
+
+	virtual Slice key() const override { return Slice(_vRows[_iPos].first); }
+	virtual Slice value() const override { return Slice(_vRows[_iPos].second); }
+	virtual Status status() const override { return _status; }
+
 private:
-	std::vector<leveldb::OdbcWriteStruct> _vData;
+	void step(bool bForward)
+	{
+		std::string sFromHex = toHex(dev::bytesConstRef(key()));
+		if (bForward == _bForward)
+		{
+			if (++_iPos < _vRows.size())
+				return;
+			//最后一页不满说明已到表尾（或表头）
+			if (_vRows.size() < (size_t)c_pageSize)
+				return;
+		}
+		load(sFromHex, false, bForward);
+	}
+
+	void load(std::string const& sFromHex, bool bInclusive, bool bForward)
+	{
+		_bForward = bForward;
+		_iPos = 0;
+		std::vector<std::pair<std::string, std::string>> vRows;
+		_status = _db->scan(sFromHex, bInclusive, bForward, c_pageSize, vRows);
+		_vRows.clear();
+		for (auto const& row : vRows)
+			_vRows.emplace_back(asString(fromHex(row.first)), asString(fromHex(row.second)));
+	}
+
+	static const int c_pageSize = 256;
+
+	LMysql *_db;
+	std::vector<std::pair<std::string, std::string>> _vRows;
+	size_t _iPos = 0;
+	bool _bForward = true;
+	Status _status;
 };
 
-LMysql::LMysql(const std::string &sDbConnInfo, const std::string &sDbName, const std::string &sTableName, const std::string &sUserName, const std::string &sPwd, int iCacheSize)
+LMysql::LMysql(const std::string &sDbConnInfo, const std::string &sDbName, const std::string &sTableName, const std::string &sUserName, const std::string &sPwd, int iCacheSize, int iPoolSize)
 :LvlDbInterface(sDbConnInfo, sDbName, sTableName, sUserName, sPwd, DBEngineType::mysql, iCacheSize)
 {
-	std::cout << "MYsql init success.";
+	for (int i = 0; i < std::max(1, iPoolSize); ++i)
+	{
+		std::unique_ptr<MysqlConn> conn(new MysqlConn);
+		if (!LvlDbInterface::Connect(conn->con, SA_AutoCommitOff))
+			BOOST_THROW_EXCEPTION(dev::eth::DatabaseConnectFailed() << errinfo_comment("mysql pool connect failed: " + sTableName));
+		_vIdle.push_back(std::move(conn));
+	}
+	std::cout << "MYsql init success. pool:" << _vIdle.size();
 	//ctrace << "MYsql init success.";
 }
 
-Status LMysql::Delete(const WriteOptions& , const Slice& key)
+std::unique_ptr<MysqlConn> LMysql::acquire()
 {
-	std::cout << "mysql delete " << key.ToString();
-	//ctrace << "mysql delete " << key.ToString();
+	std::unique_lock<std::mutex> l(_poolLock);
+	_poolSignal.wait(l, [this]() { return !_vIdle.empty(); });
+	std::unique_ptr<MysqlConn> conn = std::move(_vIdle.back());
+	_vIdle.pop_back();
+	return conn;
+}
 
-	Status s;
-	_dataCc->Erase(key);
-	return s;
+void LMysql::release(std::unique_ptr<MysqlConn> conn, bool bBroken)
+{
+	if (bBroken)
+	{
+		//预编译语句随连接一起失效
+		conn->upsert.reset();
+		conn->select.reset();
+		try
+		{
+			if (conn->con.isConnected())
+				conn->con.Disconnect();
+		}
+		catch (SAException &) {}
+		LvlDbInterface::Connect(conn->con, SA_AutoCommitOff);
+	}
+	{
+		std::lock_guard<std::mutex> l(_poolLock);
+		_vIdle.push_back(std::move(conn));
+	}
+	_poolSignal.notify_one();
+}
+
+Status LMysql::Delete(const WriteOptions& opt, const Slice& key)
+{
+	leveldb::WriteBatch batch;
+	batch.Delete(key);
+
+	return Write(opt, &batch);
 }
 
 Status LMysql::Write(const WriteOptions& , WriteBatch* batch)
 {
-	leveldb::Status s = Status::Corruption("batch write");
-	bool bSucc = false;
-	int iTryTimes = 0;
-	do
+	MysqlWriterBatch n;
+	batch->Iterate(&n);
+	if (n.empty())
+	{
+		return Status::OK();
+	}
+
+	for (int iTryTimes = 0; iTryTimes <= c_maxRetries; ++iTryTimes)
 	{
+		std::unique_ptr<MysqlConn> conn = acquire();
 		try
 		{
-			MysqlWriterBatch n;
-			batch->Iterate(&n);
+			//整批在一个事务里提交，和leveldb的WriteBatch一样要么全部生效要么都不生效
+			n.execute(*conn, _sTableName);
+			conn->con.Commit();
+			release(std::move(conn));
 
-			std::string sql = n.toWriteSqlString(_sTableName);
-			if (sql == "")
 			{
-				//std::cout << "there is no data in write batch." << std::endl;
-				return Status::OK();
+				std::lock_guard<std::mutex> l(_cacheLock);
+				++_iWriteSeq;
+				n.setCache(_dataCc);
 			}
-
-			SACommand cmd(&con);
-			SAString saSql(sql.c_str());
-			cmd.setCommandText(saSql);
-
-			cmd.Execute();
-			con.Commit();
-
-			n.setCache(_dataCc);
-			s = Status::OK();
-			bSucc = true;
+			return Status::OK();
 		}
 		catch (SAException &x)
 		{
-			//DB�쳣 sleep 50ms Ȼ���������
-			sleep(50);
-			// print error message
-			std::cerr << "SAException: " << x.ErrText().GetMultiByteChars() << std::endl;
-			// д����
-			//��ʱ�����������ʧ����� �����쳣��δ����
-			if (x.ErrNativeCode() == CR_SERVER_LOST || x.ErrNativeCode() == CR_SERVER_GONE_ERROR)
+			bool bLost = isConnectionLost(x);
+			std::cerr << "SAException: writeData " << iTryTimes << "|" << x.ErrText().GetMultiByteChars() << "|" << x.ErrNativeCode() << std::endl;
+			if (!bLost)
 			{
-				if (con.isConnected())
-				{
-					con.Disconnect();
-				}
-
-				LvlDbInterface::Connect();
-				std::cout << "SAException: lostServer  writeData��" << iTryTimes << "|" << x.ErrText().GetMultiByteChars() << "|" << x.ErrNativeCode() << std::endl;
-				continue;
-			}
-			else{
-				std::cout << "SAException: other reason  writeData��" << iTryTimes << "|" << x.ErrText().GetMultiByteChars() << "|" << x.ErrNativeCode() << std::endl;
-
+				try { conn->con.Rollback(); } catch (SAException &) { bLost = true; }
 			}
-			iTryTimes++;
-
+			release(std::move(conn), bLost);
+			//DB异常 sleep 50ms 然后重试
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
 		}
 		catch (std::exception& e){
-			//todo �����쳣�Ƿ�ֱ���˳����迼��
 			std::cerr << "exception: " << e.what() << std::endl;
+			release(std::move(conn), true);
 			break;
 		}
-		catch (...){
-			//todo �����쳣�Ƿ�ֱ���˳����迼��
-			std::cerr << "unknown exception occured" << std::endl;
-			break;
-		}
-
-	} while (!bSucc && iTryTimes <= 3);
-	return s;
+	}
+	return Status::IOError("mysql write");
 }
 
 Status LMysql::Get(const ReadOptions& , const Slice& key, std::string* value)
 {
+	Cache::Handle *handle = _dataCc->Lookup(key);
+	if (handle != NULL)
+	{
+		*value = *reinterpret_cast<std::string*>(_dataCc->Value(handle));
+		_dataCc->Release(handle);
+		return Status::OK();
+	}
 
-	leveldb::Status s = leveldb::Status::NotFound("get");
-	ostringstream ossql;
-	try
+	uint64_t iReadSeq = 0;
 	{
-		Cache::Handle *handle = _dataCc->Lookup(key);
-		if (handle == NULL) {
+		std::lock_guard<std::mutex> l(_cacheLock);
+		iReadSeq = _iWriteSeq;
+	}
+
+	for (int iTryTimes = 0; iTryTimes <= c_maxRetries; ++iTryTimes)
+	{
+		std::unique_ptr<MysqlConn> conn = acquire();
+		try
+		{
+			if (!conn->select)
+			{
+				conn->select.reset(new SACommand(&conn->con, SAString(("select s_value from " + _sTableName + " where s_key = :1").c_str())));
+				conn->select->Prepare();
+			}
+			conn->select->Param(1).setAsString() = hexParam(key);
+			conn->select->Execute();
 
-			//��ռλ�� �ַ����滻
-			bool bBreak=false;
 			bool bFind = false;
-			int iTryTimes = 0;
-			do{
-				try{
-					ossql << "select s_value from " << _sTableName << " where s_key = '" << toHex(bytesConstRef(key)) << "';";
-					SACommand cmd(&con);
-					SAString saSql(ossql.str().c_str());
-					cmd.setCommandText(saSql);
-					cmd.Execute();
-					//std::cout << "LMysql DB querysql GET: " << ossql.str() << std::endl;
-
-					while (cmd.FetchNext())
-					{
-						bFind = true;
-						// ���һ���ֶ�
-						for (int i = 1; i <= cmd.FieldCount(); ++i)
-						{
-							*value = cmd[i].asString();
-							//	std::cout << (const char*)cmd[i].Name() << "|" << (const char*)cmd[i].asBytes() << "|" << *value << endl;
-						}
-					}
-					bBreak = true;
-				}
-				catch (SAException &x)
-				{
-					sleep(100);
-					std::cout << "SAException: get data " << ossql.str() << "|" << x.ErrText().GetMultiByteChars() << "|" << x.ErrNativeCode() << std::endl;
-					iTryTimes++;
-					//�����������ϣ���Ҫ������������
-					if (x.ErrNativeCode() == CR_SERVER_LOST || x.ErrNativeCode() == CR_SERVER_GONE_ERROR)
-					{
-						if (con.isConnected())
-						{
-							con.Disconnect();
-						}
-						
-						LvlDbInterface::Connect();
-						std::cout << "SAException: lostServer  getData: " <<iTryTimes << "|" << ossql.str() << "|" << x.ErrText().GetMultiByteChars() << "|" << x.ErrNativeCode()  << std::endl;
-						
-						continue;
-					}
-					else{
-						
-						//�����쳣��֪��ô�����Ƿ�OK
-						if (con.isConnected())
-						{
-							con.Disconnect();
-						}
-
-						LvlDbInterface::Connect();
-						std::cout << "SAException: mysql other reason. getData: " << iTryTimes << "|" << ossql.str() << "|" << x.ErrText().GetMultiByteChars() << "|" << x.ErrNativeCode() << std::endl;
-
-					}
-				}
-				catch (std::exception& e){
-					//todo �����쳣�Ƿ�ֱ���˳����迼��
-					std::cout << "exception: " << e.what() << std::endl;
-					break;
-				}
-				catch (...){
-					//todo �����쳣�Ƿ�ֱ���˳����迼��
-					std::cout << "unknown exception occured" << std::endl;
-					break;
-				}
-				//std::cout << " LMYSQL GET end :" << bFind << " |" << toHex(bytesConstRef(key)) << "|" << *value << endl;
-			} while (!bBreak && iTryTimes <= 3);
+			while (conn->select->FetchNext())
+			{
+				bFind = true;
+				*value = asString(fromHex(fieldString(conn->select->Field(1))));
+			}
+			//结束读事务，否则之后读到的一直是旧快照
+			conn->con.Commit();
+			release(std::move(conn));
 
 			if (bFind)
 			{
-				char *cstr = new char[value->size() + 1];
-				strcpy(cstr, value->c_str());
-				//����骸�free
-				_dataCc->Release(_dataCc->Insert(key, EncodeValue(cstr), value->size(), &Deleter));
-				*value = asString(fromHex(*value));
+				//期间有Write提交过，读到的值可能已被覆盖，不能放进cache
+				std::lock_guard<std::mutex> l(_cacheLock);
+				if (_iWriteSeq == iReadSeq)
+					insertCache(_dataCc, key, *value);
 			}
-		
-			s = Status::OK();
+			return Status::OK();
 		}
-		else{
-			//std::cout << "LMYSQL CAHCE HAS DATA " << toHex(dev::bytesConstRef(key)) << std::endl;
-			char * ch = reinterpret_cast<char *>(_dataCc->Value(handle));
-			*value = ch;
-			_dataCc->Release(handle);
-			//std::cout << "LMYSQL GET datacache is hex data is : " << toHex(dev::bytesConstRef(key)) << "|" << ch << "|" << value <<"|" << value->size()<< std::endl;
-			//std::cout << "LMYSQL GET datacache is " << key.ToString() << "|" << *value << std::endl;
-			*value = asString(fromHex(*value));
-
+		catch (SAException &x)
+		{
+			std::cout << "SAException: get data " << toHex(bytesConstRef(key)) << "|" << x.ErrText().GetMultiByteChars() << "|" << x.ErrNativeCode() << std::endl;
+			release(std::move(conn), true);
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+		catch (std::exception& e){
+			std::cout << "exception: " << e.what() << std::endl;
+			release(std::move(conn), true);
+			break;
 		}
 	}
-	catch (SAException &x)
-	{
-		std::cout << "SAException: get data " << ossql.str() << "|" << x.ErrText().GetMultiByteChars() << "|" << x.ErrNativeCode ()<< std::endl;
-	}
-	catch (std::exception& e){
-		std::cout << "exception: " << e.what() << std::endl;
-	}
-	catch (...){
-		std::cout << "unknown exception occured" << std::endl;
-	}
-
-	return s;
+	return Status::IOError("mysql get");
 }
 
 
@@ -316,4 +416,43 @@ Status  LMysql::Put(const WriteOptions& opt, const Slice& key, const Slice& valu
 	batch.Put(key, value);
 
 	return Write(opt, &batch);
-}
\ No newline at end of file
+}
+
+Iterator* LMysql::NewIterator(const ReadOptions&)
+{
+	return new MysqlIterator(this);
+}
+
+Status LMysql::scan(const std::string &sFromHex, bool bInclusive, bool bForward, int iLimit, std::vector<std::pair<std::string, std::string>> &vRows)
+{
+	std::string sql = "select s_key,s_value from " + _sTableName;
+	if (!sFromHex.empty())
+		sql += std::string(" where s_key ") + (bForward ? ">" : "<") + (bInclusive ? "=" : "") + " :1";
+	sql += std::string(" order by s_key ") + (bForward ? "asc" : "desc") + " limit " + std::to_string(iLimit);
+
+	for (int iTryTimes = 0; iTryTimes <= c_maxRetries; ++iTryTimes)
+	{
+		vRows.clear();
+		std::unique_ptr<MysqlConn> conn = acquire();
+		try
+		{
+			SACommand cmd(&conn->con, SAString(sql.c_str()));
+			if (!sFromHex.empty())
+				cmd.Param(1).setAsString() = SAString(sFromHex.c_str(), sFromHex.size());
+			cmd.Execute();
+			while (cmd.FetchNext())
+				vRows.emplace_back(fieldString(cmd.Field(1)), fieldString(cmd.Field(2)));
+			conn->con.Commit();
+			release(std::move(conn));
+			return Status::OK();
+		}
+		catch (SAException &x)
+		{
+			std::cout << "SAException: scan " << x.ErrText().GetMultiByteChars() << "|" << x.ErrNativeCode() << std::endl;
+			release(std::move(conn), true);
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+	}
+	vRows.clear();
+	return Status::IOError("mysql scan");
+}
@@ -23,21 +23,55 @@
 
 #pragma once
 #include "LvlDbInterface.h"
+#include <condition_variable>
+#include <mutex>
 using namespace leveldb;
 
 namespace leveldb{
+	//一条连接及其上预编译的语句
+	struct MysqlConn
+	{
+		SAConnection con;
+		std::unique_ptr<SACommand> upsert;		//按c_rowsPerUpsert行预编译的replace
+		std::unique_ptr<SACommand> select;
+	};
+
 	class LMysql : public LvlDbInterface
 	{
 	public:
-		LMysql(const std::string &sDbConnInfo, const std::string &sDbName, const std::string &sTableName, const std::string &sUserName, const std::string &sPwd, int iCacheSize = 100 * 1048576);
+		LMysql(const std::string &sDbConnInfo, const std::string &sDbName, const std::string &sTableName, const std::string &sUserName, const std::string &sPwd, int iCacheSize = 100 * 1048576, int iPoolSize = 4);
 
 		virtual Status Delete(const WriteOptions&, const Slice& key) override;
 		virtual Status Write(const WriteOptions& options, WriteBatch* updates) override;
 		virtual Status Get(const ReadOptions& options, const Slice& key, std::string* value) override;
 		virtual Status Put(const WriteOptions& opt, const Slice& key, const Slice& value) override;
+		//按key顺序分页遍历整表，不是快照：遍历过程中的写入可能可见
+		virtual Iterator* NewIterator(const ReadOptions&) override;
 
 		LMysql(){}
 		~LMysql(){}
+
+		//从连接池取一条连接，没有空闲时等待
+		std::unique_ptr<MysqlConn> acquire();
+		//归还连接。bBroken为true时先重连
+		void release(std::unique_ptr<MysqlConn> conn, bool bBroken = false);
+
+		//从sFromHex起（bInclusive是否包含）按key升序或降序取最多iLimit行，sFromHex为空时从头/尾开始
+		Status scan(const std::string &sFromHex, bool bInclusive, bool bForward, int iLimit, std::vector<std::pair<std::string, std::string>> &vRows);
+
+		static const int c_rowsPerUpsert = 128;		//每条replace语句写入的行数
+		static const int c_rowsPerDelete = 1024;	//每条delete语句删除的行数，单条语句的占位符数有上限
+		static const int c_maxRetries = 3;
+
+	private:
+		std::mutex _poolLock;
+		std::condition_variable _poolSignal;
+		std::vector<std::unique_ptr<MysqlConn>> _vIdle;
+
+		//Get回填cache和Write更新cache互斥；_iWriteSeq在每次Write更新cache时加一，
+		//Get读库前后序号不同说明读到的可能是旧值，不回填
+		std::mutex _cacheLock;
+		uint64_t _iWriteSeq = 0;
 	};
 
-}
\ No newline at end of file
+}
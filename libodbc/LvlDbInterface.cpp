@@ -78,11 +78,12 @@ LvlDbInterface* LvlDbInterfaceFactory::create(int dbUseType)
 	}
 
 	int	iCacheSize = dbTypeObj["cacheSize"].get_int();
+	int iPoolSize = dbTypeObj.count("poolSize") ? dbTypeObj["poolSize"].get_int() : 4;
 
-	return create(sDbInfo, sDbName, sTableName, sUserName, sPwd, iDbEngineType, iCacheSize);
+	return create(sDbInfo, sDbName, sTableName, sUserName, sPwd, iDbEngineType, iCacheSize, iPoolSize);
 }
 
-LvlDbInterface* LvlDbInterfaceFactory::create(const std::string &sDbInfo, const std::string &sDbName, const std::string &sTableName, const std::string &username, const std::string &pwd, int dbEngineType, int iCacheSize)
+LvlDbInterface* LvlDbInterfaceFactory::create(const std::string &sDbInfo, const std::string &sDbName, const std::string &sTableName, const std::string &username, const std::string &pwd, int dbEngineType, int iCacheSize, int iPoolSize)
 {
 
 	LvlDbInterface *pLvlDb = nullptr;
@@ -90,7 +91,7 @@ LvlDbInterface* LvlDbInterfaceFactory::create(const std::string &sDbInfo, const
 	{
 	case DBEngineType::mysql:
 	{
-		pLvlDb	= new LMysql(sDbInfo, sDbName, sTableName, username, pwd, iCacheSize);
+		pLvlDb	= new LMysql(sDbInfo, sDbName, sTableName, username, pwd, iCacheSize, iPoolSize);
 	}
 		break;
 	case DBEngineType::oracle:
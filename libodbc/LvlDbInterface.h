@@ -97,6 +97,11 @@ namespace leveldb{
 		}
 
 		virtual bool Connect()
+		{
+			return Connect(con, SA_AutoCommitOn);
+		}
+
+		bool Connect(SAConnection &saCon, SAAutoCommit_t eAutoCommit)
 		{
 			bool bRet = true;
 			try
@@ -105,11 +110,11 @@ namespace leveldb{
 				SAString saDbUser(_sUserName.c_str());
 				SAString saDbPwd(_sPwd.c_str());
 
-				con.Connect(saDbInfo, saDbUser, saDbPwd, _saClient);
+				saCon.Connect(saDbInfo, saDbUser, saDbPwd, _saClient);
 							
-				con.setOption(SAString("MYSQL_OPT_READ_TIMEOUT")) = SAString("1");
-				con.setOption(SAString("MYSQL_OPT_CONNECT_TIMEOUT")) = SAString("86400");
-				con.setAutoCommit(SA_AutoCommitOn);
+				saCon.setOption(SAString("MYSQL_OPT_READ_TIMEOUT")) = SAString("1");
+				saCon.setOption(SAString("MYSQL_OPT_CONNECT_TIMEOUT")) = SAString("86400");
+				saCon.setAutoCommit(eAutoCommit);
 //				std::cout << "conn GetServerVersionString() :" << con.ServerVersionString().GetMultiByteChars() << std::endl;
 			}
 			catch (SAException &x){
@@ -188,7 +193,7 @@ namespace leveldb{
 	class LvlDbInterfaceFactory{
 	public:
 		//static std::shared_ptr<LvlDbInterface> create(const std::string &sDbInfo, const std::string &sDbName, const std::string &sTableName, const std::string &username, const std::string &pwd);
-		static LvlDbInterface* create(const std::string &sDbInfo, const std::string &sDbName, const std::string &sTableName, const std::string &username, const std::string &pwd, int dbEngineType, int iCacheSize = 100 * 1048576);
+		static LvlDbInterface* create(const std::string &sDbInfo, const std::string &sDbName, const std::string &sTableName, const std::string &username, const std::string &pwd, int dbEngineType, int iCacheSize = 100 * 1048576, int iPoolSize = 4);
 		static LvlDbInterface* create(int dbType);
 	};
 
@@ -29,7 +29,9 @@ using namespace dev;
 using namespace dev::p2p;
 
 Capability::Capability(std::shared_ptr<SessionFace> _s, HostCapabilityFace* _h, unsigned _idOffset, uint16_t _protocolID):
-	c_protocolID(_protocolID), m_session(_s), m_hostCap(_h), m_idOffset(_idOffset)
+	c_protocolID(_protocolID), m_session(_s), m_hostCap(_h), m_idOffset(_idOffset),
+	m_bytesIn(metrics::counter("fisco_p2p_bytes_total", "P2P payload bytes per capability", "cap=\"" + _h->name() + "\",dir=\"in\"")),
+	m_bytesOut(metrics::counter("fisco_p2p_bytes_total", "P2P payload bytes per capability", "cap=\"" + _h->name() + "\",dir=\"out\""))
 {
 	LOG(INFO) << "New session for capability" << m_hostCap->name() << "; idOffset:" << m_idOffset << "; protocolID:" << c_protocolID;
 }
@@ -49,7 +51,10 @@ void Capability::sealAndSend(RLPStream& _s)
 {
 	shared_ptr<SessionFace> session = m_session.lock();
 	if (session)
+	{
+		m_bytesOut.add(_s.out().size());
 		session->sealAndSend(_s, c_protocolID);
+	}
 }
 
 void Capability::addRating(int _r)
@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <libdevcore/Metrics.h>
 #include "Common.h"
 #include "HostCapability.h"
 
@@ -64,6 +65,8 @@ private:
 	HostCapabilityFace* m_hostCap;
 	bool m_enabled = true;
 	unsigned m_idOffset;
+	metrics::Counter& m_bytesIn;	///< Received by all sessions of this capability.
+	metrics::Counter& m_bytesOut;
 };
 
 }
@@ -56,6 +56,8 @@ protected:
 	virtual u256 version() const = 0;
 	CapDesc capDesc() const { return std::make_pair(name(), version()); }
 	virtual unsigned messageCount() const = 0;
+	/// Consensus traffic is written ahead of sync and transaction packets on every session.
+	virtual bool isConsensus() const { return false; }
 	virtual std::shared_ptr<Capability> newPeerCapability(std::shared_ptr<SessionFace> const& _s, unsigned _idOffset, CapDesc const& _cap, uint16_t _capID) = 0;
 
 	virtual void onStarting() {}
@@ -183,7 +183,11 @@ void RLPXFrameCoder::writeFrame(RLPStream const& _header, bytesConstRef _payload
 	egressDigest().ref().copyTo(bytesRef(&headerWithMac).cropped(h128::size,h128::size));
 
 	auto padding = (16 - (_payload.size() % 16)) % 16;
-	o_bytes.swap(headerWithMac);
+	// Keep o_bytes' storage (callers pool it) unless the payload is being framed in place.
+	if (_payload.overlapsWith(bytesConstRef(&o_bytes)))
+		o_bytes.swap(headerWithMac);
+	else
+		o_bytes.assign(headerWithMac.begin(), headerWithMac.end());
 	o_bytes.resize(32 + _payload.size() + padding + h128::size);
 	bytesRef packetRef(o_bytes.data() + 32, _payload.size());
 	m_impl->frameEnc.ProcessData(packetRef.data(), _payload.data(), _payload.size());
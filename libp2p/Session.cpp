@@ -33,6 +33,16 @@ using namespace std;
 using namespace dev;
 using namespace dev::p2p;
 
+namespace
+{
+/// Bounds on how much one write() hands to the socket, so a backlog of bulk packets can't stall the consensus lane for long.
+static const size_t c_maxCoalescedPackets = 64;
+static const size_t c_maxCoalescedBytes = 256 * 1024;
+/// Frame buffers are recycled up to this count and capacity; larger ones (block sync) go back to the allocator.
+static const size_t c_framePoolSize = 64;
+static const size_t c_maxPooledFrame = 64 * 1024;
+}
+
 Session::Session(Host* _h, unique_ptr<RLPXFrameCoder>&& _io, std::shared_ptr<RLPXSocket> const& _s, std::shared_ptr<Peer> const& _n, PeerSessionInfo _info):
 	m_server(_h),
 	m_io(move(_io)),
@@ -134,13 +144,19 @@ bool Session::readPacket(uint16_t _capId, PacketType _t, RLP const& _r)
 		{
 			for (auto const& i : m_capabilities)
 				if (i.second->c_protocolID == _capId)
+				{
+					i.second->m_bytesIn.add(_r.actualSize() + 1);
 					return i.second->m_enabled ? i.second->interpret(_t, _r) : true;
+				}
 		}
 		else
 		{
 			for (auto const& i : m_capabilities)
 				if (_t >= (int)i.second->m_idOffset && _t - i.second->m_idOffset < i.second->hostCapability()->messageCount())
+				{
+					i.second->m_bytesIn.add(_r.actualSize() + 1);
 					return i.second->m_enabled ? i.second->interpret(_t - i.second->m_idOffset, _r) : true;
+				}
 		}
 
 		return false;
@@ -254,9 +270,10 @@ void Session::send(bytes&& _msg, uint16_t _protocolID)
 	{
 		DEV_GUARDED(x_framing)
 		{
-			m_writeQueue.push_back(std::move(_msg));
-			m_writeTimeQueue.push_back(utcTime());
-			doWrite = (m_writeQueue.size() == 1);
+			auto lane = m_consensusPackets[msg[0]] ? ConsensusLane : BulkLane;
+			m_writeQueue[lane].push_back(QueuedPacket{std::move(_msg), utcTime()});
+			doWrite = !m_writeActive;
+			m_writeActive = true;
 		}
 
 		if (doWrite)
@@ -266,19 +283,38 @@ void Session::send(bytes&& _msg, uint16_t _protocolID)
 
 void Session::write()
 {
-	bytes const* out = nullptr;
+	std::vector<ba::const_buffer> out;
 	u256 enter_time = 0;
 	DEV_GUARDED(x_framing)
 	{
-		m_io->writeSingleFramePacket(&m_writeQueue[0], m_writeQueue[0]);
-		out = &m_writeQueue[0];
-		enter_time = m_writeTimeQueue[0];
+		// Frames are sealed here, in wire order, since the egress cipher and MAC are stateful.
+		size_t size = 0;
+		for (auto& lane: m_writeQueue)
+			while (!lane.empty() && m_writing.size() < c_maxCoalescedPackets && size < c_maxCoalescedBytes)
+			{
+				bytes frame;
+				if (!m_framePool.empty())
+				{
+					frame.swap(m_framePool.back());
+					m_framePool.pop_back();
+				}
+				m_io->writeSingleFramePacket(&lane.front().packet, frame);
+				size += frame.size();
+				if (!enter_time || lane.front().enqueued < enter_time)
+					enter_time = lane.front().enqueued;
+				m_writing.push_back(std::move(frame));
+				lane.pop_front();
+			}
+
+		out.reserve(m_writing.size());
+		for (auto const& frame: m_writing)
+			out.push_back(ba::buffer(frame));
 	}
 	auto self(shared_from_this());
 	m_start_t = utcTime();
 	unsigned queue_elapsed = (unsigned)(m_start_t - enter_time);
 	if (queue_elapsed > 10) {
-		LOG(WARNING) << "Session::write queue-time=" << queue_elapsed;
+		LOG(WARNING) << "Session::write queue-time=" << queue_elapsed << ",packets=" << out.size();
 	}
 
 	auto asyncWrite = [this, self](boost::system::error_code ec, std::size_t length)
@@ -300,21 +336,30 @@ void Session::write()
 
 		DEV_GUARDED(x_framing)
 		{
-			m_writeQueue.pop_front();
-			m_writeTimeQueue.pop_front();
-			if (m_writeQueue.empty())
+			for (auto& frame: m_writing)
+				if (m_framePool.size() < c_framePoolSize && frame.capacity() <= c_maxPooledFrame)
+				{
+					frame.clear();
+					m_framePool.push_back(std::move(frame));
+				}
+			m_writing.clear();
+
+			if (m_writeQueue[ConsensusLane].empty() && m_writeQueue[BulkLane].empty())
+			{
+				m_writeActive = false;
 				return;
+			}
 		}
 		write();
 	};
 
 	if (m_socket->getSocketType() == SSL_SOCKET)
 	{
-		ba::async_write(m_socket->sslref(), ba::buffer(*out), asyncWrite);
+		ba::async_write(m_socket->sslref(), out, asyncWrite);
 	}
 	else
 	{
-		ba::async_write(m_socket->ref(), ba::buffer(*out), asyncWrite);
+		ba::async_write(m_socket->ref(), out, asyncWrite);
 	}
 }
 
@@ -652,6 +697,10 @@ void Session::registerCapability(CapDesc const& _desc, std::shared_ptr<Capabilit
 	DEV_GUARDED(x_framing)
 	{
 		m_capabilities[_desc] = _p;
+		// Without framing every capability owns a contiguous range of packet types after its offset.
+		if (!isFramingEnabled() && _p->hostCapability()->isConsensus())
+			for (unsigned i = 0; i < _p->hostCapability()->messageCount() && _p->m_idOffset + i < m_consensusPackets.size(); ++i)
+				m_consensusPackets.set(_p->m_idOffset + i);
 	}
 }
 
@@ -24,6 +24,7 @@
 
 #include <mutex>
 #include <array>
+#include <bitset>
 #include <deque>
 #include <set>
 #include <memory>
@@ -147,7 +148,8 @@ private:
 	/// Check error code after reading and drop peer if error code.
 	bool checkRead(std::size_t _expected, boost::system::error_code _ec, std::size_t _length);
 
-	/// Perform a single round of the write operation. This could end up calling itself asynchronously.
+	/// Frame as many queued packets as fit in one scatter-gather write, consensus lane first, and send them.
+	/// This could end up calling itself asynchronously.
 	void write();
 	void writeFrames();
 
@@ -164,9 +166,19 @@ private:
 
 	std::unique_ptr<RLPXFrameCoder> m_io;	///< Transport over which packets are sent.
 	std::shared_ptr<RLPXSocket> m_socket;		///< Socket of peer's connection.
+	struct QueuedPacket
+	{
+		bytes packet;
+		u256 enqueued;						///< utcTime() at send(), to stat queue time.
+	};
+	enum WriteLane { ConsensusLane = 0, BulkLane, WriteLaneCount };
+
 	Mutex x_framing;						///< Mutex for the write queue.
-	std::deque<bytes> m_writeQueue;			///< The write queue.
-	std::deque<u256> m_writeTimeQueue; ///< to stat queue time
+	std::array<std::deque<QueuedPacket>, WriteLaneCount> m_writeQueue;	///< The write queue, one per lane; lanes are drained in order.
+	std::vector<bytes> m_writing;			///< Frames of the write in flight; must outlive the async_write.
+	std::vector<bytes> m_framePool;			///< Spent frame buffers kept for their capacity.
+	bool m_writeActive = false;				///< True while a write() chain is running.
+	std::bitset<256> m_consensusPackets;	///< Packet types owned by consensus capabilities.
 	std::vector<byte> m_data;			    ///< Buffer for ingress packet data.
 	bytes m_incoming;						///< Read buffer for ingress bytes.
 
@@ -117,12 +117,19 @@ struct PBFTMsg {
 
 struct PrepareReq : public PBFTMsg {
 	bytes block;
-	virtual void streamRLPFields(RLPStream& _s) const {	PBFTMsg::streamRLPFields(_s); _s << block; }
+	bytes exec_hint;  // 可选，leader给出的并行执行提示(ParallelExecHint)，不参与签名
+	virtual void streamRLPFields(RLPStream& _s) const {
+		PBFTMsg::streamRLPFields(_s); _s << block;
+		if (!exec_hint.empty())
+			_s << exec_hint;
+	}
 	virtual void populate(RLP const& _rlp) {
 		PBFTMsg::populate(_rlp);
 		int field = 0;
 		try	{
 			block = _rlp[field = 7].toBytes();
+			if (!_rlp[8].isNull())  // 兼容不带提示的旧消息
+				exec_hint = _rlp[field = 8].toBytes();
 		} catch (Exception const& _e)	{
 			_e << errinfo_name("invalid msg format") << BadFieldError(field, toHex(_rlp[field].data().toBytes()));
 			throw;
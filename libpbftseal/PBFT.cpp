@@ -28,6 +28,7 @@
 #include <libethereum/BlockChain.h>
 #include <libethereum/EthereumHost.h>
 #include <libethereum/NodeConnParamsManagerApi.h>
+#include <libethereum/ParallelExecutor.h>
 #include <libdevcrypto/Common.h>
 #include "PBFT.h"
 #include <libdevcore/easylog.h>
@@ -143,6 +144,8 @@ void PBFT::resetConfig() {
 		m_f = (m_node_num - 1 ) / 3;
 
 		m_prepare_cache.clear();
+		m_next_raw_prepare_cache.clear();
+		m_next_prepare_cache.clear();
 		m_sign_cache.clear();
 		m_recv_view_change_req.clear();
 
@@ -168,12 +171,12 @@ StringHashMap PBFT::jsInfo(BlockHeader const& _bi) const
 	return { { "number", toJS(_bi.number()) }, { "timestamp", toJS(_bi.timestamp()) } };
 }
 
-bool PBFT::generateSeal(BlockHeader const& _bi, bytes const& _block_data, u256 &_view)
+bool PBFT::generateSeal(BlockHeader const& _bi, bytes const& _block_data, u256 &_view, bytes const& _exec_hint)
 {
 	Timer t;
 	Guard l(m_mutex);
 	_view = m_view;
-	if (!broadcastPrepareReq(_bi, _block_data)) {
+	if (!broadcastPrepareReq(_bi, _block_data, _exec_hint)) {
 		LOG(ERROR) << "broadcastPrepareReq failed, " << _bi.number() << _bi.hash(WithoutSeal);
 		return false;
 	}
@@ -202,7 +205,7 @@ bool PBFT::generateCommit(BlockHeader const& _bi, bytes const& _block_data, u256
 	req.sig2 = signHash(req.fieldsWithoutBlock());
 	req.block = _block_data;
 
-	if (addPrepareReq(req) && broadcastSignReq(req)) {
+	if (addPrepareReq(req) && broadcastSignReq(req) && req.height == m_consensus_block_number) {
 		checkAndCommit(); // 支持单节点可出块
 	}
 
@@ -244,6 +247,38 @@ bool PBFT::shouldSeal(Interface*)
 		return false;
 	}
 
+	// 本块已由流水线提前打包
+	if (m_raw_prepare_cache.height == m_consensus_block_number && m_raw_prepare_cache.view == m_view && m_raw_prepare_cache.idx == m_node_idx) {
+		return false;
+	}
+
+	return true;
+}
+
+bool PBFT::shouldPipelineSeal(h256 & _parent)
+{
+	Guard l(m_mutex);
+
+	if (!chainParams().pbftPipeline || m_cfg_err || m_account_type != EN_ACCOUNT_TYPE_MINER || m_view != 0) {
+		return false;
+	}
+
+	// 当前块已收齐签名，且下一块还未打包
+	if (m_committed_prepare_cache.height != m_consensus_block_number || m_prepare_cache.height != m_consensus_block_number
+		|| m_prepare_cache.view != m_view || m_next_raw_prepare_cache.height == m_consensus_block_number + 1) {
+		return false;
+	}
+
+	auto ret = getNextLeader();
+	if (!ret.first || ret.second != m_node_idx) {
+		return false;
+	}
+
+	if (!canPipelineOn(m_prepare_cache)) {
+		return false;
+	}
+
+	_parent = m_prepare_cache.block_hash;
 	return true;
 }
 
@@ -261,6 +296,7 @@ void PBFT::reHandlePrepareReq(PrepareReq const& _req) {
 	req.sig = signHash(req.block_hash);
 	req.sig2 = signHash(req.fieldsWithoutBlock());
 	req.block = _req.block;
+	req.exec_hint = _req.exec_hint;
 
 	LOG(INFO) << "BLOCK_TIMESTAMP_STAT:[" << toString(req.block_hash) << "][" << req.height << "][" <<  utcTime() << "][" << "broadcastPrepareReq" << "]";
 	RLPStream ts;
@@ -278,6 +314,72 @@ std::pair<bool, u256> PBFT::getLeader() const {
 	return std::make_pair(true, (m_view + m_highest_block.number()) % m_node_num);
 }
 
+// 当前块以m_view上链后，下一块的leader
+std::pair<bool, u256> PBFT::getNextLeader() const {
+	if (m_cfg_err || m_leader_failed || m_highest_block.number() == Invalid256) {
+		return std::make_pair(false, Invalid256);
+	}
+
+	return std::make_pair(true, (m_view + m_highest_block.number() + 1) % m_node_num);
+}
+
+// 父块含系统合约交易时，可能改变记账节点列表和权限，下一块须等其上链后再执行
+bool PBFT::canPipelineOn(PrepareReq const& _req) {
+	if (_req.block_hash == m_pipeline_checked) {
+		return m_pipeline_allowed;
+	}
+
+	m_pipeline_checked = _req.block_hash;
+	m_pipeline_allowed = false;
+	try {
+		RLP r(_req.block);
+		for (auto const& tr : r[1]) {
+			Transaction t(tr.data(), CheckTransaction::None);
+			if (!t.isCreation() && m_bc->isSystemContract(t.receiveAddress())) {
+				LOG(INFO) << "canPipelineOn: blk=" << _req.height << " calls system contract " << t.receiveAddress() << ", no pipeline";
+				return false;
+			}
+		}
+	} catch (Exception const& _e) {
+		LOG(WARNING) << "canPipelineOn: bad block, hash=" << _req.block_hash.abridged() << "," << _e.what();
+		return false;
+	}
+
+	m_pipeline_allowed = true;
+	return true;
+}
+
+// 当前块已在本地执行完毕时，leader提前发来的下一块
+bool PBFT::isPipelinedPrepare(PrepareReq const& _req) const {
+	return chainParams().pbftPipeline && m_view == 0 && _req.view == m_view && _req.height == m_consensus_block_number + 1
+		&& m_prepare_cache.height == m_consensus_block_number && m_prepare_cache.view == m_view;
+}
+
+// 当前块上链后，把流水线中的下一块转为正在共识的块
+void PBFT::promotePipelinedPrepare() {
+	if (m_next_raw_prepare_cache.height != m_consensus_block_number || m_next_prepare_cache.height != m_consensus_block_number
+		|| m_next_prepare_cache.view != m_view) {
+		m_next_raw_prepare_cache.clear();
+		m_next_prepare_cache.clear();
+		return;
+	}
+
+	PrepareReq raw = m_next_raw_prepare_cache;
+	PrepareReq req = m_next_prepare_cache;
+	m_next_raw_prepare_cache.clear();
+	m_next_prepare_cache.clear();
+
+	if (BlockHeader(req.block).parentHash() != m_highest_block.hash()) {
+		LOG(INFO) << "promotePipelinedPrepare: parent not on chain, discard blk=" << req.height << ",hash=" << req.block_hash.abridged();
+		return;
+	}
+
+	LOG(INFO) << "promotePipelinedPrepare: blk=" << req.height << ",hash=" << req.block_hash.abridged() << ",idx=" << req.idx;
+	addRawPrepare(raw);
+	addPrepareReq(req);
+	checkAndCommit(true); // 签名可能在上链前已收齐
+}
+
 void PBFT::reportBlock(BlockHeader const & _b, u256 const &) {
 	Guard l(m_mutex);
 
@@ -286,7 +388,8 @@ void PBFT::reportBlock(BlockHeader const & _b, u256 const &) {
 
 	m_highest_block = _b;
 
-	if (m_highest_block.number() >= m_consensus_block_number) {
+	bool new_block = m_highest_block.number() >= m_consensus_block_number;
+	if (new_block) {
 		m_view = m_to_view = m_change_cycle = 0;
 		m_leader_failed = false;
 		m_last_consensus_time = utcTime();
@@ -299,6 +402,10 @@ void PBFT::reportBlock(BlockHeader const & _b, u256 const &) {
 
 	delCache(m_highest_block.hash(WithoutSeal));
 
+	if (new_block) {
+		promotePipelinedPrepare();
+	}
+
 	LOG(INFO) << "^^^^^^^^^^^^^^^^^^^^^^^^^^^^^ Report: blk=" << m_highest_block.number() << ",hash=" << _b.hash(WithoutSeal).abridged() << ",idx=" << m_highest_block.genIndex() << ", Next: blk=" << m_consensus_block_number;
 	// onchain log
 	stringstream ss;
@@ -481,6 +588,11 @@ void PBFT::handleFutureBlock() {
 		LOG(INFO) << "handleFurtureBlock, blk=" << m_future_prepare_cache.second.height;
 		handlePrepareMsg(m_future_prepare_cache.first, m_future_prepare_cache.second);
 		m_future_prepare_cache = std::make_pair(Invalid256, PrepareReq());
+	} else if (isPipelinedPrepare(m_future_prepare_cache.second) && canPipelineOn(m_prepare_cache)) {
+		LOG(INFO) << "handleFurtureBlock pipelined, blk=" << m_future_prepare_cache.second.height;
+		auto future = m_future_prepare_cache;
+		m_future_prepare_cache = std::make_pair(Invalid256, PrepareReq());
+		handlePrepareMsg(future.first, future.second);
 	}
 }
 
@@ -578,7 +690,7 @@ bool PBFT::broadcastCommitReq(PrepareReq const & _req) {
 	return false;
 }
 
-bool PBFT::broadcastPrepareReq(BlockHeader const & _bi, bytes const & _block_data) {
+bool PBFT::broadcastPrepareReq(BlockHeader const & _bi, bytes const & _block_data, bytes const & _exec_hint) {
 	PrepareReq req;
 	req.height = _bi.number();
 	req.view = m_view;
@@ -588,6 +700,7 @@ bool PBFT::broadcastPrepareReq(BlockHeader const & _bi, bytes const & _block_dat
 	req.sig = signHash(req.block_hash);
 	req.sig2 = signHash(req.fieldsWithoutBlock());
 	req.block = _block_data;
+	req.exec_hint = _exec_hint;
 
 	RLPStream ts;
 	req.streamRLPFields(ts);
@@ -706,7 +819,7 @@ void PBFT::clearMask() {
 }
 
 bool PBFT::isExistPrepare(PrepareReq const & _req) {
-	return m_raw_prepare_cache.block_hash == _req.block_hash;
+	return m_raw_prepare_cache.block_hash == _req.block_hash || m_next_raw_prepare_cache.block_hash == _req.block_hash;
 }
 
 bool PBFT::isExistSign(SignReq const & _req) {
@@ -754,7 +867,14 @@ void PBFT::handlePrepareMsg(u256 const & _from, PrepareReq const & _req, bool _s
 		return;
 	}
 
-	if (_req.height > m_consensus_block_number || _req.view > m_view) {
+	// 流水线：当前块已在本地执行，下一块可在其基础上先执行
+	std::pair<Block, u256> parent = std::make_pair(Block(0), 0);
+	if (isPipelinedPrepare(_req) && canPipelineOn(m_prepare_cache)) {
+		parent = m_bc->getBlockCache(m_prepare_cache.block_hash);
+	}
+	bool pipelined = parent.second != 0;
+
+	if (!pipelined && (_req.height > m_consensus_block_number || _req.view > m_view)) {
 		LOG(INFO) << oss.str() << "Recv a future block, wait to be handled later";
 		recvFutureBlock(_from, _req);
 		return;
@@ -762,7 +882,7 @@ void PBFT::handlePrepareMsg(u256 const & _from, PrepareReq const & _req, bool _s
 
 	addRawPrepare(_req); // 必须在recvFutureBlock之后
 
-	auto leader = getLeader();
+	auto leader = pipelined ? getNextLeader() : getLeader();
 	if (!leader.first || _req.idx != leader.second) {
 		LOG(ERROR) << oss.str()  << "Recv an illegal prepare, err leader";
 		return;
@@ -780,8 +900,10 @@ void PBFT::handlePrepareMsg(u256 const & _from, PrepareReq const & _req, bool _s
 
 	LOG(TRACE) << "start exec tx, blk=" << _req.height << ",hash=" << _req.block_hash << ",idx=" << _req.idx << ", time=" << utcTime();
 	Block outBlock(*m_bc, *m_stateDB);
+	ParallelExecHint hint;
+	bool has_hint = hint.populate(&_req.exec_hint);
 	try {
-		m_bc->checkBlockValid(_req.block_hash, _req.block, outBlock);
+		m_bc->checkBlockValid(_req.block_hash, _req.block, outBlock, has_hint ? &hint : nullptr, pipelined ? &parent.first : nullptr);
 		if (outBlock.info().hash(WithoutSeal) != _req.block_hash) {  // 检验块数据是否被更改
 			LOG(ERROR) << oss.str() << ", block_hash is not equal to block";
 			return;
@@ -795,6 +917,10 @@ void PBFT::handlePrepareMsg(u256 const & _from, PrepareReq const & _req, bool _s
 
 	// 空块切换
 	if (outBlock.pending().size() == 0 && m_omit_empty_block) {
+		if (pipelined) { // 流水线不出空块，当前块还在共识中，不能切换视图
+			LOG(INFO) << oss.str() << "Discard an empty pipelined block";
+			return;
+		}
 		changeViewForEmptyBlockWithoutLock(_from);
 		// for empty block
 		stringstream ss;
@@ -842,9 +968,11 @@ void PBFT::handlePrepareMsg(u256 const & _from, PrepareReq const & _req, bool _s
 		//return;
 	}
 
-	LOG(INFO) << oss.str() << ",real_block_hash=" << outBlock.info().hash(WithoutSeal).abridged() << " success";
+	LOG(INFO) << oss.str() << ",real_block_hash=" << outBlock.info().hash(WithoutSeal).abridged() << (pipelined ? " pipelined" : "") << " success";
 
-	checkAndCommit();
+	if (!pipelined) {
+		checkAndCommit();
+	}
 
 	LOG(DEBUG) << "handlePrepareMsg, timecost=" << 1000 * t.elapsed();
 	return;
@@ -1036,10 +1164,11 @@ void PBFT::handleViewChangeMsg(u256 const & _from, ViewChangeReq const & _req) {
 	return;
 }
 
-void PBFT::checkAndSave() {
+// _recount: 块从流水线转正时，之前缓存的签名/commit数量可能已超过quorum
+void PBFT::checkAndSave(bool _recount) {
 	u256 have_sign = m_sign_cache[m_prepare_cache.block_hash].size();
 	u256 have_commit = m_commit_cache[m_prepare_cache.block_hash].size();
-	if (have_sign >= quorum() && have_commit == quorum()) {
+	if (have_sign >= quorum() && (have_commit == quorum() || (_recount && have_commit > quorum()))) {
 		LOG(INFO) << "######### Reach enough commit for block="  << m_prepare_cache.height << ",hash=" << m_prepare_cache.block_hash.abridged() << ",have_sign=" << have_sign << ",have_commit=" << have_commit << ",quorum=" << quorum();
 
 		if (m_prepare_cache.view != m_view) {
@@ -1073,9 +1202,9 @@ void PBFT::checkAndSave() {
 	}
 }
 
-void PBFT::checkAndCommit() {
+void PBFT::checkAndCommit(bool _recount) {
 	u256 have_sign = m_sign_cache[m_prepare_cache.block_hash].size();
-	if (have_sign == quorum()) { // 只发一次
+	if (have_sign == quorum() || (_recount && have_sign > quorum())) { // 只发一次
 		LOG(INFO) << "######### Reach enough sign for block=" << m_prepare_cache.height << ",hash=" << m_prepare_cache.block_hash.abridged() << ",have_sign=" << have_sign << ",need_sign=" << quorum();
 
 		if (m_prepare_cache.view != m_view) {
@@ -1095,7 +1224,7 @@ void PBFT::checkAndCommit() {
 
 		// reach sign log
 		PBFTFlowLog(m_highest_block.number() + m_view, " ");
-		checkAndSave();
+		checkAndSave(_recount);
 	}
 }
 
@@ -1111,6 +1240,8 @@ void PBFT::checkAndChangeView() {
 
 		m_raw_prepare_cache.clear();
 		m_prepare_cache.clear();
+		m_next_raw_prepare_cache.clear();
+		m_next_prepare_cache.clear();
 		m_sign_cache.clear();
 		m_commit_cache.clear();
 
@@ -1130,17 +1261,25 @@ void PBFT::checkAndChangeView() {
 }
 
 bool PBFT::addRawPrepare(PrepareReq const& _req) {
-	m_raw_prepare_cache = _req;
+	if (_req.height > m_consensus_block_number) { // 流水线中的下一块
+		m_next_raw_prepare_cache = _req;
+	} else {
+		m_raw_prepare_cache = _req;
+	}
 	return true;
 }
 
 bool PBFT::addPrepareReq(PrepareReq const & _req) {
-	m_prepare_cache = _req;
+	if (_req.height > m_consensus_block_number) { // 流水线中的下一块
+		m_next_prepare_cache = _req;
+	} else {
+		m_prepare_cache = _req;
+	}
 
-	auto sign_iter = m_sign_cache.find(m_prepare_cache.block_hash);
+	auto sign_iter = m_sign_cache.find(_req.block_hash);
 	if (sign_iter != m_sign_cache.end()) {
 		for (auto iter2 = sign_iter->second.begin(); iter2 != sign_iter->second.end();) {
-			if (iter2->second.view != m_prepare_cache.view) {
+			if (iter2->second.view != _req.view) {
 				iter2 = sign_iter->second.erase(iter2);
 			} else {
 				++iter2;
@@ -1148,10 +1287,10 @@ bool PBFT::addPrepareReq(PrepareReq const & _req) {
 		}
 	}
 
-	auto commit_iter = m_commit_cache.find(m_prepare_cache.block_hash);
+	auto commit_iter = m_commit_cache.find(_req.block_hash);
 	if (commit_iter != m_commit_cache.end()) {
 		for (auto iter2 = commit_iter->second.begin(); iter2 != commit_iter->second.end();) {
-			if (iter2->second.view != m_prepare_cache.view) {
+			if (iter2->second.view != _req.view) {
 				iter2 = commit_iter->second.erase(iter2);
 			} else {
 				++iter2;
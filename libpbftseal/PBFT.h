@@ -76,12 +76,14 @@ public:
 	void cancelGeneration() override { stopWorking(); }
 
 	void generateSeal(BlockHeader const& , bytes const& ) override {}
-	bool generateSeal(BlockHeader const& _bi, bytes const& _block_data, u256 &_view);
+	bool generateSeal(BlockHeader const& _bi, bytes const& _block_data, u256 &_view, bytes const& _exec_hint = bytes());
 	bool generateCommit(BlockHeader const& _bi, bytes const& _block_data, u256 const& _view);
 	void onSealGenerated(std::function<void(bytes const&)> const&) override {}
 	void onSealGenerated(std::function<void(bytes const&, bool)> const& _f)  { m_onSealGenerated = _f;}
 	void onViewChange(std::function<void()> const& _f) { m_onViewChange = _f; }
 	bool shouldSeal(Interface* _i) override;
+	// 流水线出块：当前块已收齐签名、等待commit时，若自己是下一块的leader，返回true，_parent为当前块（尚未上链）的hash
+	bool shouldPipelineSeal(h256 & _parent);
 
 	// should be called before start
 	void initEnv(std::weak_ptr<PBFTHost> _host, BlockChain* _bc, OverlayDB* _db, BlockQueue *bq, KeyPair const& _key_pair, unsigned _view_timeout);
@@ -113,13 +115,19 @@ private:
 	bool getMinerList(int _blk_no, h512s & _miner_list) const;
 
 	std::pair<bool, u256> getLeader() const;
+	std::pair<bool, u256> getNextLeader() const;
+
+	// 流水线出块
+	bool canPipelineOn(PrepareReq const& _req);
+	bool isPipelinedPrepare(PrepareReq const& _req) const;
+	void promotePipelinedPrepare();
 
 	Signature signHash(h256 const& _hash) const;
 	bool checkSign(u256 const& _idx, h256 const& _hash, Signature const& _sign) const;
 	bool checkSign(PBFTMsg const& _req) const;
 
 	// 广播消息
-	bool broadcastPrepareReq(BlockHeader const& _bi, bytes const& _block_data);
+	bool broadcastPrepareReq(BlockHeader const& _bi, bytes const& _block_data, bytes const& _exec_hint);
 	bool broadcastSignReq(PrepareReq const& _req);
 	bool broadcastCommitReq(PrepareReq const & _req);
 	bool broadcastViewChangeReq();
@@ -151,8 +159,8 @@ private:
 	bool isExistViewChange(ViewChangeReq const& _req);
 
 	void checkAndChangeView();
-	void checkAndCommit();
-	void checkAndSave();
+	void checkAndCommit(bool _recount = false);
+	void checkAndSave(bool _recount = false);
 
 	void handleFutureBlock();
 	void recvFutureBlock(u256 const& _from, PrepareReq const& _req);
@@ -191,6 +199,10 @@ private:
 
 	PrepareReq m_raw_prepare_cache;
 	PrepareReq m_prepare_cache;
+	PrepareReq m_next_raw_prepare_cache;  // 流水线出块：当前块上链前收到的下一块prepare
+	PrepareReq m_next_prepare_cache;
+	h256 m_pipeline_checked;  // 最近一次canPipelineOn检查的块
+	bool m_pipeline_allowed = false;
 	std::pair<u256, PrepareReq> m_future_prepare_cache;
 	std::unordered_map<h256, std::unordered_map<std::string, SignReq>> m_sign_cache;
 	std::unordered_map<h256, std::unordered_map<std::string, CommitReq>> m_commit_cache;
@@ -66,7 +66,6 @@ PBFTClient::PBFTClient(
 	init(_params, _host);
 
 	m_empty_block_flag = false;
-	m_exec_time_per_tx = 0;
 	m_last_exec_finish_time = utcTime();
 }
 
@@ -153,7 +152,7 @@ void PBFTClient::onTransactionQueueReady() {
 	}
 }
 
-void PBFTClient::syncTransactionQueue(u256 const& _max_block_txs)
+void PBFTClient::syncTransactionQueue(u256 const& _max_block_txs, uint64_t _budgetUs)
 {
 	TransactionReceipts newPendingReceipts;
 	//DEV_WRITE_GUARDED(x_working)
@@ -169,7 +168,7 @@ void PBFTClient::syncTransactionQueue(u256 const& _max_block_txs)
 			return;
 		}
 
-		tie(newPendingReceipts, m_syncTransactionQueue) = m_working.sync(bc(), m_tq, *m_gp, false, _max_block_txs);
+		tie(newPendingReceipts, m_syncTransactionQueue) = m_working.sync(bc(), m_tq, *m_gp, false, _max_block_txs, _budgetUs);
 	}
 	
 	if (!newPendingReceipts.empty())
@@ -188,7 +187,7 @@ void PBFTClient::executeTransaction()
 
 	//DEV_WRITE_GUARDED(x_working)
 	{
-		newPendingReceipts = m_working.exec(bc(), m_tq);
+		newPendingReceipts = m_working.exec(bc(), m_tq, m_execHint.txCount ? &m_execHint : nullptr);
 	}
 
 	if (newPendingReceipts.empty())
@@ -253,6 +252,7 @@ void PBFTClient::rejigSealing() {
 		{
 			uint64_t tx_num = 0;
 			bytes block_data;
+			bytes exec_hint;
 			u256 max_block_txs = m_maxBlockTranscations;
 			DEV_WRITE_GUARDED(x_working)
 			{
@@ -293,27 +293,25 @@ void PBFTClient::rejigSealing() {
 					left_time = static_cast<uint64_t>(sealEngine()->getIntervalBlockTime()) - passed_time;
 				}
 
-				if (m_exec_time_per_tx != 0) {
-					max_block_txs = static_cast<uint64_t>(left_time / m_exec_time_per_tx);
-					if (left_time > 0 && left_time < m_exec_time_per_tx) {
-						max_block_txs = 1; // 只要还有时间，至少尝试再打一条
-					}
-					if (max_block_txs > m_maxBlockTranscations) {
-						max_block_txs = m_maxBlockTranscations;
-					}
+				// 按各合约接口的历史执行耗时预测交易开销，打包到执行时间预算为止
+				uint64_t budget_us = static_cast<uint64_t>(left_time) * 1000;
+				if (m_params.packingTimeBudget && budget_us > static_cast<uint64_t>(m_params.packingTimeBudget) * 1000) {
+					budget_us = static_cast<uint64_t>(m_params.packingTimeBudget) * 1000;
 				}
+				uint64_t packed_us = PackingScheduler::instance().predict(m_working.pending());
 
-				VLOG(10) << "last_exec=" << last_exec_finish_time << ",passed_time=" << passed_time << ",left=" << left_time << ",max_block_txs=" << max_block_txs << ",tx_num=" << tx_num;
+				VLOG(10) << "last_exec=" << last_exec_finish_time << ",passed_time=" << passed_time << ",left=" << left_time << ",budget_us=" << budget_us << ",packed_us=" << packed_us << ",tx_num=" << tx_num;
 
 				bool t = true;
-				if (tx_num < max_block_txs && !isSyncing() && !m_remoteWorking && m_syncTransactionQueue.compare_exchange_strong(t, false)) {
-					syncTransactionQueue(max_block_txs);
+				if (tx_num < max_block_txs && packed_us < budget_us && !isSyncing() && !m_remoteWorking && m_syncTransactionQueue.compare_exchange_strong(t, false)) {
+					syncTransactionQueue(max_block_txs, budget_us - packed_us);
 				}
 
 				//DEV_WRITE_GUARDED(x_working)
 				{
 					tx_num = m_working.pending().size();
-					if (tx_num < max_block_txs && utcTime() - pbft()->lastConsensusTime() < sealEngine()->getIntervalBlockTime()) {
+					m_packedUs = PackingScheduler::instance().predict(m_working.pending());
+					if (tx_num < max_block_txs && m_packedUs < budget_us && utcTime() - pbft()->lastConsensusTime() < sealEngine()->getIntervalBlockTime()) {
 						VLOG(10) << "Wait for next interval, tx:" << tx_num;
 						return;
 					}
@@ -332,6 +330,13 @@ void PBFTClient::rejigSealing() {
 						m_working.resetCurrent();
 						return;
 					}
+
+					// 预测块内会冲突的交易，随PrepareReq下发，其他节点据此并行执行
+					m_execHint = ParallelExecHint();
+					if (sealEngine()->chainParams().parallelExec && tx_num > 1) {
+						m_execHint = ParallelExecutor::instance(sealEngine()->chainParams().parallelExecThreads).predict(m_working.pending());
+						exec_hint = m_execHint.rlp();
+					}
 				}
 				// sealed log
 				stringstream ss;
@@ -343,7 +348,7 @@ void PBFTClient::rejigSealing() {
 			LOG(INFO) << "+++++++++++++++++++++++++++ Generating seal on" << m_sealingInfo.hash(WithoutSeal) << "#" << m_sealingInfo.number() << "tx:" << tx_num << ",maxtx:" << max_block_txs << ",tq.num=" << m_tq.currentTxNum() << "time:" << utcTime();
 
 			u256 view = 0;
-			bool generate_ret = pbft()->generateSeal(m_sealingInfo, block_data, view);
+			bool generate_ret = pbft()->generateSeal(m_sealingInfo, block_data, view, exec_hint);
 
 			// 空块切换
 			if (generate_ret && tx_num == 0 && m_omit_empty_block) {
@@ -400,13 +405,9 @@ void PBFTClient::rejigSealing() {
 
 				m_last_exec_finish_time = utcTime();
 				if (tx_num != 0) {
-					auto exec_time_per_tx = (float)(m_last_exec_finish_time - start_exec_time) / tx_num;
-					m_exec_time_per_tx = (m_exec_time_per_tx + exec_time_per_tx) / 2;
-					if (m_exec_time_per_tx >= (float)sealEngine()->getIntervalBlockTime()) {
-						m_exec_time_per_tx = (float)sealEngine()->getIntervalBlockTime();
-					}
+					PackingScheduler::instance().noteBlock(m_packedUs, (m_last_exec_finish_time - start_exec_time) * 1000);
 				}
-				LOG(INFO) << "finish exec blk=" << m_sealingInfo.number() << ",finish_exec=" << m_last_exec_finish_time << ",per=" << m_exec_time_per_tx << ",tx_num=" << tx_num;
+				LOG(INFO) << "finish exec blk=" << m_sealingInfo.number() << ",finish_exec=" << m_last_exec_finish_time << ",predicted_us=" << m_packedUs << ",tx_num=" << tx_num;
 			}
 
 			DEV_READ_GUARDED(x_working)
@@ -428,10 +429,92 @@ void PBFTClient::rejigSealing() {
 				}
 			}
 
+		} else {
+			h256 parent;
+			if (pbft()->shouldPipelineSeal(parent)) { // 当前块等待commit期间，提前打包下一块
+				pipelineSeal(parent);
+			}
 		}
 	}
 }
 
+void PBFTClient::pipelineSeal(h256 const& _parent) {
+	auto cached = bc().getBlockCache(_parent);
+	if (cached.second == 0) {
+		LOG(INFO) << "pipelineSeal: parent not in block cache, hash=" << _parent.abridged();
+		return;
+	}
+
+	Block pipe(bc());
+	pipe.syncOnto(cached.first);
+	pipe.setAuthor(author());
+
+	// 流水线块在前一块commit期间打包，执行预算按一个出块间隔计，同样受packingTimeBudget限制
+	uint64_t budget_us = static_cast<uint64_t>(sealEngine()->getIntervalBlockTime()) * 1000;
+	if (m_params.packingTimeBudget && budget_us > static_cast<uint64_t>(m_params.packingTimeBudget) * 1000) {
+		budget_us = static_cast<uint64_t>(m_params.packingTimeBudget) * 1000;
+	}
+	pipe.sync(bc(), m_tq, *m_gp, false, m_maxBlockTranscations, budget_us);
+
+	uint64_t tx_num = pipe.pending().size();
+	if (tx_num == 0) { // 流水线不出空块
+		return;
+	}
+
+	pipe.resetCurrentTime();
+	pipe.setIndex(pbft()->nodeIdx());
+	pipe.setNodeList(pbft()->getMinerNodeList());
+	pipe.commitToSeal(bc(), m_extraData);
+
+	BlockHeader sealing_info = pipe.info();
+	RLPStream ts;
+	sealing_info.streamRLP(ts, WithoutSeal);
+	bytes block_data;
+	if (!pipe.sealBlock(&ts.out(), block_data)) {
+		LOG(ERROR) << "Error: pipelineSeal sealBlock failed 1";
+		return;
+	}
+
+	ParallelExecHint exec_hint;
+	if (sealEngine()->chainParams().parallelExec && tx_num > 1) {
+		exec_hint = ParallelExecutor::instance(sealEngine()->chainParams().parallelExecThreads).predict(pipe.pending());
+	}
+
+	LOG(INFO) << "+++++++++++++++++++++++++++ Generating pipelined seal on" << sealing_info.hash(WithoutSeal) << "#" << sealing_info.number() << "tx:" << tx_num << ",parent=" << _parent.abridged() << "time:" << utcTime();
+
+	u256 view = 0;
+	if (!pbft()->generateSeal(sealing_info, block_data, view, exec_hint.txCount ? exec_hint.rlp() : bytes())) {
+		return;
+	}
+
+	uint64_t packed_us = PackingScheduler::instance().predict(pipe.pending());
+	auto start_exec_time = utcTime();
+	try {
+		pipe.exec(bc(), m_tq, exec_hint.txCount ? &exec_hint : nullptr);
+	} catch (Exception &e) {
+		LOG(ERROR) << "pipelineSeal exec exception " << e.what();
+		return;
+	}
+	PackingScheduler::instance().noteBlock(packed_us, (utcTime() - start_exec_time) * 1000);
+
+	pipe.commitToSealAfterExecTx(bc());
+	bc().addBlockCache(pipe, pipe.info().difficulty());
+
+	sealing_info = pipe.info();
+	RLPStream ts2;
+	sealing_info.streamRLP(ts2, WithoutSeal);
+	if (!pipe.sealBlock(ts2.out())) {
+		LOG(ERROR) << "Error: pipelineSeal sealBlock failed 2";
+		return;
+	}
+
+	m_last_exec_finish_time = utcTime();
+	LOG(INFO) << "finish pipelined exec blk=" << sealing_info.number() << ",exec_time=" << (m_last_exec_finish_time - start_exec_time) << ",predicted_us=" << packed_us << ",budget_us=" << budget_us << ",tx_num=" << tx_num;
+
+	LOG(INFO) << "************************** Generating pipelined sign on" << sealing_info.hash(WithoutSeal) << "#" << sealing_info.number() << "tx:" << tx_num << "time:" << utcTime();
+	pbft()->generateCommit(sealing_info, pipe.blockData(), view);
+}
+
 bool PBFTClient::submitSealed(bytes const & _block, bool _isOurs) {
 	auto ret = m_bq.import(&_block, _isOurs);
 	LOG(DEBUG) << "PBFTClient::submitSealed m_bq.import return " << (unsigned)ret;
@@ -24,6 +24,8 @@
 #pragma once
 
 #include <libethereum/Client.h>
+#include <libethereum/ParallelExecutor.h>
+#include <libethereum/PackingScheduler.h>
 
 namespace dev
 {
@@ -63,17 +65,20 @@ protected:
 	void doWork(bool _doWait) override;
 	void rejigSealing() override;
 	void syncBlockQueue() override;
-	void syncTransactionQueue(u256 const& _max_block_txs);
+	void syncTransactionQueue(u256 const& _max_block_txs, uint64_t _budgetUs = 0);
 	void executeTransaction();
+	// 流水线出块：在尚未上链的父块上打包、执行下一块
+	void pipelineSeal(h256 const& _parent);
 	void onTransactionQueueReady() override;
 
 	bool submitSealed(bytes const & _block, bool _isOurs);
 
 private:
 	bool  m_empty_block_flag;
-	float m_exec_time_per_tx;
 	uint64_t m_last_exec_finish_time;
 	uint64_t m_left_time;
+	ParallelExecHint m_execHint;  // 本轮打包块的并行执行提示
+	uint64_t m_packedUs = 0;  // 本轮打包块的预测执行时间(us)
 
 	ChainParams m_params;
 };
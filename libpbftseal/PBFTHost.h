@@ -48,6 +48,9 @@ public:
 
 	void foreachPeer(std::function<bool(std::shared_ptr<PBFTPeer>)> const& _f) const;
 
+protected:
+	bool isConsensus() const override { return true; }
+
 private:
 	MsgHandler m_msg_handler;
 };
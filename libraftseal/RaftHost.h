@@ -49,6 +49,9 @@ public:
 
 	void foreachPeer(std::function<bool(std::shared_ptr<RaftPeer>)> const& _f) const;
 
+protected:
+	bool isConsensus() const override { return true; }
+
 private:
 	MsgHandler m_msg_handler;
 };
@@ -63,12 +63,23 @@ bool ChannelRPCServer::StartListening() {
 
 		_server->setEnableSSL(true);
 		_server->setBind(_listenAddr, _listenPort);
+		_server->setReadSize(_readSize);
+		_server->setWorkerThreads(_workerThreads);
 
 		std::function<void(dev::channel::ChannelException, dev::channel::ChannelSession::Ptr)> fp = std::bind(&ChannelRPCServer::onConnect, shared_from_this(), std::placeholders::_1, std::placeholders::_2);
 		_server->setConnectionHandler(fp);
 
 		_server->run();
 
+		//新块上链后推送事件订阅
+		std::weak_ptr<ChannelRPCServer> self = shared_from_this();
+		RPCallback::getInstance().setEventHandler([self](dev::eth::BlockChain const& bc, h256s const& liveBlocks) {
+			auto server = self.lock();
+			if (server) {
+				server->onChainChanged(bc, liveBlocks);
+			}
+		});
+
 #if 0
 		LOG(DEBUG) << "启动IO线程";
 		_serverThread = std::make_shared<std::thread>([ = ]() {
@@ -163,6 +174,7 @@ bool ChannelRPCServer::SendResponse(const std::string& _response, void* _addInfo
 }
 
 void dev::ChannelRPCServer::removeSession(int sessionID) {
+	std::lock_guard<std::mutex> lock(_sessionMutex);
 	auto it = _sessions.find(sessionID);
 
 	if (it != _sessions.end()) {
@@ -174,8 +186,11 @@ void ChannelRPCServer::onConnect(dev::channel::ChannelException e, dev::channel:
 	if (e.errorCode() == 0) {
 		LOG(INFO) << "channel收到新连接";
 
-		auto sessionID = ++_sessionCount;
-		_sessions.insert(std::make_pair(sessionID, session));
+		{
+			std::lock_guard<std::mutex> lock(_sessionMutex);
+			auto sessionID = ++_sessionCount;
+			_sessions.insert(std::make_pair(sessionID, session));
+		}
 
 		std::function<void(dev::channel::ChannelException, dev::channel::Message::Ptr)> fp =
 		    std::bind(&dev::ChannelRPCServer::onClientRequest,
@@ -194,10 +209,33 @@ void ChannelRPCServer::onConnect(dev::channel::ChannelException e, dev::channel:
 void ChannelRPCServer::onDisconnect(dev::channel::ChannelException e, dev::channel::ChannelSession::Ptr session) {
 	LOG(ERROR) << "移除该session: " << session->host() << ":" << session->port() << " 成功";
 
-	for (auto it : _sessions) {
-		if (it.second == session) {
-			_sessions.erase(it.first);
-			break;
+	{
+		std::lock_guard<std::mutex> lock(_sessionMutex);
+		for (auto it : _sessions) {
+			if (it.second == session) {
+				_sessions.erase(it.first);
+				break;
+			}
+		}
+	}
+
+	{
+		//取消该session的事件订阅
+		std::lock_guard<std::mutex> lock(_eventMutex);
+		bool changed = false;
+		for (auto it = _eventSubscriptions.begin(); it != _eventSubscriptions.end();) {
+			it->second.owners.erase(session);
+			if (it->second.owners.empty()) {
+				it = _eventSubscriptions.erase(it);
+				changed = true;
+			}
+			else {
+				++it;
+			}
+		}
+
+		if (changed) {
+			updateEventMatcher();
 		}
 	}
 
@@ -216,6 +254,9 @@ void dev::ChannelRPCServer::onClientRequest(dev::channel::ChannelSession::Ptr se
 		case 0x12://普通区块链请求
 			onClientEthereumRequest(session, message);
 			break;
+		case 0x14: //批量交易请求
+			onClientTransactionBatch(session, message);
+			break;
 		case 0x13: //心跳
 		{
 			std::string data((char*)message->data->data(), message->data->size());
@@ -237,6 +278,10 @@ void dev::ChannelRPCServer::onClientRequest(dev::channel::ChannelSession::Ptr se
 		case 0x32: //topic请求
 			onClientTopicRequest(session, message);
 			break;
+		case 0x33: //事件订阅请求
+		case 0x34: //取消事件订阅请求
+			onClientEventRequest(session, message);
+			break;
 		default:
 			LOG(ERROR) << "未知客户端消息类型: " << message->type;
 			break;
@@ -313,6 +358,56 @@ void dev::ChannelRPCServer::onClientEthereumRequest(dev::channel::ChannelSession
 	RPCallback::getInstance().parseAndSaveSession(body, message->seq, session);
 }
 
+/*
+ * 批量交易请求(0x14)包体：若干个 [4字节网络序长度][交易RLP]
+ * 响应(0x14，同seq)包体：按请求顺序，每笔交易 [1字节ImportResult][32字节交易hash]
+ * 包体格式错误时result为INVALID_TRANSACTION_BATCH，包体为空
+ * 导入成功的交易与0x12一样，上链后以0x1000推送回执
+ */
+void dev::ChannelRPCServer::onClientTransactionBatch(dev::channel::ChannelSession::Ptr session, dev::channel::Message::Ptr message) {
+	std::vector<bytesConstRef> transactions;
+	bytesConstRef data(message->data.get());
+	bool valid = true;
+
+	while (!data.empty()) {
+		if (data.size() < sizeof(uint32_t) || transactions.size() >= MAX_TRANSACTION_BATCH) {
+			valid = false;
+			break;
+		}
+
+		uint32_t length = ntohl(*((uint32_t*)data.data()));
+		if (length == 0 || data.size() - sizeof(uint32_t) < length) {
+			valid = false;
+			break;
+		}
+
+		transactions.push_back(data.cropped(sizeof(uint32_t), length));
+		data = data.cropped(sizeof(uint32_t) + length);
+	}
+
+	LOG(DEBUG) << "收到来自前置的批量交易请求 seq:" << message->seq << " 交易数:" << transactions.size() << " 格式:" << valid;
+
+	bytes response;
+	if (valid && !transactions.empty()) {
+		auto results = _client->injectTransactions(transactions);
+
+		response.reserve(results.size() * (1 + h256::size));
+		for (auto const& r : results) {
+			response.push_back((byte)r.first);
+			response.insert(response.end(), r.second.data(), r.second.data() + h256::size);
+
+			if (r.first == ImportResult::Success) {
+				RPCallback::getInstance().saveSession(r.second, message->seq, session);
+			}
+		}
+	}
+
+	message->result = valid ? 0 : INVALID_TRANSACTION_BATCH;
+	message->data->swap(response);
+
+	session->asyncSendMessage(message, dev::channel::ChannelSession::CallbackType(), 0);
+}
+
 void dev::ChannelRPCServer::onClientTopicRequest(dev::channel::ChannelSession::Ptr session, dev::channel::Message::Ptr message) {
 	LOG(DEBUG) << "收到来自SDK的topic请求";
 
@@ -348,6 +443,272 @@ void dev::ChannelRPCServer::onClientTopicRequest(dev::channel::ChannelSession::P
 	}
 }
 
+/*
+ * 事件订阅(0x33)包体：{"topic":"推送目的topic","filter":{格式同eth_newFilter}}
+ * filter中的fromBlock、toBlock忽略，只推送订阅之后上链的日志；topic与filter均相同的订阅共用一个filterID
+ * 响应(0x33，同seq)包体：{"filterID":"0x..."}，请求格式错误时result为INVALID_EVENT_SUBSCRIPTION，包体为空
+ * 取消订阅(0x34)包体：{"topic":"...","filterID":"0x..."}
+ * 响应(0x34，同seq)包体为空，该session未订阅时result为EVENT_SUBSCRIPTION_NOT_FOUND
+ * 连接断开时，该连接的订阅随之取消
+ *
+ * 新块上链后，节点在请求处理线程池中遍历一次块内日志，每条日志按地址、topic查订阅索引，匹配结果以0x35推送给关注该topic的所有session（topic需先以0x32注册）
+ * 推送包体与0x30相同：[1字节topic长度+1][topic][JSON]，JSON为[{"filterID":"0x...","logs":[同eth_getLogs]}, ...]
+ * 每个块、每个订阅一项，按上链顺序排列
+ */
+void dev::ChannelRPCServer::onClientEventRequest(dev::channel::ChannelSession::Ptr session, dev::channel::Message::Ptr message) {
+	std::string body(message->data->data(), message->data->data() + message->data->size());
+
+	LOG(DEBUG) << "收到来自SDK的事件订阅请求 seq:" << message->seq << " type:" << message->type << " 请求:" << body;
+
+	int result = 0;
+	std::string response;
+	try {
+		Json::Reader reader;
+		Json::Value root;
+		if (!reader.parse(body, root, false) || !root.isObject() || !root["topic"].isString()) {
+			throw dev::channel::ChannelException(INVALID_EVENT_SUBSCRIPTION, "非法事件订阅请求");
+		}
+
+		//推送时topic长度占1字节
+		std::string topic = root["topic"].asString();
+		if (topic.empty() || topic.size() > 254) {
+			throw dev::channel::ChannelException(INVALID_EVENT_SUBSCRIPTION, "非法topic:" + topic);
+		}
+
+		if (message->type == 0x33) {
+			LogFilter filter = toLogFilter(root["filter"]).withEarliest(EarliestBlockHash).withLatest(PendingBlockHash);
+			h256 filterID = filter.sha3();
+
+			std::lock_guard<std::mutex> lock(_eventMutex);
+			auto it = _eventSubscriptions.find(std::make_pair(topic, filterID));
+			if (it == _eventSubscriptions.end()) {
+				if (_eventSubscriptions.size() >= MAX_EVENT_SUBSCRIPTIONS) {
+					throw dev::channel::ChannelException(INVALID_EVENT_SUBSCRIPTION, "事件订阅数已达上限");
+				}
+
+				EventSubscription subscription;
+				subscription.topic = topic;
+				subscription.filterID = filterID;
+				subscription.filter = filter;
+
+				it = _eventSubscriptions.insert(std::make_pair(std::make_pair(topic, filterID), subscription)).first;
+				updateEventMatcher();
+			}
+			it->second.owners.insert(session);
+
+			Json::Value value;
+			value["filterID"] = toJS(filterID);
+			response = Json::FastWriter().write(value);
+
+			LOG(DEBUG) << "事件订阅成功 topic:" << topic << " filterID:" << filterID;
+		}
+		else {
+			h256 filterID = jsToFixed<32>(root["filterID"].asString());
+
+			std::lock_guard<std::mutex> lock(_eventMutex);
+			auto it = _eventSubscriptions.find(std::make_pair(topic, filterID));
+			if (it == _eventSubscriptions.end() || it->second.owners.erase(session) == 0) {
+				throw dev::channel::ChannelException(EVENT_SUBSCRIPTION_NOT_FOUND, "未找到事件订阅:" + toJS(filterID));
+			}
+
+			if (it->second.owners.empty()) {
+				_eventSubscriptions.erase(it);
+				updateEventMatcher();
+			}
+
+			LOG(DEBUG) << "取消事件订阅 topic:" << topic << " filterID:" << filterID;
+		}
+	}
+	catch (dev::channel::ChannelException &e) {
+		LOG(ERROR) << "事件订阅请求错误:" << e.what();
+		result = e.errorCode();
+	}
+	catch (exception &e) {
+		LOG(ERROR) << "解析事件订阅请求错误:" << e.what();
+		result = INVALID_EVENT_SUBSCRIPTION;
+	}
+
+	message->result = result;
+	message->data->assign(response.begin(), response.end());
+
+	session->asyncSendMessage(message, dev::channel::ChannelSession::CallbackType(), 0);
+}
+
+void dev::ChannelRPCServer::onChainChanged(dev::eth::BlockChain const& bc, h256s const& liveBlocks) {
+	{
+		std::lock_guard<std::mutex> lock(_eventMutex);
+		if (!_eventMatcher) {
+			return;
+		}
+
+		_eventBlocks.push_back(std::make_pair(&bc, liveBlocks));
+		if (_eventRunning) {
+			return;
+		}
+		_eventRunning = true;
+	}
+
+	//匹配和生成JSON不占用块导入线程
+	auto threadPool = _server ? _server->threadPool() : std::shared_ptr<dev::ThreadPool>();
+	if (!threadPool) {
+		pushEvents();
+		return;
+	}
+
+	auto self = shared_from_this();
+	threadPool->enqueue([self]() { self->pushEvents(); });
+}
+
+void dev::ChannelRPCServer::updateEventMatcher() {
+	if (_eventSubscriptions.empty()) {
+		_eventMatcher.reset();
+		return;
+	}
+
+	auto matcher = std::make_shared<EventMatcher>();
+	for (auto const& it : _eventSubscriptions) {
+		size_t index = matcher->subscriptions.size();
+
+		EventSubscription subscription;
+		subscription.topic = it.second.topic;
+		subscription.filterID = it.second.filterID;
+		subscription.filter = it.second.filter;
+		matcher->subscriptions.push_back(subscription);
+
+		auto const& filter = it.second.filter;
+		if (!filter.addresses().empty()) {
+			for (auto const& address : filter.addresses()) {
+				matcher->byAddress[address].push_back(index);
+			}
+			continue;
+		}
+
+		bool indexed = false;
+		for (unsigned i = 0; i < 4 && !indexed; ++i) {
+			if (!filter.topics()[i].empty()) {
+				for (auto const& topic : filter.topics()[i]) {
+					matcher->byTopic[i][topic].push_back(index);
+				}
+				indexed = true;
+			}
+		}
+
+		if (!indexed) {
+			matcher->matchAll.push_back(index);
+		}
+	}
+
+	_eventMatcher = matcher;
+}
+
+void dev::ChannelRPCServer::pushEvents() {
+	while (true) {
+		std::pair<dev::eth::BlockChain const*, h256s> blocks;
+		std::shared_ptr<const EventMatcher> matcher;
+		{
+			std::lock_guard<std::mutex> lock(_eventMutex);
+			if (_eventBlocks.empty() || !_eventMatcher) {
+				_eventBlocks.clear();
+				_eventRunning = false;
+				return;
+			}
+
+			blocks = _eventBlocks.front();
+			_eventBlocks.pop_front();
+			matcher = _eventMatcher;
+		}
+
+		//topic -> 推送内容
+		std::map<std::string, Json::Value> pushes;
+		for (h256 const& blockHash : blocks.second) {
+			try {
+				matchEvents(*blocks.first, blockHash, *matcher, pushes);
+			}
+			catch (exception &e) {
+				LOG(ERROR) << "匹配事件订阅错误:" << e.what();
+			}
+		}
+
+		Json::FastWriter fastWriter;
+		for (auto const& p : pushes) {
+			auto sessions = getSessionByTopic(p.first);
+			if (sessions.empty()) {
+				LOG(DEBUG) << "无session关注事件topic:" << p.first;
+				continue;
+			}
+
+			std::string json = fastWriter.write(p.second);
+
+			dev::channel::Message::Ptr message = make_shared<dev::channel::Message>();
+			message->type = 0x35;
+			message->seq = h128::random().hex();
+			message->result = 0;
+			message->data->reserve(1 + p.first.size() + json.size());
+			message->data->push_back((byte)(p.first.size() + 1));
+			message->data->insert(message->data->end(), p.first.begin(), p.first.end());
+			message->data->insert(message->data->end(), json.begin(), json.end());
+
+			for (auto const& session : sessions) {
+				session->asyncSendMessage(message, dev::channel::ChannelSession::CallbackType(), 0);
+			}
+
+			LOG(DEBUG) << "推送事件 topic:" << p.first << " session数:" << sessions.size();
+		}
+	}
+}
+
+void dev::ChannelRPCServer::matchEvents(dev::eth::BlockChain const& bc, h256 const& blockHash, EventMatcher const& matcher, std::map<std::string, Json::Value>& pushes) {
+	BlockReceipts receipts = bc.receipts(blockHash);
+	BlockNumber blockNumber = bc.number(blockHash);
+	h256s hashes;
+
+	//订阅下标 -> 匹配的日志，按订阅顺序输出
+	std::map<size_t, Json::Value> matched;
+
+	std::vector<size_t> candidates;
+	for (unsigned i = 0; i < receipts.receipts.size(); ++i) {
+		for (auto const& entry : receipts.receipts[i].log()) {
+			//每个订阅只挂在一处，候选不会重复
+			candidates = matcher.matchAll;
+
+			auto addressIt = matcher.byAddress.find(entry.address);
+			if (addressIt != matcher.byAddress.end()) {
+				candidates.insert(candidates.end(), addressIt->second.begin(), addressIt->second.end());
+			}
+
+			for (unsigned j = 0; j < entry.topics.size() && j < 4; ++j) {
+				auto topicIt = matcher.byTopic[j].find(entry.topics[j]);
+				if (topicIt != matcher.byTopic[j].end()) {
+					candidates.insert(candidates.end(), topicIt->second.begin(), topicIt->second.end());
+				}
+			}
+
+			for (size_t index : candidates) {
+				if (!matcher.subscriptions[index].filter.matches(entry)) {
+					continue;
+				}
+
+				if (hashes.empty()) {
+					hashes = bc.transactionHashes(blockHash);
+				}
+				h256 hash = i < hashes.size() ? hashes[i] : h256();
+
+				matched[index].append(toJson(LocalisedLogEntry(entry, blockHash, blockNumber, hash, i, 0, BlockPolarity::Live)));
+			}
+		}
+	}
+
+	for (auto const& m : matched) {
+		auto const& subscription = matcher.subscriptions[m.first];
+
+		Json::Value event;
+		event["filterID"] = toJS(subscription.filterID);
+		event["logs"] = m.second;
+
+		pushes[subscription.topic].append(event);
+	}
+}
+
 void dev::ChannelRPCServer::onClientChannelRequest(
     dev::channel::ChannelSession::Ptr session,
     dev::channel::Message::Ptr message) {
@@ -505,6 +866,7 @@ void dev::ChannelRPCServer::onNodeMessage(h512 nodeID, dev::channel::Message::Pt
 		//seq不存在，随机下发
 		LOG(DEBUG) << "无seq，PUSH消息";
 
+		std::lock_guard<std::mutex> sessionLock(_sessionMutex);
 		for (auto it : _sessions) {
 			if (it.second->actived()) {
 				it.second->asyncSendMessage(message, dev::channel::ChannelSession::CallbackType(), 0);
@@ -742,9 +1104,12 @@ dev::channel::ChannelSession::Ptr ChannelRPCServer::sendChannelMessageToSession(
 void ChannelRPCServer::updateHostTopics() {
 	std::shared_ptr<std::set<std::string> > allTopics = std::make_shared<std::set<std::string> >();
 
-	for (auto it : _sessions) {
-		auto topics = it.second->topics();
-		allTopics->insert(topics->begin(), topics->end());
+	{
+		std::lock_guard<std::mutex> lock(_sessionMutex);
+		for (auto it : _sessions) {
+			auto topics = it.second->topics();
+			allTopics->insert(topics->begin(), topics->end());
+		}
 	}
 
 	_host.lock()->setTopics(allTopics);
@@ -754,6 +1119,7 @@ std::vector<dev::channel::ChannelSession::Ptr> ChannelRPCServer::getSessionByTop
 	std::vector<dev::channel::ChannelSession::Ptr> activedSessions;
 
 	//找出该topic对应的session
+	std::lock_guard<std::mutex> lock(_sessionMutex);
 	for (auto it : _sessions) {
 		if (it.second->topics()->empty() || !it.second->actived()) {
 			continue;
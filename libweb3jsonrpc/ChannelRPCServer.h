@@ -26,6 +26,9 @@
 #include <string>
 #include <thread>
 #include <queue>
+#include <deque>
+#include <array>
+#include <unordered_map>
 #include <sys/un.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -45,7 +48,25 @@ public:
 	enum ChannelERRORCODE {
 		REMOTE_PEER_UNAVAILIBLE = 100,
 		REMOTE_CLIENT_PEER_UNAVAILBLE = 101,
-		TIMEOUT = 102
+		TIMEOUT = 102,
+		INVALID_TRANSACTION_BATCH = 105,
+		INVALID_EVENT_SUBSCRIPTION = 106,
+		EVENT_SUBSCRIPTION_NOT_FOUND = 107
+	};
+
+	//批量交易请求最多包含的交易数
+	static const size_t MAX_TRANSACTION_BATCH = 10000;
+
+	//节点上最多的事件订阅数
+	static const size_t MAX_EVENT_SUBSCRIPTIONS = 10000;
+
+	struct EventSubscription {
+		std::string topic; //推送目的topic
+		h256 filterID;
+		dev::eth::LogFilter filter;
+
+		//订阅该事件的session，全部取消订阅或断开后删除
+		std::set<dev::channel::ChannelSession::Ptr> owners;
 	};
 
 	struct ChannelMessageSession {
@@ -88,12 +109,21 @@ public:
 	//收到来自前置的区块链请求
 	void onClientEthereumRequest(dev::channel::ChannelSession::Ptr session, dev::channel::Message::Ptr message);
 
+	//收到来自前置的批量交易请求
+	void onClientTransactionBatch(dev::channel::ChannelSession::Ptr session, dev::channel::Message::Ptr message);
+
 	//来自前置的topic请求
 	void onClientTopicRequest(dev::channel::ChannelSession::Ptr session, dev::channel::Message::Ptr message);
 
 	//来自前置的链上链下二期请求
 	void onClientChannelRequest(dev::channel::ChannelSession::Ptr session, dev::channel::Message::Ptr message);
 
+	//来自前置的事件订阅、取消订阅请求
+	void onClientEventRequest(dev::channel::ChannelSession::Ptr session, dev::channel::Message::Ptr message);
+
+	//新块上链，在请求处理线程池中按事件订阅推送日志
+	void onChainChanged(dev::eth::BlockChain const& bc, h256s const& liveBlocks);
+
 	//收到来自其他节点的请求
 	void onNodeRequest(dev::h512 nodeID, std::shared_ptr<dev::bytes> message);
 
@@ -107,6 +137,10 @@ public:
 
 	void setListenPort(int listenPort);
 
+	void setReadSize(size_t readSize) { _readSize = readSize; };
+
+	void setWorkerThreads(unsigned workerThreads) { _workerThreads = workerThreads; };
+
 	void removeSession(int sessionID);
 
 	void CloseConnection(int _socket);
@@ -115,6 +149,8 @@ public:
 
 	void setHost(std::weak_ptr<EthereumHost> host);
 
+	void setClient(dev::eth::Interface* client) { _client = client; };
+
 private:
 	h512 sendChannelMessageToNode(std::string topic, dev::channel::Message::Ptr message, const std::set<h512> &exclude);
 
@@ -126,16 +162,38 @@ private:
 
 	std::string topicStrip(std::string topic);
 
+	//事件订阅按合约地址、topic建立的索引，每条日志只查一次索引；订阅变化时重建
+	struct EventMatcher {
+		std::vector<EventSubscription> subscriptions; //不含owners的副本，匹配时不持锁
+
+		//每个订阅只挂在一处：有address的按address，否则按第一个限定的topic位置，都没有的匹配全部日志
+		std::unordered_map<Address, std::vector<size_t> > byAddress;
+		std::array<std::unordered_map<h256, std::vector<size_t> >, 4> byTopic;
+		std::vector<size_t> matchAll;
+	};
+
+	//重建_eventMatcher，需持有_eventMutex
+	void updateEventMatcher();
+
+	//依次处理_eventBlocks中的块，同一时刻只在一个线程中执行，保证推送顺序
+	void pushEvents();
+
+	//匹配一个块的日志，结果按topic追加到pushes
+	void matchEvents(dev::eth::BlockChain const& bc, h256 const& blockHash, EventMatcher const& matcher, std::map<std::string, Json::Value>& pushes);
+
 	bool _running = false;
 
 	std::string _listenAddr;
 	int _listenPort;
+	size_t _readSize = dev::channel::ChannelSession::c_defaultReadSize;
+	unsigned _workerThreads = 0;
 	std::shared_ptr<boost::asio::io_service> _ioService;
 
 	std::shared_ptr<dev::channel::ChannelServer> _server;
 	std::shared_ptr<std::thread> _topicThread;
 
 	std::map<int, dev::channel::ChannelSession::Ptr> _sessions; //所有当前session，用于下发消息
+	std::mutex _sessionMutex; //session请求在线程池中处理，_sessions需加锁
 
 	std::map<std::string, dev::channel::ChannelSession::Ptr> _seq2session; //用于查找seq对应的回包
 	std::mutex _seqMutex;
@@ -143,11 +201,19 @@ private:
 	std::map<std::string, ChannelMessageSession> _seq2MessageSession; //用于查找链上链下消息2期的session
 	std::mutex _seqMessageMutex;
 
+	//(topic, filterID) -> 事件订阅
+	std::map<std::pair<std::string, h256>, EventSubscription> _eventSubscriptions;
+	std::shared_ptr<const EventMatcher> _eventMatcher; //无订阅时为空
+	std::deque<std::pair<dev::eth::BlockChain const*, h256s> > _eventBlocks; //待推送事件的块
+	bool _eventRunning = false;
+	std::mutex _eventMutex;
+
 	//std::map<std::string, h512> _seq2NodeID; //用于查找seq对应的nodeID
 
 	int _sessionCount = 1;
 
 	std::weak_ptr<EthereumHost> _host;
+	dev::eth::Interface* _client = nullptr;
 };
 
 }
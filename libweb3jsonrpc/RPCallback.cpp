@@ -102,26 +102,7 @@ bool RPCallback::parseAndSaveSession(const string& jsonReqStr, const string& seq
                 hash = sha3(tx_data);
             }
             
-            string hashStr = hash.hex();
-            if (hashStr.empty()) {
-                continue;
-            }
-            
-            unordered_map<std::string, SSPtr>::iterator it;
-            DEV_READ_GUARDED(x_sessionMap) {
-                it = m_hashSessionMap.find(hashStr);
-            }
-            
-            if (it != m_hashSessionMap.end()) {
-                continue;
-            } else {
-                SSPtr ssPtr = std::make_shared<SeqSessionInfo>();
-                ssPtr->seq = seq;
-                ssPtr->session = session;
-                DEV_WRITE_GUARDED(x_sessionMap) {
-                    m_hashSessionMap.emplace(hashStr, ssPtr);
-                }
-            }
+            saveSession(hash, seq, session);
         } catch(std::exception& e) {
             LOG(ERROR) << "parseAndSaveSession exception:" << e.what();
         } catch(...) {
@@ -132,94 +113,89 @@ bool RPCallback::parseAndSaveSession(const string& jsonReqStr, const string& seq
     return true;
 }
 
-SSPtr RPCallback::getSessionInfoByHash(std::string hash) {
-    unordered_map<std::string, SSPtr>::iterator it;
-    DEV_READ_GUARDED(x_sessionMap) {
-        it = m_hashSessionMap.find(hash);
-    }
-    
-    if (it == m_hashSessionMap.end()) {
-        return NULL;
-    } else {
-        SSPtr ptr = it->second;
-        DEV_WRITE_GUARDED(x_sessionMap) {
-            m_hashSessionMap.erase(it);
-        }
-        
-        return ptr;
+void RPCallback::saveSession(h256 const& hash, const string& seq, ChannelSession::Ptr session) {
+    SSPtr ssPtr = std::make_shared<SeqSessionInfo>();
+    ssPtr->seq = seq;
+    ssPtr->session = session;
+    DEV_WRITE_GUARDED(x_sessionMap) {
+        m_hashSessionMap.emplace(hash, ssPtr);
     }
 }
 
-CallbackWorker& CallbackWorker::getInstance() {
-    static CallbackWorker callbackWorker;
-    return callbackWorker;
-}
-
-void CallbackWorker::doWork() {
-    if (m_blocks.size() == 0) {
-        return;
-    }
+std::vector<std::pair<unsigned, SSPtr>> RPCallback::takeSessions(h256s const& _hashes) {
+    std::vector<std::pair<unsigned, SSPtr>> ret;
     
-    vector<std::shared_ptr<Block>> blocks;
-    
-    DEV_WRITE_GUARDED(x_block) {
-        blocks.swap(m_blocks);
+    DEV_READ_GUARDED(x_sessionMap) {
+        if (m_hashSessionMap.empty()) {
+            return ret;
+        }
     }
     
-    int size = blocks.size();
-    for(int i = 0; i < size; i++) {
-        shared_ptr<Block> pBlock = blocks[i];
-        checkIf(pBlock);
+    DEV_WRITE_GUARDED(x_sessionMap) {
+        for (unsigned i = 0; i < _hashes.size(); ++i) {
+            auto it = m_hashSessionMap.find(_hashes[i]);
+            if (it != m_hashSessionMap.end()) {
+                ret.push_back(std::make_pair(i, it->second));
+                m_hashSessionMap.erase(it);
+            }
+        }
     }
+    
+    return ret;
 }
 
-bool CallbackWorker::addBlock(shared_ptr<Block> _block) {
-    if (m_blocks.size() > MAX_SZIE) {
-        return false;
-    }
-    
-    DEV_WRITE_GUARDED(x_block) {
-        m_blocks.push_back(_block);
-    }
-    
-    return true;
+void RPCallback::setEventHandler(std::function<void(BlockChain const&, h256s const&)> const& _handler) {
+    Guard l(x_eventHandler);
+    m_eventHandler = _handler;
 }
 
-void CallbackWorker::checkIf(shared_ptr<Block> _block) {
-    if (!_block) {
-        return;
-    }
+void RPCallback::onChainChanged(BlockChain const& _bc, h256s const& _liveBlocks) {
+    std::map<ChannelSession::Ptr, std::vector<dev::channel::Message::Ptr>> pushes;
+    Json::FastWriter fastWriter;
     
-    unsigned blockNumber = (unsigned)_block->info().number();
-    h256 blockHash = _block->info().hash();
-    unsigned int index = 0;
-    
-    for (Transaction t : _block->pending()) {
-        
+    for (h256 const& blockHash : _liveBlocks) {
         try {
-            string hash = t.sha3().hex();
-            SSPtr ssPtr = RPCallback::getInstance().getSessionInfoByHash(hash);
-            if (ssPtr != NULL && ssPtr->session != NULL) {
+            h256s hashes = _bc.transactionHashes(blockHash);
+            auto sessions = takeSessions(hashes);
+            if (sessions.empty()) {
+                continue;
+            }
+            
+            BlockNumber blockNumber = _bc.number(blockHash);
+            BlockReceipts receipts = _bc.receipts(blockHash);
+            for (auto const& s : sessions) {
+                unsigned index = s.first;
+                if (!s.second->session || index >= receipts.receipts.size()) {
+                    continue;
+                }
+                
                 dev::channel::Message::Ptr message = make_shared<dev::channel::Message>();
-                message->seq = ssPtr->seq;
+                message->seq = s.second->seq;
                 message->result = 0;
                 message->type = 0x1000;//交易成功的type,跟java sdk保持一致
-                TransactionReceipt tr = _block->receipt(index);
-                Json::Value jsonValue = toJson(LocalisedTransactionReceipt(tr, t.sha3(), blockHash, blockNumber, index));
-                Json::FastWriter fastWriter;
+                Json::Value jsonValue = toJson(LocalisedTransactionReceipt(receipts.receipts[index], hashes[index], blockHash, blockNumber, index));
                 std::string jsonValueStr = fastWriter.write(jsonValue);
                 message->data->assign(jsonValueStr.begin(), jsonValueStr.end());
-                LOG(DEBUG) << "start to asyncSendMessage in CallbackWorker.hash:" << hash << ",receipt:" << jsonValueStr;
-                ssPtr->session->asyncSendMessage(message, dev::channel::ChannelSession::CallbackType(), 0);
+                LOG(DEBUG) << "push receipt.hash:" << hashes[index] << ",receipt:" << jsonValueStr;
+                
+                pushes[s.second->session].push_back(message);
             }
         } catch(std::exception& e) {
-            LOG(ERROR) << "CallbackWorker checkIf exception:" << e.what();
-            //add error log
+            LOG(ERROR) << "RPCallback onChainChanged exception:" << e.what();
         } catch(...) {
-            LOG(ERROR) << "CallbackWorker checkIf unknown exception";
+            LOG(ERROR) << "RPCallback onChainChanged unknown exception";
         }
-        
-        index++;
     }
     
-}
\ No newline at end of file
+    for (auto const& p : pushes) {
+        p.first->asyncSendMessages(p.second);
+    }
+    
+    std::function<void(BlockChain const&, h256s const&)> eventHandler;
+    DEV_GUARDED(x_eventHandler) {
+        eventHandler = m_eventHandler;
+    }
+    if (eventHandler && !_liveBlocks.empty()) {
+        eventHandler(_bc, _liveBlocks);
+    }
+}
@@ -28,9 +28,9 @@
 #include <condition_variable>
 #include <chrono>
 #include <unordered_map>
-#include <libethereum/Block.h>
+#include <functional>
+#include <libethereum/BlockChain.h>
 #include <libdevcore/Guards.h>
-#include <libdevcore/Worker.h>
 #include <libchannelserver/ChannelSession.h>
 #include <libweb3jsonrpc/AccountHolder.h>
 
@@ -56,35 +56,29 @@ namespace dev {
             //保存hash和session的映射
             bool parseAndSaveSession(const string& jsonReqStr, const string& seq, ChannelSession::Ptr session);
             
-            //查找session
-            SSPtr getSessionInfoByHash(std::string hash);
+            //保存单笔交易hash和session的映射，已存在则不覆盖
+            void saveSession(h256 const& hash, const string& seq, ChannelSession::Ptr session);
+            
+            //取出并移除_hashes中已订阅的交易，返回其在_hashes中的下标和session
+            std::vector<std::pair<unsigned, SSPtr>> takeSessions(h256s const& _hashes);
+            
+            //新块上链后由Client::onChainChanged调用，推送订阅交易的回执，同一session的回执合并为一次write
+            void onChainChanged(BlockChain const& _bc, h256s const& _liveBlocks);
+            
+            //设置新块上链后的事件订阅推送，由ChannelRPCServer设置
+            void setEventHandler(std::function<void(BlockChain const&, h256s const&)> const& _handler);
             
             //设置accountHolder,用到里面的密钥签名
             void setAccountHolder(AccountHolder* _ethAccounts) { m_ethAccounts = _ethAccounts;}
         private:
             RPCallback();
-            unordered_map<std::string, SSPtr> m_hashSessionMap;
+            unordered_map<h256, SSPtr> m_hashSessionMap;
             SharedMutex x_map;
             SharedMutex x_sessionMap;
+            std::function<void(BlockChain const&, h256s const&)> m_eventHandler;
+            Mutex x_eventHandler;
             AccountHolder* m_ethAccounts;
         };
-        
-        class CallbackWorker : public Worker {
-        public:
-            virtual ~CallbackWorker(){};
-            static const uint MAX_SZIE = 100;
-            static CallbackWorker& getInstance();
-            virtual void doWork() override;
-            bool addBlock(shared_ptr<Block> _block);
-        private:
-            CallbackWorker(): Worker("CallbackWorker", 20){
-                startWorking();
-            }
-            void checkIf(shared_ptr<Block> _block);
-            
-            vector<std::shared_ptr<Block>> m_blocks;
-            SharedMutex x_block;
-        };
     }
 }
 
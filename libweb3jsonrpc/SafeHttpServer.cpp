@@ -22,6 +22,7 @@
 
 #include <microhttpd.h>
 #include <sstream>
+#include <libdevcore/Metrics.h>
 #include "SafeHttpServer.h"
 #include "DfsFileServer.h"
 
@@ -70,12 +71,54 @@ bool SafeHttpServer::SendOptionsResponse(void* _addInfo)
 	return ret == MHD_YES;
 }
 
+int SafeHttpServer::sendMetrics(struct MHD_Connection* _connection)
+{
+	ostringstream out;
+	out << metrics::render();
+
+	// Queue sizes are sampled at scrape time.
+	if (m_eth)
+	{
+		eth::TransactionQueue::Status tq = m_eth->transactionQueueStatus();
+		metrics::writeHeader(out, "fisco_txqueue_transactions", "Transactions in the transaction queue by state", "gauge");
+		metrics::writeSample(out, "fisco_txqueue_transactions", "state=\"current\"", tq.current);
+		metrics::writeSample(out, "fisco_txqueue_transactions", "state=\"future\"", tq.future);
+		metrics::writeSample(out, "fisco_txqueue_transactions", "state=\"unverified\"", tq.unverified);
+		metrics::writeHeader(out, "fisco_txqueue_dropped", "Transactions dropped by the transaction queue", "gauge");
+		metrics::writeSample(out, "fisco_txqueue_dropped", "", tq.dropped);
+
+		eth::BlockQueueStatus bq = m_eth->blockQueueStatus();
+		metrics::writeHeader(out, "fisco_blockqueue_blocks", "Blocks in the block queue by state", "gauge");
+		metrics::writeSample(out, "fisco_blockqueue_blocks", "state=\"importing\"", bq.importing);
+		metrics::writeSample(out, "fisco_blockqueue_blocks", "state=\"verified\"", bq.verified);
+		metrics::writeSample(out, "fisco_blockqueue_blocks", "state=\"verifying\"", bq.verifying);
+		metrics::writeSample(out, "fisco_blockqueue_blocks", "state=\"unverified\"", bq.unverified);
+		metrics::writeSample(out, "fisco_blockqueue_blocks", "state=\"future\"", bq.future);
+		metrics::writeSample(out, "fisco_blockqueue_blocks", "state=\"unknown\"", bq.unknown);
+		metrics::writeSample(out, "fisco_blockqueue_blocks", "state=\"bad\"", bq.bad);
+
+		metrics::writeHeader(out, "fisco_block_number", "Number of the latest block on chain", "gauge");
+		metrics::writeSample(out, "fisco_block_number", "", m_eth->number());
+	}
+
+	string body = out.str();
+	struct MHD_Response *result = MHD_create_response_from_buffer(body.size(), static_cast<void *>(const_cast<char *>(body.c_str())), MHD_RESPMEM_MUST_COPY);
+	MHD_add_response_header(result, "Content-Type", "text/plain; version=0.0.4");
+	int ret = MHD_queue_response(_connection, MHD_HTTP_OK, result);
+	MHD_destroy_response(result);
+	return ret;
+}
+
 int SafeHttpServer::callback(void *cls, struct MHD_Connection *connection, const char *url, const char *method, const char *version, const char *upload_data, size_t *upload_data_size, void **con_cls) {
 	(void)version;
 	std::string account = "";
 	string strUrl(url);
 	string strMethod(method);
 
+	//Prometheus拉取指标，GET请求无需等待上传数据，直接应答
+	if (strMethod == "GET" && strUrl == "/metrics")
+		return static_cast<SafeHttpServer*>(static_cast<jsonrpc::HttpServer*>(cls))->sendMetrics(connection);
+
 	bool isFileProcess = DfsFileServer::getInstance()->filter(strUrl, strMethod) == 0;
 	//huanggaofeng: filter file process request
 	if (isFileProcess)
@@ -61,11 +61,14 @@ public:
         return dev::rpc::fs::DfsFileServer::request_completed;
     }
 private:
+	/// Answer "GET /metrics" with the node metrics in the Prometheus text format.
+	int sendMetrics(struct MHD_Connection* _connection);
+
 	std::string m_allowedOrigin;
 
 	std::string m_path_sslrootca;
 	std::string m_sslrootca;
-	eth::Client* m_eth;
+	eth::Client* m_eth = nullptr;
 	std::string m_DfsNodeGroupId;
 	std::string m_DfsNodeId;
 	std::string m_DfsStoragePath;